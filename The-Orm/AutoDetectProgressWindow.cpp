@@ -7,6 +7,8 @@
 #include "AutoDetectProgressWindow.h"
 
 #include "UIModel.h"
+#include "DetectionScheduler.h"
+#include "GenericAdaptation.h"
 
 AutoDetectProgressWindow::AutoDetectProgressWindow(std::vector<midikraft::SynthHolder> synths) :
 	ProgressHandlerWindow("Running auto-detection", "Detecting synth...")
@@ -34,8 +36,23 @@ void AutoDetectProgressWindow::run()
 			synths.push_back(synth.lock());
 		}
 	}
-	autodetector_.autoconfigure(synths, this);
+	// Probe all synths on all ports at once, rather than one after the other
+	std::vector<DetectionScheduler::Candidate> candidates;
+	for (auto const& synth : synths) {
+		auto candidate = DetectionScheduler::Candidate::fromDevice(synth);
+		if (auto adaptation = std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(synth)) {
+			// Learns how long the synth takes to answer, for a shorter wait next time
+			candidate.replied = [adaptation](double sentMs, double receivedMs) { adaptation->observeDeviceDetect(sentMs, receivedMs); };
+		}
+		candidates.push_back(candidate);
+	}
+	DetectionScheduler scheduler(DetectionScheduler::midiControllerTransport());
+	auto detections = scheduler.detect(candidates, this);
 	if (!shouldAbort()) {
+		DetectionScheduler::apply(synths, detections);
+		for (auto const& synth : synths) {
+			autodetector_.persistSetting(synth.get());
+		}
 		onSuccess();
 	}
 	else {
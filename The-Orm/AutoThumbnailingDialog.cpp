@@ -14,83 +14,47 @@
 
 
 AutoThumbnailingDialog::AutoThumbnailingDialog(PatchView &patchView, RecordingView &recordingView) : 
-	ThreadWithProgressWindow("Recording patch thumbnails", true, true), patchView_(patchView), recordingView_(recordingView)
+	ThreadWithProgressWindow("Recording patch thumbnails", true, true), patchView_(patchView), recordingView_(recordingView), patchSwitched_(false)
 {
 	UIModel::instance()->currentPatch_.addChangeListener(this);
-	UIModel::instance()->thumbnails_.addChangeListener(this);
 }
 
 AutoThumbnailingDialog::~AutoThumbnailingDialog()
 {
 	UIModel::instance()->currentPatch_.removeChangeListener(this);
-	UIModel::instance()->thumbnails_.removeChangeListener(this);
 }
 
-bool AutoThumbnailingDialog::syncSwitchToNextPatch() {
+std::string AutoThumbnailingDialog::sendNextPatch(bool first) {
 	// Select the next patch. This is asynchronous, because the database might need to load
 	patchSwitched_ = false;
 	PatchView *patchView = &patchView_;
-	MessageManager::callAsync([patchView]() {
-		patchView->selectNextPatch();
+	MessageManager::callAsync([patchView, first]() {
+		if (first) {
+			patchView->selectFirstPatch();
+		}
+		else {
+			patchView->selectNextPatch();
+		}
 	});
-	return waitForPatchSwitchAndSendToSynth();
+	if (!waitForPatchSwitchAndSendToSynth()) {
+		return {};
+	}
+	return UIModel::currentPatch().md5();
+}
+
+void AutoThumbnailingDialog::playNote() {
+	recordingView_.playTestNote();
 }
 
 bool AutoThumbnailingDialog::waitForPatchSwitchAndSendToSynth() {
-	WaitForEvent waiter1([this]() { return patchSwitched_;  }, this);
+	WaitForEvent waiter1([this]() { return patchSwitched_.load();  }, this);
 	waiter1.startThread();
 	if (!wait(1000)) {
 		waiter1.stopThread(1000);
 		// No more patches!
 		return false;
 	}
-
-	// Now, each synth needs a different amount of time to process the new patch and be able to play the first note with it
-	// let's use the detection interval as a hint
-	auto synth = UIModel::instance()->currentSynth_.smartSynth();
-	auto discoverableDevice = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(synth);
-	if (discoverableDevice) {
-		sleep(discoverableDevice->deviceDetectSleepMS());
-	}
-	return true;
-}
-
-bool AutoThumbnailingDialog::syncSwitchToFirstPatch() {
-	// Select the next patch. This is asynchronous, because the database might need to load
-	patchSwitched_ = false;
-	PatchView *patchView = &patchView_;
-	MessageManager::callAsync([patchView]() {
-		patchView->selectFirstPatch();
-	});
-	return waitForPatchSwitchAndSendToSynth();
-}
-
-
-bool AutoThumbnailingDialog::syncRecordThumbnail() {
-	// Record the current patch
-	thumbnailDone_ = false;
-	recordingView_.sampleNote();
-
-	// First check that we can actually record a signal, that should be quick
-	WaitForEvent waitingForSignal([&]() { return recordingView_.hasDetectedSignal(); }, this);
-	WaitForEvent waitingForDone([this]() { return thumbnailDone_; }, this);
-	waitingForSignal.startThread();
-	if (wait(5000)) {
-		waitingForDone.startThread();
-		if (wait(60000)) {
-			// What do we do in case of drones?
-		}
-		else {
-			waitingForDone.stopThread(1000);
-			spdlog::info("That was a never ending patch - you're sure you're not recording something else?");
-			return false;
-		}
-	}
-	else {
-		waitingForSignal.stopThread(1000);
-		spdlog::error("No patch could be recorded, please check the Audio setup in the AudioIn view!");
-		return false;
-	}
+	// The time the synth needs to process the new patch is now determined by the settle stage of the pipeline
 	return true;
 }
 
@@ -109,24 +73,26 @@ void AutoThumbnailingDialog::run()
 		return;
 	}
 
-	// Loop over all selected patches and record the thumbnails!
-	if (syncSwitchToFirstPatch()) {
-		int recordedCount = 1;
-		int toRecord = patchView_.totalNumberOfPatches();
-		while (!threadShouldExit()) {
-			// Record current patch
-			if (!syncRecordThumbnail()) {
-				break;
-			}
-
-			// Switch to next Patch
-			if (!syncSwitchToNextPatch()) {
-				// That didn't work, no more patches
-				break;
-			}
-
-			setProgress(recordedCount++ / (double)toRecord);
-		}
+	// Each synth needs a different amount of time to process the new patch and be able to play the first note with it.
+	// The detection interval is the upper bound, but we continue as soon as the audio has settled
+	ThumbnailPipeline::Options options;
+	options.maxSettleMs = location->deviceDetectSleepMS();
+	options.minSettleMs = std::min(options.minSettleMs, options.maxSettleMs);
+	options.encoderThreads = std::max(1, SystemStats::getNumCpus() / 2);
+
+	ThumbnailPipeline pipeline(options, recordingView_.captureInput(), *this,
+		[](std::string const& patchMd5) {
+			return UIModel::getPrehearDirectory().getChildFile(patchMd5 + ".wav");
+		},
+		[](std::string const&, File const&) {
+			// Thread safe, the listeners are called on the message thread
+			UIModel::instance()->thumbnails_.sendChangeMessage();
+		});
+
+	auto result = pipeline.run(patchView_.totalNumberOfPatches(), [this]() { return threadShouldExit(); }, [this](double progress) { setProgress(progress); });
+	spdlog::info("Recorded {} thumbnails, {} written to disk", result.recorded, result.encoded);
+	if (result.encodeFailed > 0) {
+		spdlog::error("Failed to write {} thumbnails, check the log above", result.encodeFailed);
 	}
 }
 
@@ -135,8 +101,4 @@ void AutoThumbnailingDialog::changeListenerCallback(ChangeBroadcaster* source)
 	if (source == &UIModel::instance()->currentPatch_) {
 		patchSwitched_ = true;
 	}
-	else if (source == &UIModel::instance()->thumbnails_) {
-		thumbnailDone_ = true;
-	}
 }
-
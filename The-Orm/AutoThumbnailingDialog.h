@@ -10,8 +10,9 @@
 
 #include "PatchView.h"
 #include "RecordingView.h"
+#include "ThumbnailPipeline.h"
 
-class AutoThumbnailingDialog : public ThreadWithProgressWindow, private ChangeListener {
+class AutoThumbnailingDialog : public ThreadWithProgressWindow, private ThumbnailPipeline::PatchDriver, private ChangeListener {
 public:
 	AutoThumbnailingDialog(PatchView &patchView, RecordingView &recordingView);
 	virtual ~AutoThumbnailingDialog() override;
@@ -19,15 +20,15 @@ public:
 	virtual void run() override;
 
 private:
-	bool syncSwitchToNextPatch();
+	// Implement ThumbnailPipeline::PatchDriver
+	std::string sendNextPatch(bool first) override;
+	void playNote() override;
+
 	bool waitForPatchSwitchAndSendToSynth();
-	bool syncSwitchToFirstPatch();
-	bool syncRecordThumbnail();
 	void changeListenerCallback(ChangeBroadcaster* source) override;
 
 	PatchView &patchView_;
 	RecordingView &recordingView_;
-	bool patchSwitched_;
-	bool thumbnailDone_;
+	std::atomic<bool> patchSwitched_;
 };
 
@@ -0,0 +1,164 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BatchedLogSink.h"
+
+#include <spdlog/fmt/fmt.h>
+
+LogMessageQueue::LogMessageQueue(size_t capacity) : enqueuePos_(0), dequeuePos_(0), dropped_(0)
+{
+	// Round up to a power of two so the position can be masked
+	size_t size = 2;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	mask_ = size - 1;
+	cells_ = std::make_unique<Cell[]>(size);
+	for (size_t i = 0; i < size; i++) {
+		cells_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+LogMessageQueue::~LogMessageQueue() = default;
+
+bool LogMessageQueue::push(spdlog::level::level_enum level, spdlog::log_clock::time_point time, spdlog::string_view_t text)
+{
+	size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+	for (;;) {
+		Cell& cell = cells_[pos & mask_];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		auto diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				cell.entry.level = level;
+				cell.entry.time = time;
+				cell.entry.text.assign(text.data(), text.size());
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0) {
+			// Full - the consumer has not caught up yet
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else {
+			pos = enqueuePos_.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+size_t LogMessageQueue::takeDropped()
+{
+	return dropped_.exchange(0, std::memory_order_relaxed);
+}
+
+bool LogMessageQueue::pop(Entry& out)
+{
+	Cell& cell = cells_[dequeuePos_ & mask_];
+	size_t sequence = cell.sequence.load(std::memory_order_acquire);
+	if ((intptr_t)sequence - (intptr_t)(dequeuePos_ + 1) < 0) {
+		return false;
+	}
+	// Swap instead of copy, so the cell keeps the string buffer of the previous round and producers rarely allocate
+	out.level = cell.entry.level;
+	out.time = cell.entry.time;
+	std::swap(out.text, cell.entry.text);
+	cell.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+	dequeuePos_++;
+	return true;
+}
+
+BatchedLogSink::BatchedLogSink(TLineHandler lineHandler, size_t capacity, size_t maxLinesPerDrain) :
+	lineHandler_(lineHandler), queue_(capacity), maxLinesPerDrain_(maxLinesPerDrain), hasPrevious_(false), repeats_(0)
+{
+}
+
+BatchedLogSink::~BatchedLogSink()
+{
+	stopTimer();
+}
+
+void BatchedLogSink::setLineHandler(TLineHandler lineHandler)
+{
+	lineHandler_ = lineHandler;
+}
+
+void BatchedLogSink::startDraining(int intervalMs)
+{
+	startTimer(intervalMs);
+}
+
+void BatchedLogSink::stopDraining()
+{
+	stopTimer();
+	drain(true);
+}
+
+void BatchedLogSink::sink_it_(const spdlog::details::log_msg& msg)
+{
+	queue_.push(msg.level, msg.time, msg.payload);
+}
+
+void BatchedLogSink::flush_()
+{
+	// NOP, the timer drains
+}
+
+void BatchedLogSink::timerCallback()
+{
+	drain();
+}
+
+size_t BatchedLogSink::drain(bool flushRepeats)
+{
+	if (!lineHandler_) {
+		return 0;
+	}
+	size_t lines = 0;
+	LogMessageQueue::Entry entry;
+	while (lines < maxLinesPerDrain_ && queue_.pop(entry)) {
+		lines++;
+		if (hasPrevious_ && entry.level == previous_.level && entry.text == previous_.text) {
+			repeats_++;
+			previous_.time = entry.time;
+			continue;
+		}
+		emitRepeats();
+		emit(entry);
+		std::swap(previous_, entry);
+		hasPrevious_ = true;
+	}
+
+	// A quiet tick ends a run of repeated lines, so the count shows up without waiting for the next different line
+	if (lines == 0 || flushRepeats) {
+		emitRepeats();
+	}
+
+	auto dropped = queue_.takeDropped();
+	if (dropped > 0) {
+		emitRepeats();
+		emit({ spdlog::level::warn, spdlog::log_clock::now(), fmt::format("Log overflow, {} lines dropped", dropped) });
+		hasPrevious_ = false;
+	}
+	return lines;
+}
+
+void BatchedLogSink::emit(LogMessageQueue::Entry const& entry)
+{
+	spdlog::details::log_msg msg(entry.time, spdlog::source_loc{}, spdlog::string_view_t(), entry.level, spdlog::string_view_t(entry.text.data(), entry.text.size()));
+	spdlog::memory_buf_t formatted;
+	formatter_->format(msg, formatted);
+	lineHandler_(entry.level, fmt::to_string(formatted));
+}
+
+void BatchedLogSink::emitRepeats()
+{
+	if (repeats_ > 0) {
+		emit({ previous_.level, previous_.time, fmt::format("Last message repeated {} times", repeats_) });
+		repeats_ = 0;
+	}
+}
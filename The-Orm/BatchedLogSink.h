@@ -0,0 +1,84 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/null_mutex.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Bounded multi producer, single consumer queue of log lines. Producers never block, when the queue is full the line is
+// dropped and counted instead.
+class LogMessageQueue {
+public:
+	struct Entry {
+		spdlog::level::level_enum level = spdlog::level::info;
+		spdlog::log_clock::time_point time;
+		std::string text;
+	};
+
+	explicit LogMessageQueue(size_t capacity);
+	~LogMessageQueue();
+
+	// Any thread
+	bool push(spdlog::level::level_enum level, spdlog::log_clock::time_point time, spdlog::string_view_t text);
+	size_t takeDropped();
+
+	// Consumer thread only
+	bool pop(Entry& out);
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		Entry entry;
+	};
+
+	std::unique_ptr<Cell[]> cells_;
+	size_t mask_;
+	alignas(64) std::atomic<size_t> enqueuePos_;
+	alignas(64) size_t dequeuePos_;
+	std::atomic<size_t> dropped_;
+};
+
+// spdlog sink that only enqueues on the logging thread. The formatting and the hand over to the UI happens in drain(), which a
+// timer calls in batches on the message thread. Identical consecutive lines are collapsed into a "repeated N times" line.
+//
+// Register it directly on the logger. Behind a dist_sink_mt every log call would take the distributor's mutex again.
+class BatchedLogSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>, private Timer {
+public:
+	typedef std::function<void(spdlog::level::level_enum level, std::string const& line)> TLineHandler;
+
+	BatchedLogSink(TLineHandler lineHandler, size_t capacity = 4096, size_t maxLinesPerDrain = 256);
+	~BatchedLogSink() override;
+
+	// Message thread. Without a line handler, drain() leaves the lines in the queue
+	void setLineHandler(TLineHandler lineHandler);
+	void startDraining(int intervalMs = 50);
+	void stopDraining();
+	size_t drain(bool flushRepeats = false);
+
+protected:
+	void sink_it_(const spdlog::details::log_msg& msg) override;
+	void flush_() override;
+
+private:
+	void timerCallback() override;
+	void emit(LogMessageQueue::Entry const& entry);
+	void emitRepeats();
+
+	TLineHandler lineHandler_;
+	LogMessageQueue queue_;
+	size_t maxLinesPerDrain_;
+	LogMessageQueue::Entry previous_;
+	bool hasPrevious_;
+	size_t repeats_;
+};
@@ -71,8 +71,8 @@ int MetaDataArea::getDesiredHeight(int width)
 	return static_cast<int>(desiredBounds.getHeight() + patchAsText_.desiredHeight() + 2 * LAYOUT_INSET_NORMAL);
 }
 
-CurrentPatchDisplay::CurrentPatchDisplay(midikraft::PatchDatabase &database, std::vector<CategoryButtons::Category> categories, std::function<void(std::shared_ptr<midikraft::PatchHolder>)> favoriteHandler) 
-	: Component(), database_(database)
+CurrentPatchDisplay::CurrentPatchDisplay(midikraft::PatchDatabase &database, ProgramLocationIndex &programLocations, std::vector<CategoryButtons::Category> categories, std::function<void(std::shared_ptr<midikraft::PatchHolder>, int edits)> favoriteHandler) 
+	: Component(), database_(database), programLocations_(programLocations)
 	, name_(0, false, [this](int) {
 		if (onCurrentPatchClicked) {
 			onCurrentPatchClicked(currentPatch_);
@@ -229,7 +229,7 @@ void CurrentPatchDisplay::setupPatchProperties(std::shared_ptr<midikraft::PatchH
 	}
 
 	std::string knownPositions;
-	auto alreadyInSynth = database_.getBankPositions(patch->smartSynth(), patch->md5());
+	auto alreadyInSynth = programLocations_.bankPositions(patch->smartSynth(), patch->md5());
 	for (auto const& pos : alreadyInSynth) {
 		if (!knownPositions.empty()) {
 			knownPositions += ", ";
@@ -276,7 +276,7 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 			if (currentPatch_) {
 				currentPatch_->setName(value.getValue().toString().toStdString());
 				setCurrentPatch(currentPatch_);
-				favoriteHandler_(currentPatch_);
+				favoriteHandler_(currentPatch_, PatchWriteQueue::Name);
 				return;
 			}
 			else {
@@ -293,7 +293,7 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 							layers->setLayerName((int) i, value.getValue().toString().toStdString());
 							currentPatch_->setName(currentPatch_->name()); // We need to refresh the name in the patch holder to match the name calculated from the 2 layers!
 							setCurrentPatch(currentPatch_);
-							favoriteHandler_(currentPatch_);
+							favoriteHandler_(currentPatch_, PatchWriteQueue::Name);
 							return;
 						}
 					}
@@ -309,7 +309,7 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 			if (currentPatch_) {
 				currentPatch_->setComment(value.getValue().toString().toStdString());
 				setCurrentPatch(currentPatch_);
-				favoriteHandler_(currentPatch_);
+				favoriteHandler_(currentPatch_, PatchWriteQueue::Text);
 				return;
 			}
 		}
@@ -317,7 +317,7 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 			if (currentPatch_) {
 				currentPatch_->setAuthor(value.getValue().toString().toStdString());
 				setCurrentPatch(currentPatch_);
-				favoriteHandler_(currentPatch_);
+				favoriteHandler_(currentPatch_, PatchWriteQueue::Text);
 				return;
 			}
 		}
@@ -325,7 +325,7 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 			if (currentPatch_) {
 				currentPatch_->setInfo(value.getValue().toString().toStdString());
 				setCurrentPatch(currentPatch_);
-				favoriteHandler_(currentPatch_);
+				favoriteHandler_(currentPatch_, PatchWriteQueue::Text);
 				return;
 			}
 		}
@@ -416,7 +416,7 @@ void CurrentPatchDisplay::buttonClicked(Button *button)
 				regular_.setToggleState(false, dontSendNotification);
 				currentPatch_->setRegular(false);
 			}
-			favoriteHandler_(currentPatch_);
+			favoriteHandler_(currentPatch_, PatchWriteQueue::Favorite);
 		}
 		else if (button == &hide_) {
 			currentPatch_->setHidden(hide_.getToggleState());
@@ -424,7 +424,7 @@ void CurrentPatchDisplay::buttonClicked(Button *button)
 				regular_.setToggleState(false, dontSendNotification);
 				currentPatch_->setRegular(false);
 			}
-			favoriteHandler_(currentPatch_);
+			favoriteHandler_(currentPatch_, PatchWriteQueue::Hidden | PatchWriteQueue::Favorite);
 		}
 		else if (button == &regular_) {
 			bool newState = regular_.getToggleState();
@@ -439,7 +439,7 @@ void CurrentPatchDisplay::buttonClicked(Button *button)
 					currentPatch_->setHidden(false);
 				}
 			}
-			favoriteHandler_(currentPatch_);
+			favoriteHandler_(currentPatch_, PatchWriteQueue::Favorite | PatchWriteQueue::Hidden);
 		}
 	}
 }
@@ -536,7 +536,7 @@ void CurrentPatchDisplay::categoryUpdated(CategoryButtons::Category clicked, Tou
 						spdlog::error("Can't set category {} as it is not stored in the database. Program error?", cat.category);
 					}
 				}
-				favoriteHandler_(currentPatch_);
+				favoriteHandler_(currentPatch_, PatchWriteQueue::Categories);
 				break;
 			}
 		}
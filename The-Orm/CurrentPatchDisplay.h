@@ -14,7 +14,9 @@
 #include "Patch.h"
 #include "PatchHolder.h"
 #include "PatchTextBox.h"
+#include "PatchWriteQueue.h"
 #include "PatchDatabase.h"
+#include "ProgramLocationIndex.h"
 #include "PropertyEditor.h"
 
 class MetaDataArea: public Component {
@@ -44,8 +46,9 @@ class CurrentPatchDisplay : public Component,
 {
 public:
 	CurrentPatchDisplay(midikraft::PatchDatabase &database,
+		ProgramLocationIndex &programLocations,
 		std::vector<CategoryButtons::Category>  categories, 
-		std::function<void(std::shared_ptr<midikraft::PatchHolder>)> favoriteHandler);
+		std::function<void(std::shared_ptr<midikraft::PatchHolder>, int edits)> favoriteHandler);
 	virtual ~CurrentPatchDisplay() override;
 
 	std::function<void(std::shared_ptr<midikraft::PatchHolder>)> onCurrentPatchClicked;
@@ -75,6 +78,7 @@ private:
 	virtual void valueChanged(Value& value) override; // This gets called when the property editor is used
 
 	midikraft::PatchDatabase &database_;
+	ProgramLocationIndex &programLocations_;
 	PatchButton name_;
 	PropertyEditor propertyEditor_;
 	String lastOpenState_;
@@ -84,7 +88,7 @@ private:
 	Viewport metaDataScroller_;
 	MetaDataArea metaData_;
 	
-	std::function<void(std::shared_ptr<midikraft::PatchHolder>)> favoriteHandler_;
+	std::function<void(std::shared_ptr<midikraft::PatchHolder>, int edits)> favoriteHandler_; // edits are PatchWriteQueue::Edits
 	std::shared_ptr<midikraft::PatchHolder> currentPatch_;
 
 	TypedNamedValueSet metaDataValues_;
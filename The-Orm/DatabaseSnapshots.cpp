@@ -0,0 +1,356 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseSnapshots.h"
+
+#include <SQLiteCpp/Backup.h>
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <sqlite3.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+	const int kBusyTimeoutMs = 5000;
+	// 4 MB per step with the default page size
+	const int kPagesPerStep = 1024;
+	const int kPauseMs = 10;
+	const char* kLatestMarker = "latest";
+
+	// Fixed width, so the names sort by time
+	std::string timestamp() {
+		auto now = std::chrono::system_clock::now();
+		auto seconds = std::chrono::system_clock::to_time_t(now);
+		auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+		std::tm local{};
+#ifdef _WIN32
+		localtime_s(&local, &seconds);
+#else
+		localtime_r(&seconds, &local);
+#endif
+		char buffer[32];
+		std::strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &local);
+		char result[40];
+		std::snprintf(result, sizeof(result), "%s-%03d", buffer, (int) millis);
+		return result;
+	}
+
+	// Identifies the state of one file without reading it, "-" if there is none
+	std::string fileState(std::filesystem::path const& file) {
+		std::error_code ec;
+		auto size = std::filesystem::file_size(file, ec);
+		if (ec) {
+			return "-";
+		}
+		auto modified = std::filesystem::last_write_time(file, ec);
+		return std::to_string(size) + "@" + std::to_string(ec ? 0 : (long long) modified.time_since_epoch().count());
+	}
+
+	// Every commit changes the database file in rollback journal mode, or the log in WAL mode
+	std::string databaseState(std::string const& databaseFile) {
+		return fileState(databaseFile) + " " + fileState(databaseFile + "-wal");
+	}
+
+	int64_t dataVersion(SQLite::Database& db) {
+		SQLite::Statement version(db, "PRAGMA data_version");
+		return version.executeStep() ? version.getColumn(0).getInt64() : -1;
+	}
+
+	bool sameContent(std::filesystem::path const& a, std::filesystem::path const& b) {
+		std::error_code ec;
+		auto size = std::filesystem::file_size(a, ec);
+		if (ec || size != std::filesystem::file_size(b, ec) || ec) {
+			return false;
+		}
+		std::ifstream first(a, std::ios::binary);
+		std::ifstream second(b, std::ios::binary);
+		std::vector<char> bufferA(1 << 20), bufferB(1 << 20);
+		while (first && second) {
+			first.read(bufferA.data(), bufferA.size());
+			second.read(bufferB.data(), bufferB.size());
+			if (first.gcount() != second.gcount() || !std::equal(bufferA.begin(), bufferA.begin() + first.gcount(), bufferB.begin())) {
+				return false;
+			}
+		}
+		return first.eof() && second.eof();
+	}
+
+}
+
+DatabaseSnapshots::DatabaseSnapshots(std::string const& databaseFile, size_t keep /* = 5 */, int quietMs /* = kQuietMs */) :
+	databaseFile_(databaseFile), keep_(std::max(keep, (size_t) 1)), quiet_(std::max(quietMs, 0)), cancel_(false)
+{
+	std::filesystem::path file(databaseFile);
+	auto directory = file.parent_path() / (file.stem().string() + "-snapshots");
+	directory_ = directory.string();
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	if (ec) {
+		spdlog::warn("Cannot create the snapshot directory {}: {}", directory_, ec.message());
+	}
+	// Copies that were interrupted by the end of the last session
+	for (auto const& entry : std::filesystem::directory_iterator(directory, ec)) {
+		if (entry.path().extension() == ".partial") {
+			std::filesystem::remove(entry.path(), ec);
+		}
+	}
+	thread_ = std::thread([this]() { run(); });
+}
+
+DatabaseSnapshots::~DatabaseSnapshots()
+{
+	cancel_ = true;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		stop_ = true;
+	}
+	changed_.notify_all();
+	thread_.join();
+}
+
+void DatabaseSnapshots::request(std::string const& reason)
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		requested_ = reason;
+	}
+	changed_.notify_all();
+}
+
+std::string DatabaseSnapshots::snapshotNow(std::string const& reason)
+{
+	try {
+		return take(reason);
+	}
+	catch (std::exception const& e) {
+		spdlog::error("Could not take a snapshot of the database: {}", e.what());
+		return "";
+	}
+}
+
+bool DatabaseSnapshots::upToDate()
+{
+	std::lock_guard<std::mutex> lock(copyLock_);
+	try {
+		return current();
+	}
+	catch (SQLite::Exception const&) {
+		return false;
+	}
+}
+
+std::vector<std::string> DatabaseSnapshots::snapshots() const
+{
+	std::vector<std::string> result;
+	std::error_code ec;
+	for (auto const& entry : std::filesystem::directory_iterator(directory_, ec)) {
+		if (entry.path().extension() == ".db3") {
+			result.push_back(entry.path().filename().string());
+		}
+	}
+	// The names start with the time they were taken
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+std::string DatabaseSnapshots::latest() const
+{
+	std::string name, databaseState;
+	return readMarker(name, databaseState) ? name : "";
+}
+
+bool DatabaseSnapshots::readMarker(std::string& name, std::string& databaseState) const
+{
+	std::ifstream marker(std::filesystem::path(directory_) / kLatestMarker);
+	if (!std::getline(marker, name) || !std::filesystem::exists(std::filesystem::path(directory_) / name)) {
+		return false;
+	}
+	// Markers of older versions have no state, they never match
+	if (!std::getline(marker, databaseState)) {
+		databaseState.clear();
+	}
+	return true;
+}
+
+bool DatabaseSnapshots::copy(SQLite::Database& source, std::string const& targetFile, int pagesPerStep, int pauseMs, std::atomic<bool> const& cancel)
+{
+	SQLite::Database target(targetFile, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	{
+		SQLite::Backup backup(target, source);
+		for (;;) {
+			if (cancel) {
+				return false;
+			}
+			if (backup.executeStep(pagesPerStep) == SQLITE_DONE) {
+				break;
+			}
+			// Also after SQLITE_BUSY, when a writer has the file locked
+			std::this_thread::sleep_for(std::chrono::milliseconds(pauseMs));
+		}
+	}
+	// The copy takes over WAL mode. Without it, a snapshot is complete in one file and restoring it is copying it back
+	target.exec("PRAGMA journal_mode = DELETE");
+	return true;
+}
+
+std::string DatabaseSnapshots::take(std::string const& reason)
+{
+	std::lock_guard<std::mutex> lock(copyLock_);
+	namespace fs = std::filesystem;
+	fs::path directory(directory_);
+	if (current()) {
+		return (directory / latest()).string();
+	}
+	// Before the copy starts, so a commit in between leads to one snapshot too many and not one too few
+	auto state = databaseState(databaseFile_);
+	auto version = dataVersion(*source_);
+
+	auto name = timestamp() + "-" + reason + ".db3";
+	while (fs::exists(directory / name)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		name = timestamp() + "-" + reason + ".db3";
+	}
+	auto partial = directory / (name + ".partial");
+
+	// In WAL mode a read transaction keeps the copy at one state of the database without blocking writers. Otherwise the
+	// backup starts over whenever another connection writes
+	bool readTransaction = false;
+	{
+		SQLite::Statement mode(*source_, "PRAGMA journal_mode");
+		if (mode.executeStep() && mode.getColumn(0).getString() == "wal") {
+			source_->exec("BEGIN");
+			source_->exec("SELECT count(*) FROM sqlite_master");
+			readTransaction = true;
+		}
+	}
+	bool complete = false;
+	try {
+		complete = copy(*source_, partial.string(), kPagesPerStep, kPauseMs, cancel_);
+	}
+	catch (...) {
+		if (readTransaction) {
+			source_->exec("ROLLBACK");
+		}
+		std::error_code ec;
+		fs::remove(partial, ec);
+		throw;
+	}
+	if (readTransaction) {
+		source_->exec("COMMIT");
+	}
+	if (!complete) {
+		std::error_code ec;
+		fs::remove(partial, ec);
+		return "";
+	}
+
+	// Nothing changed since a snapshot, e.g. of the last session, or one was restored. Newest first, the likeliest match.
+	// Different sizes are told apart without reading the files
+	auto existing = snapshots();
+	auto same = std::find_if(existing.rbegin(), existing.rend(), [&](std::string const& snapshot) { return sameContent(partial, directory / snapshot); });
+	if (same != existing.rend()) {
+		fs::remove(partial);
+		name = *same;
+	}
+	else {
+		fs::rename(partial, directory / name);
+		spdlog::info("Database snapshot {} taken", name);
+	}
+
+	// Replace the marker in one step, so it always names a complete snapshot
+	auto marker = directory / kLatestMarker;
+	auto markerUpdate = directory / (std::string(kLatestMarker) + ".partial");
+	{
+		std::ofstream out(markerUpdate, std::ios::trunc);
+		out << name << "\n" << state << "\n";
+	}
+	fs::rename(markerUpdate, marker);
+	snapshotVersion_ = version;
+	prune(name);
+	return (directory / name).string();
+}
+
+bool DatabaseSnapshots::current()
+{
+	if (!source_) {
+		source_ = std::make_unique<SQLite::Database>(databaseFile_, SQLite::OPEN_READONLY, kBusyTimeoutMs);
+	}
+	auto version = dataVersion(*source_);
+	if (snapshotVersion_ < 0) {
+		// A new session. The state is read after the version, so a commit in between doesn't go unnoticed
+		std::string name, takenState;
+		if (readMarker(name, takenState) && takenState == databaseState(databaseFile_)) {
+			snapshotVersion_ = version;
+		}
+	}
+	return snapshotVersion_ >= 0 && version == snapshotVersion_;
+}
+
+bool DatabaseSnapshots::settled()
+{
+	std::lock_guard<std::mutex> lock(copyLock_);
+	if (current()) {
+		return false;
+	}
+	auto version = dataVersion(*source_);
+	auto now = std::chrono::steady_clock::now();
+	if (version != seenVersion_) {
+		seenVersion_ = version;
+		seenAt_ = now;
+		return false;
+	}
+	return now - seenAt_ >= quiet_;
+}
+
+void DatabaseSnapshots::prune(std::string const& keepFile)
+{
+	auto existing = snapshots();
+	std::error_code ec;
+	size_t surplus = existing.size() > keep_ ? existing.size() - keep_ : 0;
+	for (size_t i = 0; i < existing.size() && surplus > 0; i++) {
+		if (existing[i] != keepFile) {
+			std::filesystem::remove(std::filesystem::path(directory_) / existing[i], ec);
+			surplus--;
+		}
+	}
+}
+
+void DatabaseSnapshots::run()
+{
+	// Looking for commits costs a PRAGMA
+	auto poll = std::clamp(quiet_ / 4, std::chrono::milliseconds(10), std::chrono::milliseconds(1000));
+	std::unique_lock<std::mutex> lock(lock_);
+	while (!stop_) {
+		changed_.wait_for(lock, poll, [this]() { return stop_ || !requested_.empty(); });
+		if (stop_) {
+			break;
+		}
+		auto reason = requested_;
+		requested_.clear();
+		lock.unlock();
+		try {
+			if (reason.empty() && settled()) {
+				reason = "changed";
+			}
+			if (!reason.empty()) {
+				take(reason);
+			}
+		}
+		catch (std::exception const& e) {
+			spdlog::warn("Background snapshot of the database failed: {}", e.what());
+		}
+		lock.lock();
+	}
+}
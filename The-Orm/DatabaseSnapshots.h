@@ -0,0 +1,88 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SQLite {
+	class Database;
+}
+
+// Backups of the database taken while the app runs, with SQLite's online backup API. The copy is made a few pages at a
+// time from a read-only connection, so neither the UI nor a writer waits for it, and in WAL mode the snapshot is consistent
+// as of its start.
+//
+// Snapshots go to "<name>-snapshots" next to the database file. A background thread takes one once something was committed
+// and the database has been quiet for a while, and on request. Nothing is copied when the database is closed - the database
+// is opened without the backup PatchDatabase makes on closing, and what was committed after the last snapshot goes into the
+// first one of the next session. A request when nothing was committed since the last snapshot copies nothing, a copy
+// identical to one of the snapshots kept is dropped in favour of that one, and only the newest ones are kept.
+//
+// The file "latest" names the last complete snapshot, and the size and modification time of the database files when it was
+// taken. If they are unchanged, a new session starts up to date without copying anything. In WAL mode, closing the database
+// moves the log into the database file, so the next session's background snapshot checks for a change by copying.
+class DatabaseSnapshots {
+public:
+	static const int kQuietMs = 5000;
+
+	// quietMs is how long after the last commit the background snapshot is taken
+	explicit DatabaseSnapshots(std::string const& databaseFile, size_t keep = 5, int quietMs = kQuietMs);
+	// Abandons a copy in progress
+	~DatabaseSnapshots();
+
+	// Takes a snapshot in the background
+	void request(std::string const& reason);
+
+	// Takes a snapshot on the calling thread. Returns its file, or an empty string if that failed
+	std::string snapshotNow(std::string const& reason);
+
+	// True if the latest snapshot has everything committed so far
+	bool upToDate();
+
+	// Oldest first
+	std::vector<std::string> snapshots() const;
+	std::string latest() const;
+	std::string directory() const { return directory_; }
+
+	// Copies the database of the source connection to the target file, pagesPerStep pages at a time with a pause in between.
+	// Returns false if cancelled
+	static bool copy(SQLite::Database& source, std::string const& targetFile, int pagesPerStep, int pauseMs, std::atomic<bool> const& cancel);
+
+private:
+	std::string take(std::string const& reason);
+	bool current();
+	bool settled();
+	bool readMarker(std::string& name, std::string& databaseState) const;
+	void prune(std::string const& keepFile);
+	void run();
+
+	std::string databaseFile_;
+	std::string directory_;
+	size_t keep_;
+	std::chrono::milliseconds quiet_;
+
+	std::mutex copyLock_; // Guards source_, the versions and the snapshot files
+	std::unique_ptr<SQLite::Database> source_;
+	int64_t snapshotVersion_ = -1;
+	int64_t seenVersion_ = -1;
+	std::chrono::steady_clock::time_point seenAt_;
+
+	std::mutex lock_;
+	std::condition_variable changed_;
+	std::string requested_;
+	bool stop_ = false;
+	std::atomic<bool> cancel_;
+	std::thread thread_;
+};
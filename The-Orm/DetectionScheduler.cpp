@@ -0,0 +1,355 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DetectionScheduler.h"
+
+#include "MidiController.h"
+#include "SimpleDiscoverableDevice.h"
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+	class MidiControllerTransport : public DetectionScheduler::Transport {
+	public:
+		~MidiControllerTransport() override {
+			stopListening();
+		}
+
+		std::vector<juce::MidiDeviceInfo> outputs() override {
+			auto set = midikraft::MidiController::instance()->currentOutputs(false);
+			return { set.begin(), set.end() };
+		}
+
+		void send(juce::MidiDeviceInfo const& output, std::vector<MidiMessage> const& messages) override {
+			if (auto midiOut = midikraft::MidiController::instance()->getMidiOutput(output)) {
+				midiOut->sendBlockOfMessagesFullSpeed(messages);
+			}
+		}
+
+		void startListening(TReplyHandler handler) override {
+			auto controller = midikraft::MidiController::instance();
+			for (auto const& input : controller->currentInputs(false)) {
+				controller->enableMidiInput(input);
+			}
+			handle_ = midikraft::MidiController::makeOneHandle();
+			controller->addMessageHandler(handle_, [handler](MidiInput* source, MidiMessage const& message) {
+				if (source && !message.isMidiClock() && !message.isActiveSense()) {
+					handler(source->getDeviceInfo(), message);
+				}
+			});
+		}
+
+		void stopListening() override {
+			if (!handle_.isNull()) {
+				midikraft::MidiController::instance()->removeMessageHandler(handle_);
+				handle_ = midikraft::MidiController::HandlerHandle();
+			}
+		}
+
+	private:
+		midikraft::MidiController::HandlerHandle handle_;
+	};
+
+	std::vector<int> channelsToProbe(DetectionScheduler::Candidate const& candidate) {
+		if (!candidate.channelSpecific) {
+			return { -1 };
+		}
+		std::vector<int> channels;
+		for (int channel = 0; channel < 16; channel++) {
+			channels.push_back(channel);
+		}
+		return channels;
+	}
+
+	int probeChannel(DetectionScheduler::Candidate const& candidate, DetectionScheduler::Detection const& detection) {
+		return candidate.channelSpecific ? detection.channel.toZeroBasedInt() : -1;
+	}
+
+	// The raw bytes of the probe, to tell which candidates can't be told apart by their probes
+	std::string probeBytes(DetectionScheduler::Candidate const& candidate, int channel) {
+		std::string bytes;
+		for (auto const& message : candidate.probe(channel)) {
+			bytes.append((const char*)message.getRawData(), (size_t)message.getRawDataSize());
+		}
+		return bytes;
+	}
+
+	// Position of a Universal Non-Realtime device inquiry (F0 7E <device> 06 01) in the probe, npos if there is none
+	size_t identityRequest(std::string const& probe, size_t from = 0) {
+		for (size_t pos = probe.find("\xf0\x7e", from); pos != std::string::npos; pos = probe.find("\xf0\x7e", pos + 1)) {
+			if (pos + 4 < probe.size() && probe[pos + 3] == '\x06' && probe[pos + 4] == '\x01') {
+				return pos;
+			}
+		}
+		return std::string::npos;
+	}
+
+	bool universalIdentityRequest(std::string const& probe) {
+		for (size_t pos = identityRequest(probe); pos != std::string::npos; pos = identityRequest(probe, pos + 1)) {
+			if (probe[pos + 2] == '\x7f') {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Two probes conflict if a synth answering one would also answer the other. Besides equal probes, an inquiry sent to all
+	// devices (device ID 7F) is answered by every synth that answers a device inquiry at all, whatever device ID it is addressed by
+	bool probesConflict(std::string const& a, std::string const& b) {
+		if (a == b) {
+			return true;
+		}
+		return (universalIdentityRequest(a) && identityRequest(b) != std::string::npos)
+			|| (universalIdentityRequest(b) && identityRequest(a) != std::string::npos);
+	}
+
+}
+
+DetectionScheduler::Candidate DetectionScheduler::Candidate::fromDevice(std::shared_ptr<midikraft::SimpleDiscoverableDevice> device)
+{
+	Candidate candidate;
+	candidate.name = device->getName();
+	candidate.channelSpecific = device->needsChannelSpecificDetection();
+	candidate.replyTimeoutMs = device->deviceDetectSleepMS();
+	candidate.probe = [device](int channel) { return device->deviceDetect(channel); };
+	candidate.identify = [device](MidiMessage const& message) { return device->channelIfValidDeviceResponse(message); };
+	MidiMessage endMessage;
+	if (device->endDeviceDetect(endMessage)) {
+		candidate.endProbe = [endMessage]() { return std::vector<MidiMessage>({ endMessage }); };
+	}
+	return candidate;
+}
+
+DetectionScheduler::DetectionScheduler(std::shared_ptr<Transport> transport) : transport_(transport)
+{
+}
+
+DetectionScheduler::~DetectionScheduler()
+{
+	transport_->stopListening();
+}
+
+std::shared_ptr<DetectionScheduler::Transport> DetectionScheduler::midiControllerTransport()
+{
+	return std::make_shared<MidiControllerTransport>();
+}
+
+std::vector<DetectionScheduler::Detection> DetectionScheduler::detect(std::vector<Candidate> const& candidates, midikraft::ProgressHandler* progressHandler)
+{
+	std::vector<Detection> result(candidates.size());
+	auto outputs = transport_->outputs();
+	if (candidates.empty() || outputs.empty()) {
+		return result;
+	}
+	startListening();
+
+	// First round - every candidate on every output, which tells us who is there, on which input and channel
+	std::vector<Probe> probes;
+	for (size_t c = 0; c < candidates.size(); c++) {
+		for (auto const& output : outputs) {
+			for (int channel : channelsToProbe(candidates[c])) {
+				probes.push_back({ c, output, channel });
+			}
+		}
+	}
+	if (progressHandler) progressHandler->setMessage(fmt::format("Probing {} synths on {} MIDI outputs...", candidates.size(), outputs.size()));
+	auto round = runRound(candidates, probes, progressHandler);
+
+	// Then bisect the outputs of the synths found, to find the first output that reaches them - just as probing them in order would.
+	// Synths with conflicting probes are bisected in separate rounds, as each would also answer the probes sent for the other
+	struct Search {
+		size_t candidate;
+		size_t low;
+		size_t high;
+		std::string probe;
+	};
+	std::vector<Search> searches;
+	for (size_t c = 0; c < candidates.size(); c++) {
+		if (auto reply = identifyFromReplies(candidates[c], round.replies, result[c])) {
+			timeReply(candidates[c], round, reply);
+			searches.push_back({ c, 0, outputs.size(), probeBytes(candidates[c], probeChannel(candidates[c], result[c])) });
+		}
+	}
+	int roundNo = 1;
+	int rounds = 1 + (int)std::ceil(std::log2((double)outputs.size()));
+	while (progressHandler == nullptr || !progressHandler->shouldAbort()) {
+		if (progressHandler) progressHandler->setProgressPercentage(std::min(roundNo / (double)rounds, 1.0));
+		probes.clear();
+		std::vector<Search*> bisecting;
+		for (auto& search : searches) {
+			bool conflicting = std::any_of(bisecting.begin(), bisecting.end(), [&search](Search const* other) { return probesConflict(search.probe, other->probe); });
+			if (search.high - search.low > 1 && !conflicting) {
+				int channel = probeChannel(candidates[search.candidate], result[search.candidate]);
+				size_t middle = search.low + (search.high - search.low) / 2;
+				for (size_t o = search.low; o < middle; o++) {
+					probes.push_back({ search.candidate, outputs[o], channel });
+				}
+				bisecting.push_back(&search);
+			}
+		}
+		if (probes.empty()) {
+			break;
+		}
+		round = runRound(candidates, probes, progressHandler);
+		for (auto search : bisecting) {
+			size_t middle = search->low + (search->high - search->low) / 2;
+			if (auto reply = repliedAgain(candidates[search->candidate], round.replies, result[search->candidate])) {
+				timeReply(candidates[search->candidate], round, reply);
+				search->high = middle;
+			}
+			else {
+				search->low = middle;
+			}
+		}
+		roundNo++;
+	}
+	for (auto const& search : searches) {
+		result[search.candidate].output = outputs[search.low];
+	}
+
+	transport_->stopListening();
+	for (auto const& candidate : candidates) {
+		if (candidate.endProbe) {
+			for (auto const& output : outputs) {
+				transport_->send(output, candidate.endProbe());
+			}
+		}
+	}
+	return result;
+}
+
+std::vector<DetectionScheduler::Detection> DetectionScheduler::detectSequentially(std::vector<Candidate> const& candidates, midikraft::ProgressHandler* progressHandler)
+{
+	std::vector<Detection> result(candidates.size());
+	auto outputs = transport_->outputs();
+	startListening();
+	for (size_t c = 0; c < candidates.size(); c++) {
+		auto const& candidate = candidates[c];
+		if (progressHandler) {
+			if (progressHandler->shouldAbort()) break;
+			progressHandler->setMessage(fmt::format("Trying to detect {}...", candidate.name));
+			progressHandler->setProgressPercentage(c / (double)candidates.size());
+		}
+		for (auto const& output : outputs) {
+			for (int channel : channelsToProbe(candidate)) {
+				auto round = runRound(candidates, { Probe{ c, output, channel } }, progressHandler);
+				if (auto reply = identifyFromReplies(candidate, round.replies, result[c])) {
+					timeReply(candidate, round, reply);
+					result[c].output = output;
+					break;
+				}
+			}
+			if (candidate.endProbe) {
+				transport_->send(output, candidate.endProbe());
+			}
+			if (result[c].found) {
+				break;
+			}
+		}
+	}
+	transport_->stopListening();
+	return result;
+}
+
+void DetectionScheduler::apply(std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> const& devices, std::vector<Detection> const& detections)
+{
+	jassert(devices.size() == detections.size());
+	for (size_t i = 0; i < devices.size() && i < detections.size(); i++) {
+		auto const& detection = detections[i];
+		if (detection.found) {
+			spdlog::info("Found {} on channel {} replying on device {} when sending to {}", devices[i]->getName(), detection.channel.toOneBasedInt(),
+				detection.input.name.toStdString(), detection.output.name.toStdString());
+			devices[i]->setCurrentChannelZeroBased(detection.input, detection.output, detection.channel.toZeroBasedInt());
+		}
+		else {
+			spdlog::info("No {} could be detected", devices[i]->getName());
+			devices[i]->setWasDetected(false);
+		}
+	}
+}
+
+void DetectionScheduler::sendProbe(Candidate const& candidate, Probe const& probe)
+{
+	auto messages = candidate.probe(probe.channel);
+	if (!messages.empty()) {
+		transport_->send(probe.output, messages);
+	}
+}
+
+void DetectionScheduler::startListening()
+{
+	transport_->startListening([this](juce::MidiDeviceInfo const& input, MidiMessage const& message) {
+		double now = Time::getMillisecondCounterHiRes();
+		std::lock_guard<std::mutex> lock(repliesMutex_);
+		replies_.push_back({ input, message, now });
+	});
+}
+
+DetectionScheduler::Round DetectionScheduler::runRound(std::vector<Candidate> const& candidates, std::vector<Probe> const& probes, midikraft::ProgressHandler* progressHandler)
+{
+	{
+		std::lock_guard<std::mutex> lock(repliesMutex_);
+		replies_.clear();
+	}
+	Round result;
+	result.sentMs = Time::getMillisecondCounterHiRes();
+	int timeoutMs = 0;
+	for (auto const& probe : probes) {
+		sendProbe(candidates[probe.candidate], probe);
+		timeoutMs = std::max(timeoutMs, candidates[probe.candidate].replyTimeoutMs);
+	}
+	// Wait for the slowest synth of this round only, but stay responsive to cancel
+	double deadline = Time::getMillisecondCounterHiRes() + timeoutMs;
+	for (double now = Time::getMillisecondCounterHiRes(); now < deadline; now = Time::getMillisecondCounterHiRes()) {
+		if (progressHandler && progressHandler->shouldAbort()) {
+			break;
+		}
+		Thread::sleep(std::clamp((int)(deadline - now), 1, 10));
+	}
+	std::lock_guard<std::mutex> lock(repliesMutex_);
+	result.replies.swap(replies_);
+	return result;
+}
+
+DetectionScheduler::Reply const* DetectionScheduler::identifyFromReplies(Candidate const& candidate, std::vector<Reply> const& replies, Detection& outDetection) const
+{
+	for (auto const& reply : replies) {
+		auto channel = candidate.identify(reply.message);
+		if (channel.isValid()) {
+			outDetection.found = true;
+			outDetection.input = reply.input;
+			outDetection.channel = channel;
+			return &reply;
+		}
+	}
+	return nullptr;
+}
+
+DetectionScheduler::Reply const* DetectionScheduler::repliedAgain(Candidate const& candidate, std::vector<Reply> const& replies, Detection const& detection) const
+{
+	// Only the synth found counts, another one of the same kind replies on its own input or on another channel
+	for (auto const& reply : replies) {
+		if (reply.input.identifier == detection.input.identifier) {
+			auto channel = candidate.identify(reply.message);
+			if (channel.isValid() && channel.toZeroBasedInt() == detection.channel.toZeroBasedInt()) {
+				return &reply;
+			}
+		}
+	}
+	return nullptr;
+}
+
+void DetectionScheduler::timeReply(Candidate const& candidate, Round const& round, Reply const* reply)
+{
+	if (candidate.replied && reply) {
+		candidate.replied(round.sentMs, std::max(reply->receivedMs, round.sentMs));
+	}
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "MidiChannel.h"
+#include "ProgressHandler.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace midikraft {
+	class SimpleDiscoverableDevice;
+}
+
+// Runs the device detection of many synths on many MIDI ports at the same time. Instead of probing one synth on one output and
+// waiting for its reply timeout before trying the next, all probes go out together and the replies are told apart by asking each
+// synth whether it recognizes them. A detection round therefore only takes as long as the longest timeout of the synths still
+// probed. As a reply tells on which input a synth sits but not which output reached it, the outputs of each detected synth are
+// then narrowed down by bisection, again for all synths at once, except those whose probes conflict - sharing a probe, or one
+// being the universal device inquiry the other synth answers as well.
+class DetectionScheduler {
+public:
+	// The MIDI ports to detect on. The default implementation uses the MidiController and all its currently available ports
+	class Transport {
+	public:
+		typedef std::function<void(juce::MidiDeviceInfo const& input, MidiMessage const& message)> TReplyHandler;
+
+		virtual ~Transport() = default;
+		virtual std::vector<juce::MidiDeviceInfo> outputs() = 0;
+		virtual void send(juce::MidiDeviceInfo const& output, std::vector<MidiMessage> const& messages) = 0;
+		virtual void startListening(TReplyHandler handler) = 0;
+		virtual void stopListening() = 0;
+	};
+
+	// What the scheduler needs to know about a synth to detect it
+	struct Candidate {
+		std::string name;
+		bool channelSpecific; // Probe each of the 16 channels separately
+		int replyTimeoutMs;
+		std::function<std::vector<MidiMessage>(int channel)> probe; // Channel is -1 if not channel specific
+		std::function<MidiChannel(MidiMessage const&)> identify; // Invalid channel if the reply is not from this synth
+		std::function<std::vector<MidiMessage>()> endProbe; // Optional, sent to the synth's output once it has been found
+		// Optional, told when a probe went out and when the synth's answer to it came in
+		std::function<void(double sentMs, double receivedMs)> replied;
+
+		static Candidate fromDevice(std::shared_ptr<midikraft::SimpleDiscoverableDevice> device);
+	};
+
+	struct Detection {
+		bool found = false;
+		juce::MidiDeviceInfo input;
+		juce::MidiDeviceInfo output;
+		MidiChannel channel = MidiChannel::invalidChannel();
+	};
+
+	explicit DetectionScheduler(std::shared_ptr<Transport> transport);
+	~DetectionScheduler();
+
+	static std::shared_ptr<Transport> midiControllerTransport();
+
+	// Both return one Detection per candidate, in the order given. The sequential version is the classic one probe at a time
+	// algorithm, kept as reference
+	std::vector<Detection> detect(std::vector<Candidate> const& candidates, midikraft::ProgressHandler* progressHandler);
+	std::vector<Detection> detectSequentially(std::vector<Candidate> const& candidates, midikraft::ProgressHandler* progressHandler);
+
+	// Stores the results in the devices, as the classic auto-detection did
+	static void apply(std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> const& devices, std::vector<Detection> const& detections);
+
+private:
+	struct Reply {
+		juce::MidiDeviceInfo input;
+		MidiMessage message;
+		double receivedMs; // When the transport delivered it, identifying it waits for the end of the round
+	};
+
+	struct Round {
+		std::vector<Reply> replies;
+		double sentMs; // When the first probe of the round went out - a reply might answer another candidate's probe
+	};
+
+	struct Probe {
+		size_t candidate;
+		juce::MidiDeviceInfo output;
+		int channel;
+	};
+
+	void sendProbe(Candidate const& candidate, Probe const& probe);
+	void startListening();
+	Round runRound(std::vector<Candidate> const& candidates, std::vector<Probe> const& probes, midikraft::ProgressHandler* progressHandler);
+	// The reply the candidate was found by, nullptr if none
+	Reply const* identifyFromReplies(Candidate const& candidate, std::vector<Reply> const& replies, Detection& outDetection) const;
+	// The synth detected answered once more, on the same input and channel. Its reply, nullptr if none
+	Reply const* repliedAgain(Candidate const& candidate, std::vector<Reply> const& replies, Detection const& detection) const;
+	// From the first probe of the round to the reply, which is the synth's latency or a little more
+	static void timeReply(Candidate const& candidate, Round const& round, Reply const* reply);
+
+	std::shared_ptr<Transport> transport_;
+	std::mutex repliesMutex_;
+	std::vector<Reply> replies_;
+};
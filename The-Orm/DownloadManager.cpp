@@ -0,0 +1,344 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DownloadManager.h"
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+// A synth may reply after the manager is gone. Its callbacks check under this lock, so the manager is either gone already or
+// stays until they return. Recursive, as a transfer may call done right away
+struct DownloadManager::Lifetime {
+	std::recursive_mutex lock;
+	bool alive = true;
+};
+
+class DownloadManager::JobProgress : public midikraft::ProgressHandler {
+public:
+	JobProgress(DownloadManager& manager, Job& job) : manager_(manager), job_(job), lifetime_(manager.lifetime_) {}
+
+	bool shouldAbort() const override;
+	void setProgressPercentage(double zeroToOne) override;
+	void onSuccess() override {}
+	void onCancel() override {}
+	void setMessage(std::string const& message) override;
+
+private:
+	DownloadManager& manager_;
+	Job& job_;
+	std::shared_ptr<Lifetime> lifetime_;
+};
+
+struct DownloadManager::Job {
+	int id = 0;
+	Download download;
+	State state = State::Queued;
+	size_t nextBank = 0;
+	int transferred = 0;
+	int processed = 0;
+	double transferProgress = 0.0;
+	std::string message;
+	std::unique_ptr<JobProgress> progress;
+
+	bool transferring() const { return state == State::Running && transferred < (int)download.banks.size(); }
+};
+
+class DownloadManager::ProcessJob : public ThreadPoolJob {
+public:
+	explicit ProcessJob(std::function<void()> work) : ThreadPoolJob("Process downloaded bank"), work_(std::move(work)) {}
+
+	JobStatus runJob() override {
+		work_();
+		return jobHasFinished;
+	}
+
+private:
+	std::function<void()> work_;
+};
+
+bool DownloadManager::JobProgress::shouldAbort() const
+{
+	std::lock_guard<std::recursive_mutex> alive(lifetime_->lock);
+	if (!lifetime_->alive) {
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(manager_.lock_);
+	return job_.state == State::Cancelled;
+}
+
+void DownloadManager::JobProgress::setProgressPercentage(double zeroToOne)
+{
+	std::lock_guard<std::recursive_mutex> alive(lifetime_->lock);
+	if (lifetime_->alive) {
+		std::lock_guard<std::mutex> lock(manager_.lock_);
+		job_.transferProgress = zeroToOne;
+	}
+}
+
+void DownloadManager::JobProgress::setMessage(std::string const& message)
+{
+	std::lock_guard<std::recursive_mutex> alive(lifetime_->lock);
+	if (lifetime_->alive) {
+		std::lock_guard<std::mutex> lock(manager_.lock_);
+		job_.message = message;
+	}
+}
+
+DownloadManager::DownloadManager() : nextId_(1), pendingProcessing_(0), lifetime_(std::make_shared<Lifetime>()), processing_(1)
+{
+}
+
+DownloadManager::~DownloadManager()
+{
+	cancelAll();
+	if (!waitUntilIdle(5000)) {
+		spdlog::warn("Shutting down with bank downloads still being processed");
+	}
+	std::lock_guard<std::recursive_mutex> alive(lifetime_->lock);
+	lifetime_->alive = false;
+}
+
+int DownloadManager::start(Download download)
+{
+	auto job = std::make_shared<Job>();
+	bool runNow = false;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		job->id = nextId_++;
+		job->download = std::move(download);
+		job->progress = std::make_unique<JobProgress>(*this, *job);
+		if (job->download.banks.empty()) {
+			job->state = State::Finished;
+		}
+		else {
+			runNow = !portBusy(job->download.port);
+			job->state = runNow ? State::Running : State::Queued;
+			job->message = runNow ? "Downloading..." : fmt::format("Waiting for port {}", job->download.port);
+		}
+		jobs_[job->id] = job;
+	}
+	changed_.notify_all();
+	if (job->state == State::Finished && job->download.finished) {
+		job->download.finished(false);
+	}
+	if (runNow) {
+		transferNext(job);
+	}
+	return job->id;
+}
+
+void DownloadManager::cancel(int id)
+{
+	std::shared_ptr<Job> job;
+	bool wasTransferring = false;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		auto found = jobs_.find(id);
+		if (found == jobs_.end() || found->second->state == State::Finished || found->second->state == State::Cancelled) {
+			return;
+		}
+		job = found->second;
+		wasTransferring = job->transferring();
+		job->state = State::Cancelled;
+		job->message = "Cancelled";
+		pendingProcessing_++;
+	}
+	spdlog::info("Cancelled download from {}", job->download.synthName);
+	if (wasTransferring && job->download.abortTransfer) {
+		job->download.abortTransfer();
+	}
+	// Queued behind the banks already handed to the processing thread, so finished is always the last call
+	processing_.addJob(new ProcessJob([this, job]() {
+		if (job->download.finished) {
+			job->download.finished(true);
+		}
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			pendingProcessing_--;
+		}
+		changed_.notify_all();
+	}), true);
+	if (wasTransferring) {
+		startNextOnPort(job->download.port);
+	}
+}
+
+void DownloadManager::cancelAll()
+{
+	std::vector<int> ids;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		for (auto const& [id, job] : jobs_) {
+			ids.push_back(id);
+		}
+	}
+	for (int id : ids) {
+		cancel(id);
+	}
+}
+
+std::vector<DownloadManager::Status> DownloadManager::status() const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	std::vector<Status> result;
+	for (auto const& [id, job] : jobs_) {
+		result.push_back({ id, job->download.synthName, job->state, (int)job->download.banks.size(), job->transferred, job->processed,
+			job->transferProgress, job->message });
+	}
+	return result;
+}
+
+void DownloadManager::clearDone()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	for (auto it = jobs_.begin(); it != jobs_.end(); ) {
+		if (it->second->state == State::Finished || it->second->state == State::Cancelled) {
+			it = jobs_.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+bool DownloadManager::isBusy() const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	return busy();
+}
+
+bool DownloadManager::waitUntilIdle(int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(lock_);
+	return changed_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !busy(); });
+}
+
+void DownloadManager::transferNext(std::shared_ptr<Job> job)
+{
+	MidiBankNumber bank = MidiBankNumber::invalid();
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (job->state != State::Running || job->nextBank >= job->download.banks.size()) {
+			return;
+		}
+		bank = job->download.banks[job->nextBank++];
+		job->transferProgress = 0.0;
+	}
+	job->download.transfer(bank, job->progress.get(), [this, lifetime = lifetime_, job, bank](std::vector<midikraft::PatchHolder> patches) {
+		std::lock_guard<std::recursive_mutex> alive(lifetime->lock);
+		if (lifetime->alive) {
+			bankTransferred(job, bank, std::move(patches));
+		}
+	});
+}
+
+void DownloadManager::bankTransferred(std::shared_ptr<Job> job, MidiBankNumber bank, std::vector<midikraft::PatchHolder> patches)
+{
+	bool transferComplete = false;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (job->state != State::Running) {
+			// Cancelled while the bank was on its way
+			return;
+		}
+		job->transferred++;
+		job->transferProgress = 0.0;
+		transferComplete = job->transferred == (int)job->download.banks.size();
+		pendingProcessing_++;
+	}
+	processing_.addJob(new ProcessJob([this, job, bank, patches = std::move(patches)]() mutable {
+		bankProcessed(job, bank, std::move(patches));
+	}), true);
+	if (transferComplete) {
+		// The port is free for the next synth, while our last bank is still being processed
+		startNextOnPort(job->download.port);
+	}
+	else {
+		transferNext(job);
+	}
+}
+
+void DownloadManager::bankProcessed(std::shared_ptr<Job> job, MidiBankNumber bank, std::vector<midikraft::PatchHolder> patches)
+{
+	bool cancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		cancelled = job->state == State::Cancelled;
+	}
+	if (!cancelled && job->download.process) {
+		try {
+			job->download.process(bank, std::move(patches));
+		}
+		catch (std::exception& e) {
+			spdlog::error("Failed to store bank downloaded from {}: {}", job->download.synthName, e.what());
+		}
+	}
+	bool finished = false;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (job->state == State::Running) {
+			job->processed++;
+			if (job->processed == (int)job->download.banks.size()) {
+				job->state = State::Finished;
+				job->message = fmt::format("Done, {} banks", job->processed);
+				finished = true;
+			}
+		}
+	}
+	if (finished && job->download.finished) {
+		job->download.finished(false);
+	}
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		pendingProcessing_--;
+	}
+	changed_.notify_all();
+}
+
+void DownloadManager::startNextOnPort(std::string const& port)
+{
+	std::shared_ptr<Job> next;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (portBusy(port)) {
+			return;
+		}
+		for (auto const& [id, job] : jobs_) {
+			if (job->state == State::Queued && job->download.port == port) {
+				next = job;
+				next->state = State::Running;
+				next->message = "Downloading...";
+				break;
+			}
+		}
+	}
+	if (next) {
+		transferNext(next);
+	}
+}
+
+bool DownloadManager::portBusy(std::string const& port) const
+{
+	for (auto const& [id, job] : jobs_) {
+		if (job->download.port == port && job->transferring()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool DownloadManager::busy() const
+{
+	if (pendingProcessing_ > 0) {
+		return true;
+	}
+	for (auto const& [id, job] : jobs_) {
+		if (job->state == State::Queued || job->state == State::Running) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,101 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "MidiBankNumber.h"
+#include "PatchHolder.h"
+#include "ProgressHandler.h"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Runs bank downloads from several synths at the same time, and pipelines each of them. As soon as a bank has been transferred,
+// the request for the next bank goes out while the bank just received is categorized and merged into the database on the
+// processing thread. Downloads from synths on the same MIDI port are queued, as their replies could not be told apart. All
+// processing happens on a single thread, so the database sees one writer at a time no matter how many synths are downloading.
+class DownloadManager {
+public:
+	typedef std::function<void(std::vector<midikraft::PatchHolder> patches)> TBankDone;
+	// Transfers one bank from the synth. Must call done exactly once, from any thread, unless the download was cancelled. done and
+	// the progress handler may still be called after the manager is gone, they do nothing then
+	typedef std::function<void(MidiBankNumber bank, midikraft::ProgressHandler* progress, TBankDone done)> TBankTransfer;
+	// Categorizes and stores one transferred bank, called on the processing thread
+	typedef std::function<void(MidiBankNumber bank, std::vector<midikraft::PatchHolder> patches)> TBankProcessor;
+
+	struct Download {
+		std::string synthName;
+		std::string port; // Downloads on the same port run one after the other
+		std::vector<MidiBankNumber> banks;
+		TBankTransfer transfer;
+		TBankProcessor process;
+		std::function<void()> abortTransfer; // Optional, called when a download is cancelled while transferring
+		std::function<void(bool cancelled)> finished; // Optional, called on the processing thread once all banks are processed or the download was cancelled
+	};
+
+	enum class State {
+		Queued,
+		Running,
+		Finished,
+		Cancelled
+	};
+
+	struct Status {
+		int id;
+		std::string synthName;
+		State state;
+		int banksTotal;
+		int banksTransferred;
+		int banksProcessed;
+		double transferProgress; // Of the bank currently being transferred
+		std::string message;
+	};
+
+	DownloadManager();
+	// Cancels all downloads and waits a while for the processing thread
+	~DownloadManager();
+
+	// Returns the id of the download, it starts right away if its port is free
+	int start(Download download);
+	void cancel(int id);
+	void cancelAll();
+
+	// One entry per download not yet cleared, in the order they were started
+	std::vector<Status> status() const;
+	void clearDone();
+	bool isBusy() const;
+
+	// For tests and shutdown
+	bool waitUntilIdle(int timeoutMs);
+
+private:
+	struct Job;
+	struct Lifetime;
+	class JobProgress;
+	class ProcessJob;
+
+	void transferNext(std::shared_ptr<Job> job);
+	void bankTransferred(std::shared_ptr<Job> job, MidiBankNumber bank, std::vector<midikraft::PatchHolder> patches);
+	void bankProcessed(std::shared_ptr<Job> job, MidiBankNumber bank, std::vector<midikraft::PatchHolder> patches);
+	void startNextOnPort(std::string const& port);
+	bool portBusy(std::string const& port) const;
+	bool busy() const;
+
+	mutable std::mutex lock_;
+	std::condition_variable changed_;
+	std::map<int, std::shared_ptr<Job>> jobs_;
+	int nextId_;
+	int pendingProcessing_;
+	std::shared_ptr<Lifetime> lifetime_; // Shared with the callbacks handed to the synths
+	ThreadPool processing_;
+};
@@ -0,0 +1,111 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DownloadProgressPanel.h"
+
+#include "LayoutConstants.h"
+
+#include <fmt/format.h>
+
+class DownloadProgressPanel::Row : public Component {
+public:
+	Row(DownloadManager& manager, int id) : progressBar_(progress_) {
+		addAndMakeVisible(name_);
+		addAndMakeVisible(progressBar_);
+		addAndMakeVisible(cancel_);
+		cancel_.setButtonText("Cancel");
+		cancel_.onClick = [&manager, id]() {
+			manager.cancel(id);
+		};
+	}
+
+	void update(DownloadManager::Status const& status) {
+		name_.setText(fmt::format("{}: {}", status.synthName, status.message), dontSendNotification);
+		switch (status.state) {
+		case DownloadManager::State::Queued:
+			progress_ = 0.0;
+			break;
+		case DownloadManager::State::Running:
+			// Transferred banks count fully, processing is fast compared to MIDI
+			progress_ = status.banksTotal > 0 ? (status.banksTransferred + status.transferProgress) / status.banksTotal : 0.0;
+			break;
+		case DownloadManager::State::Finished:
+			progress_ = 1.0;
+			break;
+		case DownloadManager::State::Cancelled:
+			break;
+		}
+		progressBar_.setTextToDisplay(fmt::format("{} of {} banks", status.banksProcessed, status.banksTotal));
+		cancel_.setEnabled(status.state == DownloadManager::State::Queued || status.state == DownloadManager::State::Running);
+	}
+
+	void resized() override {
+		auto area = getLocalBounds();
+		cancel_.setBounds(area.removeFromRight(LAYOUT_BUTTON_WIDTH).withTrimmedLeft(LAYOUT_INSET_NORMAL));
+		name_.setBounds(area.removeFromTop(area.getHeight() / 2));
+		progressBar_.setBounds(area);
+	}
+
+private:
+	double progress_ = 0.0;
+	Label name_;
+	ProgressBar progressBar_;
+	TextButton cancel_;
+};
+
+DownloadProgressPanel::DownloadProgressPanel(DownloadManager& manager) : manager_(manager)
+{
+	addAndMakeVisible(clearDone_);
+	clearDone_.setButtonText("Clear finished");
+	clearDone_.onClick = [this]() {
+		manager_.clearDone();
+		timerCallback();
+	};
+	addAndMakeVisible(empty_);
+	empty_.setText("No downloads running. Import banks from a synth to see their progress here.", dontSendNotification);
+	empty_.setJustificationType(Justification::centred);
+	startTimer(100);
+}
+
+DownloadProgressPanel::~DownloadProgressPanel()
+{
+	stopTimer();
+}
+
+void DownloadProgressPanel::resized()
+{
+	auto area = getLocalBounds().reduced(LAYOUT_INSET_NORMAL);
+	clearDone_.setBounds(area.removeFromBottom(LAYOUT_BUTTON_HEIGHT).removeFromRight(LAYOUT_BUTTON_WIDTH));
+	empty_.setBounds(area);
+	for (auto& [id, row] : rows_) {
+		row->setBounds(area.removeFromTop(2 * LAYOUT_LINE_HEIGHT));
+		area.removeFromTop(LAYOUT_INSET_NORMAL);
+	}
+}
+
+void DownloadProgressPanel::timerCallback()
+{
+	auto status = manager_.status();
+	bool layoutChanged = status.size() != rows_.size();
+	std::map<int, std::unique_ptr<Row>> rows;
+	for (auto const& download : status) {
+		auto existing = rows_.find(download.id);
+		if (existing != rows_.end()) {
+			rows[download.id] = std::move(existing->second);
+		}
+		else {
+			rows[download.id] = std::make_unique<Row>(manager_, download.id);
+			addAndMakeVisible(*rows[download.id]);
+			layoutChanged = true;
+		}
+		rows[download.id]->update(download);
+	}
+	rows_ = std::move(rows);
+	empty_.setVisible(rows_.empty());
+	if (layoutChanged) {
+		resized();
+	}
+}
@@ -0,0 +1,34 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "DownloadManager.h"
+
+#include <map>
+#include <memory>
+
+// Non-modal overview of the running bank downloads, one row with progress and cancel button per synth
+class DownloadProgressPanel : public Component, private Timer
+{
+public:
+	explicit DownloadProgressPanel(DownloadManager& manager);
+	virtual ~DownloadProgressPanel() override;
+
+	virtual void resized() override;
+
+private:
+	class Row;
+
+	virtual void timerCallback() override;
+
+	DownloadManager& manager_;
+	std::map<int, std::unique_ptr<Row>> rows_;
+	TextButton clearDone_;
+	Label empty_;
+};
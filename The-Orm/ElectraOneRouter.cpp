@@ -10,12 +10,22 @@
 
 #include "Logger.h"
 
+namespace {
+	const char* const kElectraOneInput = "Electra Controller";
+	const int kRoutingCheckMs = 500;
+}
+
 ElectraOneRouter::ElectraOneRouter() : enabled_(false)
 {
+	UIModel::instance()->currentSynth_.addChangeListener(this);
+	midikraft::MidiController::instance()->addChangeListener(this);
 }
 
 ElectraOneRouter::~ElectraOneRouter()
 {
+	stopTimer();
+	midikraft::MidiController::instance()->removeChangeListener(this);
+	UIModel::instance()->currentSynth_.removeChangeListener(this);
 	// Delete message handler, in case it was created
 	if (!routerCallback_.isNull()) {
 		midikraft::MidiController::instance()->removeMessageHandler(routerCallback_);
@@ -27,21 +37,13 @@ void ElectraOneRouter::enable(bool enabled)
 	if (enabled) {
 		enabled_ = true;
 		if (routerCallback_.isNull()) {
-			// Install handler
+			// Install handler. This only executes the precompiled routing table, see rebuildRouting()
 			routerCallback_ = midikraft::MidiController::makeOneHandle();
-			midikraft::MidiController::instance()->addMessageHandler(routerCallback_, [](MidiInput *source, MidiMessage const &message) {
-				if (source->getName() == "Electra Controller") {
-					auto toWhichSynthToForward = UIModel::currentSynth();
-					if (toWhichSynthToForward) {
-						auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(toWhichSynthToForward);
-						if (location) {
-							// Check if this is a channel message, and if yes, re-channel to the current synth
-							MidiMessage channelMessage = message;
-							if (message.getChannel() != 0) {
-								channelMessage.setChannel(location->channel().toOneBasedInt());
-							}
-							midikraft::MidiController::instance()->getMidiOutput(location->midiOutput())->sendMessageNow(channelMessage);
-						}
+			midikraft::MidiController::instance()->addMessageHandler(routerCallback_, [this](MidiInput *source, MidiMessage const &message) {
+				MidiRouter::Snapshot routing(router_);
+				if (routing) {
+					if (auto route = routing->findSource(source)) {
+						routing->forward(*route, message);
 					}
 				}
 			});
@@ -56,4 +58,44 @@ void ElectraOneRouter::enable(bool enabled)
 		//midikraft::MidiController::instance()->disableMidiInput("Electra Controller");
 		//SimpleLogger::instance()->postMessage("Turning off USB input Electra Controller");
 	}
+	rebuildRouting();
+}
+
+void ElectraOneRouter::rebuildRouting()
+{
+	auto table = std::make_unique<MidiRoutingTable>();
+	if (enabled_) {
+		auto toWhichSynthToForward = UIModel::instance()->currentSynth_.smartSynth();
+		if (toWhichSynthToForward) {
+			auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(toWhichSynthToForward);
+			if (location) {
+				// Channel messages are re-channeled to the current synth
+				int source = table->addSource(kElectraOneInput);
+				auto output = midikraft::MidiController::instance()->getMidiOutput(location->midiOutput());
+				table->addDestination(source, std::make_shared<SafeMidiOutputRoute>(output), location->channel().toOneBasedInt());
+				table->dependOn([location]() { return location->midiOutput().identifier + "/" + String(location->channel().toOneBasedInt()); });
+			}
+		}
+	}
+	router_.publish(std::move(table));
+	// Nobody tells when the Setup view or the auto-detection move the synth to another output or channel
+	if (enabled_) {
+		startTimer(kRoutingCheckMs);
+	}
+	else {
+		stopTimer();
+	}
+}
+
+void ElectraOneRouter::timerCallback()
+{
+	if (router_.outdated()) {
+		rebuildRouting();
+	}
+}
+
+void ElectraOneRouter::changeListenerCallback(ChangeBroadcaster* source)
+{
+	ignoreUnused(source);
+	rebuildRouting();
 }
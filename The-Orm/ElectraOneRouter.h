@@ -7,16 +7,22 @@
 #pragma once
 
 #include "MidiController.h"
+#include "MidiRoutingTable.h"
 
-class ElectraOneRouter {
+class ElectraOneRouter : private ChangeListener, private Timer {
 public:
 	ElectraOneRouter();
-	virtual ~ElectraOneRouter();
+	virtual ~ElectraOneRouter() override;
 
 	void enable(bool enabled);
 
 private:
+	void rebuildRouting();
+	void changeListenerCallback(ChangeBroadcaster* source) override; // The current synth or the MIDI devices changed
+	void timerCallback() override; // The output or channel of the current synth changed
+
 	bool enabled_;
+	MidiRouter router_;
 	midikraft::MidiController::HandlerHandle routerCallback_ = midikraft::MidiController::makeNoneHandle();
 };
 
@@ -30,6 +30,7 @@ const char *kInputDeviceSettingKey = "MIDI Input Device Name";
 const char *kMidiChannel = "MIDI channel";
 const char *kLowestNote = "Lowest MIDI Note";
 const char *kHighestNote = "Highest MIDI Note";
+const int kRoutingCheckMs = 500;
 
 
 class KeyboardMacroView::RecordProgress : private MidiKeyboardStateListener {
@@ -113,6 +114,7 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 						macros_[event] = newMacro;
 						saveSettings();
 						refreshUI();
+						rebuildRouting();
 					}
 					activeRecorder_ = nullptr;
 					}
@@ -135,73 +137,43 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 
 		UIModel::instance()->currentSynth_.addChangeListener(this);
 	}
+	UIModel::instance()->currentPatch_.addChangeListener(this);
 
-	// Install keyboard handler to refresh midi keyboard display
+	// Install keyboard handler to refresh midi keyboard display. The routing is precompiled by rebuildRouting(), this is called for every
+	// incoming message and must stay lean - no allocation, no locks, no lookups in the UIModel
 	midikraft::MidiController::instance()->addMessageHandler(handle_, [this](MidiInput *source, MidiMessage const &message) {
-		if (source && source->getName().toStdString() == customMasterkeyboardSetup_.typedNamedValueByName(kInputDevice)->lookupValue()) {
-			int forwardMode = customMasterkeyboardSetup_.valueByName(kRouteMasterkeyboard).getValue();
-			if (forwardMode == 2 || forwardMode == 3 || forwardMode == 4) {
-				std::shared_ptr<midikraft::Synth> toWhichSynthToForward;
-				if (forwardMode == 4) {
-					// Fixed synth routing, that means, don't take away my master keyboard while I select a patch for a different synth
-					auto selectedSynth = customMasterkeyboardSetup_.typedNamedValueByName(kFixedSynthSelected)->lookupValue();
-					for (auto s : UIModel::instance()->synthList_.activeSynths()) {
-						if (s->getName() == selectedSynth) {
-							toWhichSynthToForward = std::dynamic_pointer_cast<midikraft::Synth>(s);
-						}
-					}
-				}
-				else if (forwardMode == 3) {
-					// We want to route all events from the master keyboard to the synth of the current patch, so we can play it!
-					// Forward to the synth of the current patch
-					auto currentPatch = UIModel::currentPatch();
-					if (currentPatch.patch()) {
-						toWhichSynthToForward = currentPatch.smartSynth();
-					}
-				}
-				if (forwardMode == 2 || !toWhichSynthToForward) {
-					// Forward to the synth selected in the top row
-					toWhichSynthToForward = UIModel::instance()->currentSynth_.smartSynth();
-				}
-				if (toWhichSynthToForward) {
-					auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(toWhichSynthToForward);
-					if (location) {
-						// Check if this is a channel message, and if yes, re-channel to the current synth
-						MidiMessage channelMessage = message;
-						if (message.getChannel() != 0) {
-							channelMessage.setChannel(location->channel().toOneBasedInt());
-						}
-						midikraft::MidiController::instance()->getMidiOutput(location->midiOutput())->sendMessageNow(channelMessage);
-					}
-				}
-			}
-			if (message.isNoteOnOrOff()) {
-				ignoreUnused(source);
-				state_.processNextMidiEvent(message);
-
-				// Check if this is a message we will transform into a macro
-				for (const auto& macro : macros_) {
-					bool matched = isMacroState(macro.second);
-					bool wasActive = macroActiveStates_[macro.first];
-					if (matched && !wasActive) {
-						macroActiveStates_[macro.first] = true;
-						auto code = macro.first;
-						MessageManager::callAsync([this, code]() {
-							executeMacro_(code);
-							});
-					} else if (!matched && wasActive) {
-						macroActiveStates_[macro.first] = false;
-					}
-				}
-			}
-			else if (message.isControllerOfType(123)) {
-				// Keep forwarding CC123 but also clear local state to mirror the synth
-				state_.allNotesOff(0);
-				for (auto& entry : macroActiveStates_) {
-					entry.second = false;
+		MidiRouter::Snapshot routing(router_);
+		if (!routing) return;
+		auto route = routing->findSource(source);
+		if (!route) return;
+
+		routing->forward(*route, message);
+
+		if (message.isNoteOnOrOff()) {
+			state_.processNextMidiEvent(message);
+			heldNotes_.set((size_t)(message.getNoteNumber() & 0x7f), message.isNoteOn());
+
+			// Check if this is a message we will transform into a macro
+			for (auto const& macro : routing->macros()) {
+				bool matched = heldNotes_ == macro.notes;
+				bool& wasActive = macroActiveStates_[(size_t)macro.code];
+				if (matched && !wasActive) {
+					wasActive = true;
+					auto code = static_cast<KeyboardMacroEvent>(macro.code);
+					MessageManager::callAsync([this, code]() {
+						executeMacro_(code);
+						});
+				} else if (!matched && wasActive) {
+					wasActive = false;
 				}
 			}
 		}
+		else if (message.isControllerOfType(123)) {
+			// Keep forwarding CC123 but also clear local state to mirror the synth
+			state_.allNotesOff(0);
+			heldNotes_.reset();
+			macroActiveStates_.fill(false);
+		}
 	});
 
 	// Load Macro Definitions
@@ -209,10 +181,15 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 	loadFromSettings();
 	refreshUI();
 	setupKeyboardControl();
+	rebuildRouting();
+	// Neither the Setup view nor the auto-detection tell when they move a synth to another output or channel
+	startTimer(kRoutingCheckMs);
 }
 
 KeyboardMacroView::~KeyboardMacroView()
 {
+	stopTimer();
+	UIModel::instance()->currentPatch_.removeChangeListener(this);
 	midikraft::MidiController::instance()->removeMessageHandler(handle_);
 	saveSettings();
 }
@@ -454,6 +431,8 @@ void KeyboardMacroView::valueChanged(Value& value)
 		value.refersToSameSourceAs(customMasterkeyboardSetup_.valueByName(kSecondaryMIDIOut))) {
 		updateSecondaryMidiOutSelection();
 	}
+	// Any of the properties could change the routing
+	rebuildRouting();
 }
 
 void KeyboardMacroView::turnOnMasterkeyboardInput() {
@@ -477,6 +456,9 @@ void KeyboardMacroView::changeListenerCallback(ChangeBroadcaster* source)
 	else if (source == &UIModel::instance()->synthList_) {
 		refreshSynthList();
 	}
+	else if (source == &UIModel::instance()->currentPatch_) {
+		// Only relevant when forwarding to the synth of the current patch
+	}
 	else if (customMasterkeyboardSetup_.valueByName(kAutomaticSetup).getValue()) {
 		// Mode 1 - follow current synth, use that as master keyboard
 		auto currentSynth = UIModel::instance()->currentSynth_.smartSynth();
@@ -508,36 +490,66 @@ void KeyboardMacroView::changeListenerCallback(ChangeBroadcaster* source)
 		// so turn back on again
 		turnOnMasterkeyboardInput();
 	}
+	rebuildRouting();
 }
 
-bool KeyboardMacroView::isMacroState(KeyboardMacro const &macro)
+void KeyboardMacroView::rebuildRouting()
 {
-	// Check if macros are turned on
-	if (!customMasterkeyboardSetup_.valueByName(kMacrosEnabled).getValue()) {
-		// No - then don't do anything
-		return false;
-	}
-
-	// Check if the keyboard state does contain all keys of the keyboard macro
-	bool allDetected = true;
-	for (int note : macro.midiNotes) {
-		if (!state_.isNoteOnForChannels(0xffff, note)) {
-			// No, this note is missing
-			allDetected = false;
-			break;
+	auto table = std::make_unique<MidiRoutingTable>();
+
+	auto inputDevice = customMasterkeyboardSetup_.typedNamedValueByName(kInputDevice);
+	std::string masterkeyboard = inputDevice ? inputDevice->lookupValue() : "";
+	if (!masterkeyboard.empty()) {
+		int source = table->addSource(masterkeyboard);
+
+		int forwardMode = customMasterkeyboardSetup_.valueByName(kRouteMasterkeyboard).getValue();
+		if (forwardMode == 2 || forwardMode == 3 || forwardMode == 4) {
+			std::shared_ptr<midikraft::Synth> toWhichSynthToForward;
+			if (forwardMode == 4) {
+				// Fixed synth routing, that means, don't take away my master keyboard while I select a patch for a different synth
+				auto selectedSynth = customMasterkeyboardSetup_.typedNamedValueByName(kFixedSynthSelected)->lookupValue();
+				for (auto s : UIModel::instance()->synthList_.activeSynths()) {
+					if (s->getName() == selectedSynth) {
+						toWhichSynthToForward = std::dynamic_pointer_cast<midikraft::Synth>(s);
+					}
+				}
+			}
+			else if (forwardMode == 3) {
+				// We want to route all events from the master keyboard to the synth of the current patch, so we can play it!
+				auto currentPatch = UIModel::currentPatch();
+				if (currentPatch.patch()) {
+					toWhichSynthToForward = currentPatch.smartSynth();
+				}
+			}
+			if (forwardMode == 2 || !toWhichSynthToForward) {
+				// Forward to the synth selected in the top row
+				toWhichSynthToForward = UIModel::instance()->currentSynth_.smartSynth();
+			}
+			auto location = toWhichSynthToForward ? midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(toWhichSynthToForward) : nullptr;
+			if (location) {
+				// Channel messages are re-channeled to the synth
+				auto output = midikraft::MidiController::instance()->getMidiOutput(location->midiOutput());
+				table->addDestination(source, std::make_shared<SafeMidiOutputRoute>(output), location->channel().toOneBasedInt());
+				table->dependOn([location]() { return location->midiOutput().identifier + "/" + String(location->channel().toOneBasedInt()); });
+			}
 		}
-	}
-	// Check that no extra key is pressed
-	bool extraKeyDetected = false;
-	for (int note = 0; note < 128; note++) {
-		if (state_.isNoteOnForChannels(0xffff, note)) {
-			if (macro.midiNotes.find(note) == macro.midiNotes.end()) {
-				extraKeyDetected = true;
-				break;
+
+		// Only macros that are turned on are compiled into the table
+		if (customMasterkeyboardSetup_.valueByName(kMacrosEnabled).getValue()) {
+			for (auto const& macro : macros_) {
+				table->addMacro(static_cast<int>(macro.first), macro.second.midiNotes);
 			}
 		}
 	}
-	return allDetected && !extraKeyDetected;
+
+	router_.publish(std::move(table));
+}
+
+void KeyboardMacroView::timerCallback()
+{
+	if (router_.outdated()) {
+		rebuildRouting();
+	}
 }
 
 void KeyboardMacroView::handleMidiMessage(const MidiMessage& message, const String& source, bool isOut)
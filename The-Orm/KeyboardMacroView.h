@@ -14,10 +14,13 @@
 
 #include "MidiChannelPropertyEditor.h"
 #include "ElectraOneRouter.h"
+#include "MidiRoutingTable.h"
 
+#include <array>
+#include <bitset>
 #include <mutex>
 
-class KeyboardMacroView : public Component, private ChangeListener, private Value::Listener {
+class KeyboardMacroView : public Component, private ChangeListener, private Value::Listener, private Timer {
 public:
 	KeyboardMacroView(std::function<void(KeyboardMacroEvent)> callback);
 	virtual ~KeyboardMacroView() override;
@@ -34,7 +37,7 @@ private:
 	void saveSettings();
 	void refreshSecondaryMidiOutList();
 	void updateSecondaryMidiOutSelection();
-	bool isMacroState(KeyboardMacro const &macro);
+	void rebuildRouting();
 	void refreshSynthList();
 	void refreshUI();
 
@@ -42,6 +45,7 @@ private:
 
 	void changeListenerCallback(ChangeBroadcaster* source) override; // This gets called when the synth is changed
 	void valueChanged(Value& value) override; // This gets called when the property editor is used
+	void timerCallback() override; // Picks up output and channel changes of the target synth
 
 	PropertyEditor customSetup_;
 	MidiKeyboardState state_;
@@ -57,8 +61,12 @@ private:
 
 	std::map<KeyboardMacroEvent, KeyboardMacro> macros_;
 	std::function<void(KeyboardMacroEvent)> executeMacro_;
-	std::map<KeyboardMacroEvent, bool> macroActiveStates_; // Tracks edge-trigger state to avoid repeats while held
 
+	// Only touched by the MIDI input thread
+	std::bitset<128> heldNotes_;
+	std::array<bool, static_cast<size_t>(KeyboardMacroEvent::Unknown) + 1> macroActiveStates_{}; // Tracks edge-trigger state to avoid repeats while held
+
+	MidiRouter router_;
 	midikraft::MidiController::HandlerHandle handle_ = midikraft::MidiController::makeNoneHandle();
 
 	TypedNamedValueSet customMasterkeyboardSetup_;
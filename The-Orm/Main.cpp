@@ -7,6 +7,7 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 
 #include "MainComponent.h"
+#include "BatchedLogSink.h"
 
 #include "Settings.h"
 #include "UIModel.h"
@@ -20,7 +21,6 @@
 #include <chrono>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/rotating_file_sink.h>
-#include <spdlog/sinks/dist_sink.h>
 #include "SpdLogJuce.h"
 #include "EditFocusKeeper.h"
 
@@ -78,10 +78,11 @@ void configurePersistentLogger(const juce::String& applicationDataDirName)
 	auto fileSink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(logFile.getFullPathName().toStdString(), maxLogSize, maxLogFiles, true);
 	fileSink->set_pattern("%Y-%m-%d %H:%M:%S.%e [%t] %-5l %v");
 
-	auto distSink = std::make_shared<spdlog::sinks::dist_sink_mt>();
-	distSink->add_sink(fileSink);
+	// The MainComponent attaches the log view to this sink. Until then the lines wait in its queue
+	auto logViewSink = std::make_shared<BatchedLogSink>(nullptr);
+	logViewSink->set_pattern("%H:%M:%S: %l %v");
 
-	auto logger = std::make_shared<spdlog::logger>("KnobKraftOrm", distSink);
+	auto logger = std::make_shared<spdlog::logger>("KnobKraftOrm", spdlog::sinks_init_list{ fileSink, logViewSink });
 	logger->set_level(spdlog::level::trace);
 	logger->flush_on(spdlog::level::warn);
 	spdlog::set_default_logger(logger);
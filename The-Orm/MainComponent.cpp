@@ -61,52 +61,29 @@ const std::string kFullMidiLog{ "fullMidiLog" };
 const std::string kSysexMidiLog{ "sysexMidiLog" };
 const std::string kSelectAdaptationDirect{ "selectAdaptationDir" };
 const std::string kCreateNewAdaptation{ "createNewAdaptation" };
+const std::string kWriteAheadLog{ "writeAheadLog" };
+
+const char* const kWriteAheadLogSetting = "DatabaseWriteAheadLog";
 
 extern std::string getOrmVersion();
 
 //
-// Build a spdlog sink that goes into out standard log view
+// spdlog setup, the sink into our standard log view is the BatchedLogSink
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
-#include <spdlog/sinks/base_sink.h>
-#include <spdlog/sinks/dist_sink.h>
+#include "BatchedLogSink.h"
+#include "ReadConnectionPool.h"
 #include <algorithm>
 
-template<typename Mutex>
-class LogViewSink : public spdlog::sinks::base_sink<Mutex>
-{
-public:
-	LogViewSink(LogView& logView) : logView_(logView) {}
-
-protected:
-	void sink_it_(const spdlog::details::log_msg& msg) override
-	{
-		spdlog::memory_buf_t formatted;
-		this->formatter_->format(msg, formatted);
-		logView_.logMessage(msg.level, fmt::to_string(formatted));
-	}
-
-	void flush_() override
-	{
-		// NOP
-	}
-
-private:
-	LogView& logView_;
-};
-
-#include <mutex>
-using LogViewSink_mt = LogViewSink<std::mutex>;
-
 namespace {
-std::shared_ptr<spdlog::sinks::dist_sink_mt> getDistributorSink(const std::shared_ptr<spdlog::logger>& logger)
+std::shared_ptr<BatchedLogSink> getLogViewSink(const std::shared_ptr<spdlog::logger>& logger)
 {
 	if (!logger) {
 		return {};
 	}
 	for (auto& sink : logger->sinks()) {
-		if (auto distSink = std::dynamic_pointer_cast<spdlog::sinks::dist_sink_mt>(sink)) {
-			return distSink;
+		if (auto logViewSink = std::dynamic_pointer_cast<BatchedLogSink>(sink)) {
+			return logViewSink;
 		}
 	}
 	return {};
@@ -161,8 +138,6 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	logArea_(&logView_, BorderSize<int>(8))
 {
 	logger_ = std::make_unique<LogViewLogger>(logView_);
-	logViewSink_ = std::make_shared<LogViewSink_mt>(logView_);
-	logViewSink_->set_pattern("%H:%M:%S: %l %v");
 
 	auto sharedLogger = spdlog::default_logger();
 	jassert(sharedLogger != nullptr);
@@ -172,12 +147,17 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		spdlog::set_default_logger(sharedLogger);
 	}
 
-	if (auto distSink = getDistributorSink(sharedLogger)) {
-		distSink->add_sink(logViewSink_);
-	}
-	else {
+	// The sink is created with the logger, so the log calls don't need a mutexed distributor to add it at runtime
+	logViewSink_ = getLogViewSink(sharedLogger);
+	if (!logViewSink_) {
+		logViewSink_ = std::make_shared<BatchedLogSink>(nullptr);
+		logViewSink_->set_pattern("%H:%M:%S: %l %v");
 		sharedLogger->sinks().push_back(logViewSink_);
 	}
+	logViewSink_->setLineHandler([this](spdlog::level::level_enum level, std::string const& line) {
+		logView_.logMessage(level, line);
+	});
+	logViewSink_->startDraining();
 	spdlog::info("Launching KnobKraft Orm");
 
 	auto customDatabase = Settings::instance().get("LastDatabase");
@@ -187,7 +167,8 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		// This is not openDatabase, because that expects the database_ pointer to be already initialized.
 		// Refactoring would be to create a database without a loaded file state.
 		try {
-			database_ = std::make_unique<midikraft::PatchDatabase>(customDatabase, midikraft::PatchDatabase::OpenMode::READ_WRITE);
+			applyJournalMode(customDatabase);
+			database_ = std::make_unique<midikraft::PatchDatabase>(customDatabase, midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS);
 		}
 		catch (midikraft::PatchDatabaseException& e) {
 			spdlog::error("Critical error trying to open database, maybe wrong version? Creating a new empty database instead. Error was '{}'", e.what());
@@ -276,7 +257,7 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		{3, { "Patches", { { kLoadSysEx}, { kExportSysEx }, { kExportBank},  { kExportPIF}, { kShowDiff} }}},
 		{4, { "Categories", { { "Edit categories" }, {{ "Show category naming rules file"}},  {"Edit category import mapping"},  {"Rerun auto categorize"}}}},
 		{5, { "View", { { "Open 2nd window" }, {"Scale 75%"}, {"Scale 100%"}, {"Scale 125%"}, {"Scale 150%"}, {"Scale 175%"}, {"Scale 200%"}}}},
-		{6, { "Options", { { kCreateNewAdaptation}, { kSelectAdaptationDirect} }}},
+		{6, { "Options", { { kCreateNewAdaptation}, { kSelectAdaptationDirect}, { kWriteAheadLog } }}},
 		{7, { "Help", {
 #ifndef _DEBUG
 #ifdef USE_SENTRY
@@ -342,6 +323,9 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	{"Create new adaptation...", { kCreateNewAdaptation, [this]() {
 		setupView_->createNewAdaptation();
 	} } },
+	{"Concurrent database access...", { kWriteAheadLog, []() {
+		chooseJournalMode();
+	} } },
 
 		//}, 0x44 /* D */, ModifierKeys::ctrlModifier } },
 		{ "Edit categories", { "Edit categories", [this]() {
@@ -363,6 +347,7 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		}
 	} } },
 	{ "Rerun auto categorize...", { "Rerun auto categorize", [this]() {
+		patchView_->flushEdits();
 		auto currentFilter = patchView_->currentFilter();
 		int affected = database_->getPatchesCount(currentFilter);
 		if (AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, "Re-run auto-categorization?",
@@ -603,15 +588,9 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 MainComponent::~MainComponent()
 {
 	if (logViewSink_) {
-		if (auto sharedLogger = spdlog::default_logger()) {
-			if (auto distSink = getDistributorSink(sharedLogger)) {
-				distSink->remove_sink(logViewSink_);
-			}
-			else {
-				auto& sinks = sharedLogger->sinks();
-				sinks.erase(std::remove(sinks.begin(), sinks.end(), logViewSink_), sinks.end());
-			}
-		}
+		// The sink stays on the logger. Without the handler it keeps the lines until its queue is full, then drops them
+		logViewSink_->stopDraining();
+		logViewSink_->setLineHandler(nullptr);
 		logViewSink_.reset();
 	}
 
@@ -678,11 +657,16 @@ bool MainComponent::createNewDatabase()
 		}
 		if (database_) {
 			recentFiles_.addFile(File(database_->getCurrentDatabaseFileName()));
+			if (patchView_) {
+				patchView_->closeDatabase();
+			}
 		}
 		else {
 			database_ = std::make_unique<midikraft::PatchDatabase>(false);
 		}
-		if (database_->switchDatabaseFile(databaseFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE)) {
+		if (database_->switchDatabaseFile(databaseFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS)) {
+			// A new file has nobody else on it, switching it now works either way
+			applyJournalMode(databaseFile.getFullPathName().toStdString());
 			persistRecentFileList();
 			// That worked, new database file is in use!
 			Settings::instance().set("LastDatabasePath", databaseFile.getParentDirectory().getFullPathName().toStdString());
@@ -717,10 +701,15 @@ void MainComponent::openDatabase()
 void MainComponent::openDatabase(File& databaseFile)
 {
 	if (databaseFile.existsAsFile()) {
+		// Queued edits belong to the database that is closed now
+		if (patchView_) {
+			patchView_->closeDatabase();
+		}
 		recentFiles_.addFile(File(database_->getCurrentDatabaseFileName()));
 		UIModel::instance()->clear();
 		try {
-			if (database_->switchDatabaseFile(databaseFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE)) {
+			applyJournalMode(databaseFile.getFullPathName().toStdString());
+			if (database_->switchDatabaseFile(databaseFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS)) {
 				recentFiles_.removeFile(databaseFile);
 				persistRecentFileList();
 				// That worked, new database file is in use!
@@ -741,6 +730,28 @@ void MainComponent::openDatabase(File& databaseFile)
 	}
 }
 
+void MainComponent::applyJournalMode(std::string const& databaseFile)
+{
+	// Leaving WAL needs the file to ourselves, so this runs before the PatchDatabase opens it
+	ReadConnectionPool::useWriteAheadLog(databaseFile, Settings::instance().get(kWriteAheadLogSetting, "0") == "1");
+}
+
+void MainComponent::chooseJournalMode()
+{
+	bool enabled = Settings::instance().get(kWriteAheadLogSetting, "0") == "1";
+	auto choice = AlertWindow::showYesNoCancelBox(AlertWindow::QuestionIcon, "Concurrent database access",
+		String("With a write-ahead log, the patch grid and the counts don't wait while an import or a bulk edit writes to the database.\n\n"
+			"While the database is open, it then consists of three files: the .db3 file and a -wal and a -shm file next to it. Copy the database only with the Orm closed, "
+			"and don't use it on a network drive.\n\nThe write-ahead log is currently ") + (enabled ? "on." : "off."),
+		"Use write-ahead log", "Don't use it", "Cancel");
+	if (choice == 0 || (choice == 1) == enabled) {
+		// Cancelled, or no change
+		return;
+	}
+	Settings::instance().set(kWriteAheadLogSetting, choice == 1 ? "1" : "0");
+	juce::AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Reopen required", "The database will change its journal mode when it is opened next, e.g. after a restart of the application!");
+}
+
 void MainComponent::saveDatabaseAs()
 {
 	std::string lastPath = Settings::instance().get("LastDatabasePath", "");
@@ -751,6 +762,7 @@ void MainComponent::saveDatabaseAs()
 	FileChooser databaseChooser("Please choose a new KnobKraft Orm SQlite database file...", lastDirectory, "*.db3");
 	if (databaseChooser.browseForFileToSave(true)) {
 		File databaseFile = databaseChooser.getResult();
+		patchView_->flushEdits();
 		database_->makeDatabaseBackup(databaseFile);
 		openDatabase(databaseFile);
 	}
@@ -960,7 +972,10 @@ void MainComponent::resized()
 
 void MainComponent::shutdown()
 {
-	// Shutdown database, which will make a backup
+	// The queued edits need the database, and the snapshot replaces the backup on closing
+	if (patchView_) {
+		patchView_->shutdown();
+	}
 	database_.reset();
 }
 
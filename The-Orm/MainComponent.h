@@ -35,6 +35,7 @@
 #include "RecordingView.h"
 #include "BCR2000_Component.h"
 #include "AdaptationView.h"
+#include "BatchedLogSink.h"
 
 #include <spdlog/logger.h>
 
@@ -58,6 +59,8 @@ private:
 	void openDatabase();
 	void openDatabase(File &databaseFile);
 	void saveDatabaseAs();
+	static void applyJournalMode(std::string const& databaseFile);
+	static void chooseJournalMode();
 	static void exportDatabases();
 	void mergeDatabases();
 	PopupMenu recentFileMenu();
@@ -119,7 +122,7 @@ private:
 
 	InsetBox logArea_;
 
-	spdlog::sink_ptr logViewSink_;
+	std::shared_ptr<BatchedLogSink> logViewSink_;
 
 	ListenerSet listeners_;
 
@@ -0,0 +1,161 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MidiRoutingTable.h"
+
+#include <algorithm>
+
+MidiRoutingTable::MidiRoutingTable() : nextUnrouted_(0)
+{
+	for (auto& known : unrouted_) {
+		known = nullptr;
+	}
+}
+
+int MidiRoutingTable::addSource(String const& inputName)
+{
+	for (size_t i = 0; i < sources_.size(); i++) {
+		if (sources_[i].inputName == inputName) {
+			return (int)i;
+		}
+	}
+	sources_.emplace_back(inputName);
+	return (int)sources_.size() - 1;
+}
+
+int MidiRoutingTable::addDestination(int sourceIndex, std::shared_ptr<Output> output, int oneBasedChannel)
+{
+	jassert(sourceIndex >= 0 && sourceIndex < (int)sources_.size());
+	Destination destination{ output, oneBasedChannel, false, {} };
+	for (int i = 0; i < 128; i++) {
+		destination.controllerMap[i] = (int8)i;
+	}
+	auto& destinations = sources_[sourceIndex].destinations;
+	destinations.push_back(destination);
+	return (int)destinations.size() - 1;
+}
+
+void MidiRoutingTable::mapController(int sourceIndex, int destinationIndex, int fromController, int toController)
+{
+	jassert(fromController >= 0 && fromController < 128 && toController < 128);
+	auto& destination = sources_[sourceIndex].destinations[destinationIndex];
+	destination.remapControllers = true;
+	destination.controllerMap[fromController & 0x7f] = (int8)std::max(-1, toController);
+}
+
+void MidiRoutingTable::addMacro(int code, std::set<int> const& notes)
+{
+	Macro macro{ code, {} };
+	for (auto note : notes) {
+		if (note >= 0 && note < 128) {
+			macro.notes.set((size_t)note);
+		}
+	}
+	if (macro.notes.any()) {
+		macros_.push_back(macro);
+	}
+}
+
+void MidiRoutingTable::dependOn(std::function<String()> currentState)
+{
+	auto compiled = currentState();
+	dependencies_.emplace_back(std::move(currentState), compiled);
+}
+
+bool MidiRoutingTable::outdated() const
+{
+	return std::any_of(dependencies_.begin(), dependencies_.end(), [](std::pair<std::function<String()>, String> const& dependency) {
+		return dependency.first() != dependency.second;
+	});
+}
+
+MidiRoutingTable::Source const* MidiRoutingTable::findSource(MidiInput* input) const
+{
+	return findSource(input, [input]() { return input->getName(); });
+}
+
+void MidiRoutingTable::forward(Source const& source, MidiMessage const& message) const
+{
+	if (source.destinations.empty()) {
+		return;
+	}
+
+	auto raw = message.getRawData();
+	int size = message.getRawDataSize();
+	bool isChannelMessage = size > 0 && size <= 3 && raw[0] >= 0x80 && raw[0] < 0xf0;
+	for (auto const& destination : source.destinations) {
+		if (!isChannelMessage) {
+			// Sysex and realtime messages are passed on as they are
+			destination.output->send(message);
+			continue;
+		}
+
+		// Short messages are rebuilt on the stack, JUCE stores them without heap allocation
+		uint8 bytes[3] = { raw[0], size > 1 ? raw[1] : (uint8)0, size > 2 ? raw[2] : (uint8)0 };
+		if (destination.channel > 0) {
+			bytes[0] = (uint8)((bytes[0] & 0xf0) | ((destination.channel - 1) & 0x0f));
+		}
+		if (destination.remapControllers && (bytes[0] & 0xf0) == 0xb0) {
+			auto mapped = destination.controllerMap[bytes[1] & 0x7f];
+			if (mapped < 0) {
+				continue;
+			}
+			bytes[1] = (uint8)mapped;
+		}
+		destination.output->send(MidiMessage(bytes, size, message.getTimeStamp()));
+	}
+}
+
+MidiRouter::Snapshot::Snapshot(MidiRouter const& router) : router_(router)
+{
+	// Register as reader before looking at the table, so the writer will not delete it under our feet
+	router_.activeReaders_++;
+	table_ = router_.current_.load();
+}
+
+MidiRouter::Snapshot::~Snapshot()
+{
+	router_.activeReaders_--;
+}
+
+MidiRouter::MidiRouter() : current_(nullptr), activeReaders_(0)
+{
+}
+
+MidiRouter::~MidiRouter()
+{
+	current_ = nullptr;
+	while (activeReaders_ > 0) {
+		Thread::yield();
+	}
+}
+
+void MidiRouter::publish(std::unique_ptr<MidiRoutingTable const> table)
+{
+	std::lock_guard<std::mutex> lock(publishLock_);
+	current_ = table.get();
+	if (table) {
+		tables_.push_back(std::move(table));
+	}
+	releaseRetired();
+}
+
+bool MidiRouter::outdated() const
+{
+	Snapshot current(*this);
+	return current && current->outdated();
+}
+
+void MidiRouter::releaseRetired()
+{
+	// Any reader arriving after this check already sees the new table
+	if (activeReaders_ == 0) {
+		auto current = current_.load();
+		tables_.erase(std::remove_if(tables_.begin(), tables_.end(), [current](std::unique_ptr<MidiRoutingTable const> const& table) {
+			return table.get() != current;
+		}), tables_.end());
+	}
+}
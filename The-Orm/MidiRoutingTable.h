@@ -0,0 +1,158 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "MidiController.h"
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+// A precompiled MIDI routing setup. It is built on the message thread whenever the setup changes (ports, target synth, channel,
+// controller mapping, keyboard macros) and then published to a MidiRouter. Once published it is never modified, so the MIDI
+// input thread can use it without locks. The per-message path does neither allocate nor compare strings.
+class MidiRoutingTable {
+public:
+	class Output {
+	public:
+		virtual ~Output() = default;
+		virtual void send(MidiMessage const& message) = 0;
+	};
+
+	struct Destination {
+		std::shared_ptr<Output> output;
+		int channel; // One based MIDI channel to re-channel to, 0 to keep the channel of the incoming message
+		bool remapControllers;
+		std::array<int8, 128> controllerMap; // Target controller number per incoming controller, -1 drops the controller
+	};
+
+	struct Source {
+		Source(String const& name) : inputName(name), resolvedInput(nullptr) {}
+		Source(Source const& other) : inputName(other.inputName), resolvedInput(other.resolvedInput.load()), destinations(other.destinations) {}
+
+		String inputName;
+		mutable std::atomic<void const*> resolvedInput; // Cached identity of the MidiInput, so we compare names only once per port
+		std::vector<Destination> destinations;
+	};
+
+	struct Macro {
+		int code;
+		std::bitset<128> notes;
+	};
+
+	MidiRoutingTable();
+
+	// Building the table, before it is published
+	int addSource(String const& inputName);
+	int addDestination(int sourceIndex, std::shared_ptr<Output> output, int oneBasedChannel);
+	void mapController(int sourceIndex, int destinationIndex, int fromController, int toController);
+	void addMacro(int code, std::set<int> const& notes);
+	// The table was compiled from state whose changes nobody broadcasts, like the output and channel the auto-detection or the
+	// Setup view give a synth. currentState returns a key of that state, the table is outdated once the key changed
+	void dependOn(std::function<String()> currentState);
+
+	// Message thread
+	bool outdated() const;
+
+	// Realtime path
+	Source const* findSource(MidiInput* input) const;
+	template <typename NameLookup> Source const* findSource(void const* inputKey, NameLookup&& nameOf) const;
+	void forward(Source const& source, MidiMessage const& message) const;
+	std::vector<Macro> const& macros() const { return macros_; }
+
+private:
+	static constexpr size_t kUnroutedCacheSize = 8;
+
+	std::vector<Source> sources_;
+	std::vector<Macro> macros_;
+	std::vector<std::pair<std::function<String()>, String>> dependencies_; // State and its key when compiled
+	mutable std::array<std::atomic<void const*>, kUnroutedCacheSize> unrouted_; // Inputs known not to be routed by this table
+	mutable std::atomic<size_t> nextUnrouted_;
+};
+
+template <typename NameLookup>
+MidiRoutingTable::Source const* MidiRoutingTable::findSource(void const* inputKey, NameLookup&& nameOf) const
+{
+	if (inputKey == nullptr) {
+		return nullptr;
+	}
+	for (auto const& source : sources_) {
+		if (source.resolvedInput.load(std::memory_order_relaxed) == inputKey) {
+			return &source;
+		}
+	}
+	for (auto const& known : unrouted_) {
+		if (known.load(std::memory_order_relaxed) == inputKey) {
+			return nullptr;
+		}
+	}
+
+	// Slow path - first message from this port since the table was compiled
+	String name = nameOf();
+	for (auto const& source : sources_) {
+		if (source.inputName == name) {
+			source.resolvedInput.store(inputKey, std::memory_order_relaxed);
+			return &source;
+		}
+	}
+	unrouted_[nextUnrouted_++ % kUnroutedCacheSize].store(inputKey, std::memory_order_relaxed);
+	return nullptr;
+}
+
+// Holds the currently active MidiRoutingTable and swaps it atomically. Readers pin the table with a Snapshot,
+// replaced tables are only deleted once no reader is active anymore.
+class MidiRouter {
+public:
+	class Snapshot {
+	public:
+		explicit Snapshot(MidiRouter const& router);
+		~Snapshot();
+
+		MidiRoutingTable const* operator->() const { return table_; }
+		explicit operator bool() const { return table_ != nullptr; }
+
+	private:
+		MidiRouter const& router_;
+		MidiRoutingTable const* table_;
+	};
+
+	MidiRouter();
+	~MidiRouter();
+
+	// Call from the message thread whenever the setup changed
+	void publish(std::unique_ptr<MidiRoutingTable const> table);
+	// Message thread. True if the current table depends on state that has changed since, so it needs compiling again
+	bool outdated() const;
+
+private:
+	void releaseRetired();
+
+	std::atomic<MidiRoutingTable const*> current_;
+	mutable std::atomic<int> activeReaders_;
+	std::mutex publishLock_; // Only taken by writers
+	std::vector<std::unique_ptr<MidiRoutingTable const>> tables_; // The current table plus those retired but possibly still in use
+};
+
+// Route output writing to a MidiController output port
+class SafeMidiOutputRoute : public MidiRoutingTable::Output {
+public:
+	explicit SafeMidiOutputRoute(std::shared_ptr<midikraft::SafeMidiOutput> output) : output_(output) {}
+
+	void send(MidiMessage const& message) override {
+		output_->sendMessageNow(message);
+	}
+
+private:
+	std::shared_ptr<midikraft::SafeMidiOutput> output_;
+};
@@ -0,0 +1,162 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "OrmSchema.h"
+
+#include "PatchCounters.h"
+#include "PatchProjection.h"
+#include "PatchQuery.h"
+#include "PatchSearchIndex.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include <sqlite3.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+
+namespace {
+
+	const int kBusyTimeoutMs = 5000;
+
+	struct Step {
+		int version;
+		const char* name;
+		bool (*installed)(SQLite::Database& db);
+		void (*create)(SQLite::Database& db);
+	};
+
+	// Append only. A step may be run again on a database that has it already, it has to start from scratch
+	const Step kSteps[] = {
+		{ 1, "patch counters", &PatchCounters::installed, &PatchCounters::create },
+		{ 2, "paging indexes", &PatchQuery::indexed, &PatchQuery::createIndexes },
+		{ 3, "patch summary index", &PatchProjection::indexed, &PatchProjection::createIndex },
+		{ 4, "search index", &PatchSearchIndex::upToDate, &PatchSearchIndex::create },
+	};
+
+	void storeVersion(SQLite::Database& db, int version) {
+		db.exec("DELETE FROM orm_schema_version");
+		SQLite::Statement insert(db, "INSERT INTO orm_schema_version (number) VALUES (:NUM)");
+		insert.bind(":NUM", version);
+		insert.exec();
+	}
+
+}
+
+const int OrmSchema::kVersion = kSteps[std::size(kSteps) - 1].version;
+
+OrmSchema::OrmSchema(std::string const& databaseFile, std::function<void()> migrated) : cancel_(false)
+{
+	thread_ = std::thread(&OrmSchema::run, this, databaseFile, std::move(migrated));
+}
+
+OrmSchema::~OrmSchema()
+{
+	cancel_ = true;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (running_) {
+			sqlite3_interrupt(running_);
+		}
+	}
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+}
+
+int OrmSchema::version(SQLite::Database& db)
+{
+	if (!db.tableExists("orm_schema_version")) {
+		return 0;
+	}
+	SQLite::Statement query(db, "SELECT max(number) FROM orm_schema_version");
+	return query.executeStep() && !query.getColumn(0).isNull() ? query.getColumn(0).getInt() : 0;
+}
+
+bool OrmSchema::upToDate(SQLite::Database& db)
+{
+	if (version(db) < kVersion) {
+		return false;
+	}
+	return std::all_of(std::begin(kSteps), std::end(kSteps), [&db](Step const& step) { return step.installed(db); });
+}
+
+bool OrmSchema::upToDate(std::string const& databaseFile)
+{
+	try {
+		SQLite::Database db(databaseFile, SQLite::OPEN_READONLY, kBusyTimeoutMs);
+		return upToDate(db);
+	}
+	catch (SQLite::Exception const& e) {
+		spdlog::warn("Could not check the schema of {}: {}", databaseFile, e.what());
+		return false;
+	}
+}
+
+int OrmSchema::migrate(SQLite::Database& db)
+{
+	db.exec("CREATE TABLE IF NOT EXISTS orm_schema_version (number INTEGER)");
+	int current = version(db);
+	int run = 0;
+	for (auto const& step : kSteps) {
+		if (step.version <= current && step.installed(db)) {
+			continue;
+		}
+		SQLite::Transaction transaction(db);
+		step.create(db);
+		current = std::max(current, step.version);
+		storeVersion(db, current);
+		transaction.commit();
+		spdlog::info("Database migrated to {} (orm schema version {})", step.name, current);
+		run++;
+	}
+	return run;
+}
+
+void OrmSchema::run(std::string const& databaseFile, std::function<void()> migrated)
+{
+	try {
+		SQLite::Database db(databaseFile, SQLite::OPEN_READWRITE, kBusyTimeoutMs);
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			if (cancel_) {
+				return;
+			}
+			running_ = db.getHandle();
+		}
+		int steps = 0;
+		std::exception_ptr failure;
+		try {
+			steps = migrate(db);
+		}
+		catch (...) {
+			failure = std::current_exception();
+		}
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			running_ = nullptr;
+		}
+		if (failure) {
+			std::rethrow_exception(failure);
+		}
+		if (steps > 0 && migrated) {
+			migrated();
+		}
+	}
+	catch (std::exception const& e) {
+		if (cancel_) {
+			spdlog::info("Database migration interrupted, it continues when the database is opened next");
+		}
+		else {
+			spdlog::error("Could not migrate the database, counts and searches run on the patches directly: {}", e.what());
+		}
+	}
+}
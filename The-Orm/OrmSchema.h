@@ -0,0 +1,54 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct sqlite3;
+
+namespace SQLite {
+	class Database;
+}
+
+// Versioned migration of the tables The-Orm keeps next to the patches. The PatchDatabase counts its migrations in
+// schema_version, these steps are counted in orm_schema_version, so both can move independently. Nothing else creates
+// these tables: until the migration is done, their users fall back to reading the database the old way.
+//
+// A step builds its tables from all patches, which takes seconds on a large library, so an instance runs the migration
+// on a thread of its own. A PatchDatabase migration that recreates a table drops the triggers and indexes on it - a
+// step found incomplete is run again, whatever the version says.
+class OrmSchema {
+public:
+	static const int kVersion;
+
+	// Starts migrating the file. migrated is called on the migration thread, and only if a step had to run
+	OrmSchema(std::string const& databaseFile, std::function<void()> migrated);
+	// Interrupts a migration still running, which rolls back the step it is in
+	~OrmSchema();
+
+	// The version stored in the file, 0 if there is none
+	static int version(SQLite::Database& db);
+
+	// At the current version and nothing missing
+	static bool upToDate(SQLite::Database& db);
+	static bool upToDate(std::string const& databaseFile);
+
+	// Runs the steps needed, each in a transaction of its own. Returns the number of steps run, throws if one failed
+	static int migrate(SQLite::Database& db);
+
+private:
+	void run(std::string const& databaseFile, std::function<void()> migrated);
+
+	std::mutex lock_;
+	sqlite3* running_ = nullptr;
+	std::atomic<bool> cancel_;
+	std::thread thread_;
+};
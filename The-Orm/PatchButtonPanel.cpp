@@ -170,6 +170,7 @@ void PatchButtonPanel::setTotalCount(int totalCount, bool resetToPageOne /* = tr
 		// Either we want to jump back to page 1, or the current page is no longer possible as the totalCount is smaller than the current's page first element index
 		pageBase_ = pageNumber_ = 0;
 	}
+	setupPageButtons();
 }
 
 void PatchButtonPanel::changeGridSize(int newWidth, int newHeight) {
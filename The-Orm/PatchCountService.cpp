@@ -0,0 +1,207 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchCountService.h"
+
+#include "JuceHeader.h"
+
+#include "OrmSchema.h"
+#include "PatchDatabase.h"
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+namespace {
+	const size_t kMaxRememberedCounts = 256;
+}
+
+PatchCountService::PatchCountService(midikraft::PatchDatabase& database) : database_(database)
+{
+}
+
+PatchCountService::~PatchCountService() = default;
+
+PatchCountService::Count PatchCountService::estimate(midikraft::PatchFilter const& filter)
+{
+	auto counters = this->counters();
+	try {
+		if (counters) {
+			auto answer = fromCounters(*counters, filter);
+			if (answer) {
+				return { answer->second, true };
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			auto known = lastExact_.find(cacheKey(filter));
+			if (known != lastExact_.end()) {
+				return { known->second, false };
+			}
+		}
+		if (counters) {
+			return { upperBound(*counters, filter), false };
+		}
+	}
+	catch (std::exception const& e) {
+		spdlog::warn("Could not read patch counters: {}", e.what());
+	}
+	return { 0, false };
+}
+
+int PatchCountService::count(midikraft::PatchFilter const& filter)
+{
+	return *count(filter, [this](midikraft::PatchFilter const& filter) { return std::optional<int>(database_.getPatchesCount(filter)); });
+}
+
+std::optional<int> PatchCountService::count(midikraft::PatchFilter const& filter, TFullCount const& fullCount)
+{
+	auto counters = this->counters();
+	if (counters) {
+		try {
+			auto answer = fromCounters(*counters, filter);
+			if (answer) {
+				bool verify;
+				{
+					std::lock_guard<std::mutex> lock(lock_);
+					verify = verified_.insert(answer->first).second;
+				}
+				if (!verify) {
+					return answer->second;
+				}
+				auto total = fullCount(filter);
+				if (!total) {
+					// Check the next time
+					std::lock_guard<std::mutex> lock(lock_);
+					verified_.erase(answer->first);
+					return {};
+				}
+				if (*total != answer->second) {
+					spdlog::warn("Patch counters say {} but the database has {} patches, recounting", answer->second, *total);
+					counters->rebuild();
+				}
+				return total;
+			}
+		}
+		catch (std::exception const& e) {
+			spdlog::warn("Could not read patch counters: {}", e.what());
+		}
+	}
+	auto total = fullCount(filter);
+	if (!total) {
+		return {};
+	}
+	std::lock_guard<std::mutex> lock(lock_);
+	if (lastExact_.size() >= kMaxRememberedCounts) {
+		lastExact_.clear();
+	}
+	lastExact_[cacheKey(filter)] = *total;
+	return total;
+}
+
+std::shared_ptr<PatchCounters> PatchCountService::counters()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	auto file = String(database_.getCurrentDatabaseFileName()).toStdString();
+	if (file != databaseFile_) {
+		// Another database was opened, or this is the first call
+		databaseFile_ = file;
+		verified_.clear();
+		lastExact_.clear();
+		counters_.reset();
+		unavailable_ = false;
+	}
+	// Asked again with every count until the migration running in the background is done
+	if (!counters_ && !unavailable_ && OrmSchema::upToDate(file)) {
+		try {
+			counters_ = std::make_shared<PatchCounters>(file);
+		}
+		catch (std::exception const& e) {
+			spdlog::warn("Patch counters not available, counting with full queries: {}", e.what());
+			unavailable_ = true;
+		}
+	}
+	return counters_;
+}
+
+std::optional<std::pair<PatchCountService::Answer, int>> PatchCountService::fromCounters(PatchCounters& counters, midikraft::PatchFilter const& filter)
+{
+	if (filter.synths.empty() || !filter.name.empty() || filter.onlySpecifcType || filter.onlyUntagged) {
+		return {};
+	}
+	// Either the default (everything but hidden), or all four visibility buttons pressed, which is everything
+	bool allVisibility = filter.onlyFaves && filter.showHidden && filter.showRegular && filter.showUndecided;
+	bool defaultVisibility = !filter.onlyFaves && !filter.showHidden && !filter.showRegular && !filter.showUndecided;
+	if (!allVisibility && !defaultVisibility) {
+		return {};
+	}
+
+	int total = 0;
+	if (filter.onlyDuplicateNames) {
+		if (!filter.listID.empty() || !filter.categories.empty()) {
+			return {};
+		}
+		for (auto const& synth : filter.synths) {
+			auto duplicates = counters.duplicates(synth.first);
+			total += allVisibility ? duplicates.patches : duplicates.visible;
+		}
+		return std::make_pair(Answer::Duplicates, total);
+	}
+	if (!filter.listID.empty()) {
+		if (!filter.categories.empty()) {
+			return {};
+		}
+		for (auto const& synth : filter.synths) {
+			auto list = counters.list(filter.listID, synth.first);
+			total += allVisibility ? list.entries : list.visible;
+		}
+		return std::make_pair(Answer::List, total);
+	}
+	if (filter.categories.empty()) {
+		for (auto const& synth : filter.synths) {
+			auto counts = counters.synth(synth.first);
+			total += allVisibility ? counts.total : counts.total - counts.hidden;
+		}
+		return std::make_pair(Answer::Synths, total);
+	}
+	if (filter.categories.size() == 1 && defaultVisibility) {
+		int bit = filter.categories.begin()->def()->id;
+		for (auto const& synth : filter.synths) {
+			total += counters.category(synth.first, bit);
+		}
+		return std::make_pair(Answer::Category, total);
+	}
+	return {};
+}
+
+int PatchCountService::upperBound(PatchCounters& counters, midikraft::PatchFilter const& filter)
+{
+	bool anyVisibility = filter.onlyFaves || filter.showHidden || filter.showRegular || filter.showUndecided;
+	int total = 0;
+	for (auto const& synth : filter.synths) {
+		if (!filter.listID.empty()) {
+			total += counters.list(filter.listID, synth.first).entries;
+		}
+		else {
+			auto counts = counters.synth(synth.first);
+			total += anyVisibility ? counts.total : counts.total - counts.hidden;
+		}
+	}
+	return total;
+}
+
+std::string PatchCountService::cacheKey(midikraft::PatchFilter const& filter)
+{
+	std::string key = fmt::format("{}|{}|{}{}{}{}{}{}{}{}|{}|", filter.name, filter.listID, filter.onlyFaves, filter.showHidden, filter.showRegular,
+		filter.showUndecided, filter.onlyUntagged, filter.onlyDuplicateNames, filter.andCategories, filter.onlySpecifcType, filter.onlySpecifcType ? filter.typeID : -1);
+	for (auto const& synth : filter.synths) {
+		key += synth.first + ",";
+	}
+	key += "|";
+	for (auto const& category : filter.categories) {
+		key += std::to_string(category.def()->id) + ",";
+	}
+	return key;
+}
@@ -0,0 +1,69 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "PatchCounters.h"
+#include "PatchFilter.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+
+namespace midikraft {
+	class PatchDatabase;
+}
+
+// Answers "how many patches match this filter" for the paging controls. The common filters - synths with the default or
+// all visibility, optionally one category, a list or only duplicate names - come from the PatchCounters without touching the patches. Everything
+// else gets an immediate estimate, which the caller refines by asking for the exact count in the background.
+// Until the OrmSchema migration has built the counters, every count is a full query.
+class PatchCountService {
+public:
+	struct Count {
+		int total = 0;
+		bool exact = false;
+	};
+
+	explicit PatchCountService(midikraft::PatchDatabase& database);
+	~PatchCountService();
+
+	// Never scans. Exact when the counters can answer, else the last exact count seen for the same filter, else an upper bound
+	Count estimate(midikraft::PatchFilter const& filter);
+
+	typedef std::function<std::optional<int>(midikraft::PatchFilter const&)> TFullCount;
+
+	// Exact, running the full count query only if the counters can't answer. The first answer of each kind from the counters
+	// after opening a database is checked against the full query once, and the counters rebuilt if they drifted
+	int count(midikraft::PatchFilter const& filter);
+	// The same with a full count of the caller's, which may give up - e.g. because its search was superseded. Empty then
+	std::optional<int> count(midikraft::PatchFilter const& filter, TFullCount const& fullCount);
+
+private:
+	enum class Answer {
+		Synths,
+		Category,
+		List,
+		Duplicates
+	};
+
+	std::shared_ptr<PatchCounters> counters();
+	static std::optional<std::pair<Answer, int>> fromCounters(PatchCounters& counters, midikraft::PatchFilter const& filter);
+	static int upperBound(PatchCounters& counters, midikraft::PatchFilter const& filter);
+	static std::string cacheKey(midikraft::PatchFilter const& filter);
+
+	midikraft::PatchDatabase& database_;
+	std::mutex lock_;
+	std::string databaseFile_;
+	std::shared_ptr<PatchCounters> counters_;
+	bool unavailable_ = false;
+	std::set<Answer> verified_;
+	std::map<std::string, int> lastExact_;
+};
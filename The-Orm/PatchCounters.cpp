@@ -0,0 +1,214 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchCounters.h"
+
+#include "OrmSchema.h"
+#include "ReadConnectionPool.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+	const char* kTriggers[] = {
+		"orm_count_patch_insert", "orm_count_patch_delete", "orm_count_patch_update",
+		"orm_count_entry_insert", "orm_count_entry_delete", "orm_count_entry_update"
+	};
+
+	const int kCategoryBits = 63;
+
+	// Adds (sign +) or removes (sign -) the patch row (NEW or OLD) from all counters
+	std::string patchDelta(const char* row, const char* sign) {
+		return fmt::format(
+			"INSERT OR IGNORE INTO orm_count_synth (synth) VALUES ({0}.synth); "
+			"UPDATE orm_count_synth SET total = total {1} 1, hidden = hidden {1} (IFNULL({0}.hidden, 0) != 0), "
+			"favorites = favorites {1} (IFNULL({0}.favorite, 0) = 1 AND IFNULL({0}.hidden, 0) = 0) WHERE synth = {0}.synth; "
+			"INSERT OR IGNORE INTO orm_count_category (synth, bit) SELECT {0}.synth, bit FROM orm_count_bits "
+			"WHERE IFNULL({0}.hidden, 0) = 0 AND (IFNULL({0}.categories, 0) >> bit) & 1; "
+			"UPDATE orm_count_category SET visible = visible {1} 1 "
+			"WHERE synth = {0}.synth AND IFNULL({0}.hidden, 0) = 0 AND (IFNULL({0}.categories, 0) >> bit) & 1; "
+			// List entries may exist before or after the patch, so the patch accounts for the ones already there
+			"UPDATE orm_count_list SET visible = visible {1} (SELECT count(*) FROM patch_in_list l WHERE l.id = orm_count_list.id AND l.synth = {0}.synth AND l.md5 = {0}.md5) "
+			"WHERE synth = {0}.synth AND IFNULL({0}.hidden, 0) = 0 AND id IN (SELECT id FROM patch_in_list WHERE synth = {0}.synth AND md5 = {0}.md5); "
+			// Names no patch uses anymore are dropped, so the table doesn't grow with every rename
+			"INSERT OR IGNORE INTO orm_count_name (synth, name) VALUES ({0}.synth, IFNULL({0}.name, '')); "
+			"UPDATE orm_count_name SET total = total {1} 1, hidden = hidden {1} (IFNULL({0}.hidden, 0) != 0) WHERE synth = {0}.synth AND name = IFNULL({0}.name, ''); "
+			"DELETE FROM orm_count_name WHERE synth = {0}.synth AND name = IFNULL({0}.name, '') AND total = 0; ",
+			row, sign);
+	}
+
+	// Same for an entry in patch_in_list
+	std::string entryDelta(const char* row, const char* sign) {
+		return fmt::format(
+			"INSERT OR IGNORE INTO orm_count_list (id, synth) VALUES ({0}.id, {0}.synth); "
+			"UPDATE orm_count_list SET entries = entries {1} 1, "
+			"visible = visible {1} EXISTS (SELECT 1 FROM patches p WHERE p.synth = {0}.synth AND p.md5 = {0}.md5 AND IFNULL(p.hidden, 0) = 0) "
+			"WHERE id = {0}.id AND synth = {0}.synth; ",
+			row, sign);
+	}
+
+}
+
+PatchCounters::PatchCounters(std::string const& databaseFile)
+{
+	db_ = std::make_unique<SQLite::Database>(databaseFile, SQLite::OPEN_READWRITE, 5000);
+	if (!OrmSchema::upToDate(*db_)) {
+		throw std::runtime_error("The patch counters are not migrated yet");
+	}
+	reads_ = std::make_unique<ReadConnectionPool>(databaseFile);
+}
+
+PatchCounters::~PatchCounters() = default;
+
+PatchCounters::SynthCounts PatchCounters::synth(std::string const& synthName)
+{
+	auto lease = reads_->acquire();
+	SQLite::Statement query(lease.db(), "SELECT total, hidden, favorites FROM orm_count_synth WHERE synth = :SYN");
+	query.bind(":SYN", synthName);
+	SynthCounts result;
+	if (query.executeStep()) {
+		result.total = query.getColumn(0).getInt();
+		result.hidden = query.getColumn(1).getInt();
+		result.favorites = query.getColumn(2).getInt();
+	}
+	return result;
+}
+
+int PatchCounters::category(std::string const& synthName, int bitIndex)
+{
+	auto lease = reads_->acquire();
+	SQLite::Statement query(lease.db(), "SELECT visible FROM orm_count_category WHERE synth = :SYN AND bit = :BIT");
+	query.bind(":SYN", synthName);
+	query.bind(":BIT", bitIndex);
+	return query.executeStep() ? query.getColumn(0).getInt() : 0;
+}
+
+PatchCounters::ListCounts PatchCounters::list(std::string const& listId, std::string const& synthName)
+{
+	auto lease = reads_->acquire();
+	SQLite::Statement query(lease.db(), "SELECT entries, visible FROM orm_count_list WHERE id = :ID AND synth = :SYN");
+	query.bind(":ID", listId);
+	query.bind(":SYN", synthName);
+	ListCounts result;
+	if (query.executeStep()) {
+		result.entries = query.getColumn(0).getInt();
+		result.visible = query.getColumn(1).getInt();
+	}
+	return result;
+}
+
+PatchCounters::DuplicateCounts PatchCounters::duplicates(std::string const& synthName)
+{
+	auto lease = reads_->acquire();
+	SQLite::Statement query(lease.db(), "SELECT IFNULL(sum(total), 0), IFNULL(sum(total - hidden), 0) FROM orm_count_name WHERE synth = :SYN AND total > 1");
+	query.bind(":SYN", synthName);
+	DuplicateCounts result;
+	if (query.executeStep()) {
+		result.patches = query.getColumn(0).getInt();
+		result.visible = query.getColumn(1).getInt();
+	}
+	return result;
+}
+
+std::vector<PatchCounters::NameGroup> PatchCounters::duplicateGroups(std::vector<std::string> const& synthNames, int limit, std::optional<NameGroup> const& after)
+{
+	std::vector<NameGroup> result;
+	if (synthNames.empty()) {
+		return result;
+	}
+	std::string synths;
+	for (size_t i = 0; i < synthNames.size(); i++) {
+		synths += fmt::format("{}:S{}", i == 0 ? "" : ", ", i);
+	}
+	auto lease = reads_->acquire();
+	// Keyset paging on the partial index, so every page is a range scan no matter how far in
+	SQLite::Statement query(lease.db(), fmt::format("SELECT synth, name, total, hidden FROM orm_count_name WHERE total > 1 AND synth IN ({}) {} "
+		"ORDER BY synth, name LIMIT :LIMIT", synths, after ? "AND (synth, name) > (:AFTER_SYN, :AFTER_NAM)" : ""));
+	for (size_t i = 0; i < synthNames.size(); i++) {
+		query.bind(fmt::format(":S{}", i), synthNames[i]);
+	}
+	if (after) {
+		query.bind(":AFTER_SYN", after->synth);
+		query.bind(":AFTER_NAM", after->name);
+	}
+	query.bind(":LIMIT", limit);
+	while (query.executeStep()) {
+		result.push_back({ query.getColumn(0).getString(), query.getColumn(1).getString(), query.getColumn(2).getInt(), query.getColumn(3).getInt() });
+	}
+	return result;
+}
+
+void PatchCounters::rebuild()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	SQLite::Transaction transaction(*db_);
+	create(*db_);
+	transaction.commit();
+}
+
+bool PatchCounters::installed(SQLite::Database& db)
+{
+	SQLite::Statement query(db, "SELECT count(*) FROM sqlite_master WHERE type = 'trigger' AND name LIKE 'orm_count_%'");
+	int triggers = query.executeStep() ? query.getColumn(0).getInt() : 0;
+	return triggers == static_cast<int>(std::size(kTriggers)) && db.tableExists("orm_count_synth") && db.tableExists("orm_count_name");
+}
+
+void PatchCounters::create(SQLite::Database& db)
+{
+	for (auto trigger : kTriggers) {
+		db.exec(fmt::format("DROP TRIGGER IF EXISTS {}", trigger));
+	}
+	db.exec("DROP TABLE IF EXISTS orm_count_synth");
+	db.exec("DROP TABLE IF EXISTS orm_count_category");
+	db.exec("DROP TABLE IF EXISTS orm_count_list");
+	db.exec("DROP TABLE IF EXISTS orm_count_bits");
+	db.exec("DROP TABLE IF EXISTS orm_count_name");
+
+	db.exec("CREATE TABLE orm_count_synth (synth TEXT PRIMARY KEY, total INTEGER NOT NULL DEFAULT 0, hidden INTEGER NOT NULL DEFAULT 0, favorites INTEGER NOT NULL DEFAULT 0)");
+	db.exec("CREATE TABLE orm_count_category (synth TEXT NOT NULL, bit INTEGER NOT NULL, visible INTEGER NOT NULL DEFAULT 0, PRIMARY KEY (synth, bit))");
+	db.exec("CREATE TABLE orm_count_list (id TEXT NOT NULL, synth TEXT NOT NULL, entries INTEGER NOT NULL DEFAULT 0, visible INTEGER NOT NULL DEFAULT 0, PRIMARY KEY (id, synth))");
+	db.exec("CREATE TABLE orm_count_name (synth TEXT NOT NULL, name TEXT NOT NULL, total INTEGER NOT NULL DEFAULT 0, hidden INTEGER NOT NULL DEFAULT 0, PRIMARY KEY (synth, name))");
+	// Only the names used more than once, which is what the duplicate filter and the duplicate groups look at
+	db.exec("CREATE INDEX orm_count_name_duplicates ON orm_count_name (synth, name) WHERE total > 1");
+	// Triggers can't use recursive CTEs, so the category bits are a table
+	db.exec("CREATE TABLE orm_count_bits (bit INTEGER PRIMARY KEY)");
+	for (int bit = 0; bit < kCategoryBits; bit++) {
+		db.exec(fmt::format("INSERT INTO orm_count_bits (bit) VALUES ({})", bit));
+	}
+	// The patch triggers look up the lists containing a patch
+	db.exec("CREATE INDEX IF NOT EXISTS orm_count_patch_in_list ON patch_in_list (synth, md5, id)");
+	// Going from a duplicate name to its patches
+	db.exec("CREATE INDEX IF NOT EXISTS orm_count_patch_name ON patches (synth, name)");
+
+	db.exec("INSERT INTO orm_count_synth (synth, total, hidden, favorites) "
+		"SELECT synth, count(*), sum(IFNULL(hidden, 0) != 0), sum(IFNULL(favorite, 0) = 1 AND IFNULL(hidden, 0) = 0) FROM patches GROUP BY synth");
+	db.exec("INSERT INTO orm_count_category (synth, bit, visible) "
+		"SELECT p.synth, b.bit, count(*) FROM patches p JOIN orm_count_bits b ON (IFNULL(p.categories, 0) >> b.bit) & 1 "
+		"WHERE IFNULL(p.hidden, 0) = 0 GROUP BY p.synth, b.bit");
+	db.exec("INSERT INTO orm_count_list (id, synth, entries, visible) "
+		"SELECT l.id, l.synth, count(*), sum(EXISTS (SELECT 1 FROM patches p WHERE p.synth = l.synth AND p.md5 = l.md5 AND IFNULL(p.hidden, 0) = 0)) "
+		"FROM patch_in_list l GROUP BY l.id, l.synth");
+	db.exec("INSERT INTO orm_count_name (synth, name, total, hidden) "
+		"SELECT synth, IFNULL(name, ''), count(*), sum(IFNULL(hidden, 0) != 0) FROM patches GROUP BY synth, IFNULL(name, '')");
+
+	db.exec("CREATE TRIGGER orm_count_patch_insert AFTER INSERT ON patches BEGIN " + patchDelta("NEW", "+") + "END");
+	db.exec("CREATE TRIGGER orm_count_patch_delete AFTER DELETE ON patches BEGIN " + patchDelta("OLD", "-") + "END");
+	db.exec("CREATE TRIGGER orm_count_patch_update AFTER UPDATE OF synth, md5, name, hidden, favorite, categories ON patches BEGIN "
+		+ patchDelta("OLD", "-") + patchDelta("NEW", "+") + "END");
+	db.exec("CREATE TRIGGER orm_count_entry_insert AFTER INSERT ON patch_in_list BEGIN " + entryDelta("NEW", "+") + "END");
+	db.exec("CREATE TRIGGER orm_count_entry_delete AFTER DELETE ON patch_in_list BEGIN " + entryDelta("OLD", "-") + "END");
+	db.exec("CREATE TRIGGER orm_count_entry_update AFTER UPDATE OF id, synth, md5 ON patch_in_list BEGIN "
+		+ entryDelta("OLD", "-") + entryDelta("NEW", "+") + "END");
+	spdlog::debug("Created patch counters");
+}
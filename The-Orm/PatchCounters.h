@@ -0,0 +1,77 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace SQLite {
+	class Database;
+}
+
+class ReadConnectionPool;
+
+// Counter tables next to the patches, maintained by triggers inside the same transaction as every insert, delete and update
+// of patches and list entries - no matter which connection writes. Reading them is a primary key lookup instead of a scan.
+// Kept per synth (all, hidden, visible favorites), per synth and category bit (visible patches), per list and synth
+// (entries, entries whose patch is visible) and per synth and patch name (all, hidden), which gives the duplicate names.
+class PatchCounters {
+public:
+	struct SynthCounts {
+		int total = 0;
+		int hidden = 0;
+		int favorites = 0; // Not hidden
+	};
+
+	struct ListCounts {
+		int entries = 0;
+		int visible = 0;
+	};
+
+	// Patches whose name is used by another patch of the same synth
+	struct DuplicateCounts {
+		int patches = 0;
+		int visible = 0;
+	};
+
+	struct NameGroup {
+		std::string synth;
+		std::string name;
+		int total = 0;
+		int hidden = 0;
+	};
+
+	// Opens its own connection to the database file. The counters are created by the OrmSchema migration, this throws if it
+	// hasn't run yet. Reads go through a few read-only connections
+	explicit PatchCounters(std::string const& databaseFile);
+	~PatchCounters();
+
+	SynthCounts synth(std::string const& synthName);
+	int category(std::string const& synthName, int bitIndex);
+	ListCounts list(std::string const& listId, std::string const& synthName);
+	DuplicateCounts duplicates(std::string const& synthName);
+
+	// The names used more than once, ordered by synth and name. Pass the last group of a page to get the next one
+	std::vector<NameGroup> duplicateGroups(std::vector<std::string> const& synthNames, int limit, std::optional<NameGroup> const& after = {});
+
+	// Recount from scratch, e.g. when a writer bypassed the triggers
+	void rebuild();
+
+	// False if the counters or some of their triggers are missing
+	static bool installed(SQLite::Database& db);
+
+	// Drops and recreates the counters, counting all patches. This is a step of the OrmSchema migration
+	static void create(SQLite::Database& db);
+
+private:
+	std::mutex lock_; // Writes only, the reads go through the pool
+	std::unique_ptr<SQLite::Database> db_;
+	std::unique_ptr<ReadConnectionPool> reads_;
+};
@@ -0,0 +1,119 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchDeleteJob.h"
+
+#include "ProgressHandler.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+
+namespace {
+	const int kBusyTimeoutMs = 5000;
+	const int kResolvePageSize = 1000;
+	// Finding the patches is quick compared to deleting them
+	const double kResolveShare = 0.1;
+	// midikraft::PatchListType::IMPORT_LIST
+	const int kImportListType = 4;
+
+	void collectLists(SQLite::Database& db, std::string const& synth, std::vector<std::string> const& md5s, PatchDeleteJob::Delta& delta) {
+		std::string parameters;
+		for (size_t i = 0; i < md5s.size(); i++) {
+			parameters += fmt::format("{}:M{}", i == 0 ? "" : ", ", i);
+		}
+		SQLite::Statement query(db, fmt::format("SELECT DISTINCT e.id, l.list_type FROM patch_in_list e LEFT JOIN lists l ON l.id = e.id "
+			"WHERE e.synth = :SYN AND e.md5 IN ({})", parameters));
+		query.bind(":SYN", synth);
+		for (size_t i = 0; i < md5s.size(); i++) {
+			query.bind(fmt::format(":M{}", i), md5s[i]);
+		}
+		while (query.executeStep()) {
+			auto id = query.getColumn(0).getString();
+			delta.lists.insert(id);
+			if (!query.getColumn(1).isNull() && query.getColumn(1).getInt() == kImportListType) {
+				delta.imports.insert(id);
+			}
+		}
+	}
+}
+
+bool PatchDeleteJob::Delta::contains(std::string const& synth, std::string const& md5) const
+{
+	auto found = patches.find(synth);
+	return found != patches.end() && found->second.count(md5) > 0;
+}
+
+PatchDeleteJob::Delta PatchDeleteJob::run(std::string const& databaseFile, TResolve resolve, TDelete remove, int expectedTotal, midikraft::ProgressHandler* progress,
+	int chunkSize /* = 250 */)
+{
+	Delta delta;
+	try {
+		deleteChunks(databaseFile, resolve, remove, expectedTotal, progress, chunkSize, delta);
+	}
+	catch (std::exception const& e) {
+		// The chunks deleted so far stay deleted, the UI has to refresh them
+		spdlog::error("Deleting patches failed after {} of them: {}", delta.deleted + delta.hidden, e.what());
+		delta.failed = true;
+	}
+	return delta;
+}
+
+void PatchDeleteJob::deleteChunks(std::string const& databaseFile, TResolve const& resolve, TDelete const& remove, int expectedTotal,
+	midikraft::ProgressHandler* progress, int chunkSize, Delta& delta)
+{
+	auto aborted = [&]() {
+		if (progress && progress->shouldAbort()) {
+			delta.cancelled = true;
+		}
+		return delta.cancelled;
+	};
+
+	// Per synth, as the patches are deleted per synth
+	std::map<std::string, std::vector<std::string>> matching;
+	int total = 0;
+	if (progress) progress->setMessage("Finding the patches to delete...");
+	for (;;) {
+		if (aborted()) {
+			return;
+		}
+		auto page = resolve(total, kResolvePageSize);
+		for (auto const& key : page) {
+			matching[key.synth].push_back(key.md5);
+		}
+		total += static_cast<int>(page.size());
+		if (progress) progress->setProgressPercentage(kResolveShare * std::min(1.0, total / (double) std::max(1, expectedTotal)));
+		if (page.size() < static_cast<size_t>(kResolvePageSize)) {
+			break;
+		}
+	}
+
+	SQLite::Database db(databaseFile, SQLite::OPEN_READONLY, kBusyTimeoutMs);
+	int done = 0;
+	for (auto const& [synth, md5s] : matching) {
+		for (size_t first = 0; first < md5s.size(); first += chunkSize) {
+			if (aborted()) {
+				spdlog::info("Deleting patches cancelled after {} of {}", done, total);
+				return;
+			}
+			std::vector<std::string> chunk(md5s.begin() + first, md5s.begin() + std::min(md5s.size(), first + chunkSize));
+			if (progress) progress->setMessage(fmt::format("Deleting patches {} to {} of {}...", done + 1, done + chunk.size(), total));
+			// Before the entries are gone
+			collectLists(db, synth, chunk, delta);
+			// Also if the delete throws, the chunk may be gone in part and refreshing it does no harm
+			delta.patches[synth].insert(chunk.begin(), chunk.end());
+			auto [deleted, hidden] = remove(synth, chunk);
+			delta.deleted += deleted;
+			delta.hidden += hidden;
+			done += static_cast<int>(chunk.size());
+			if (progress) progress->setProgressPercentage(kResolveShare + (1.0 - kResolveShare) * done / total);
+		}
+	}
+}
@@ -0,0 +1,58 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace midikraft {
+	class ProgressHandler;
+}
+
+// Deletes the patches matching a filter in chunks, each in a transaction of its own, so other connections get their turn
+// in between and the progress can be shown. The matching patches are resolved up front, as deleting shifts the pages of
+// the filter. A cancelled job keeps the chunks deleted so far.
+//
+// The result is one delta for the UI, with the patches gone or hidden and the lists that had entries of them. An error stops
+// the job, the delta then has the chunks done until then.
+class PatchDeleteJob {
+public:
+	struct Key {
+		std::string synth;
+		std::string md5;
+	};
+
+	// The patches matching the filter from offset on, at most limit of them
+	typedef std::function<std::vector<Key>(int offset, int limit)> TResolve;
+	// Deletes patches of one synth, returns how many were deleted and how many were hidden instead because a bank refers to them
+	typedef std::function<std::pair<int, int>(std::string const& synth, std::vector<std::string> const& md5s)> TDelete;
+
+	struct Delta {
+		int deleted = 0;
+		int hidden = 0;
+		bool cancelled = false;
+		bool failed = false; // Stopped by an error, which was logged
+		std::map<std::string, std::set<std::string>> patches; // md5s per synth, deleted or hidden
+		std::set<std::string> lists; // Lists that had entries of these patches
+		std::set<std::string> imports; // Those of them that are imports
+
+		bool empty() const { return patches.empty(); }
+		bool contains(std::string const& synth, std::string const& md5) const;
+	};
+
+	// expectedTotal is only used for the progress
+	static Delta run(std::string const& databaseFile, TResolve resolve, TDelete remove, int expectedTotal, midikraft::ProgressHandler* progress,
+		int chunkSize = 250);
+
+private:
+	static void deleteChunks(std::string const& databaseFile, TResolve const& resolve, TDelete const& remove, int expectedTotal,
+		midikraft::ProgressHandler* progress, int chunkSize, Delta& delta);
+};
@@ -5,6 +5,8 @@
 #include "PatchView.h"
 #include "PatchDatabase.h"
 
+#include <algorithm>
+
 PatchHistoryPanel::PatchHistoryPanel(PatchView* patchView, midikraft::PatchDatabase *db) : patchView_(patchView), db_(db)
 	, buttonMode_(static_cast<PatchButtonInfo>(static_cast<int>(PatchButtonInfo::SubtitleSynth) | static_cast<int>(PatchButtonInfo::CenterName)))	
 {
@@ -44,6 +46,14 @@ void PatchHistoryPanel::refreshList()
 	history_->setPatchList(patchHistory_, buttonMode_);
 }
 
+void PatchHistoryPanel::refreshList(std::function<bool(midikraft::PatchHolder const&)> const& affected)
+{
+	auto patches = patchHistory_->patches();
+	if (std::any_of(patches.begin(), patches.end(), affected)) {
+		refreshList();
+	}
+}
+
 void PatchHistoryPanel::changeListenerCallback(ChangeBroadcaster* source)
 {
 	if (source == &UIModel::instance()->currentPatch_)
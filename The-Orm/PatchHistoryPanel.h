@@ -27,6 +27,8 @@ public:
 	virtual void resized() override;
 
 	void refreshList();
+	// Reloads the list only if it shows one of the patches
+	void refreshList(std::function<bool(midikraft::PatchHolder const&)> const& affected);
 
 private:
 	virtual void changeListenerCallback(ChangeBroadcaster* source) override;
@@ -125,7 +125,7 @@ private:
 };
 
 PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft::SynthHolder> const& synths)
-	: db_(db)
+	: db_(db), projection_(db)
 {
 	treeView_ = std::make_unique<TreeView>();
 	treeView_->setOpenCloseButtonsVisible(true);
@@ -338,6 +338,17 @@ void PatchListTree::refreshChildrenOfListId(std::string const& list_id, std::fun
 		});
 }
 
+void PatchListTree::refreshLists(std::set<std::string> const& listIds) {
+	MessageManager::callAsync([this, listIds] {
+		for (auto const& list_id : listIds) {
+			auto node = findNodeForListID(list_id);
+			if (node != nullptr) {
+				node->regenerate();
+			}
+		}
+	});
+}
+
 void PatchListTree::refreshParentOfListId(std::string const& list_id, std::function<void()> onFinished) {
 	MessageManager::callAsync([this, list_id, onFinished] {
 		auto node = findNodeForListID(list_id);
@@ -403,24 +414,34 @@ void PatchListTree::selectItemByPath(std::vector<std::string> const& path)
 	}
 }
 
-TreeViewNode* PatchListTree::newTreeViewItemForPatch(midikraft::ListInfo list, midikraft::PatchHolder patchHolder, int index) {
-	auto node = new TreeViewNode(patchHolder.name(), patchHolder.md5());
+TreeViewNode* PatchListTree::newTreeViewItemForPatch(midikraft::ListInfo list, PatchSummary patch, int index) {
+	auto node = new TreeViewNode(patch.name, patch.md5);
 	//TODO - this doesn't work. The TreeView from JUCE has no handlers for selected or clicked that do not fire if a drag is started, so 
 	// you can do either the one thing or the other.
-	node->onSelected = [this, patchHolder](String md5) {
+	node->onSelected = [this, patch](String md5) {
         juce::ignoreUnused(md5);
-		if (onPatchSelected)
-			onPatchSelected(patchHolder);
+		if (onPatchSelected) {
+			// Only now load the sysex data
+			auto synth = synths_.find(patch.synth);
+			if (synth == synths_.end()) {
+				spdlog::error("Synth unknown for patch {}: {}", patch.name, patch.synth);
+				return;
+			}
+			midikraft::PatchHolder patchHolder;
+			if (projection_.materialize(patch, synth->second.lock(), patchHolder)) {
+				onPatchSelected(patchHolder);
+			}
+		}
 	};
-	node->onItemDragged = [patchHolder, list, index]() {
+	node->onItemDragged = [patch, list, index]() {
 		nlohmann::json dragInfo{ { "drag_type", "PATCH_IN_LIST"},
 			{ "list_id", list.id},
 			{ "list_name", list.name},
 			{ "order_num", index },
-			{ "synth", patchHolder.smartSynth()->getName()},
-			{ "data_type", patchHolder.patch()->dataTypeID()},
-			{ "md5", patchHolder.md5()},
-			{ "patch_name", patchHolder.name() } };
+			{ "synth", patch.synth},
+			{ "data_type", patch.dataType},
+			{ "md5", patch.md5},
+			{ "patch_name", patch.name } };
 		return var(dragInfo.dump(-1, ' ', true, nlohmann::detail::error_handler_t::replace));
 	};
 	return node;
@@ -711,13 +732,15 @@ TreeViewNode* PatchListTree::newTreeViewItemForUserBank(std::shared_ptr<midikraf
 TreeViewNode* PatchListTree::newTreeViewItemForPatchList(midikraft::ListInfo list) {
 	auto node = new TreeViewNode(list.name, list.id);
 	node->onGenerateChildren = [this, list]() {
-		auto patchList = db_.getPatchList(list, synths_);
+		// Names are all the tree shows, the patches are loaded when selected
 		std::vector<TreeViewItem*> result;
-		if (patchList) {
-			int index = 0;
-			for (auto patch : patchList->patches()) {
-				result.push_back(newTreeViewItemForPatch(list, patch, index++));
+		int index = 0;
+		for (auto const& patch : projection_.list(list.id)) {
+			// Like getPatchList, skip the patches of synths not loaded
+			if (synths_.find(patch.synth) == synths_.end()) {
+				continue;
 			}
+			result.push_back(newTreeViewItemForPatch(list, patch, index++));
 		}
 		return result;
 	};
@@ -12,6 +12,9 @@
 #include "SynthHolder.h"
 #include "TreeViewNode.h"
 #include "CreateListDialog.h"
+#include "PatchProjection.h"
+
+#include <set>
 
 
 class PatchListTree : public Component, private ChangeListener {
@@ -42,6 +45,8 @@ public:
 	void refreshAllImports(std::function<void()> onFinished);
 	void refreshChildrenOfListId(std::string const& list_id, std::function<void()> onFinished);
 	void refreshParentOfListId(std::string const& list_id, std::function<void()> onFinished);
+	// Regenerates the nodes of the lists that are in the tree, the others load fresh when opened
+	void refreshLists(std::set<std::string> const& listIds);
 
 	void selectAllIfNothingIsSelected();
 	void selectItemByPath(std::vector<std::string> const& path);
@@ -58,7 +63,7 @@ private:
 	std::list<std::string> pathOfSelectedItem() const;
 	TreeViewNode* findNodeForListID(std::string const& list_id);
 
-	TreeViewNode* newTreeViewItemForPatch(midikraft::ListInfo list, midikraft::PatchHolder patchHolder, int index);
+	TreeViewNode* newTreeViewItemForPatch(midikraft::ListInfo list, PatchSummary patch, int index);
 	TreeViewNode* newTreeViewItemForSynthBanks(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
 	TreeViewNode* newTreeViewItemForStoredBanks(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
 	TreeViewNode* newTreeViewItemForImports(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
@@ -71,6 +76,7 @@ private:
 	//std::map<std::string, std::unique_ptr<XmlElement>> synthSpecificTreeState_;
 
 	midikraft::PatchDatabase& db_;
+	PatchProjection projection_;
 
 	std::unique_ptr<TreeView> treeView_;
 	TreeViewNode* allPatchesItem_;
@@ -0,0 +1,272 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchPager.h"
+
+#include "PatchDatabase.h"
+#include "OrmSchema.h"
+#include "PatchProjection.h"
+#include "PatchSearchIndex.h"
+#include "ReadConnectionPool.h"
+
+#include <SQLiteCpp/Database.h>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+	// A cursor is a handful of values, but a user paging through a huge library one page at a time shouldn't grow the map forever
+	const size_t kMaxCursors = 1024;
+
+}
+
+class PatchPager::PageJob : public ThreadPoolJob {
+public:
+	PageJob(PatchPager& pager, midikraft::PatchFilter filter, SearchQueryScheduler::Token token, int skip, int limit, TPageCallback callback, bool ranked, Load load) :
+		ThreadPoolJob("Patch page"), pager_(pager), filter_(std::move(filter)), token_(std::move(token)), skip_(skip), limit_(limit), callback_(std::move(callback)), ranked_(ranked), load_(load) {
+	}
+
+	JobStatus runJob() override {
+		try {
+			if (pager_.beforeRead_ && !token_.superseded()) {
+				pager_.beforeRead_(filter_);
+			}
+			auto patches = pager_.page(filter_, token_, skip_, limit_, ranked_, load_);
+			if (!token_.superseded()) {
+				callback_(patches);
+			}
+		}
+		catch (std::exception const& e) {
+			spdlog::error("Could not load the patches of the page: {}", e.what());
+		}
+		return jobHasFinished;
+	}
+
+private:
+	PatchPager& pager_;
+	midikraft::PatchFilter filter_;
+	SearchQueryScheduler::Token token_;
+	int skip_;
+	int limit_;
+	TPageCallback callback_;
+	bool ranked_;
+	Load load_;
+};
+
+PatchPager::PatchPager(midikraft::PatchDatabase& database, TBeforeRead beforeRead) : database_(database), beforeRead_(std::move(beforeRead)), migrated_(false), generation_(0), worker_(1), rankedGeneration_(0)
+{
+}
+
+PatchPager::~PatchPager()
+{
+	worker_.removeAllJobs(true, 5000);
+}
+
+std::vector<midikraft::PatchHolder> PatchPager::page(midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token, int skip, int limit, bool ranked, Load load)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	if (token.superseded()) {
+		return {};
+	}
+	auto query = PatchQuery::from(filter, ranked);
+	auto reads = query && limit > 0 ? pool() : nullptr;
+	if (reads) {
+		try {
+			auto lease = reads->acquire();
+			if (migrated(lease.db()) && (!query->ranked() || rank(lease.db(), filter, token))) {
+				SearchQueryScheduler::StatementInterrupter interrupter(lease.db().getHandle(), token);
+				if (token.generation() != generation_) {
+					generation_ = token.generation();
+					cursors_.clear();
+				}
+				// Start from the nearest page before that we have seen, or from the beginning
+				PatchQuery::Cursor from;
+				int at = 0;
+				auto known = cursors_.upper_bound(skip);
+				if (known != cursors_.begin()) {
+					--known;
+					at = known->first;
+					from = known->second;
+				}
+				auto start = query->advance(lease.db(), from, skip - at);
+				if (!start) {
+					return {};
+				}
+				remember(skip, *start);
+				PatchQuery::Cursor last;
+				auto keys = query->keys(lease.db(), *start, limit, &last);
+				if (!keys.empty()) {
+					remember(skip + static_cast<int>(keys.size()), last);
+				}
+				return load == Load::DisplayOnly ? summarize(lease.db(), filter, keys) : materialize(filter, keys);
+			}
+			if (!query->ranked() && !filter.onlyDuplicateNames) {
+				// Before the migration there are neither indexes to seek on nor a projection, but the order is the same as by cursor
+				SearchQueryScheduler::StatementInterrupter interrupter(lease.db().getHandle(), token);
+				return materialize(filter, query->keysByOffset(lease.db(), skip, limit));
+			}
+		}
+		catch (std::exception const& e) {
+			if (token.superseded()) {
+				// Interrupted, nobody waits for this page any more
+				return {};
+			}
+			spdlog::warn("Paging by cursor failed, falling back to offsets: {}", e.what());
+		}
+	}
+	return database_.getPatches(filter, skip, limit);
+}
+
+void PatchPager::requestPage(midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token, int skip, int limit, TPageCallback callback, bool ranked, Load load)
+{
+	worker_.addJob(new PageJob(*this, filter, token, skip, limit, std::move(callback), ranked, load), true);
+}
+
+std::optional<int> PatchPager::count(midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token, bool ranked)
+{
+	std::unique_lock<std::mutex> lock(lock_);
+	if (token.superseded()) {
+		return {};
+	}
+	auto query = PatchQuery::from(filter, ranked);
+	auto reads = query ? pool() : nullptr;
+	if (reads) {
+		try {
+			auto lease = reads->acquire();
+			if (migrated(lease.db()) && (!query->ranked() || rank(lease.db(), filter, token))) {
+				SearchQueryScheduler::StatementInterrupter interrupter(lease.db().getHandle(), token);
+				return query->count(lease.db());
+			}
+		}
+		catch (std::exception const& e) {
+			if (token.superseded()) {
+				return {};
+			}
+			spdlog::warn("Counting on the paging connection failed: {}", e.what());
+		}
+	}
+	// The PatchDatabase connection can't be interrupted, and doesn't need the pager
+	lock.unlock();
+	return database_.getPatchesCount(filter);
+}
+
+ReadConnectionPool* PatchPager::pool()
+{
+	auto file = String(database_.getCurrentDatabaseFileName()).toStdString();
+	if (file != databaseFile_) {
+		// Another database was opened, or this is the first call
+		databaseFile_ = file;
+		reads_.reset();
+		migrated_ = false;
+		cursors_.clear();
+		// The TEMP table goes with the connection
+		searchIndex_.reset();
+		rankedSearch_.clear();
+		try {
+			// One page at a time
+			reads_ = std::make_unique<ReadConnectionPool>(file, 1);
+		}
+		catch (std::exception const& e) {
+			spdlog::warn("Paging by cursor not available: {}", e.what());
+		}
+	}
+	return reads_.get();
+}
+
+bool PatchPager::migrated(SQLite::Database& db)
+{
+	if (!migrated_) {
+		// The paging indexes and the name counters come with the migration, retry until it is done
+		migrated_ = OrmSchema::upToDate(db);
+	}
+	return migrated_;
+}
+
+bool PatchPager::rank(SQLite::Database& db, midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token)
+{
+	auto search = PatchSearchIndex::matchExpression(filter.name);
+	if (search.empty() || !searchIndex(db)) {
+		return false;
+	}
+	std::vector<std::string> synths;
+	for (auto const& synth : filter.synths) {
+		synths.push_back(synth.first);
+		search += "|" + synth.first;
+	}
+	if (search == rankedSearch_ && token.generation() == rankedGeneration_) {
+		return true;
+	}
+	rankedSearch_.clear();
+	int matches = PatchSearchIndex::rank(db, filter.name, synths, PatchSearchIndex::kMaxRankedResults);
+	// The cursors point to places in the table
+	cursors_.clear();
+	rankedSearch_ = search;
+	rankedGeneration_ = token.generation();
+	if (matches > PatchSearchIndex::kMaxRankedResults && search != truncatedSearch_) {
+		spdlog::info("More than {0} patches match \"{1}\", only the {0} most relevant are shown. Add words to narrow the search, or sort by name to see all",
+			PatchSearchIndex::kMaxRankedResults, filter.name);
+		truncatedSearch_ = search;
+	}
+	return true;
+}
+
+bool PatchPager::searchIndex(SQLite::Database& db)
+{
+	if (!searchIndex_.has_value()) {
+		// The OrmSchema migration creates it, unless SQLite lacks FTS5
+		searchIndex_ = PatchSearchIndex::installed(db);
+		if (!*searchIndex_) {
+			spdlog::warn("Search index not available, searching by name only");
+		}
+	}
+	return *searchIndex_;
+}
+
+void PatchPager::remember(int offset, PatchQuery::Cursor const& cursor)
+{
+	if (offset == 0) {
+		// The start needs no cursor
+		return;
+	}
+	if (cursors_.size() >= kMaxCursors) {
+		cursors_.clear();
+	}
+	cursors_[offset] = cursor;
+}
+
+std::vector<midikraft::PatchHolder> PatchPager::materialize(midikraft::PatchFilter const& filter, std::vector<PatchQuery::Key> const& keys)
+{
+	std::vector<midikraft::PatchHolder> result;
+	result.reserve(keys.size());
+	for (auto const& key : keys) {
+		auto synth = filter.synths.find(key.synth);
+		auto loadedSynth = synth != filter.synths.end() ? synth->second.lock() : nullptr;
+		std::vector<midikraft::PatchHolder> loaded;
+		if (loadedSynth && database_.getSinglePatch(loadedSynth, key.md5, loaded) && loaded.size() == 1) {
+			result.push_back(loaded.front());
+		}
+		else {
+			// Deleted between reading the keys and loading it, the grid shows one patch less on this page
+			spdlog::debug("Patch {} of synth {} is no longer in the database", key.md5, key.synth);
+		}
+	}
+	return result;
+}
+
+std::vector<midikraft::PatchHolder> PatchPager::summarize(SQLite::Database& db, midikraft::PatchFilter const& filter, std::vector<PatchQuery::Key> const& keys)
+{
+	auto categories = database_.getCategories();
+	std::vector<midikraft::PatchHolder> result;
+	result.reserve(keys.size());
+	for (auto const& summary : PatchProjection::summaries(db, keys)) {
+		auto synth = filter.synths.find(summary.synth);
+		auto loadedSynth = synth != filter.synths.end() ? synth->second.lock() : nullptr;
+		if (loadedSynth) {
+			result.push_back(PatchProjection::displayOnly(summary, loadedSynth, categories));
+		}
+	}
+	return result;
+}
@@ -0,0 +1,97 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchFilter.h"
+#include "PatchHolder.h"
+#include "PatchQuery.h"
+#include "SearchQueryScheduler.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace midikraft {
+	class PatchDatabase;
+}
+
+namespace SQLite {
+	class Database;
+}
+
+class ReadConnectionPool;
+
+// Loads the pages of the patch grid. A filter with a PatchQuery translation is paged by cursor on a read connection of its
+// own: the keys of a page come from a range scan that continues after the last key of the page before, and only the patches
+// of the page are loaded from the PatchDatabase. The cursors are remembered per generation of the search, so going to the
+// next page, back, or jumping ahead from a known page doesn't walk the rows before it again. Before the OrmSchema migration
+// has run, the translation is paged by offset on the same connection, in the same order. Everything else is paged by offset
+// through the PatchDatabase as before. The queries on the pager's connection stop as soon as the token of their search is
+// superseded.
+//
+// Display only, the pager reads the summaries of the page from the covering index of PatchProjection instead of loading the
+// patches, so the cost of a page doesn't grow with the size of the patches. The grid loads the full patch on selection.
+//
+// A ranked search is ranked on the pager's connection by whichever of the count and the first page comes first, into a TEMP
+// table that lives as long as the connection. Without the search index, the name is matched as a substring as usual.
+class PatchPager {
+public:
+	typedef std::function<void(std::vector<midikraft::PatchHolder>)> TPageCallback;
+	typedef std::function<void(midikraft::PatchFilter const&)> TBeforeRead;
+
+	enum class Load {
+		Full,
+		DisplayOnly // PatchProjection::displayOnly patches where the page is paged by cursor, full patches otherwise
+	};
+
+	// beforeRead is called on the pager's thread before a requested page is read, e.g. to write pending edits it would read
+	explicit PatchPager(midikraft::PatchDatabase& database, TBeforeRead beforeRead = TBeforeRead());
+	~PatchPager();
+
+	// The patches skip to skip + limit of the filter, empty if the token is superseded. A new generation forgets the cursors
+	// and the ranking of the old one. Ranked, the name search is ordered by relevance and limited to the best matches
+	std::vector<midikraft::PatchHolder> page(midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token, int skip, int limit, bool ranked = false, Load load = Load::Full);
+
+	// Loads the page on the pager's thread, the callback is called there. Not at all if the token is superseded meanwhile
+	void requestPage(midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token, int skip, int limit, TPageCallback callback, bool ranked = false, Load load = Load::Full);
+
+	// The number of patches of the filter, counted on the pager's connection if the filter has a translation. Empty if the
+	// token was superseded
+	std::optional<int> count(midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token, bool ranked = false);
+
+private:
+	class PageJob;
+
+	ReadConnectionPool* pool();
+	bool migrated(SQLite::Database& db);
+	bool rank(SQLite::Database& db, midikraft::PatchFilter const& filter, SearchQueryScheduler::Token const& token);
+	bool searchIndex(SQLite::Database& db);
+	void remember(int offset, PatchQuery::Cursor const& cursor);
+	std::vector<midikraft::PatchHolder> materialize(midikraft::PatchFilter const& filter, std::vector<PatchQuery::Key> const& keys);
+	std::vector<midikraft::PatchHolder> summarize(SQLite::Database& db, midikraft::PatchFilter const& filter, std::vector<PatchQuery::Key> const& keys);
+
+	midikraft::PatchDatabase& database_;
+	TBeforeRead beforeRead_;
+	std::mutex lock_;
+	std::string databaseFile_;
+	std::unique_ptr<ReadConnectionPool> reads_;
+	bool migrated_;
+	uint64_t generation_;
+	std::map<int, PatchQuery::Cursor> cursors_; // Offset of a row -> cursor to continue from to get it
+	std::optional<bool> searchIndex_;
+	uint64_t rankedGeneration_;
+	std::string rankedSearch_; // The search in the ranked table, empty if none
+	std::string truncatedSearch_; // The last search reported to have too many matches
+	ThreadPool worker_;
+};
@@ -0,0 +1,193 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchProjection.h"
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+#include "ReadConnectionPool.h"
+#include "SynthBank.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <set>
+
+namespace {
+
+	const char* kSummaryColumns = "p.synth, p.md5, p.name, p.type, p.categories, p.favorite, p.hidden, p.midiBankNo, p.midiProgramNo, p.author";
+
+	// The summary columns, with synth and md5 first so a lookup by key is answered from the index
+	const char* kSummaryIndex = "orm_patch_summary";
+
+	PatchSummary readSummary(SQLite::Statement& query) {
+		PatchSummary summary;
+		summary.synth = query.getColumn(0).getString();
+		summary.md5 = query.getColumn(1).getString();
+		summary.name = query.getColumn(2).getString();
+		summary.dataType = query.getColumn(3).getInt();
+		summary.categories = static_cast<uint64_t>(query.getColumn(4).getInt64());
+		summary.favorite = query.getColumn(5).getInt() == 1;
+		summary.hidden = query.getColumn(6).getInt() == 1;
+		summary.bank = query.getColumn(7).isNull() ? -1 : query.getColumn(7).getInt();
+		summary.program = query.getColumn(8).isNull() ? -1 : query.getColumn(8).getInt();
+		summary.author = query.getColumn(9).getString();
+		return summary;
+	}
+
+	// Stands in for the patch data of a display only PatchHolder
+	class DisplayOnlyData : public midikraft::DataFile {
+	public:
+		explicit DisplayOnlyData(int dataType) : midikraft::DataFile(dataType, midikraft::Synth::PatchData()) {}
+	};
+
+}
+
+PatchProjection::PatchProjection(midikraft::PatchDatabase& database) : database_(database)
+{
+}
+
+PatchProjection::~PatchProjection() = default;
+
+std::vector<PatchSummary> PatchProjection::list(std::string const& listId)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	try {
+		auto reads = pool();
+		if (reads) {
+			auto lease = reads->acquire();
+			return list(lease.db(), listId);
+		}
+	}
+	catch (std::exception const& e) {
+		spdlog::error("Could not read the patches of list {}: {}", listId, e.what());
+	}
+	return {};
+}
+
+std::vector<PatchSummary> PatchProjection::list(SQLite::Database& db, std::string const& listId)
+{
+	// No PatchHolder and no Python patch object is built. Without the covering index, the columns after data make SQLite
+	// walk the overflow pages of large blobs
+	SQLite::Statement query(db, fmt::format("SELECT {} FROM patch_in_list l JOIN patches p {} ON p.synth = l.synth AND p.md5 = l.md5 "
+		"WHERE l.id = :ID ORDER BY l.order_num", kSummaryColumns, indexed(db) ? fmt::format("INDEXED BY {}", kSummaryIndex) : ""));
+	query.bind(":ID", listId);
+	std::vector<PatchSummary> result;
+	while (query.executeStep()) {
+		result.push_back(readSummary(query));
+	}
+	return result;
+}
+
+std::vector<PatchSummary> PatchProjection::summaries(SQLite::Database& db, std::vector<PatchQuery::Key> const& keys)
+{
+	// The planner prefers the primary key for the lookup, which reads the row
+	SQLite::Statement query(db, fmt::format("SELECT {} FROM patches p INDEXED BY {} WHERE p.synth = :SYN AND p.md5 = :MD5", kSummaryColumns, kSummaryIndex));
+	std::vector<PatchSummary> result;
+	result.reserve(keys.size());
+	for (auto const& key : keys) {
+		query.bind(":SYN", key.synth);
+		query.bind(":MD5", key.md5);
+		if (query.executeStep()) {
+			result.push_back(readSummary(query));
+		}
+		query.reset();
+	}
+	return result;
+}
+
+bool PatchProjection::materialize(PatchSummary const& summary, std::shared_ptr<midikraft::Synth> synth, midikraft::PatchHolder& result)
+{
+	if (!synth) {
+		return false;
+	}
+	std::vector<midikraft::PatchHolder> loaded;
+	if (database_.getSinglePatch(synth, summary.md5, loaded) && loaded.size() == 1) {
+		result = loaded.front();
+		return true;
+	}
+	spdlog::warn("Patch {} of synth {} is no longer in the database", summary.name, summary.synth);
+	return false;
+}
+
+midikraft::PatchHolder PatchProjection::displayOnly(PatchSummary const& summary, std::shared_ptr<midikraft::Synth> synth, std::vector<midikraft::Category> const& categories)
+{
+	midikraft::PatchHolder holder(synth, nullptr, std::make_shared<DisplayOnlyData>(summary.dataType));
+	holder.setName(summary.name);
+	holder.setAuthor(summary.author);
+	// Enough to draw the star, selecting the patch loads whether it was decided
+	holder.setFavorite(summary.favorite ? midikraft::Favorite(true) : midikraft::Favorite());
+	holder.setHidden(summary.hidden);
+	std::set<midikraft::Category> tagged;
+	for (auto const& category : categories) {
+		if (category.def() && category.def()->id >= 0 && category.def()->id < 64 && (summary.categories & (uint64_t(1) << category.def()->id))) {
+			tagged.insert(category);
+		}
+	}
+	holder.setCategories(tagged);
+	if (summary.bank >= 0) {
+		auto bank = MidiBankNumber::fromZeroBase(summary.bank, midikraft::SynthBank::numberOfPatchesInBank(synth, summary.bank));
+		holder.setBank(bank);
+		if (summary.program >= 0) {
+			holder.setPatchNumber(MidiProgramNumber::fromZeroBaseWithBank(bank, summary.program));
+		}
+	}
+	else if (summary.program >= 0) {
+		holder.setPatchNumber(MidiProgramNumber::fromZeroBase(summary.program));
+	}
+	return holder;
+}
+
+bool PatchProjection::isDisplayOnly(midikraft::PatchHolder const& patch)
+{
+	return std::dynamic_pointer_cast<DisplayOnlyData>(patch.patch()) != nullptr;
+}
+
+bool PatchProjection::materialize(midikraft::PatchDatabase& database, midikraft::PatchHolder& patch)
+{
+	std::vector<midikraft::PatchHolder> loaded;
+	if (patch.smartSynth() && database.getSinglePatch(patch.smartSynth(), patch.md5(), loaded) && loaded.size() == 1) {
+		patch = loaded.front();
+		return true;
+	}
+	spdlog::warn("Patch {} is no longer in the database", patch.name());
+	return false;
+}
+
+bool PatchProjection::indexed(SQLite::Database& db)
+{
+	SQLite::Statement query(db, "SELECT count(*) FROM sqlite_master WHERE type = 'index' AND name = :NAME");
+	query.bind(":NAME", kSummaryIndex);
+	return query.executeStep() && query.getColumn(0).getInt() == 1;
+}
+
+void PatchProjection::createIndex(SQLite::Database& db)
+{
+	db.exec(fmt::format("DROP INDEX IF EXISTS {}", kSummaryIndex));
+	db.exec(fmt::format("CREATE INDEX {} ON patches (synth, md5, name, type, categories, favorite, hidden, midiBankNo, midiProgramNo, author)", kSummaryIndex));
+}
+
+ReadConnectionPool* PatchProjection::pool()
+{
+	auto file = String(database_.getCurrentDatabaseFileName()).toStdString();
+	if (file != databaseFile_) {
+		// Another database was opened, or this is the first call
+		databaseFile_ = file;
+		reads_.reset();
+		try {
+			// The tree expands one node at a time on the message thread
+			reads_ = std::make_unique<ReadConnectionPool>(file, 1);
+		}
+		catch (std::exception const& e) {
+			spdlog::warn("Patch summaries not available: {}", e.what());
+		}
+	}
+	return reads_.get();
+}
@@ -0,0 +1,84 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "PatchQuery.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace midikraft {
+	class Category;
+	class PatchDatabase;
+	class PatchHolder;
+	class Synth;
+}
+
+namespace SQLite {
+	class Database;
+}
+
+class ReadConnectionPool;
+
+// The columns a view needs to show a patch, without the sysex data
+struct PatchSummary {
+	std::string synth;
+	std::string md5;
+	std::string name;
+	int dataType = 0;
+	uint64_t categories = 0; // Bit field of the category bitIndex
+	bool favorite = false;
+	bool hidden = false;
+	int bank = -1;
+	int program = -1;
+	std::string author;
+};
+
+// Reads patches as summaries. Loading a PatchHolder reads the blob and builds the synth specific patch, which for an
+// adaptation means calls into Python. A tree or grid showing only names doesn't need that, so it reads the summaries and
+// materializes the full patch only when one is selected, dragged or sent.
+//
+// The summary columns are stored after the blob in the patches rows, so reading them from the table follows the overflow
+// pages of large patches. The OrmSchema migration adds a covering index with them, and once it is there the summaries
+// are read from the index only, at a cost that doesn't grow with the size of the patches.
+class PatchProjection {
+public:
+	explicit PatchProjection(midikraft::PatchDatabase& database);
+	~PatchProjection();
+
+	// The patches of the list in list order. Entries whose patch is gone are skipped
+	std::vector<PatchSummary> list(std::string const& listId);
+	static std::vector<PatchSummary> list(SQLite::Database& db, std::string const& listId);
+
+	// The summaries of the keys in key order, read from the covering index. Keys whose patch is gone are skipped
+	static std::vector<PatchSummary> summaries(SQLite::Database& db, std::vector<PatchQuery::Key> const& keys);
+
+	// Loads the full patch of a summary. Returns false if it was deleted in the meantime
+	bool materialize(PatchSummary const& summary, std::shared_ptr<midikraft::Synth> synth, midikraft::PatchHolder& result);
+
+	// A PatchHolder showing the summary, without the sysex data of the patch. A grid can draw it, anything else has to load
+	// the full patch first. The categories are those of the PatchDatabase, the summary's bits select from them
+	static midikraft::PatchHolder displayOnly(PatchSummary const& summary, std::shared_ptr<midikraft::Synth> synth, std::vector<midikraft::Category> const& categories);
+	static bool isDisplayOnly(midikraft::PatchHolder const& patch);
+	// Replaces a display only patch with the full one. False if it was deleted in the meantime
+	static bool materialize(midikraft::PatchDatabase& database, midikraft::PatchHolder& patch);
+
+	// The covering index, an OrmSchema step
+	static bool indexed(SQLite::Database& db);
+	static void createIndex(SQLite::Database& db);
+
+private:
+	ReadConnectionPool* pool();
+
+	midikraft::PatchDatabase& database_;
+	std::mutex lock_;
+	std::string databaseFile_;
+	std::unique_ptr<ReadConnectionPool> reads_;
+};
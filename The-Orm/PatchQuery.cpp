@@ -0,0 +1,228 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchQuery.h"
+
+#include "PatchSearchIndex.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <fmt/format.h>
+
+#include <iterator>
+
+namespace {
+
+	// The same expressions as in the paging indexes of the OrmSchema, or they won't be used
+	const char* kName = "IFNULL(p.name, '')";
+	const char* kBank = "IFNULL(p.midiBankNo, -1)";
+	const char* kProgram = "IFNULL(p.midiProgramNo, -1)";
+	// The primary key of the patches breaks the ties of every ordering of patches, whether paged by cursor or by offset
+	const char* kSynth = "p.synth";
+	const char* kMd5 = "p.md5";
+
+	const char* kIndexes[] = { "orm_page_name", "orm_page_program", "orm_page_list" };
+
+	std::string joined(std::vector<std::string> const& parts, const char* separator) {
+		std::string result;
+		for (size_t i = 0; i < parts.size(); i++) {
+			result += (i == 0 ? "" : separator) + parts[i];
+		}
+		return result;
+	}
+
+}
+
+std::optional<PatchQuery> PatchQuery::from(midikraft::PatchFilter const& filter, bool ranked)
+{
+	// Within a list, a name is always matched as a substring
+	bool rankedName = ranked && !filter.name.empty() && filter.listID.empty();
+	if (filter.synths.empty() || (!filter.name.empty() && !rankedName) || !filter.categories.empty() || filter.onlyUntagged || filter.onlySpecifcType) {
+		return {};
+	}
+	// Either the default (everything but hidden), or all four visibility buttons pressed, which is everything
+	bool allVisibility = filter.onlyFaves && filter.showHidden && filter.showRegular && filter.showUndecided;
+	bool defaultVisibility = !filter.onlyFaves && !filter.showHidden && !filter.showRegular && !filter.showUndecided;
+	if (!allVisibility && !defaultVisibility) {
+		return {};
+	}
+
+	PatchQuery query;
+	std::vector<std::string> conditions;
+	if (rankedName) {
+		// The place is the rank, whatever ordering was chosen
+		query.from_ = fmt::format("temp.{} r JOIN patches p ON p.synth = r.synth AND p.md5 = r.md5", PatchSearchIndex::kRankedTable);
+		query.keyColumns_ = { "r.place" };
+		query.ranked_ = true;
+	}
+	else if (!filter.listID.empty()) {
+		// Lists may hold a patch several times, only the place in list tells the entries apart
+		if (filter.orderBy != midikraft::PatchOrdering::Order_by_Place_in_List) {
+			return {};
+		}
+		query.from_ = "patch_in_list l JOIN patches p ON p.synth = l.synth AND p.md5 = l.md5";
+		conditions.push_back("l.id = :LIST");
+		query.parameters_.emplace_back(":LIST", filter.listID);
+		query.keyColumns_ = { "l.order_num", "l.rowid" };
+	}
+	else {
+		query.from_ = "patches p";
+		switch (filter.orderBy) {
+		case midikraft::PatchOrdering::Order_by_Name:
+			query.keyColumns_ = { kName, kBank, kProgram };
+			query.expressionKey_ = true;
+			break;
+		case midikraft::PatchOrdering::Order_by_ProgramNo:
+		case midikraft::PatchOrdering::Order_by_BankNo:
+			query.keyColumns_ = { kBank, kProgram, kName };
+			query.expressionKey_ = true;
+			break;
+		case midikraft::PatchOrdering::No_ordering:
+			break;
+		default:
+			// The import order needs the import lists, and without a list there is no place in list
+			return {};
+		}
+		query.keyColumns_.push_back(kSynth);
+		query.keyColumns_.push_back(kMd5);
+	}
+	if (filter.onlyDuplicateNames) {
+		// The names used more than once within their synth, hidden patches included, are kept by the PatchCounters
+		query.from_ += " JOIN orm_count_name d ON d.synth = p.synth AND d.name = IFNULL(p.name, '') AND d.total > 1";
+	}
+
+	std::vector<std::string> synths;
+	for (auto const& synth : filter.synths) {
+		auto parameter = fmt::format(":S{}", synths.size());
+		synths.push_back(parameter);
+		query.parameters_.emplace_back(parameter, synth.first);
+	}
+	// The unary plus keeps the planner from seeking on the synth and sorting all its patches for every page, the range scan
+	// on the key is what makes a page cheap
+	conditions.push_back("+p.synth IN (" + joined(synths, ", ") + ")");
+	if (defaultVisibility) {
+		conditions.push_back("IFNULL(p.hidden, 0) = 0");
+	}
+	query.where_ = joined(conditions, " AND ");
+	return query;
+}
+
+std::vector<PatchQuery::Key> PatchQuery::keys(SQLite::Database& db, Cursor const& after, int limit, Cursor* last) const
+{
+	SQLite::Statement query(db, select("p.synth, p.md5, " + joined(keyColumns_, ", "), after) + " LIMIT :LIMIT");
+	bind(query, after);
+	query.bind(":LIMIT", limit);
+	std::vector<Key> result;
+	while (query.executeStep()) {
+		result.push_back({ query.getColumn(0).getString(), query.getColumn(1).getString() });
+		if (last) {
+			*last = cursorOf(query, 2);
+		}
+	}
+	return result;
+}
+
+std::optional<PatchQuery::Cursor> PatchQuery::advance(SQLite::Database& db, Cursor const& from, int rows) const
+{
+	if (rows <= 0) {
+		return from;
+	}
+	SQLite::Statement query(db, select(joined(keyColumns_, ", "), from) + " LIMIT 1 OFFSET :SKIP");
+	bind(query, from);
+	query.bind(":SKIP", rows - 1);
+	if (query.executeStep()) {
+		return cursorOf(query, 0);
+	}
+	return {};
+}
+
+int PatchQuery::count(SQLite::Database& db) const
+{
+	SQLite::Statement query(db, "SELECT count(*) FROM " + from_ + " WHERE " + where_);
+	bind(query, {});
+	return query.executeStep() ? query.getColumn(0).getInt() : 0;
+}
+
+std::vector<PatchQuery::Key> PatchQuery::keysByOffset(SQLite::Database& db, int offset, int limit) const
+{
+	SQLite::Statement query(db, select("p.synth, p.md5", {}) + " LIMIT :LIMIT OFFSET :SKIP");
+	bind(query, {});
+	query.bind(":LIMIT", limit);
+	query.bind(":SKIP", offset);
+	std::vector<Key> result;
+	while (query.executeStep()) {
+		result.push_back({ query.getColumn(0).getString(), query.getColumn(1).getString() });
+	}
+	return result;
+}
+
+bool PatchQuery::indexed(SQLite::Database& db)
+{
+	SQLite::Statement query(db, "SELECT count(*) FROM sqlite_master WHERE type = 'index' AND name LIKE 'orm_page_%'");
+	int indexes = query.executeStep() ? query.getColumn(0).getInt() : 0;
+	return indexes == static_cast<int>(std::size(kIndexes));
+}
+
+void PatchQuery::createIndexes(SQLite::Database& db)
+{
+	for (auto index : kIndexes) {
+		db.exec(fmt::format("DROP INDEX IF EXISTS {}", index));
+	}
+	// The key expressions of the orderings, the table alias doesn't matter to the planner
+	db.exec("CREATE INDEX orm_page_name ON patches (IFNULL(name, ''), IFNULL(midiBankNo, -1), IFNULL(midiProgramNo, -1), synth, md5, hidden)");
+	db.exec("CREATE INDEX orm_page_program ON patches (IFNULL(midiBankNo, -1), IFNULL(midiProgramNo, -1), IFNULL(name, ''), synth, md5, hidden)");
+	db.exec("CREATE INDEX orm_page_list ON patch_in_list (id, order_num)");
+}
+
+std::string PatchQuery::select(std::string const& columns, Cursor const& after) const
+{
+	std::string where = where_;
+	if (!after.empty()) {
+		std::vector<std::string> values;
+		for (size_t i = 0; i < after.size(); i++) {
+			values.push_back(fmt::format(":C{}", i));
+		}
+		// Row values compare column by column, which is exactly the order of the key. SQLite seeks on a row value only if the
+		// columns are plain columns, the bound on the first one alone lets it seek on the expression indexes as well
+		if (expressionKey_) {
+			where += " AND " + keyColumns_[0] + " >= :C0";
+		}
+		where += " AND (" + joined(keyColumns_, ", ") + ") > (" + joined(values, ", ") + ")";
+	}
+	return "SELECT " + columns + " FROM " + from_ + " WHERE " + where + " ORDER BY " + joined(keyColumns_, ", ");
+}
+
+void PatchQuery::bind(SQLite::Statement& query, Cursor const& after) const
+{
+	for (auto const& [name, value] : parameters_) {
+		query.bind(name, value);
+	}
+	for (size_t i = 0; i < after.size(); i++) {
+		auto name = fmt::format(":C{}", i);
+		if (std::holds_alternative<int64_t>(after[i])) {
+			query.bind(name, static_cast<long long>(std::get<int64_t>(after[i])));
+		}
+		else {
+			query.bind(name, std::get<std::string>(after[i]));
+		}
+	}
+}
+
+PatchQuery::Cursor PatchQuery::cursorOf(SQLite::Statement& query, int firstColumn) const
+{
+	Cursor cursor;
+	for (size_t i = 0; i < keyColumns_.size(); i++) {
+		auto column = query.getColumn(firstColumn + static_cast<int>(i));
+		if (column.isInteger()) {
+			cursor.emplace_back(static_cast<int64_t>(column.getInt64()));
+		}
+		else {
+			cursor.emplace_back(column.getString());
+		}
+	}
+	return cursor;
+}
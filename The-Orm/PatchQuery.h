@@ -0,0 +1,78 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "PatchFilter.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace SQLite {
+	class Database;
+	class Statement;
+}
+
+// The filters of the patch grid as SQL over the patches table, so they can run on connections of our own. Only the part of
+// PatchFilter whose meaning is pinned down by tests is translated: synths, the default or the all visibility, a list in
+// list order and the duplicate names. Anything else - a name, categories, type, other visibility combinations, import order
+// - has no translation, and has to go through the PatchDatabase. The one exception is a ranked name search, which joins the
+// matches the PatchSearchIndex ranked into a TEMP table of the connection beforehand, in rank order.
+//
+// Every ordering is completed into a total order by tie-breakers, see docs/patchdatabase_keyset_paging.md, which allows
+// paging by cursor: a page continues after the key of the last row of the page before, an index range scan however deep
+// into the result it is. Orderings of patches end in (synth, md5), and keysByOffset orders by the same key, so both ways of
+// paging return the same rows in the same order. The duplicate names need the OrmSchema migration.
+class PatchQuery {
+public:
+	typedef std::variant<int64_t, std::string> Value;
+	// Values of the key columns of a row. Empty is before the first row
+	typedef std::vector<Value> Cursor;
+
+	struct Key {
+		std::string synth;
+		std::string md5;
+	};
+
+	// Empty if the filter has no translation. Ranked, a name outside of a list is looked up in the ranked matches
+	static std::optional<PatchQuery> from(midikraft::PatchFilter const& filter, bool ranked = false);
+
+	// Reads the ranked matches, which have to be on the connection before running it
+	bool ranked() const { return ranked_; }
+
+	// At most limit rows after the cursor. The cursor of the last row returned goes to last, if given
+	std::vector<Key> keys(SQLite::Database& db, Cursor const& after, int limit, Cursor* last = nullptr) const;
+
+	// The cursor of the row rows after the cursor, reading the key columns only. Empty if there are fewer rows
+	std::optional<Cursor> advance(SQLite::Database& db, Cursor const& from, int rows) const;
+
+	int count(SQLite::Database& db) const;
+
+	// Up to limit rows from offset on, as the offset path would page
+	std::vector<Key> keysByOffset(SQLite::Database& db, int offset, int limit) const;
+
+	// The indexes the orderings seek on, with hidden for the default visibility. A step of the OrmSchema migration
+	static bool indexed(SQLite::Database& db);
+	static void createIndexes(SQLite::Database& db);
+
+private:
+	PatchQuery() = default;
+
+	std::string select(std::string const& columns, Cursor const& after) const;
+	void bind(SQLite::Statement& query, Cursor const& after) const;
+	Cursor cursorOf(SQLite::Statement& query, int firstColumn) const;
+
+	std::string from_;
+	std::string where_;
+	std::vector<std::string> keyColumns_;
+	bool expressionKey_ = false;
+	bool ranked_ = false;
+	std::vector<std::pair<std::string, std::string>> parameters_;
+};
@@ -0,0 +1,253 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchReindexer.h"
+
+#include "ProgressHandler.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace {
+	const int kBusyTimeoutMs = 5000;
+	const int kBatchSize = 64;
+	const int kProgressIntervalMs = 50;
+	// The compute phase is most of the work
+	const double kComputeShare = 0.9;
+	// Not a valid md5, so it can't collide with one
+	const char* kMovingPrefix = "orm-reindex:";
+
+	int countPatches(SQLite::Database& db, std::string const& synth) {
+		SQLite::Statement query(db, "SELECT count(*) FROM patches WHERE synth = :SYN");
+		query.bind(":SYN", synth);
+		return query.executeStep() ? query.getColumn(0).getInt() : 0;
+	}
+}
+
+PatchReindexer::Result PatchReindexer::reindex(std::string const& databaseFile, std::string const& synth, TFingerprint fingerprint, midikraft::ProgressHandler* progress, int threads /* = 0 */)
+{
+	Result result;
+	std::vector<Mapping> mappings;
+	{
+		SQLite::Database reader(databaseFile, SQLite::OPEN_READONLY, kBusyTimeoutMs);
+		result.before = countPatches(reader, synth);
+		if (progress) progress->setMessage(fmt::format("Computing the fingerprints of {} patches...", result.before));
+		if (!compute(reader, synth, fingerprint, threads, progress, mappings, result.failed)) {
+			result.cancelled = true;
+			result.after = result.before;
+			return result;
+		}
+	}
+	if (progress) progress->setMessage(fmt::format("Moving {} patches to their new fingerprint...", mappings.size()));
+	SQLite::Database writer(databaseFile, SQLite::OPEN_READWRITE, kBusyTimeoutMs);
+	result.after = merge(writer, synth, mappings);
+	result.changed = static_cast<int>(mappings.size());
+	if (progress) progress->setProgressPercentage(1.0);
+	return result;
+}
+
+bool PatchReindexer::compute(SQLite::Database& db, std::string const& synth, TFingerprint fingerprint, int threads, midikraft::ProgressHandler* progress,
+	std::vector<Mapping>& outMappings, int& outFailed)
+{
+	struct Row {
+		std::string md5;
+		std::vector<uint8_t> data;
+		int programNo;
+	};
+
+	int total = countPatches(db, synth);
+	if (threads <= 0) {
+		threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	}
+	threads = std::max(1, std::min(threads, total / kBatchSize + 1));
+
+	// Keyset paging on the primary key, every batch is a statement of its own and holds no transaction afterwards
+	std::mutex readLock;
+	std::string after;
+	bool exhausted = false;
+	auto nextBatch = [&](std::vector<Row>& batch) {
+		std::lock_guard<std::mutex> lock(readLock);
+		batch.clear();
+		if (exhausted) {
+			return false;
+		}
+		SQLite::Statement query(db, "SELECT md5, data, midiProgramNo FROM patches WHERE synth = :SYN AND md5 > :AFT ORDER BY md5 LIMIT :LIM");
+		query.bind(":SYN", synth);
+		query.bind(":AFT", after);
+		query.bind(":LIM", kBatchSize);
+		while (query.executeStep()) {
+			auto data = query.getColumn(1);
+			auto bytes = static_cast<const uint8_t*>(data.getBlob());
+			auto program = query.getColumn(2);
+			batch.push_back({ query.getColumn(0).getString(), std::vector<uint8_t>(bytes, bytes + data.getBytes()), program.isNull() ? -1 : program.getInt() });
+		}
+		exhausted = batch.size() < static_cast<size_t>(kBatchSize);
+		if (!batch.empty()) {
+			after = batch.back().md5;
+		}
+		return !batch.empty();
+	};
+
+	std::atomic<int> done(0);
+	std::atomic<int> failed(0);
+	std::atomic<int> running(threads);
+	std::atomic<bool> cancel(false);
+	std::mutex resultLock;
+	std::exception_ptr error;
+	outMappings.clear();
+	auto work = [&]() {
+		std::vector<Mapping> mappings;
+		try {
+			std::vector<Row> batch;
+			while (!cancel && nextBatch(batch)) {
+				for (auto const& row : batch) {
+					if (cancel) break;
+					std::string newMd5;
+					try {
+						newMd5 = fingerprint(row.data, row.programNo);
+					}
+					catch (std::exception const& e) {
+						spdlog::warn("Could not compute the fingerprint of patch {}: {}", row.md5, e.what());
+					}
+					if (newMd5.empty()) {
+						failed++;
+					}
+					else if (newMd5 != row.md5) {
+						mappings.push_back({ row.md5, newMd5 });
+					}
+					done++;
+				}
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(resultLock);
+			error = std::current_exception();
+			cancel = true;
+		}
+		{
+			std::lock_guard<std::mutex> lock(resultLock);
+			outMappings.insert(outMappings.end(), mappings.begin(), mappings.end());
+		}
+		running--;
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; i++) {
+		workers.emplace_back(work);
+	}
+	// Progress and cancellation stay on the calling thread
+	bool cancelled = false;
+	while (running > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(kProgressIntervalMs));
+		if (progress) {
+			progress->setProgressPercentage(total > 0 ? kComputeShare * done / total : kComputeShare);
+			if (!cancelled && progress->shouldAbort()) {
+				cancelled = true;
+				cancel = true;
+			}
+		}
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	outFailed = failed;
+	return !cancelled;
+}
+
+int PatchReindexer::merge(SQLite::Database& db, std::string const& synth, std::vector<Mapping> const& mappings)
+{
+	SQLite::Transaction transaction(db);
+	db.exec("CREATE TEMP TABLE IF NOT EXISTS orm_reindex (old TEXT PRIMARY KEY, new TEXT NOT NULL)");
+	db.exec("DELETE FROM temp.orm_reindex");
+	{
+		SQLite::Statement insert(db, "INSERT INTO temp.orm_reindex (old, new) VALUES (:OLD, :NEW)");
+		for (auto const& mapping : mappings) {
+			insert.bind(":OLD", mapping.oldMd5);
+			insert.bind(":NEW", mapping.newMd5);
+			insert.exec();
+			insert.reset();
+		}
+	}
+
+	// Out of the way first, so a patch can take over the md5 another one is leaving
+	{
+		SQLite::Statement moveAside(db, "UPDATE patches SET md5 = :PRE || md5 WHERE synth = :SYN AND md5 IN (SELECT old FROM temp.orm_reindex)");
+		moveAside.bind(":PRE", kMovingPrefix);
+		moveAside.bind(":SYN", synth);
+		moveAside.exec();
+	}
+
+	SQLite::Statement exists(db, "SELECT count(*) FROM patches WHERE synth = :SYN AND md5 = :NEW");
+	SQLite::Statement move(db, "UPDATE patches SET md5 = :NEW WHERE synth = :SYN AND md5 = :PRE || :OLD");
+	// The same patch twice: keep the row already there, and whatever either copy was marked with. A column the user sets that
+	// the PatchDatabase adds to patches, or another table of it keyed by md5, needs handling here
+	auto moving = [](std::string const& column) {
+		return "(SELECT " + column + " FROM patches WHERE synth = :SYN AND md5 = :PRE || :OLD)";
+	};
+	SQLite::Statement combine(db, fmt::format("UPDATE patches SET "
+		"favorite = max(coalesce(favorite, 0), coalesce({0}, 0)), "
+		"hidden = min(coalesce(hidden, 0), coalesce({1}, 0)), "
+		"categories = coalesce(categories, 0) | coalesce({2}, 0), "
+		"categoryUserDecision = coalesce(categoryUserDecision, 0) | coalesce({3}, 0) "
+		"WHERE synth = :SYN AND md5 = :NEW", moving("favorite"), moving("hidden"), moving("categories"), moving("categoryUserDecision")));
+	SQLite::Statement remove(db, "DELETE FROM patches WHERE synth = :SYN AND md5 = :PRE || :OLD");
+	auto run = [&](SQLite::Statement& statement, std::string const& oldMd5, std::string const& newMd5) {
+		statement.bind(":SYN", synth);
+		if (&statement != &remove) {
+			statement.bind(":NEW", newMd5);
+		}
+		statement.bind(":PRE", kMovingPrefix);
+		statement.bind(":OLD", oldMd5);
+		statement.exec();
+		statement.reset();
+	};
+
+	SQLite::Statement query(db, "SELECT old, new FROM temp.orm_reindex ORDER BY new, old");
+	int merged = 0;
+	while (query.executeStep()) {
+		auto oldMd5 = query.getColumn(0).getString();
+		auto newMd5 = query.getColumn(1).getString();
+		exists.bind(":SYN", synth);
+		exists.bind(":NEW", newMd5);
+		bool taken = exists.executeStep() && exists.getColumn(0).getInt() > 0;
+		exists.reset();
+		if (taken) {
+			run(combine, oldMd5, newMd5);
+			run(remove, oldMd5, newMd5);
+			merged++;
+		}
+		else {
+			run(move, oldMd5, newMd5);
+		}
+	}
+
+	// All list entries in one statement, so a chain of moves can't move an entry twice
+	{
+		SQLite::Statement entries(db, "UPDATE patch_in_list SET md5 = (SELECT new FROM temp.orm_reindex WHERE old = patch_in_list.md5) "
+			"WHERE synth = :SYN AND md5 IN (SELECT old FROM temp.orm_reindex)");
+		entries.bind(":SYN", synth);
+		entries.exec();
+	}
+	db.exec("DELETE FROM temp.orm_reindex");
+	int after = countPatches(db, synth);
+	transaction.commit();
+	spdlog::info("Reindexed {} patches of {}, {} of them merged into a patch with the same fingerprint", mappings.size(), synth, merged);
+	return after;
+}
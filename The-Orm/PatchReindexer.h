@@ -0,0 +1,62 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace midikraft {
+	class ProgressHandler;
+}
+
+namespace SQLite {
+	class Database;
+}
+
+// Recomputes the fingerprints of the patches of a synth, in two phases. The compute phase reads the patches in batches from
+// a read-only connection without holding a transaction, and fingerprints them on a pool of threads. It produces the patches
+// whose md5 changed, and can be cancelled without having written anything. The merge phase then moves the patches to their
+// new md5 in one short transaction, merges patches that turn out to be the same, and rewrites their list entries. Everything
+// else keyed by md5 follows through the triggers on patches.
+//
+// The fingerprints are computed on one thread unless the caller knows the fingerprint function is safe to call on several
+// at once. The app doesn't: the synths parse the data with code that was written for the message thread, and all calls into
+// a Python adaptation go through the one interpreter of its module anyway.
+//
+// The merge phase writes the PatchDatabase tables directly. Its SQL knows which columns of patches to combine and that
+// patch_in_list is the only other table keyed by md5 - it has to change with the PatchDatabase schema.
+class PatchReindexer {
+public:
+	// Returns the fingerprint of the patch data, or an empty string if it can't be computed. Called on as many threads at once
+	// as reindex() was given
+	typedef std::function<std::string(std::vector<uint8_t> const& data, int programNo)> TFingerprint;
+
+	struct Mapping {
+		std::string oldMd5;
+		std::string newMd5;
+	};
+
+	struct Result {
+		bool cancelled = false;
+		int before = 0;
+		int after = 0;
+		int changed = 0; // Patches with a new md5
+		int failed = 0; // Patches without a fingerprint, left as they are
+	};
+
+	// threads 0 uses one per core
+	static Result reindex(std::string const& databaseFile, std::string const& synth, TFingerprint fingerprint, midikraft::ProgressHandler* progress, int threads = 1);
+
+	// The patches of the synth whose fingerprint differs from their md5. Returns false if cancelled
+	static bool compute(SQLite::Database& db, std::string const& synth, TFingerprint fingerprint, int threads, midikraft::ProgressHandler* progress,
+		std::vector<Mapping>& outMappings, int& outFailed);
+
+	// Returns the number of patches of the synth afterwards. Keep in sync with the PatchDatabase schema, see above
+	static int merge(SQLite::Database& db, std::string const& synth, std::vector<Mapping> const& mappings);
+};
@@ -18,11 +18,15 @@ namespace {
 
 	//const char* kAllDataTypesFilter = "All types";
 
+	// Not a PatchOrdering - the PatchView ranks name searches through the search index, and sorts by name without a search
+	const int kSortByRelevance = 100;
+
 	std::vector<std::pair<String, int>> kSortChoices = {
 		{ "Sort by import", static_cast<int>(midikraft::PatchOrdering::Order_by_Import_id)},
 		{ "Sort by name", static_cast<int>(midikraft::PatchOrdering::Order_by_Name)},
 		{ "Sort by program #", static_cast<int>(midikraft::PatchOrdering::Order_by_ProgramNo)},
 		{ "Sort by bank #", static_cast<int>(midikraft::PatchOrdering::Order_by_BankNo)},
+		{ "Sort by relevance", kSortByRelevance},
 	};
 
 	std::vector<std::pair<String, int>> kDisplayChoices = {
@@ -58,7 +62,7 @@ public:
 	AdvancedFilterPanel(PatchView* patchView) :
 		synthFilters_({}, [patchView](CategoryButtons::Category, TouchButtonFunction f) {
 		juce::ignoreUnused(f);
-		patchView->retrieveFirstPageFromDatabase();
+		patchView->retrieveFirstPageFromDatabase(true);
 	}, false, true)
 	{
 		addAndMakeVisible(synthFilters_);
@@ -88,13 +92,13 @@ PatchSearchComponent::PatchSearchComponent(PatchView* patchView, PatchButtonPane
         multiModeFilter_({}),
         patchView_(patchView),
         patchButtons_(patchButtons),
-        textSearch_([this]() { updateCurrentFilter(); patchView_->retrieveFirstPageFromDatabase();  }),
+        textSearch_([this]() { updateCurrentFilter(); patchView_->retrieveFirstPageFromDatabase(true);  }),
         categoryFilters_({}, [this](CategoryButtons::Category cat, TouchButtonFunction f) { 
 	if (f == TouchButtonFunction::SECONDARY) {
 		categoryFilters_.setActive({ cat });
 	}
 			updateCurrentFilter(); 
-			patchView_->retrieveFirstPageFromDatabase(); 
+			patchView_->retrieveFirstPageFromDatabase(true); 
 		}, true, true),
         database_(database)
 {
@@ -209,7 +213,7 @@ void PatchSearchComponent::unclickAllButtons() {
 	}
 	// Make sure to keep the sort order
 	auto defaultFilter = midikraft::PatchFilter(synthList);
-	defaultFilter.orderBy = static_cast<midikraft::PatchOrdering>(orderByType_.getSelectedId());
+	defaultFilter.orderBy = selectedOrdering();
 	loadFilter(defaultFilter);
 }
 
@@ -295,9 +299,11 @@ void PatchSearchComponent::loadFilter(midikraft::PatchFilter filter) {
 	// Set name filter
 	textSearch_.setSearchText(filter.name);
 
-	// Set sort order
-	int selectedOrder = static_cast<int>(filter.orderBy);
-	orderByType_.setSelectedId(selectedOrder, dontSendNotification);
+	// Set sort order. Ranking is not part of the filter, so it stays on until chosen otherwise
+	if (!rankedSearch()) {
+		int selectedOrder = static_cast<int>(filter.orderBy);
+		orderByType_.setSelectedId(selectedOrder, dontSendNotification);
+	}
 }
 
 bool PatchSearchComponent::isInMultiSynthMode() {
@@ -386,8 +392,7 @@ midikraft::PatchFilter PatchSearchComponent::buildFilter() const
 
 	// Setup sort order
 	//midikraft::PatchOrdering sortOrder = filter.onlyDuplicateNames ? midikraft::PatchOrdering::Order_by_Name : midikraft::PatchOrdering::Order_by_Import_id;
-	auto selectedSortOrder = static_cast<midikraft::PatchOrdering>(orderByType_.getSelectedId());
-	filter.orderBy = selectedSortOrder;
+	filter.orderBy = selectedOrdering();
 	return filter;
 }
 
@@ -467,3 +472,16 @@ juce::String PatchSearchComponent::advancedTextSearch() const
 	return textSearch_.searchText();
 }
 
+bool PatchSearchComponent::rankedSearch() const
+{
+	return orderByType_.getSelectedId() == kSortByRelevance;
+}
+
+midikraft::PatchOrdering PatchSearchComponent::selectedOrdering() const
+{
+	if (rankedSearch()) {
+		return midikraft::PatchOrdering::Order_by_Name;
+	}
+	return static_cast<midikraft::PatchOrdering>(orderByType_.getSelectedId());
+}
+
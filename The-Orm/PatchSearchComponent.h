@@ -31,6 +31,9 @@ public:
 	void rebuildDataTypeFilterBox();
 
 	String advancedTextSearch() const;
+
+	// "Sort by relevance" is selected, name searches should be ranked
+	bool rankedSearch() const;
 	
 private:
 	void refreshWithFunction(TouchButtonFunction f, ToggleButton& buttonPressed);
@@ -39,6 +42,7 @@ private:
 	static bool isInMultiSynthMode();
 	void updateCurrentFilter(); 
 	midikraft::PatchFilter buildFilter() const;
+	midikraft::PatchOrdering selectedOrdering() const;
 
 	std::map<std::string, midikraft::PatchFilter> synthSpecificFilter_; // We store one filter per synth
 	midikraft::PatchFilter multiModeFilter_; // The filter used when in multi synth mode
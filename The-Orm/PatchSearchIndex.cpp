@@ -0,0 +1,222 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchSearchIndex.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include <sqlite3.h>
+
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+#include <cctype>
+#include <iterator>
+
+const char* PatchSearchIndex::kRankedTable = "orm_ranked";
+
+namespace {
+
+	const char* kTriggers[] = {
+		"orm_search_patch_insert", "orm_search_patch_delete", "orm_search_patch_update",
+		"orm_search_entry_insert", "orm_search_entry_delete", "orm_search_entry_update",
+		"orm_search_list_insert", "orm_search_list_delete", "orm_search_list_update",
+		"orm_search_category_insert", "orm_search_category_delete", "orm_search_category_update"
+	};
+
+	const int kImportListType = 4;
+
+	// The indexed text of the patches p, rowid first
+	std::string document() {
+		return fmt::format("SELECT k.id, p.name, "
+			"(SELECT group_concat(c.name) FROM categories c WHERE (IFNULL(p.categories, 0) >> c.bitIndex) & 1), "
+			"(SELECT group_concat(DISTINCT l.name) FROM patch_in_list e JOIN lists l ON l.id = e.id WHERE e.synth = p.synth AND e.md5 = p.md5 AND l.list_type = {}) "
+			"FROM patches p JOIN orm_search_key k ON k.synth = p.synth AND k.md5 = p.md5 ", kImportListType);
+	}
+
+	// Reindexes the patches p matching the condition
+	std::string refresh(std::string const& where) {
+		return fmt::format("DELETE FROM orm_search WHERE rowid IN (SELECT k.id FROM patches p JOIN orm_search_key k ON k.synth = p.synth AND k.md5 = p.md5 WHERE ({0})); "
+			"INSERT INTO orm_search (rowid, name, tags, imports) {1} WHERE ({0}); ", where, document());
+	}
+
+	std::string isPatch(const char* row) {
+		return fmt::format("p.synth = {0}.synth AND p.md5 = {0}.md5", row);
+	}
+
+	std::string addPatch(const char* row) {
+		return fmt::format("INSERT OR IGNORE INTO orm_search_key (synth, md5) VALUES ({0}.synth, {0}.md5); ", row) + refresh(isPatch(row));
+	}
+
+	std::string removePatch(const char* row) {
+		return fmt::format("DELETE FROM orm_search WHERE rowid = (SELECT id FROM orm_search_key WHERE synth = {0}.synth AND md5 = {0}.md5); "
+			"DELETE FROM orm_search_key WHERE synth = {0}.synth AND md5 = {0}.md5; ", row);
+	}
+
+	std::string inList(const char* row) {
+		return fmt::format("(p.synth, p.md5) IN (SELECT synth, md5 FROM patch_in_list WHERE id = {}.id)", row);
+	}
+
+	std::string isImport(const char* row) {
+		return fmt::format("EXISTS (SELECT 1 FROM lists WHERE id = {}.id AND list_type = {})", row, kImportListType);
+	}
+
+	std::string hasBit(const char* row) {
+		return fmt::format("(IFNULL(p.categories, 0) >> {}.bitIndex) & 1", row);
+	}
+
+}
+
+bool PatchSearchIndex::install(SQLite::Database& db)
+{
+	if (installed(db)) {
+		return true;
+	}
+	if (!available()) {
+		spdlog::warn("Could not create the search index, SQLite was built without FTS5");
+		return false;
+	}
+	// Missing or half there, e.g. because a migration recreated the patches table, which drops its triggers
+	try {
+		SQLite::Transaction transaction(db);
+		create(db);
+		transaction.commit();
+		return true;
+	}
+	catch (SQLite::Exception const& e) {
+		// Most likely "no such module: fts5"
+		spdlog::warn("Could not create the search index: {}", e.what());
+		return false;
+	}
+}
+
+bool PatchSearchIndex::installed(SQLite::Database& db)
+{
+	SQLite::Statement query(db, "SELECT count(*) FROM sqlite_master WHERE type = 'trigger' AND name LIKE 'orm_search_%'");
+	int triggers = query.executeStep() ? query.getColumn(0).getInt() : 0;
+	return triggers == static_cast<int>(std::size(kTriggers)) && db.tableExists("orm_search") && db.tableExists("orm_search_key");
+}
+
+bool PatchSearchIndex::available()
+{
+	return sqlite3_compileoption_used("SQLITE_ENABLE_FTS5") != 0;
+}
+
+bool PatchSearchIndex::upToDate(SQLite::Database& db)
+{
+	return !available() || installed(db);
+}
+
+void PatchSearchIndex::create(SQLite::Database& db)
+{
+	if (!available()) {
+		return;
+	}
+	for (auto trigger : kTriggers) {
+		db.exec(fmt::format("DROP TRIGGER IF EXISTS {}", trigger));
+	}
+	db.exec("DROP TABLE IF EXISTS orm_search");
+	db.exec("DROP TABLE IF EXISTS orm_search_key");
+
+	// The rowid of the patches changes with a VACUUM, so the index has keys of its own
+	db.exec("CREATE TABLE orm_search_key (id INTEGER PRIMARY KEY, synth TEXT NOT NULL, md5 TEXT NOT NULL, UNIQUE (synth, md5))");
+	db.exec("CREATE VIRTUAL TABLE orm_search USING fts5(name, tags, imports, tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3')");
+	db.exec("INSERT INTO orm_search_key (synth, md5) SELECT synth, md5 FROM patches");
+	db.exec("INSERT INTO orm_search (rowid, name, tags, imports) " + document());
+
+	db.exec("CREATE TRIGGER orm_search_patch_insert AFTER INSERT ON patches BEGIN " + addPatch("NEW") + "END");
+	db.exec("CREATE TRIGGER orm_search_patch_delete AFTER DELETE ON patches BEGIN " + removePatch("OLD") + "END");
+	db.exec("CREATE TRIGGER orm_search_patch_update AFTER UPDATE OF synth, md5, name, categories ON patches BEGIN "
+		+ removePatch("OLD") + addPatch("NEW") + "END");
+	// Only entries of import lists change the text
+	db.exec("CREATE TRIGGER orm_search_entry_insert AFTER INSERT ON patch_in_list WHEN " + isImport("NEW") + " BEGIN " + refresh(isPatch("NEW")) + "END");
+	db.exec("CREATE TRIGGER orm_search_entry_delete AFTER DELETE ON patch_in_list WHEN " + isImport("OLD") + " BEGIN " + refresh(isPatch("OLD")) + "END");
+	db.exec("CREATE TRIGGER orm_search_entry_update AFTER UPDATE OF id, synth, md5 ON patch_in_list BEGIN " + refresh(isPatch("OLD") + " OR " + isPatch("NEW")) + "END");
+	db.exec(fmt::format("CREATE TRIGGER orm_search_list_insert AFTER INSERT ON lists WHEN NEW.list_type = {} BEGIN ", kImportListType) + refresh(inList("NEW")) + "END");
+	db.exec(fmt::format("CREATE TRIGGER orm_search_list_delete AFTER DELETE ON lists WHEN OLD.list_type = {} BEGIN ", kImportListType) + refresh(inList("OLD")) + "END");
+	db.exec(fmt::format("CREATE TRIGGER orm_search_list_update AFTER UPDATE OF id, name, list_type ON lists WHEN OLD.list_type = {0} OR NEW.list_type = {0} BEGIN ", kImportListType)
+		+ refresh(inList("OLD") + " OR " + inList("NEW")) + "END");
+	db.exec("CREATE TRIGGER orm_search_category_insert AFTER INSERT ON categories BEGIN " + refresh(hasBit("NEW")) + "END");
+	db.exec("CREATE TRIGGER orm_search_category_delete AFTER DELETE ON categories BEGIN " + refresh(hasBit("OLD")) + "END");
+	db.exec("CREATE TRIGGER orm_search_category_update AFTER UPDATE OF bitIndex, name ON categories BEGIN "
+		+ refresh(hasBit("OLD") + " OR " + hasBit("NEW")) + "END");
+	spdlog::debug("Created patch search index");
+}
+
+std::vector<std::pair<std::string, std::string>> PatchSearchIndex::search(SQLite::Database& db, std::string const& text, std::vector<std::string> const& synths, int limit)
+{
+	std::vector<std::pair<std::string, std::string>> result;
+	auto match = matchExpression(text);
+	if (match.empty()) {
+		return result;
+	}
+	std::string synthCondition;
+	if (!synths.empty()) {
+		synthCondition = "AND k.synth IN (";
+		for (size_t i = 0; i < synths.size(); i++) {
+			synthCondition += fmt::format("{}:S{}", i == 0 ? "" : ", ", i);
+		}
+		synthCondition += ") ";
+	}
+	// Name hits count most, then tags, then import names. Ties in name order, so the result is stable
+	SQLite::Statement query(db, "SELECT k.synth, k.md5 FROM orm_search JOIN orm_search_key k ON k.id = orm_search.rowid "
+		"WHERE orm_search MATCH :MATCH " + synthCondition + "ORDER BY bm25(orm_search, 10.0, 4.0, 1.0), orm_search.name, k.synth, k.md5 LIMIT :LIMIT");
+	query.bind(":MATCH", match);
+	for (size_t i = 0; i < synths.size(); i++) {
+		query.bind(fmt::format(":S{}", i), synths[i]);
+	}
+	query.bind(":LIMIT", limit);
+	while (query.executeStep()) {
+		result.emplace_back(query.getColumn(0).getString(), query.getColumn(1).getString());
+	}
+	return result;
+}
+
+int PatchSearchIndex::rank(SQLite::Database& db, std::string const& text, std::vector<std::string> const& synths, int limit)
+{
+	// One more than needed tells whether there were more
+	auto matches = search(db, text, synths, limit + 1);
+	SQLite::Transaction transaction(db);
+	db.exec(fmt::format("CREATE TEMP TABLE IF NOT EXISTS {} (place INTEGER PRIMARY KEY, synth TEXT NOT NULL, md5 TEXT NOT NULL)", kRankedTable));
+	db.exec(fmt::format("DELETE FROM temp.{}", kRankedTable));
+	SQLite::Statement insert(db, fmt::format("INSERT INTO temp.{} (place, synth, md5) VALUES (:ORD, :SYN, :MD5)", kRankedTable));
+	for (int place = 0; place < static_cast<int>(matches.size()) && place < limit; place++) {
+		insert.bind(":ORD", place);
+		insert.bind(":SYN", matches[place].first);
+		insert.bind(":MD5", matches[place].second);
+		insert.exec();
+		insert.reset();
+	}
+	transaction.commit();
+	return static_cast<int>(matches.size());
+}
+
+std::string PatchSearchIndex::matchExpression(std::string const& text)
+{
+	// Split like the unicode61 tokenizer does for ASCII, and keep all non ASCII bytes as word characters. Quoting
+	// each word keeps FTS5 operators typed by the user (AND, NOT, -, :) from being interpreted
+	std::string result;
+	std::string word;
+	auto flush = [&]() {
+		if (!word.empty()) {
+			result += (result.empty() ? "\"" : " \"") + word + "\"*";
+			word.clear();
+		}
+	};
+	for (char c : text) {
+		auto u = static_cast<unsigned char>(c);
+		if (u >= 0x80 || std::isalnum(u)) {
+			word += c;
+		}
+		else {
+			flush();
+		}
+	}
+	flush();
+	return result;
+}
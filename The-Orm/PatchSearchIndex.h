@@ -0,0 +1,54 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SQLite {
+	class Database;
+}
+
+// Full text index over the patch names, their category names (tags) and the names of the imports they came from, kept in
+// an FTS5 table next to the patches. Triggers on patches, patch_in_list, lists and categories keep it in sync no matter
+// which connection writes. The OrmSchema migration creates them. Searching is by word prefix, ranked by bm25 with the name
+// weighing most.
+//
+// The PatchFilter has no notion of rank. A ranked search writes its best matches into a TEMP table of the connection it
+// runs on, which the PatchQuery of the filter joins in rank order, see PatchPager. Nothing is written to the database file.
+class PatchSearchIndex {
+public:
+	static const char* kRankedTable;
+	static const int kMaxRankedResults = 1000;
+
+	// Creates or repairs the index on any connection. False if SQLite was built without FTS5
+	static bool install(SQLite::Database& db);
+
+	// The index and all its triggers are there
+	static bool installed(SQLite::Database& db);
+
+	// SQLite was built with FTS5
+	static bool available();
+
+	// Installed, or it can't be because FTS5 is missing. Searching then goes by name only
+	static bool upToDate(SQLite::Database& db);
+
+	// Drops and recreates the index and its triggers, indexing all patches. Does nothing without FTS5. This is a step of
+	// the OrmSchema migration
+	static void create(SQLite::Database& db);
+
+	// Best matches first, limited to the synths given (all synths if empty)
+	static std::vector<std::pair<std::string, std::string>> search(SQLite::Database& db, std::string const& text, std::vector<std::string> const& synths, int limit);
+
+	// Replaces the rows of the TEMP table kRankedTable of the connection by the best matches, at most limit of them, the best
+	// at place 0. Returns the number of matches, limit + 1 if there were more than limit
+	static int rank(SQLite::Database& db, std::string const& text, std::vector<std::string> const& synths, int limit);
+
+	// Every word of the text as a quoted prefix query, all of which must match. Empty if the text has no words
+	static std::string matchExpression(std::string const& text);
+};
@@ -33,6 +33,9 @@
 
 #include <fmt/format.h>
 #include "PatchInterchangeFormat.h"
+#include "PatchProjection.h"
+#include "PatchQuery.h"
+#include "PatchReindexer.h"
 #include "Settings.h"
 #include "ReceiveManualDumpWindow.h"
 #include "ExportDialog.h"
@@ -41,6 +44,8 @@
 
 #include "LayoutConstants.h"
 
+#include <SQLiteCpp/Database.h>
+
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
 
@@ -56,6 +61,23 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
         , librarian_(synths)
         , synths_(synths)
         , database_(database)
+        , programLocations_(database)
+        , counts_(database)
+        , writes_([this](std::vector<PatchWriteQueue::Edit> const& batch) {
+			writeEdits(batch);
+		}, 500, [this](std::vector<PatchWriteQueue::Edit> const&, std::string const&) {
+			// The grid shows the edits, but the database doesn't have them
+			Component::SafePointer<PatchView> safeThis(this);
+			MessageManager::callAsync([safeThis]() {
+				if (safeThis) {
+					safeThis->requeryDatabase(false, false);
+				}
+			});
+		})
+        , pager_(database, [this](midikraft::PatchFilter const& filter) {
+			// On the pager's thread, and only if the page could look different with the edits written
+			writes_.flush(PatchWriteQueue::readBy(filter));
+		})
 {
 	patchListTree_.onImportListSelected = [this](String id, std::shared_ptr<midikraft::Synth> synth) {
 		setListFilter(id, synth);
@@ -89,9 +111,10 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 		}
 	});
 
-	currentPatchDisplay_ = std::make_unique<CurrentPatchDisplay>(database_, predefinedCategories(),
-		[this](std::shared_ptr<midikraft::PatchHolder> favoritePatch) {
-		database_.putPatch(*favoritePatch);
+	currentPatchDisplay_ = std::make_unique<CurrentPatchDisplay>(database_, programLocations_, predefinedCategories(),
+		[this](std::shared_ptr<midikraft::PatchHolder> favoritePatch, int edits) {
+		// The display has changed the patch already, the database follows in the background
+		writes_.enqueue(*favoritePatch, edits);
 		// Keep the current view stable: update only visible buttons in-place without re-querying the list
 		patchButtons_->updateVisiblePatch(*favoritePatch);
 		for (auto* secondaryGrid : secondaryPatchGrids_) {
@@ -108,10 +131,13 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 		}
 	};
 
-	synthBank_ = std::make_unique<SynthBankPanel>(database_, this);
+	synthBank_ = std::make_unique<SynthBankPanel>(database_, programLocations_, this);
 	patchHistory_ = std::make_unique<PatchHistoryPanel>(this, &database_);
+	downloadPanel_ = std::make_unique<DownloadProgressPanel>(downloads_);
 
 	patchSearch_ = std::make_unique<PatchSearchComponent>(this, patchButtons_.get(), database_);
+	snapshots_ = std::make_unique<DatabaseSnapshots>(database_.getCurrentDatabaseFileName());
+	migrateSchema();
 
 	auto box = new LambdaLayoutBox();
 	box->onResized = [this](Component* box) {
@@ -147,6 +173,7 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 	rightSideTab_.addTab("Current Patch", Colours::black, currentPatchDisplay_.get(), false);
 	rightSideTab_.addTab("Synth Bank", Colours::black, synthBank_.get(), false);
 	rightSideTab_.addTab("Recent Patches", Colours::black, patchHistory_.get(), false);
+	rightSideTab_.addTab("Downloads", Colours::black, downloadPanel_.get(), false);
 
 	splitters_ = std::make_unique<SplitteredComponent>("PatchViewSplitter",
 		SplitteredEntry{ box, 15, 5, 40 },
@@ -157,18 +184,25 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 	addAndMakeVisible(recycleBin_);
 
 	patchButtons_->setPatchLoader([this](int skip, int limit, std::function<void(std::vector< midikraft::PatchHolder>)> callback) {
-		loadPage(skip, limit, currentFilter(), callback);
+		loadCurrentPage(skip, limit, callback);
 	});
 
 	patchButtons_->setButtonSendModes({ "program change", "edit buffer", "automatic"});
 
 	// Register for updates
 	UIModel::instance()->currentPatch_.addChangeListener(this);
+	UIModel::instance()->databaseChanged.addChangeListener(this);
 }
 
 PatchView::~PatchView()
 {
+	// The banks already handed to the processing thread are still stored, into members of ours
+	downloads_.cancelAll();
+	while (!downloads_.waitUntilIdle(1000)) {
+		spdlog::info("Waiting for the downloaded banks to be stored...");
+	}
 	UIModel::instance()->currentPatch_.removeChangeListener(this);
+	UIModel::instance()->databaseChanged.removeChangeListener(this);
 	BulkRenameDialog::release();
 }
 
@@ -181,6 +215,26 @@ void PatchView::changeListenerCallback(ChangeBroadcaster* source)
 	if (dynamic_cast<CurrentPatch *>(source)) {
 		currentPatchDisplay_->setCurrentPatch(std::make_shared<midikraft::PatchHolder>(UIModel::currentPatch()));
 	}
+	else if (source == &UIModel::instance()->databaseChanged) {
+		programLocations_.invalidateAll();
+		snapshots_ = std::make_unique<DatabaseSnapshots>(database_.getCurrentDatabaseFileName());
+		migrateSchema();
+	}
+}
+
+void PatchView::migrateSchema()
+{
+	// Interrupts the migration of the previous database
+	schema_.reset();
+	Component::SafePointer<PatchView> safeThis(this);
+	schema_ = std::make_unique<OrmSchema>(String(database_.getCurrentDatabaseFileName()).toStdString(), [safeThis]() {
+		MessageManager::callAsync([safeThis]() {
+			// The counts now come from the counters
+			if (safeThis) {
+				safeThis->retrieveFirstPageFromDatabase();
+			}
+		});
+	});
 }
 
 std::vector<CategoryButtons::Category> PatchView::predefinedCategories()
@@ -195,7 +249,10 @@ std::vector<CategoryButtons::Category> PatchView::predefinedCategories()
 }
 
 int PatchView::getTotalCount() {
-	return database_.getPatchesCount(currentFilter());
+	auto filter = currentFilter();
+	writes_.flush(PatchWriteQueue::readBy(filter));
+	auto estimate = counts_.estimate(filter);
+	return estimate.exact ? estimate.total : counts_.count(filter);
 }
 
 void PatchView::registerSecondaryGrid(SimplePatchGrid* grid)
@@ -216,12 +273,48 @@ void PatchView::unregisterSecondaryGrid(SimplePatchGrid* grid)
 	secondaryPatchGrids_.erase(std::remove(secondaryPatchGrids_.begin(), secondaryPatchGrids_.end(), grid), secondaryPatchGrids_.end());
 }
 
-void PatchView::retrieveFirstPageFromDatabase() {
-	// First, we need to find out how many patches there are (for the paging control)
-	int total = getTotalCount();
-	patchButtons_->setTotalCount(total, true);
-	patchButtons_->refresh(true); // This kicks of loading the first page
-	Data::instance().getEphemeral().setProperty(EPROPERTY_LIBRARY_PATCH_LIST, juce::Uuid().toString(), nullptr);
+void PatchView::retrieveFirstPageFromDatabase(bool debounce /* = false */) {
+	requeryDatabase(debounce, true);
+}
+
+void PatchView::requeryDatabase(bool debounce, bool firstPage) {
+	// This supersedes all earlier requests, so pages still loading for an older filter are dropped when they arrive
+	auto filter = currentFilter();
+	bool ranked = patchSearch_->rankedSearch();
+	searches_.request([this, filter, ranked, firstPage](SearchQueryScheduler::Token const& token) {
+		// The counters follow the patches, so edits the filter reads have to be written first. Here, not on the message thread
+		writes_.flush(PatchWriteQueue::readBy(filter));
+		// The paging control starts with an estimate, so the first page does not wait for a slow count
+		auto estimate = counts_.estimate(filter);
+		MessageManager::callAsync([this, token, estimate, firstPage]() {
+			// Also covers the PatchView being gone, its scheduler cancels everything on destruction
+			if (token.superseded()) {
+				return;
+			}
+			patchButtons_->setTotalCount(estimate.total, firstPage);
+			patchButtons_->refresh(true); // This kicks of loading the page
+			Data::instance().getEphemeral().setProperty(EPROPERTY_LIBRARY_PATCH_LIST, juce::Uuid().toString(), nullptr);
+		});
+		if (token.superseded()) {
+			return;
+		}
+		// On the pager's connection the count stops as soon as the next filter comes in. A ranked search is ranked here, on the
+		// scheduler's thread, and counted by the number of its best matches, which the counters know nothing about
+		std::optional<int> total;
+		if (ranked) {
+			total = pager_.count(filter, token, true);
+		}
+		else {
+			total = counts_.count(filter, [this, token](midikraft::PatchFilter const& filter) { return pager_.count(filter, token); });
+		}
+		if (total && *total != estimate.total) {
+			MessageManager::callAsync([this, token, total]() {
+				if (!token.superseded()) {
+					patchButtons_->setTotalCount(*total, false);
+				}
+			});
+		}
+	}, debounce);
 }
 
 std::shared_ptr<midikraft::PatchList>  PatchView::retrieveListFromDatabase(midikraft::ListInfo const& info)
@@ -230,6 +323,7 @@ std::shared_ptr<midikraft::PatchList>  PatchView::retrieveListFromDatabase(midik
 		return nullptr;
 	}
 
+	writes_.flush();
 	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
 	for (auto synth : synths_) {
 		synths.emplace(synth.getName(), synth.synth());
@@ -237,6 +331,45 @@ std::shared_ptr<midikraft::PatchList>  PatchView::retrieveListFromDatabase(midik
 	return database_.getPatchList(info, synths);
 }
 
+void PatchView::flushEdits()
+{
+	writes_.flush();
+}
+
+void PatchView::writeEdits(std::vector<PatchWriteQueue::Edit> const& batch)
+{
+	std::vector<PatchWriteQueue::Edit> flags;
+	for (auto const& edit : batch) {
+		if (PatchWriteQueue::flagsOnly(edit.edits)) {
+			flags.push_back(edit);
+		}
+	}
+	if (!flags.empty()) {
+		// One transaction on a connection of our own, instead of one per patch
+		SQLite::Database db(String(database_.getCurrentDatabaseFileName()).toStdString(), SQLite::OPEN_READWRITE, 5000);
+		PatchWriteQueue::writeFlags(db, flags);
+	}
+	// A name changes the data of a layered patch, that is the PatchDatabase's job
+	std::lock_guard<std::mutex> lock(sharedConnectionWrites_);
+	for (auto const& edit : batch) {
+		if (!PatchWriteQueue::flagsOnly(edit.edits)) {
+			database_.putPatch(edit.patch);
+		}
+	}
+}
+
+void PatchView::closeDatabase()
+{
+	writes_.flush();
+	// Nothing is copied on closing, a background copy in progress is abandoned. The next session's snapshot has what the last one missed
+	snapshots_.reset();
+}
+
+void PatchView::shutdown()
+{
+	closeDatabase();
+}
+
 void PatchView::hideCurrentPatch()
 {
 	currentPatchDisplay_->toggleHide();
@@ -263,12 +396,11 @@ void PatchView::selectNextPatch()
 }
 
 void PatchView::loadPage(int skip, int limit, midikraft::PatchFilter const& filter, std::function<void(std::vector<midikraft::PatchHolder>)> callback) {
+	// The bulk actions work on what the user sees, edits included
+	writes_.flush(PatchWriteQueue::readBy(filter));
 	// Kick off loading from the database (could be Internet?)
 	database_.getPatchesAsync(filter, [this, callback](midikraft::PatchFilter const filter, std::vector<midikraft::PatchHolder> const &newPatches) {
         ignoreUnused(filter);
-		// Discard the result when there is a newer filter - another thread will be working on a better result!
-		/*if (currentFilter() != filter)
-			return;*/
 
 		// Check if a client-side filter is active (python based)
 		String advancedQuery = patchSearch_->advancedTextSearch();
@@ -285,6 +417,30 @@ void PatchView::loadPage(int skip, int limit, midikraft::PatchFilter const& filt
 	}, skip, limit);
 }
 
+void PatchView::loadCurrentPage(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback) {
+	auto token = searches_.current();
+	// The grid draws the patches from their summaries and loads one when it is selected. A Python predicate needs the data
+	auto load = patchSearch_->advancedTextSearch().startsWith("!") ? PatchPager::Load::Full : PatchPager::Load::DisplayOnly;
+	// The pager remembers where the pages of this search start, so paging on doesn't walk the rows before the page again
+	pager_.requestPage(currentFilter(), token, skip, limit, [this, token, callback](std::vector<midikraft::PatchHolder> patches) {
+		MessageManager::callAsync([this, token, callback, patches]() {
+			// Discard the result when there is a newer filter - only the latest search may reach the grid. This also covers
+			// the PatchView being gone, its scheduler cancels everything on destruction
+			if (token.superseded()) {
+				return;
+			}
+			String advancedQuery = patchSearch_->advancedTextSearch();
+			if (advancedQuery.startsWith("!") && knobkraft::GenericAdaptation::hasPython()) {
+				ScriptedQuery query;
+				callback(query.filterByPredicate(advancedQuery.substring(1).toStdString(), patches));
+			}
+			else {
+				callback(patches);
+			}
+		});
+	}, patchSearch_->rankedSearch(), load);
+}
+
 void PatchView::resized()
 {
 	Rectangle<int> area(getLocalBounds());
@@ -330,13 +486,14 @@ void PatchView::showPatchDiffDialog() {
 
 void PatchView::saveCurrentPatchCategories() {
 	if (currentPatchDisplay_->getCurrentPatch()->patch()) {
-		database_.putPatch(*currentPatchDisplay_->getCurrentPatch());
+		writes_.enqueue(*currentPatchDisplay_->getCurrentPatch(), PatchWriteQueue::Categories);
 		patchButtons_->refresh(false);
 	}
 }
 
 void PatchView::loadSynthBankFromDatabase(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::string const& bankId)
 {
+	writes_.flush();
 	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
 	if (synth) {
 		synths[synth->getName()] = synth;
@@ -356,6 +513,7 @@ void PatchView::loadSynthBankFromDatabase(std::shared_ptr<midikraft::Synth> synt
 		return;
 	}
 
+	programLocations_.bankLoaded(bankList);
 	auto patches = bankList->patches();
 	spdlog::info("Bank of {} patches retrieved from database", patches.size());
 
@@ -380,35 +538,17 @@ void PatchView::retrieveBankFromSynth(std::shared_ptr<midikraft::Synth> synth, M
 	downloadBanksFromSynth(
 		synth,
 		std::vector<MidiBankNumber>{ bank },
-		"Import patches from Synth",
-		[this, synth, bank, finishedHandler = std::move(finishedHandler)](std::vector<midikraft::PatchHolder> patchesLoaded) mutable {
-			spdlog::info("Retrieved {} patches from synth", patchesLoaded.size());
-			
-			// First make sure all patches are stored in the database
-			auto patchesForBank = patchesLoaded;
-			auto enhanced = autoCategorize(patchesLoaded);
-			mergeNewPatches(std::move(enhanced));
-
-			// Then store the list of them in the database
-			auto retrievedBank = std::make_shared<midikraft::ActiveSynthBank>(synth, bank, juce::Time::getCurrentTime());
-			retrievedBank->setPatches(std::move(patchesForBank));
-			database_.putPatchList(retrievedBank);
-
-			// We need to mark something as "active in synth" together with position in the patch_in_list table, so we now when we can program change to the patch
-			// instead of sending the sysex
-			patchListTree_.refreshAllUserLists([this, synth, bank, finishedHandler = std::move(finishedHandler)]() mutable {
-				loadSynthBankFromDatabase(synth, bank, midikraft::ActiveSynthBank::makeId(synth, bank));
-				if (finishedHandler) {
-					finishedHandler();
-				}
-			});
+		[this, synth, bank, finishedHandler = std::move(finishedHandler)]() {
+			loadSynthBankFromDatabase(synth, bank, midikraft::ActiveSynthBank::makeId(synth, bank));
+			if (finishedHandler) {
+				finishedHandler();
+			}
 		});
 }
 
 void PatchView::downloadBanksFromSynth(std::shared_ptr<midikraft::Synth> synth,
 	const std::vector<MidiBankNumber>& banks,
-	const juce::String& progressTitle,
-	std::function<void(std::vector<midikraft::PatchHolder>)> onLoaded,
+	std::function<void()> onFinished,
 	bool requireDetectedDevice)
 {
 	if (!synth || banks.empty()) {
@@ -429,31 +569,80 @@ void PatchView::downloadBanksFromSynth(std::shared_ptr<midikraft::Synth> synth,
 		return;
 	}
 
-	auto progressWindow = std::make_shared<LibrarianProgressWindow>(librarian_, progressTitle.toStdString());
 	midikraft::MidiController::instance()->enableMidiInput(location->midiInput());
-	progressWindow->launchThread();
-
-	if (banks.size() == 1) {
-		progressWindow->setMessage(fmt::format("Importing {} from {}...", midikraft::SynthBank::friendlyBankName(synth, banks.front()), synth->getName()));
-	}
-	else {
-		progressWindow->setMessage(fmt::format("Importing patches from {}...", synth->getName()));
-	}
-
 	auto midiOutput = midikraft::MidiController::instance()->getMidiOutput(location->midiOutput());
-	librarian_.startDownloadingAllPatches(
-		midiOutput,
-		synth,
-		banks,
-		progressWindow.get(),
-		[progressWindow, onLoaded = std::move(onLoaded)](std::vector<midikraft::PatchHolder> patchesLoaded) mutable {
-			progressWindow->signalThreadShouldExit();
-			MessageManager::callAsync([onLoaded = std::move(onLoaded), patches = std::move(patchesLoaded)]() mutable {
-				if (onLoaded) {
-					onLoaded(std::move(patches));
+
+	// Each download needs its own Librarian, as that keeps the MIDI handlers of the download currently running
+	auto librarian = std::make_shared<midikraft::Librarian>(synths_);
+	auto newPatches = std::make_shared<std::vector<midikraft::PatchHolder>>();
+	auto now = juce::Time::getCurrentTime();
+
+	DownloadManager::Download download;
+	download.synthName = synth->getName();
+	download.port = location->midiOutput().identifier.toStdString();
+	download.banks = banks;
+	download.transfer = [librarian, midiOutput, synth](MidiBankNumber bank, midikraft::ProgressHandler* progress, DownloadManager::TBankDone done) {
+		progress->setMessage(fmt::format("Importing {}...", midikraft::SynthBank::friendlyBankName(synth, bank)));
+		librarian->startDownloadingAllPatches(midiOutput, synth, std::vector<MidiBankNumber>{ bank }, progress,
+			[done](std::vector<midikraft::PatchHolder> patchesLoaded) {
+				// Request the next bank from the message thread, not from within the Librarian's MIDI callback
+				MessageManager::callAsync([done, patches = std::move(patchesLoaded)]() mutable {
+					done(std::move(patches));
+				});
+			});
+	};
+	download.abortTransfer = [librarian]() {
+		// Make sure to destroy any stray MIDI callback handlers, else we'll get into trouble when we retry the operation
+		librarian->clearHandlers();
+	};
+	download.process = [this, synth, now, newPatches](MidiBankNumber bank, std::vector<midikraft::PatchHolder> patches) {
+		spdlog::info("Retrieved {} patches from {}", patches.size(), synth->getName());
+		std::lock_guard<std::mutex> lock(sharedConnectionWrites_);
+		auto stored = storeDownloadedBank(synth, bank, patches, now);
+		newPatches->insert(newPatches->end(), stored.begin(), stored.end());
+	};
+	// The destructor waits for the processing thread, but not for the message thread
+	Component::SafePointer<PatchView> safeThis(this);
+	download.finished = [safeThis, newPatches, onFinished = std::move(onFinished)](bool cancelled) {
+		MessageManager::callAsync([safeThis, newPatches, onFinished, cancelled]() {
+			if (!safeThis) {
+				// Cancelled because the view is gone
+				return;
+			}
+			safeThis->showNewPatches(*newPatches);
+			// We need to mark something as "active in synth" together with position in the patch_in_list table, so we now when we can program change to the patch
+			// instead of sending the sysex
+			safeThis->patchListTree_.refreshAllUserLists([onFinished, cancelled]() {
+				if (onFinished && !cancelled) {
+					onFinished();
 				}
 			});
 		});
+	};
+	downloads_.start(std::move(download));
+	rightSideTab_.setCurrentTabIndex(3, true);
+}
+
+std::vector<midikraft::PatchHolder> PatchView::storeDownloadedBank(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> const& patches, juce::Time timestamp)
+{
+	// First make sure all patches are stored in the database
+	std::vector<midikraft::PatchHolder> newPatches;
+	auto enhanced = autoCategorize(patches);
+	if (!enhanced.empty()) {
+		auto numberNew = database_.mergePatchesIntoDatabase(enhanced, newPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+		if (!newPatches.empty()) {
+			database_.createImportLists(newPatches);
+		}
+		spdlog::info("Got {} new or changed patches, saved to database", numberNew);
+	}
+
+	// Then store the list of them in the database
+	if (bank.isValid() && !patches.empty()) {
+		auto retrievedBank = std::make_shared<midikraft::ActiveSynthBank>(synth, bank, timestamp);
+		retrievedBank->setPatches(patches);
+		programLocations_.putPatchList(retrievedBank);
+	}
+	return newPatches;
 }
 
 void PatchView::sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend, bool ignoreDirty, std::function<void()> finishedHandler)
@@ -546,6 +735,8 @@ void PatchView::deleteSomething(nlohmann::json const& infos)
 			std::string patchName = infos["patch_name"];
 			if (AlertWindow::showOkCancelBox(AlertWindow::WarningIcon, "Delete patch from database",
 				"Do you really want to delete the patch " + patchName + " from the database? There is no undo!")) {
+				// A queued edit written after the delete would bring the patch back
+				writes_.flush();
 				auto [deleted, hidden] = database_.deletePatches(infos["synth"], { infos["md5"] });
 				if (deleted > 0) {
 					spdlog::info("Deleted patch {} from database", patchName);
@@ -597,38 +788,7 @@ void PatchView::retrievePatches() {
 		importDialog_ = std::make_unique<ImportFromSynthDialog>(activeSynth,
 			[this, activeSynth](std::vector<MidiBankNumber> bankNo) {
 				if (!bankNo.empty()) {
-					auto banksForStorage = bankNo;
-					downloadBanksFromSynth(
-						activeSynth,
-						bankNo,
-						"Import patches from Synth",
-						[this, activeSynth, banksForStorage](std::vector<midikraft::PatchHolder> patchesLoaded) {
-							auto originalPatches = patchesLoaded;
-							auto enhanced = autoCategorize(patchesLoaded);
-							mergeNewPatches(std::move(enhanced));
-							auto now = juce::Time::getCurrentTime();
-							for (auto const& bank : banksForStorage) {
-								if (!bank.isValid()) {
-									continue;
-								}
-								std::vector<midikraft::PatchHolder> patchesForBank;
-								std::copy_if(
-									originalPatches.begin(),
-									originalPatches.end(),
-									std::back_inserter(patchesForBank),
-									[bank](midikraft::PatchHolder const& patch) {
-										return !(patch.bankNumber() != bank);
-									});
-								if (patchesForBank.empty()) {
-									continue;
-								}
-								auto retrievedBank = std::make_shared<midikraft::ActiveSynthBank>(activeSynth, bank, now);
-								retrievedBank->setPatches(std::move(patchesForBank));
-								database_.putPatchList(retrievedBank);
-							}
-							patchListTree_.refreshAllUserLists([]() {});
-						},
-						false);
+					downloadBanksFromSynth(activeSynth, bankNo, nullptr, false);
 				}
 			});
 		DialogWindow::LaunchOptions launcher;
@@ -698,23 +858,124 @@ void PatchView::bulkRenamePatches()
 		});
 }
 
+class BulkDeletePatches : public ProgressHandlerWindow {
+public:
+	BulkDeletePatches(midikraft::PatchDatabase& database, std::mutex& databaseWrites, midikraft::PatchFilter const& filter, int expectedTotal) :
+		ProgressHandlerWindow("Deleting patches", "Finding the patches to delete..."), database_(database), databaseWrites_(databaseWrites), filter_(filter), expectedTotal_(expectedTotal) {
+	}
+
+	virtual void run() override {
+		auto databaseFile = String(database_.getCurrentDatabaseFileName()).toStdString();
+		// Only the keys are needed. Filters with a translation don't load the patches for them
+		auto query = PatchQuery::from(filter_);
+		std::unique_ptr<SQLite::Database> reads;
+		if (query) {
+			try {
+				reads = std::make_unique<SQLite::Database>(databaseFile, SQLite::OPEN_READONLY, 5000);
+				if (!OrmSchema::upToDate(*reads)) {
+					reads.reset();
+				}
+			}
+			catch (std::exception const& e) {
+				spdlog::warn("Resolving the patches to delete by loading them: {}", e.what());
+				reads.reset();
+			}
+		}
+		auto resolve = [this, &query, &reads](int offset, int limit) {
+			std::vector<PatchDeleteJob::Key> keys;
+			if (reads) {
+				for (auto const& key : query->keysByOffset(*reads, offset, limit)) {
+					keys.push_back({ key.synth, key.md5 });
+				}
+			}
+			else {
+				for (auto const& patch : database_.getPatches(filter_, offset, limit)) {
+					keys.push_back({ patch.smartSynth()->getName(), patch.md5() });
+				}
+			}
+			return keys;
+		};
+		auto remove = [this](std::string const& synth, std::vector<std::string> const& md5s) {
+			std::lock_guard<std::mutex> lock(databaseWrites_);
+			return database_.deletePatches(synth, md5s);
+		};
+		delta_ = PatchDeleteJob::run(databaseFile, resolve, remove, expectedTotal_, this);
+	}
+
+	PatchDeleteJob::Delta const& delta() const { return delta_; }
+
+private:
+	midikraft::PatchDatabase& database_;
+	std::mutex& databaseWrites_;
+	midikraft::PatchFilter filter_;
+	int expectedTotal_;
+	PatchDeleteJob::Delta delta_;
+};
+
 void PatchView::deletePatches()
 {
+	// The filter must see the queued edits, and none of them may be written after the delete
+	writes_.flush();
 	int totalAffected = totalNumberOfPatches();
 	if (AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, fmt::format("Delete all {} patches matching current filter", totalAffected),
 		fmt::format("Warning, there is no undo operation. Do you really want to delete the {} patches matching the current filter?\n\n"
 			"They will be gone forever, unless you use a backup!", totalAffected))) {
 		if (AlertWindow::showOkCancelBox(AlertWindow::WarningIcon, "Do you know what you are doing?",
 			"Are you sure?", "Yes", "No")) {
-			auto deleted = database_.deletePatches(currentFilter());
-			AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Patches deleted", fmt::format("{} patches deleted from database, {} hidden.", deleted.first, deleted.second));
-			UIModel::instance()->importListChanged_.sendChangeMessage();
-			refreshAllAfterDelete();
+			BulkDeletePatches job(database_, sharedConnectionWrites_, currentFilter(), totalAffected);
+			job.runThread();
+			auto const& delta = job.delta();
+			auto message = fmt::format("{} patches deleted from database, {} hidden.", delta.deleted, delta.hidden);
+			if (delta.failed) {
+				message = "Stopped by an error, see the log. " + message;
+			}
+			else if (delta.cancelled) {
+				message = "Cancelled. " + message;
+			}
+			AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Patches deleted", message);
+			refreshAfterDelete(delta);
+		}
+	}
+}
+
+void PatchView::refreshAfterDelete(PatchDeleteJob::Delta const& delta) {
+	if (delta.empty()) {
+		return;
+	}
+	for (auto const& synth : delta.patches) {
+		programLocations_.invalidate(synth.first);
+	}
+	// The pages from the first deleted patch on have shifted. Stay on the current page and reload it, counting in the background
+	requeryDatabase(false, false);
+	auto bank = synthBank_->getCurrentSynthBank();
+	if (bank && delta.lists.count(bank->id()) > 0) {
+		synthBank_->reloadFromDatabase();
+	}
+	patchHistory_->refreshList([&delta](midikraft::PatchHolder const& patch) {
+		return patch.smartSynth() && delta.contains(patch.smartSynth()->getName(), patch.md5());
+	});
+	if (!delta.imports.empty()) {
+		// Imports that lost all their patches disappear
+		UIModel::instance()->importListChanged_.sendChangeMessage();
+	}
+	patchListTree_.refreshLists(delta.lists);
+	auto current = UIModel::instance()->currentPatch();
+	if (current.patch() && current.smartSynth() && delta.contains(current.smartSynth()->getName(), current.md5())) {
+		// Reload, because it might have become hidden
+		std::vector<midikraft::PatchHolder> loaded;
+		database_.getSinglePatch(current.smartSynth(), current.md5(), loaded);
+		if (loaded.size() > 0) {
+			currentPatchDisplay_->setCurrentPatch(std::make_shared<midikraft::PatchHolder>(loaded[0]));
+		}
+		else {
+			currentPatchDisplay_->reset();
 		}
 	}
 }
 
 void PatchView::refreshAllAfterDelete() {
+	// Deleted patches are gone from the synth banks as well
+	programLocations_.invalidateAll();
 	// Reload grid
 	retrieveFirstPageFromDatabase();
 	// Reload bank
@@ -724,17 +985,51 @@ void PatchView::refreshAllAfterDelete() {
 	// Check if the current patch still exists. Reload, because it might have become hidden
 	auto current = UIModel::instance()->currentPatch();
 	if (current.patch()) {
+		writes_.flush();
 		std::vector<midikraft::PatchHolder> loaded;
 		database_.getSinglePatch(current.smartSynth(), current.md5(), loaded);
 		if (loaded.size() > 0) {
 			currentPatchDisplay_->setCurrentPatch(std::make_shared<midikraft::PatchHolder>(loaded[0]));
 		}
 		else {
-			currentPatchDisplay_.reset();
+			currentPatchDisplay_->reset();
 		}
 	}
 }
 
+class ReindexPatches : public ProgressHandlerWindow {
+public:
+	ReindexPatches(std::string const& databaseFile, std::shared_ptr<midikraft::Synth> synth) :
+		ProgressHandlerWindow("Reindexing patches", "Computing fingerprints..."), databaseFile_(databaseFile), synth_(synth) {
+	}
+
+	virtual void run() override {
+		auto synth = synth_;
+		auto fingerprint = [synth](std::vector<uint8_t> const& data, int programNo) {
+			auto place = programNo >= 0 ? MidiProgramNumber::fromZeroBase(programNo) : MidiProgramNumber::invalidProgram();
+			auto patch = synth->patchFromPatchData(data, place);
+			return patch ? synth->calculateFingerprint(patch) : std::string();
+		};
+		try {
+			// One thread, the synths are not safe to call concurrently
+			result_ = PatchReindexer::reindex(databaseFile_, synth_->getName(), fingerprint, this, 1);
+			success_ = true;
+		}
+		catch (std::exception const& e) {
+			spdlog::error("Reindexing the patches of {} failed: {}", synth_->getName(), e.what());
+		}
+	}
+
+	bool success() const { return success_; }
+	PatchReindexer::Result const& result() const { return result_; }
+
+private:
+	std::string databaseFile_;
+	std::shared_ptr<midikraft::Synth> synth_;
+	PatchReindexer::Result result_;
+	bool success_ = false;
+};
+
 void PatchView::reindexPatches() {
 	// We do reindex all patches of the currently selected synth. It does not make sense to reindex less than that.
 	auto currentSynth = UIModel::instance()->currentSynth_.smartSynth();
@@ -742,14 +1037,26 @@ void PatchView::reindexPatches() {
 	midikraft::PatchFilter filter({ currentSynth });
 	filter.turnOnAll(); // Make sure we also reindex hidden entries
 
-	int totalAffected = database_.getPatchesCount(filter);
+	int totalAffected = counts_.count(filter);
 	if (AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, fmt::format("Do you want to reindex all {} patches for synth {}?", totalAffected, currentSynth->getName()),
 		fmt::format("This will reindex the {} patches with the current fingerprinting algorithm.\n\n"
 			"Hopefully this will get rid of duplicates properly, but if there are duplicates under multiple names you'll end up with a somewhat random result which name is chosen for the de-duplicated patch.\n",
 			totalAffected))) {
-		std::string backupName = database_.makeDatabaseBackup("-before-reindexing");
+		writes_.flush();
+		// A snapshot is a copy only if something changed since the last one
+		std::string backupName = snapshots_ ? snapshots_->snapshotNow("before-reindexing") : "";
+		if (backupName.empty()) {
+			backupName = database_.makeDatabaseBackup("-before-reindexing");
+		}
 		spdlog::info("Created database backup at {}", backupName);
-		int countAfterReindexing = database_.reindexPatches(filter);
+		// Fingerprints are computed without holding the database, only the final merge writes
+		ReindexPatches reindexing(String(database_.getCurrentDatabaseFileName()).toStdString(), currentSynth);
+		reindexing.runThread();
+		if (reindexing.success() && reindexing.result().cancelled) {
+			spdlog::info("Reindexing cancelled, the database was not changed");
+			return;
+		}
+		int countAfterReindexing = reindexing.success() ? reindexing.result().after : -1;
 		if (countAfterReindexing != -1) {
 			// No error, display user info
 			if (totalAffected > countAfterReindexing) {
@@ -765,13 +1072,16 @@ void PatchView::reindexPatches() {
 
 		}
 		//TODO refresh import filter
-		retrieveFirstPageFromDatabase();
+		// Patches moved to another md5, for the banks and the current patch just like deleted ones
+		refreshAllAfterDelete();
 	}
 }
 
 int PatchView::totalNumberOfPatches()
 {
-	return database_.getPatchesCount(currentFilter());
+	auto filter = currentFilter();
+	writes_.flush(PatchWriteQueue::readBy(filter));
+	return counts_.count(filter);
 }
 
 void PatchView::selectFirstPatch()
@@ -781,6 +1091,7 @@ void PatchView::selectFirstPatch()
 
 midikraft::PatchFilter PatchView::currentFilter()
 {
+	// Pending edits are written by the queries that read them, see PatchWriteQueue::readBy
 	auto filter = patchSearch_->getFilter();
 	filter.listID = listFilterID_;
 	if (!filter.listID.empty() && !juce::String(filter.listID).startsWith("import:")) {
@@ -991,27 +1302,31 @@ void PatchView::mergeNewPatches(std::vector<midikraft::PatchHolder> patchesLoade
 	MergeManyPatchFiles backgroundThread(database_, patchesLoaded, [this](std::vector<midikraft::PatchHolder> outNewPatches) {
 		// Back to UI thread
 		MessageManager::callAsync([this, outNewPatches]() {
-			if (outNewPatches.size() > 0) {
-					patchListTree_.refreshAllImports([outNewPatches, this]() {
-						// Select this import
-						auto info = outNewPatches[0].sourceInfo(); //TODO this will break should I change the logic in the PatchDatabase, this is a mere convention
-						auto currentSynth = UIModel::currentSynth();
-						if (info && currentSynth) {
-							auto name = currentSynth->getName();
-							auto scopedId = midikraft::SourceInfo::isEditBufferImport(info)
-								? fmt::format("import:{}:{}", name, "EditBufferImport")
-								: fmt::format("import:{}:{}", name, info->md5(currentSynth));
-							patchListTree_.selectItemByPath({ "allpatches", "library-" + name, "imports-" + name, scopedId });
-						}
-					});
-				}
-			});
+			showNewPatches(outNewPatches);
+		});
 	});
 	backgroundThread.runThread();
 }
 
+void PatchView::showNewPatches(std::vector<midikraft::PatchHolder> const& newPatches) {
+	if (newPatches.size() > 0) {
+		patchListTree_.refreshAllImports([newPatches, this]() {
+			// Select this import
+			auto info = newPatches[0].sourceInfo(); //TODO this will break should I change the logic in the PatchDatabase, this is a mere convention
+			auto currentSynth = UIModel::currentSynth();
+			if (info && currentSynth) {
+				auto name = currentSynth->getName();
+				auto scopedId = midikraft::SourceInfo::isEditBufferImport(info)
+					? fmt::format("import:{}:{}", name, "EditBufferImport")
+					: fmt::format("import:{}:{}", name, info->md5(currentSynth));
+				patchListTree_.selectItemByPath({ "allpatches", "library-" + name, "imports-" + name, scopedId });
+			}
+		});
+	}
+}
+
 std::vector<MidiProgramNumber> PatchView::patchIsInSynth(midikraft::PatchHolder& patch) {
-	auto alreadyInSynth = database_.getBankPositions(patch.smartSynth(), patch.md5());
+	auto alreadyInSynth = programLocations_.bankPositions(patch.smartSynth(), patch.md5());
 	for (auto inSynth : alreadyInSynth) {
 		if (inSynth.bank().isValid()) {
 			spdlog::debug("Patch is already in synth in bank {} at position {}", inSynth.bank().toZeroBased(), inSynth.toZeroBasedDiscardingBank());
@@ -1118,6 +1433,13 @@ void PatchView::sendPatchAsSysex(midikraft::PatchHolder &patch) {
 
 void PatchView::selectPatch(midikraft::PatchHolder &patch, bool alsoSendToSynth)
 {
+	if (PatchProjection::isDisplayOnly(patch)) {
+		// Selected in the grid, which has only the summary. The grid's entry is replaced with the full patch
+		if (!PatchProjection::materialize(database_, patch)) {
+			return;
+		}
+		patchButtons_->updateVisiblePatch(patch);
+	}
 	auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch.patch());
 	// Always refresh the compare target, you just expect it after you clicked it!
 	compareTarget_ = UIModel::currentPatch(); // Previous patch is the one we will compare with
@@ -1196,6 +1518,7 @@ void PatchView::fillList(std::shared_ptr<midikraft::PatchList> list, CreateListD
 	}
 	else  {
 		auto filter = currentFilter();
+		writes_.flush(PatchWriteQueue::readBy(filter));
 		auto synthBank = std::dynamic_pointer_cast<midikraft::SynthBank>(list);
 		size_t patchesDesired = fillParameters.number;
 		size_t minimumPatches = 0;
@@ -1213,7 +1536,7 @@ void PatchView::fillList(std::shared_ptr<midikraft::PatchList> list, CreateListD
 			}
 		}
 
-        if(database_.getPatchesCount(currentFilter()) == 0) {
+        if(counts_.count(currentFilter()) == 0) {
             spdlog::error("The list can't be filled, there are no patches in the database matching the current filter.");
             return;
         }
@@ -31,8 +31,19 @@
 #include "ImportFromSynthDialog.h"
 #include "SynthBankPanel.h"
 #include "PatchHistoryPanel.h"
+#include "DownloadManager.h"
+#include "DownloadProgressPanel.h"
+#include "ProgramLocationIndex.h"
+#include "PatchCountService.h"
+#include "PatchDeleteJob.h"
+#include "PatchPager.h"
+#include "PatchWriteQueue.h"
+#include "DatabaseSnapshots.h"
+#include "OrmSchema.h"
+#include "SearchQueryScheduler.h"
 
 #include <map>
+#include <mutex>
 
 class PatchDiff;
 class PatchSearchComponent;
@@ -51,8 +62,16 @@ public:
 	// React on synth or patch changed
 	virtual void changeListenerCallback(ChangeBroadcaster* source) override;
 
-	void retrieveFirstPageFromDatabase();
+	// Debounce when called for every keystroke or toggle, only the last of a quick series is then run against the database
+	void retrieveFirstPageFromDatabase(bool debounce = false);
 	std::shared_ptr<midikraft::PatchList> retrieveListFromDatabase(midikraft::ListInfo const& info);
+	// Writes the metadata edits still queued, call before the database file is switched or copied
+	void flushEdits();
+	// Before the database file is switched or closed: writes the queued edits and stops the background snapshots, without
+	// copying anything. The database is opened without the backup the PatchDatabase would make on closing
+	void closeDatabase();
+	// Before the database is closed for good
+	void shutdown();
 	void loadSynthBankFromDatabase(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::string const& bankId);
 	void retrieveBankFromSynth(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::function<void()> finishedHandler);
 	void sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend, bool ignoreDirty, std::function<void()> finishedHandler);
@@ -72,6 +91,7 @@ public:
 	void receiveManualDump();
 	void deletePatches();
 	void refreshAllAfterDelete();
+	void refreshAfterDelete(PatchDeleteJob::Delta const& delta);
 	void reindexPatches();
 	void loadPatches();
 	void exportPatches();
@@ -100,7 +120,13 @@ private:
 	std::vector<CategoryButtons::Category> predefinedCategories();
 
 	int getTotalCount();
+	// Counts the current filter and reloads the page, the first or the one shown. Superseded by the next call
+	void requeryDatabase(bool debounce, bool firstPage);
+	// The write queue's writer, on its thread
+	void writeEdits(std::vector<PatchWriteQueue::Edit> const& batch);
 	void loadPage(int skip, int limit, midikraft::PatchFilter const& filter, std::function<void(std::vector<midikraft::PatchHolder>)> callback);
+	// A page of the current filter for the grids, dropped when the filter changed before it arrives
+	void loadCurrentPage(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback);
 
 	std::vector<midikraft::PatchHolder> autoCategorize(std::vector<midikraft::PatchHolder> const &patches);
 
@@ -114,13 +140,18 @@ private:
 	static void sendPatchAsSysex(midikraft::PatchHolder& patch);
 
 	void updateLastPath();
+	// Brings the tables next to the patches up to date in the background, and reloads the grid when it had to do something
+	void migrateSchema();
 
 	void mergeNewPatches(std::vector<midikraft::PatchHolder> patchesLoaded);
+	void showNewPatches(std::vector<midikraft::PatchHolder> const& newPatches);
+	// Runs in the background, each bank is stored in the database while the next one is transferred. onFinished is called on
+	// the message thread once all banks are stored, but not if the user cancelled the download
 	void downloadBanksFromSynth(std::shared_ptr<midikraft::Synth> synth,
 		const std::vector<MidiBankNumber>& banks,
-		const juce::String& progressTitle,
-		std::function<void(std::vector<midikraft::PatchHolder>)> onLoaded,
+		std::function<void()> onFinished,
 		bool requireDetectedDevice = true);
+	std::vector<midikraft::PatchHolder> storeDownloadedBank(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> const& patches, juce::Time timestamp);
 	
 	void saveCurrentPatchCategories();
 	void setSynthBankFilter(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank);
@@ -149,6 +180,7 @@ private:
 	std::unique_ptr<CurrentPatchDisplay> currentPatchDisplay_;
 	std::unique_ptr<SynthBankPanel> synthBank_;
 	std::unique_ptr<PatchHistoryPanel> patchHistory_;
+	std::unique_ptr<DownloadProgressPanel> downloadPanel_;
 	std::unique_ptr<ImportFromSynthDialog> importDialog_;
 	std::unique_ptr<PatchDiff> diffDialog_;
 
@@ -160,8 +192,20 @@ private:
 	midikraft::PatchHolder compareTarget_;
 
 	midikraft::PatchDatabase &database_;
+	// Transactions on the PatchDatabase's connection from background threads - the write queue, downloads and deletes
+	std::mutex sharedConnectionWrites_;
+	ProgramLocationIndex programLocations_;
+	PatchCountService counts_;
+	PatchWriteQueue writes_;
+	PatchPager pager_;
+	std::unique_ptr<DatabaseSnapshots> snapshots_;
+	std::unique_ptr<OrmSchema> schema_;
+	SearchQueryScheduler searches_;
 	
 	std::string lastPathForPIF_;
 
+	// Last, so running downloads are cancelled before anything they use goes away
+	DownloadManager downloads_;
+
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatchView)
 };
@@ -0,0 +1,214 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchWriteQueue.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+
+namespace {
+
+	std::string keyOf(midikraft::PatchHolder const& patch) {
+		return patch.smartSynth()->getName() + "/" + patch.md5();
+	}
+
+	// Bit def()->id per category, as PatchDatabase stores the sets and PatchCountService looks them up
+	int64_t categoryBits(std::set<midikraft::Category> const& categories) {
+		int64_t bits = 0;
+		for (auto const& category : categories) {
+			if (category.def() && category.def()->id >= 0 && category.def()->id < 63) {
+				bits |= int64_t(1) << category.def()->id;
+			}
+		}
+		return bits;
+	}
+
+}
+
+PatchWriteQueue::PatchWriteQueue(TWriter writer, int delayMs /* = 500 */, TFailed failed /* = TFailed() */) :
+	writer_(std::move(writer)), delayMs_(delayMs), failed_(std::move(failed))
+{
+	thread_ = std::thread([this]() { run(); });
+}
+
+PatchWriteQueue::~PatchWriteQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		stop_ = true;
+	}
+	changed_.notify_all();
+	thread_.join();
+}
+
+void PatchWriteQueue::enqueue(midikraft::PatchHolder const& patch, int edits /* = AllEdits */)
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		// A replaced edit of the same patch stays counted, its columns are written with the latest state
+		auto existing = pending_.find(keyOf(patch));
+		if (existing != pending_.end()) {
+			existing->second = { patch, existing->second.edits | edits };
+		}
+		else {
+			pending_.emplace(keyOf(patch), Edit{ patch, edits });
+		}
+		pendingEdits_ |= edits;
+	}
+	changed_.notify_all();
+}
+
+void PatchWriteQueue::flush()
+{
+	std::unique_lock<std::mutex> lock(lock_);
+	if (pending_.empty() && !writing_) {
+		return;
+	}
+	flushing_++;
+	changed_.notify_all();
+	changed_.wait(lock, [this]() { return pending_.empty() && !writing_; });
+	flushing_--;
+}
+
+void PatchWriteQueue::flush(int edits)
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (((pendingEdits_ | writingEdits_) & edits) == 0) {
+			return;
+		}
+	}
+	flush();
+}
+
+int PatchWriteQueue::readBy(midikraft::PatchFilter const& filter)
+{
+	int edits = 0;
+	bool allVisibility = filter.onlyFaves && filter.showHidden && filter.showRegular && filter.showUndecided;
+	if (!allVisibility) {
+		// The default leaves out the hidden patches, the buttons select by favorite and hidden
+		edits |= Hidden;
+		if (filter.onlyFaves || filter.showHidden || filter.showRegular || filter.showUndecided) {
+			edits |= Favorite;
+		}
+	}
+	if (!filter.categories.empty() || filter.onlyUntagged) {
+		edits |= Categories;
+	}
+	if (!filter.name.empty()) {
+		// The ranked search looks at the category names as well
+		edits |= Name | Text | Categories;
+	}
+	if (filter.orderBy == midikraft::PatchOrdering::Order_by_Name || filter.onlyDuplicateNames) {
+		edits |= Name;
+	}
+	return edits;
+}
+
+bool PatchWriteQueue::flagsOnly(int edits)
+{
+	return (edits & ~(Favorite | Hidden | Categories)) == 0;
+}
+
+void PatchWriteQueue::writeFlags(SQLite::Database& db, std::vector<Edit> const& batch)
+{
+	SQLite::Transaction transaction(db);
+	SQLite::Statement update(db, "UPDATE patches SET favorite = :FAV, hidden = :HID, categories = :CAT, categoryUserDecision = :CUD "
+		"WHERE synth = :SYN AND md5 = :MD5");
+	for (auto const& edit : batch) {
+		auto const& patch = edit.patch;
+		update.bind(":FAV", (int) patch.howFavorite().is());
+		update.bind(":HID", patch.isHidden() ? 1 : 0);
+		update.bind(":CAT", (long long) categoryBits(patch.categories()));
+		update.bind(":CUD", (long long) categoryBits(patch.userDecisionSet()));
+		update.bind(":SYN", patch.smartSynth()->getName());
+		update.bind(":MD5", patch.md5());
+		// A patch deleted meanwhile has nothing left to update
+		update.exec();
+		update.reset();
+	}
+	transaction.commit();
+}
+
+size_t PatchWriteQueue::pending() const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	return pending_.size();
+}
+
+void PatchWriteQueue::run()
+{
+	std::unique_lock<std::mutex> lock(lock_);
+	for (;;) {
+		changed_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+		if (pending_.empty()) {
+			// Stopped, and nothing left to write
+			return;
+		}
+		// The next edit often follows within a moment, e.g. when stepping through patches with the keyboard
+		changed_.wait_for(lock, std::chrono::milliseconds(delayMs_), [this]() { return stop_ || flushing_ > 0; });
+
+		std::vector<Edit> batch;
+		batch.reserve(pending_.size());
+		for (auto const& entry : pending_) {
+			batch.push_back(entry.second);
+		}
+		pending_.clear();
+		writingEdits_ = pendingEdits_;
+		pendingEdits_ = 0;
+		writing_ = true;
+		lock.unlock();
+		std::string error;
+		try {
+			writer_(batch);
+		}
+		catch (std::exception const& e) {
+			error = e.what();
+		}
+		bool lost = false;
+		lock.lock();
+		if (!error.empty()) {
+			if (++failures_ < kTries) {
+				spdlog::warn("Could not store the changes of {} patches in the database, trying again: {}", batch.size(), error);
+				for (auto const& edit : batch) {
+					// A newer edit of the patch has its latest state already, it writes the columns of both
+					auto key = keyOf(edit.patch);
+					auto newer = pending_.find(key);
+					if (newer != pending_.end()) {
+						newer->second.edits |= edit.edits;
+					}
+					else {
+						pending_.emplace(key, edit);
+					}
+					pendingEdits_ |= edit.edits;
+				}
+			}
+			else {
+				failures_ = 0;
+				lost = true;
+			}
+		}
+		else {
+			failures_ = 0;
+		}
+		writing_ = false;
+		writingEdits_ = 0;
+		changed_.notify_all();
+		if (lost) {
+			lock.unlock();
+			spdlog::error("Could not store the changes of {} patches in the database: {}", batch.size(), error);
+			if (failed_) {
+				failed_(batch, error);
+			}
+			lock.lock();
+		}
+	}
+}
@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "PatchFilter.h"
+#include "PatchHolder.h"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SQLite {
+	class Database;
+}
+
+// Write-behind for metadata edits like favorite, hide and categories. The caller has already changed its PatchHolder, the
+// queue only takes care of the database. Edits are collected for a moment and handed to the writer in one batch on a
+// background thread, and several edits of the same patch in that time are written once with the latest state.
+//
+// Anything reading the edited columns back from the database has to call flush() first, as has anything replacing or
+// copying the database file, or deleting patches. A query flushes only if edits of the columns its filter reads are pending,
+// see readBy().
+//
+// A batch the writer throws on is queued again, behind newer edits of the same patches, and retried. After the last try it
+// is given to the failure handler, so the caller can show what the database really has.
+class PatchWriteQueue {
+public:
+	struct Edit {
+		midikraft::PatchHolder patch;
+		int edits; // What was changed since the patch was written last
+	};
+
+	typedef std::function<void(std::vector<Edit> const& batch)> TWriter;
+	typedef std::function<void(std::vector<Edit> const& lost, std::string const& error)> TFailed;
+
+	static const int kTries = 3;
+
+	// What an edit changed
+	enum Edits {
+		Name = 1 << 0,
+		Favorite = 1 << 1, // Includes regular, which is stored as a decided non-favorite
+		Hidden = 1 << 2,
+		Categories = 1 << 3,
+		Text = 1 << 4, // Comment, author and info
+		AllEdits = Name | Favorite | Hidden | Categories | Text
+	};
+
+	explicit PatchWriteQueue(TWriter writer, int delayMs = 500, TFailed failed = TFailed());
+	// Writes what is still pending
+	~PatchWriteQueue();
+
+	// Any thread. Replaces a pending edit of the same patch
+	void enqueue(midikraft::PatchHolder const& patch, int edits = AllEdits);
+
+	// Blocks until everything enqueued so far is written
+	void flush();
+	// The same, but returns at once if none of the edits pending changed one of these
+	void flush(int edits);
+
+	// The edits that can change which patches a query with the filter returns, or their order
+	static int readBy(midikraft::PatchFilter const& filter);
+
+	// True if only the favorite, hidden and category columns need writing, which writeFlags() does
+	static bool flagsOnly(int edits);
+	// Writes favorite, hidden and the categories of the patches in one transaction on the connection given. These are the
+	// columns PatchDatabase::putPatch writes for them, which this has to stay in sync with
+	static void writeFlags(SQLite::Database& db, std::vector<Edit> const& batch);
+
+	size_t pending() const;
+
+private:
+	void run();
+
+	TWriter writer_;
+	int delayMs_;
+	TFailed failed_;
+	mutable std::mutex lock_;
+	std::condition_variable changed_;
+	std::map<std::string, Edit> pending_;
+	int failures_ = 0; // Of the batch written last, in a row
+	int pendingEdits_ = 0;
+	int writingEdits_ = 0;
+	bool writing_ = false;
+	int flushing_ = 0;
+	bool stop_ = false;
+	std::thread thread_;
+};
@@ -0,0 +1,142 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ProgramLocationIndex.h"
+
+#include "PatchDatabase.h"
+#include "SynthBank.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+ProgramLocationIndex::ProgramLocationIndex(midikraft::PatchDatabase& database, TLoaded loaded) : database_(database), loaded_(std::move(loaded)), cleared_(0)
+{
+}
+
+std::vector<MidiProgramNumber> ProgramLocationIndex::bankPositions(std::shared_ptr<midikraft::Synth> synth, std::string const& md5)
+{
+	if (!synth) {
+		return {};
+	}
+	auto synthName = synth->getName();
+	std::unique_lock<std::mutex> lock(lock_);
+	while (true) {
+		auto found = synths_.find(synthName);
+		if (found != synths_.end()) {
+			auto positions = found->second.positions.find(md5);
+			return positions != found->second.positions.end() ? positions->second : std::vector<MidiProgramNumber>();
+		}
+		// Not under the lock, this is the one time we go to the database for this synth
+		auto before = generation(synthName);
+		lock.unlock();
+		auto loaded = loadFromDatabase(synth);
+		if (loaded_) {
+			loaded_(synthName);
+		}
+		lock.lock();
+		if (generation(synthName) == before) {
+			// If another lookup was faster, its result is as current as ours
+			synths_.emplace(synthName, std::move(loaded));
+		}
+		else {
+			// A bank was stored or the synth invalidated while we were reading, what we have might predate it
+			spdlog::debug("Banks of {} changed while indexing them, reading them again", synthName);
+		}
+	}
+}
+
+void ProgramLocationIndex::putPatchList(std::shared_ptr<midikraft::PatchList> list)
+{
+	database_.putPatchList(list);
+	if (auto bank = std::dynamic_pointer_cast<midikraft::SynthBank>(list)) {
+		bankLoaded(bank);
+	}
+}
+
+void ProgramLocationIndex::bankLoaded(std::shared_ptr<midikraft::SynthBank> bank)
+{
+	if (!bank || !bank->isActiveSynthBank() || !bank->synth()) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(lock_);
+	changes_[bank->synth()->getName()]++;
+	auto found = synths_.find(bank->synth()->getName());
+	if (found != synths_.end()) {
+		// If the synth is not indexed yet, the first lookup will read this bank from the database anyway
+		indexBank(found->second, *bank);
+	}
+}
+
+void ProgramLocationIndex::invalidate(std::string const& synthName)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	changes_[synthName]++;
+	synths_.erase(synthName);
+}
+
+void ProgramLocationIndex::invalidateAll()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	cleared_++;
+	synths_.clear();
+}
+
+uint64_t ProgramLocationIndex::generation(std::string const& synthName) const
+{
+	auto changes = changes_.find(synthName);
+	return cleared_ + (changes != changes_.end() ? changes->second : 0);
+}
+
+ProgramLocationIndex::SynthIndex ProgramLocationIndex::loadFromDatabase(std::shared_ptr<midikraft::Synth> synth)
+{
+	SynthIndex index;
+	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
+	synths[synth->getName()] = synth;
+	int banks = 0;
+	for (auto const& info : database_.allSynthBanks(synth)) {
+		auto bank = std::dynamic_pointer_cast<midikraft::SynthBank>(database_.getPatchList(info, synths));
+		if (bank && bank->isActiveSynthBank()) {
+			indexBank(index, *bank);
+			banks++;
+		}
+	}
+	spdlog::debug("Indexed {} patches in {} banks of {}", index.positions.size(), banks, synth->getName());
+	return index;
+}
+
+void ProgramLocationIndex::indexBank(SynthIndex& index, midikraft::SynthBank const& bank)
+{
+	auto bankNo = bank.bankNumber();
+	int bankIndex = bankNo.toZeroBased();
+
+	// Remove what we knew about this bank before
+	for (auto const& md5 : index.bankContents[bankIndex]) {
+		auto positions = index.positions.find(md5);
+		if (positions != index.positions.end()) {
+			auto& list = positions->second;
+			list.erase(std::remove_if(list.begin(), list.end(), [bankIndex](MidiProgramNumber const& program) {
+				return program.isBankKnown() && program.bank().toZeroBased() == bankIndex;
+			}), list.end());
+			if (list.empty()) {
+				index.positions.erase(positions);
+			}
+		}
+	}
+
+	std::vector<std::string> contents;
+	int program = 0;
+	for (auto const& patch : bank.patches()) {
+		auto md5 = patch.md5();
+		auto& list = index.positions[md5];
+		list.push_back(MidiProgramNumber::fromZeroBaseWithBank(bankNo, program++));
+		std::sort(list.begin(), list.end(), [](MidiProgramNumber const& a, MidiProgramNumber const& b) {
+			return std::make_pair(a.bank().toZeroBased(), a.toZeroBasedDiscardingBank()) < std::make_pair(b.bank().toZeroBased(), b.toZeroBasedDiscardingBank());
+		});
+		contents.push_back(md5);
+	}
+	index.bankContents[bankIndex] = std::move(contents);
+}
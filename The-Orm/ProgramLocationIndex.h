@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "MidiProgramNumber.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace midikraft {
+	class PatchDatabase;
+	class PatchList;
+	class Synth;
+	class SynthBank;
+}
+
+// Keeps in memory where each patch sits in the synth according to the active synth banks, so selecting a patch does not need
+// to ask the database. The first lookup for a synth loads all its synced banks, afterwards the index follows the banks stored
+// through putPatchList or loaded via bankLoaded. Lookups and updates may come from different threads. The database is read
+// without holding the lock, a bank stored or an invalidation meanwhile makes the lookup read again.
+class ProgramLocationIndex {
+public:
+	typedef std::function<void(std::string const& synthName)> TLoaded;
+
+	// loaded is called after the banks of a synth were read from the database, before they go into the index
+	explicit ProgramLocationIndex(midikraft::PatchDatabase& database, TLoaded loaded = TLoaded());
+
+	// Same result as PatchDatabase::getBankPositions
+	std::vector<MidiProgramNumber> bankPositions(std::shared_ptr<midikraft::Synth> synth, std::string const& md5);
+
+	// Stores the list in the database, and replaces the bank's entries in the index if it is an active synth bank
+	void putPatchList(std::shared_ptr<midikraft::PatchList> list);
+	void bankLoaded(std::shared_ptr<midikraft::SynthBank> bank);
+
+	// The next lookup will rebuild from the database, e.g. after patches were deleted or another database was opened
+	void invalidate(std::string const& synthName);
+	void invalidateAll();
+
+private:
+	struct SynthIndex {
+		std::map<std::string, std::vector<MidiProgramNumber>> positions; // md5 to places in the synth
+		std::map<int, std::vector<std::string>> bankContents; // md5 per program for each zero based bank, to replace a bank
+	};
+
+	SynthIndex loadFromDatabase(std::shared_ptr<midikraft::Synth> synth);
+	static void indexBank(SynthIndex& index, midikraft::SynthBank const& bank);
+	uint64_t generation(std::string const& synthName) const; // Call under the lock
+
+	midikraft::PatchDatabase& database_;
+	TLoaded loaded_;
+	std::mutex lock_;
+	std::map<std::string, SynthIndex> synths_;
+	std::map<std::string, uint64_t> changes_; // Banks stored and invalidations per synth
+	uint64_t cleared_; // invalidateAll calls
+};
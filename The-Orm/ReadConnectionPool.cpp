@@ -0,0 +1,148 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ReadConnectionPool.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	const int kBusyTimeoutMs = 5000;
+}
+
+ReadConnectionPool::Lease::Lease(ReadConnectionPool* pool, std::unique_ptr<SQLite::Database> db, bool snapshot) :
+	pool_(pool), db_(std::move(db)), snapshot_(snapshot)
+{
+	if (snapshot_) {
+		try {
+			db_->exec("BEGIN");
+			// A read transaction takes its snapshot with the first read, not with the BEGIN
+			db_->exec("SELECT count(*) FROM sqlite_master");
+		}
+		catch (SQLite::Exception const&) {
+			snapshot_ = false;
+			try {
+				db_->exec("ROLLBACK");
+			}
+			catch (SQLite::Exception const&) {
+			}
+			pool_->release(std::move(db_));
+			throw;
+		}
+	}
+}
+
+ReadConnectionPool::Lease::Lease(Lease&& other) noexcept :
+	pool_(other.pool_), db_(std::move(other.db_)), snapshot_(other.snapshot_)
+{
+	other.pool_ = nullptr;
+}
+
+ReadConnectionPool::Lease::~Lease()
+{
+	if (!pool_ || !db_) {
+		return;
+	}
+	if (snapshot_) {
+		try {
+			db_->exec("COMMIT");
+		}
+		catch (SQLite::Exception const& e) {
+			// A connection with an open transaction would hold on to its snapshot forever
+			spdlog::warn("Could not end read snapshot: {}", e.what());
+			try {
+				db_->exec("ROLLBACK");
+			}
+			catch (SQLite::Exception const&) {
+			}
+		}
+	}
+	pool_->release(std::move(db_));
+}
+
+ReadConnectionPool::ReadConnectionPool(std::string const& databaseFile, size_t size) : writeAheadLog_(false)
+{
+	for (size_t i = 0; i < size; i++) {
+		free_.push_back(std::make_unique<SQLite::Database>(databaseFile, SQLite::OPEN_READONLY, kBusyTimeoutMs));
+	}
+	if (!free_.empty()) {
+		SQLite::Statement mode(*free_.front(), "PRAGMA journal_mode");
+		writeAheadLog_ = mode.executeStep() && mode.getColumn(0).getString() == "wal";
+	}
+}
+
+ReadConnectionPool::~ReadConnectionPool()
+{
+	// Leases must not outlive the pool
+	std::unique_lock<std::mutex> lock(lock_);
+	free_.clear();
+}
+
+ReadConnectionPool::Lease ReadConnectionPool::acquire()
+{
+	return Lease(this, take(), false);
+}
+
+ReadConnectionPool::Lease ReadConnectionPool::snapshot()
+{
+	return Lease(this, take(), true);
+}
+
+bool ReadConnectionPool::enableWriteAheadLog(SQLite::Database& db)
+{
+	try {
+		SQLite::Statement mode(db, "PRAGMA journal_mode = WAL");
+		std::string result = mode.executeStep() ? mode.getColumn(0).getString() : "";
+		if (result == "wal") {
+			return true;
+		}
+		spdlog::warn("Database stays in {} journal mode, reads will wait for writes", result);
+	}
+	catch (SQLite::Exception const& e) {
+		spdlog::warn("Could not switch the database to WAL mode: {}", e.what());
+	}
+	return false;
+}
+
+bool ReadConnectionPool::useWriteAheadLog(std::string const& databaseFile, bool enabled)
+{
+	try {
+		SQLite::Database db(databaseFile, SQLite::OPEN_READWRITE, kBusyTimeoutMs);
+		if (enabled) {
+			return enableWriteAheadLog(db);
+		}
+		SQLite::Statement mode(db, "PRAGMA journal_mode = DELETE");
+		std::string result = mode.executeStep() ? mode.getColumn(0).getString() : "";
+		if (result != "delete") {
+			spdlog::warn("Database stays in {} journal mode", result);
+		}
+		return result == "wal";
+	}
+	catch (SQLite::Exception const& e) {
+		spdlog::warn("Could not change the journal mode of the database: {}", e.what());
+		return false;
+	}
+}
+
+std::unique_ptr<SQLite::Database> ReadConnectionPool::take()
+{
+	std::unique_lock<std::mutex> lock(lock_);
+	available_.wait(lock, [this]() { return !free_.empty(); });
+	auto db = std::move(free_.back());
+	free_.pop_back();
+	return db;
+}
+
+void ReadConnectionPool::release(std::unique_ptr<SQLite::Database> db)
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		free_.push_back(std::move(db));
+	}
+	available_.notify_one();
+}
@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SQLite {
+	class Database;
+}
+
+// A few read-only connections to the database file, so queries don't queue up behind each other or behind a writer.
+// The pool leaves the journal mode of the file alone. In WAL mode, which the app turns on only if the user chose it,
+// readers never wait for the writer and the writer never waits for readers. In the rollback journal mode a commit still
+// locks the readers out for its duration, and waits for the reads in flight. A plain lease holds its lock for one statement
+// only, so this is short and covered by the busy timeout on both sides.
+//
+// Consistency: a plain lease runs every statement in its own implicit transaction, so two queries through it can see
+// different states of the database if a writer commits in between. A snapshot lease holds one read transaction for its
+// whole life - a count and all pages read through it see the database as of the snapshot's start, whatever gets committed
+// meanwhile. Keep snapshots short, a checkpoint can't move past the oldest open snapshot and the WAL file grows until it ends.
+class ReadConnectionPool {
+public:
+	class Lease {
+	public:
+		Lease(Lease&& other) noexcept;
+		Lease(Lease const&) = delete;
+		Lease& operator=(Lease const&) = delete;
+		~Lease();
+
+		SQLite::Database& db() const { return *db_; }
+
+	private:
+		friend class ReadConnectionPool;
+		Lease(ReadConnectionPool* pool, std::unique_ptr<SQLite::Database> db, bool snapshot);
+
+		ReadConnectionPool* pool_;
+		std::unique_ptr<SQLite::Database> db_;
+		bool snapshot_;
+	};
+
+	explicit ReadConnectionPool(std::string const& databaseFile, size_t size = 3);
+	~ReadConnectionPool();
+
+	// Blocks until a connection is free
+	Lease acquire();
+	Lease snapshot();
+
+	// False if the file was not in WAL mode when the pool was created. Reads still work then, but wait for writers as before
+	bool writeAheadLog() const { return writeAheadLog_; }
+
+	// Switches the file of the connection to WAL, which is persistent. Returns false if that failed
+	static bool enableWriteAheadLog(SQLite::Database& db);
+
+	// Switches the file to WAL or back to the rollback journal. Leaving WAL fails while another connection has the file open,
+	// so call this before opening the database. Returns true if the file is in WAL mode afterwards
+	static bool useWriteAheadLog(std::string const& databaseFile, bool enabled);
+
+private:
+	std::unique_ptr<SQLite::Database> take();
+	void release(std::unique_ptr<SQLite::Database> db);
+
+	std::mutex lock_;
+	std::condition_variable available_;
+	std::vector<std::unique_ptr<SQLite::Database>> free_;
+	bool writeAheadLog_;
+};
@@ -39,6 +39,7 @@ RecordingView::RecordingView(PatchView &patchView) :
 		spdlog::error("Error initializing audio device manager: {}", audioError);
 	}
 	deviceManager_.addAudioCallback(&recorder_);
+	deviceManager_.addAudioCallback(&capture_);
 
 	addAndMakeVisible(thumbnail_);
 
@@ -73,6 +74,7 @@ RecordingView::~RecordingView()
 }
 
 void RecordingView::stopAudio() {
+	deviceManager_.removeAudioCallback(&capture_);
 	deviceManager_.removeAudioCallback(&recorder_);
 }
 
@@ -102,6 +104,10 @@ void RecordingView::sampleNote() {
 		UIModel::instance()->thumbnails_.sendChangeMessage();
 	});
 
+	playTestNote();
+}
+
+void RecordingView::playTestNote() {
 	auto device = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(UIModel::instance()->currentSynth_.smartSynth());
 	if (device->wasDetected()) {
 		auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(UIModel::instance()->currentSynth_.smartSynth());
@@ -120,6 +126,11 @@ bool RecordingView::hasDetectedSignal() const
 	return recorder_.hasDetectedSignal();
 }
 
+ThumbnailPipeline::AudioInput& RecordingView::captureInput()
+{
+	return capture_;
+}
+
 void RecordingView::changeListenerCallback(ChangeBroadcaster* source)
 {
 	ignoreUnused(source);
@@ -15,6 +15,7 @@
 #include "LambdaButtonStrip.h"
 
 #include "PatchView.h"
+#include "ThumbnailPipeline.h"
 
 class RecordingView : public Component, private ChangeListener {
 public:
@@ -28,6 +29,10 @@ public:
 	void sampleNote();
 	bool hasDetectedSignal() const;
 
+	// For the auto thumbnailer
+	void playTestNote();
+	ThumbnailPipeline::AudioInput& captureInput();
+
 private:
 	void changeListenerCallback(ChangeBroadcaster* source) override;
 
@@ -38,6 +43,7 @@ private:
 	AudioSourcePlayer audioSource_;
 
 	AudioRecorder recorder_;
+	ThumbnailAudioCapture capture_;
 	midikraft::TimedMidiSender midiSender_;
 
 	LambdaButtonStrip buttons_;
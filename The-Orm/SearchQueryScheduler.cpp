@@ -0,0 +1,127 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SearchQueryScheduler.h"
+
+#include <spdlog/spdlog.h>
+
+#include <sqlite3.h>
+
+#include <chrono>
+
+class SearchQueryScheduler::QueryJob : public ThreadPoolJob {
+public:
+	QueryJob(SearchQueryScheduler& scheduler, Token token, double dueMs, TQuery query) :
+		ThreadPoolJob("Search query"), scheduler_(scheduler), token_(token), dueMs_(dueMs), query_(std::move(query)) {
+	}
+
+	JobStatus runJob() override {
+		scheduler_.run(token_, dueMs_, query_);
+		{
+			std::lock_guard<std::mutex> lock(scheduler_.lock_);
+			scheduler_.pending_--;
+		}
+		scheduler_.changed_.notify_all();
+		return jobHasFinished;
+	}
+
+private:
+	SearchQueryScheduler& scheduler_;
+	Token token_;
+	double dueMs_;
+	TQuery query_;
+};
+
+SearchQueryScheduler::Token::Token(uint64_t generation, std::shared_ptr<std::atomic<uint64_t>> latest) : generation_(generation), latest_(std::move(latest))
+{
+}
+
+bool SearchQueryScheduler::Token::superseded() const
+{
+	return !latest_ || latest_->load() != generation_;
+}
+
+SearchQueryScheduler::StatementInterrupter::StatementInterrupter(sqlite3* db, Token token, int instructionsBetweenChecks /* = 1000 */) : db_(db), token_(token)
+{
+	sqlite3_progress_handler(db_, instructionsBetweenChecks, &StatementInterrupter::progress, this);
+}
+
+SearchQueryScheduler::StatementInterrupter::~StatementInterrupter()
+{
+	sqlite3_progress_handler(db_, 0, nullptr, nullptr);
+}
+
+int SearchQueryScheduler::StatementInterrupter::progress(void* context)
+{
+	// Non-zero makes SQLite abandon the statement with SQLITE_INTERRUPT
+	return static_cast<StatementInterrupter*>(context)->token_.superseded() ? 1 : 0;
+}
+
+SearchQueryScheduler::SearchQueryScheduler(int debounceMs /* = 150 */) :
+	debounceMs_(debounceMs), latest_(std::make_shared<std::atomic<uint64_t>>(0)), pending_(0), worker_(1)
+{
+}
+
+SearchQueryScheduler::~SearchQueryScheduler()
+{
+	// Anything still debouncing gives up right away, a running query should check its token
+	cancelAll();
+}
+
+SearchQueryScheduler::Token SearchQueryScheduler::request(TQuery query, bool debounce)
+{
+	Token token;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		token = Token(++(*latest_), latest_);
+		pending_++;
+	}
+	// Wake up the job waiting for its debounce window, it is superseded now
+	changed_.notify_all();
+	double dueMs = Time::getMillisecondCounterHiRes() + (debounce ? debounceMs_ : 0);
+	worker_.addJob(new QueryJob(*this, token, dueMs, std::move(query)), true);
+	return token;
+}
+
+SearchQueryScheduler::Token SearchQueryScheduler::current() const
+{
+	return Token(latest_->load(), latest_);
+}
+
+void SearchQueryScheduler::cancelAll()
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		++(*latest_);
+	}
+	changed_.notify_all();
+}
+
+bool SearchQueryScheduler::waitUntilIdle(int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(lock_);
+	return changed_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return pending_ == 0; });
+}
+
+void SearchQueryScheduler::run(Token const& token, double dueMs, TQuery const& query)
+{
+	{
+		std::unique_lock<std::mutex> lock(lock_);
+		double remainingMs = dueMs - Time::getMillisecondCounterHiRes();
+		if (remainingMs > 0) {
+			changed_.wait_for(lock, std::chrono::duration<double, std::milli>(remainingMs), [&token]() { return token.superseded(); });
+		}
+	}
+	if (token.superseded()) {
+		return;
+	}
+	try {
+		query(token);
+	}
+	catch (std::exception const& e) {
+		spdlog::error("Search query failed: {}", e.what());
+	}
+}
@@ -0,0 +1,84 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+struct sqlite3;
+
+// Runs the queries behind the patch grid so that only the latest one counts. Every request starts a new generation and
+// supersedes all earlier ones: a superseded query that has not started yet is dropped, a running one can see it through its
+// Token and stop, and its result is not to be used. Requests that come in within the debounce window of each other (typing
+// into the search box) collapse into the last one.
+class SearchQueryScheduler {
+public:
+	class Token {
+	public:
+		Token() = default;
+
+		uint64_t generation() const { return generation_; }
+		// True once a newer request was made or the scheduler was cancelled. Safe to call after the scheduler is gone
+		bool superseded() const;
+
+	private:
+		friend class SearchQueryScheduler;
+		Token(uint64_t generation, std::shared_ptr<std::atomic<uint64_t>> latest);
+
+		uint64_t generation_ = 0;
+		std::shared_ptr<std::atomic<uint64_t>> latest_;
+	};
+
+	// While it exists, statements on the connection fail with SQLITE_INTERRUPT as soon as the token is superseded. This uses
+	// the connection's progress handler, so there can only be one per connection at a time
+	class StatementInterrupter {
+	public:
+		StatementInterrupter(sqlite3* db, Token token, int instructionsBetweenChecks = 1000);
+		~StatementInterrupter();
+
+	private:
+		static int progress(void* context);
+
+		sqlite3* db_;
+		Token token_;
+	};
+
+	typedef std::function<void(Token const& token)> TQuery;
+
+	explicit SearchQueryScheduler(int debounceMs = 150);
+	~SearchQueryScheduler();
+
+	// Supersedes everything requested before. The query runs on the scheduler's thread, after the debounce window if debounce
+	// is set and no newer request came in meanwhile
+	Token request(TQuery query, bool debounce);
+
+	// Token of the latest request, to tag work that belongs to it like loading further pages
+	Token current() const;
+
+	// Supersedes everything without a new request
+	void cancelAll();
+
+	bool waitUntilIdle(int timeoutMs);
+
+private:
+	class QueryJob;
+
+	void run(Token const& token, double dueMs, TQuery const& query);
+
+	int debounceMs_;
+	std::shared_ptr<std::atomic<uint64_t>> latest_;
+	std::mutex lock_;
+	std::condition_variable changed_;
+	int pending_;
+	ThreadPool worker_;
+};
@@ -21,7 +21,7 @@ SimplePatchGrid::SimplePatchGrid(PatchView* patchView) : patchView_(patchView)
 
 	// Setup the Grid so it always shows the same list as our main patch view
 	grid_->setPatchLoader([this](int skip, int limit, std::function<void(std::vector< midikraft::PatchHolder>)> callback) {
-		patchView_->loadPage(skip, limit, patchView_->currentFilter(), callback);
+		patchView_->loadCurrentPage(skip, limit, callback);
 		});
 
 	Data::ensureEphemeralPropertyExists(EPROPERTY_LIBRARY_PATCH_LIST, {});
@@ -12,8 +12,8 @@
 
 #include <spdlog/spdlog.h>
 
-SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchView *patchView)
-	: patchDatabase_(patchDatabase), patchView_(patchView)
+SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, ProgramLocationIndex& programLocations, PatchView *patchView)
+	: patchDatabase_(patchDatabase), programLocations_(programLocations), patchView_(patchView)
 {
 	instructions_.setText("This window displays a synth bank and acts as drop target to arrange patches. To start, select a synth bank via the Library tree.", juce::dontSendNotification);
 	addAndMakeVisible(instructions_);
@@ -46,7 +46,7 @@ SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchVie
 			{
 				patchView_->sendBankToSynth(synthBank_, false, [this]() {
 					// Save it in the database now that we have successfully sent it to the synth
-					patchDatabase_.putPatchList(synthBank_);
+					programLocations_.putPatchList(synthBank_);
 					// Mark the bank as not modified
 					synthBank_->clearDirty();
 					refresh();
@@ -184,7 +184,7 @@ void SynthBankPanel::copyPatchNamesToClipboard()
 }
 
 void SynthBankPanel::saveToDatabase() {
-	patchDatabase_.putPatchList(synthBank_);
+	programLocations_.putPatchList(synthBank_);
 	synthBank_->clearDirty();
 	refresh();
 }
@@ -11,6 +11,7 @@
 #include "VerticalPatchButtonList.h"
 #include "SynthBank.h"
 #include "PatchDatabase.h"
+#include "ProgramLocationIndex.h"
 #include "InfoText.h"
 
 class PatchView;
@@ -18,7 +19,7 @@ class PatchView;
 class SynthBankPanel : public Component, private ChangeListener
 {
 public:
-	SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchView *patchView);
+	SynthBankPanel(midikraft::PatchDatabase& patchDatabase, ProgramLocationIndex& programLocations, PatchView *patchView);
 	virtual ~SynthBankPanel() override;
 
 	virtual void resized() override;
@@ -40,6 +41,7 @@ private:
 	void showInfoIfRequired();
 
 	midikraft::PatchDatabase& patchDatabase_;
+	ProgramLocationIndex& programLocations_;
 	PatchView* patchView_;
 	std::shared_ptr<midikraft::SynthBank> synthBank_;
 	PatchButtonInfo buttonMode_;
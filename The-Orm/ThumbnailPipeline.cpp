@@ -0,0 +1,373 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ThumbnailPipeline.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+	// How long a single read may block. Short, so we can react to the cancel button
+	constexpr int kReadTimeoutMs = 50;
+}
+
+class ThumbnailPipeline::EncodeJob : public ThreadPoolJob {
+public:
+	EncodeJob(ThumbnailPipeline& pipeline, std::string const& patchMd5, AudioBuffer<float>&& audio, double sampleRate) :
+		ThreadPoolJob("Encode thumbnail " + patchMd5), pipeline_(pipeline), patchMd5_(patchMd5), audio_(std::move(audio)), sampleRate_(sampleRate) {
+	}
+
+	JobStatus runJob() override {
+		File target = pipeline_.targetFile_(patchMd5_);
+		if (writeWavFile(target, audio_, sampleRate_)) {
+			pipeline_.encoded_++;
+			if (pipeline_.onEncoded_) {
+				pipeline_.onEncoded_(patchMd5_, target);
+			}
+		}
+		else {
+			pipeline_.encodeFailed_++;
+			spdlog::error("Failed to write prehear file {}", target.getFullPathName().toStdString());
+		}
+		pipeline_.pendingEncodes_--;
+		return jobHasFinished;
+	}
+
+private:
+	ThumbnailPipeline& pipeline_;
+	std::string patchMd5_;
+	AudioBuffer<float> audio_;
+	double sampleRate_;
+};
+
+ThumbnailPipeline::ThumbnailPipeline(Options const& options, AudioInput& input, PatchDriver& driver, TTargetFile targetFile, TEncodedHandler onEncoded) :
+	options_(options), input_(input), driver_(driver), targetFile_(targetFile), onEncoded_(onEncoded)
+	, encoders_(std::max(1, options.encoderThreads))
+	, pendingEncodes_(0), encoded_(0), encodeFailed_(0)
+{
+}
+
+ThumbnailPipeline::~ThumbnailPipeline()
+{
+	// Never drop recordings that have already been made
+	waitForEncodes(0);
+}
+
+int ThumbnailPipeline::samplesFromMs(int ms) const
+{
+	return roundToInt(input_.sampleRate() * ms / 1000.0);
+}
+
+ThumbnailPipeline::Statistics ThumbnailPipeline::run(int totalPatches, std::function<bool()> shouldExit, std::function<void(double)> progress)
+{
+	Statistics result;
+	bool first = true;
+	while (!shouldExit()) {
+		// Stage 1: Send the patch. The encoder pool is still busy with the previous one
+		auto patchMd5 = sendPatch(first);
+		first = false;
+		if (patchMd5.empty()) {
+			// No more patches
+			break;
+		}
+		result.sent++;
+
+		// Stage 2: Wait until the synth has processed the patch change
+		if (!waitForSettle(shouldExit)) {
+			break;
+		}
+
+		// Stage 3: Record the note
+		AudioBuffer<float> recording;
+		auto captureResult = capture(recording, shouldExit);
+		if (captureResult == CaptureResult::Aborted) {
+			break;
+		}
+		else if (captureResult == CaptureResult::NoSignal) {
+			spdlog::error("No patch could be recorded, please check the Audio setup in the AudioIn view!");
+			result.noSignal = true;
+			break;
+		}
+		else if (captureResult == CaptureResult::NeverEnding) {
+			spdlog::info("That was a never ending patch - you're sure you're not recording something else? Keeping the first {} seconds", options_.maxRecordingMs / 1000);
+			result.neverEnding++;
+		}
+		result.recorded++;
+
+		// Stage 4: Hand over to the encoder pool, and block only if it falls behind too far
+		waitForEncodes(options_.maxPendingEncodes);
+		encodeAsync(patchMd5, std::move(recording));
+
+		if (progress && totalPatches > 0) {
+			progress(std::min(1.0, result.recorded / (double)totalPatches));
+		}
+	}
+
+	waitForEncodes(0);
+	result.encoded = encoded_;
+	result.encodeFailed = encodeFailed_;
+	return result;
+}
+
+std::string ThumbnailPipeline::sendPatch(bool first)
+{
+	// The audio input kept capturing while we were encoding, and a full ring drops the newest audio. Settling must only
+	// judge what the synth does after the patch change
+	input_.flush();
+	return driver_.sendNextPatch(first);
+}
+
+bool ThumbnailPipeline::waitForSettle(std::function<bool()> const& shouldExit)
+{
+	int minSamples = samplesFromMs(options_.minSettleMs);
+	int quietSamplesRequired = samplesFromMs(options_.settleSilenceMs);
+	int maxSamples = samplesFromMs(options_.maxSettleMs);
+
+	AudioBuffer<float> block(std::max(1, input_.numChannels()), options_.blockSize);
+	int elapsed = 0;
+	int quiet = 0;
+	int starvedMs = 0;
+	while (elapsed < maxSamples) {
+		if (shouldExit()) {
+			return false;
+		}
+		int read = input_.read(block, kReadTimeoutMs);
+		if (read <= 0) {
+			// The audio device is not delivering, don't wait forever for it
+			starvedMs += kReadTimeoutMs;
+			if (starvedMs >= options_.maxSettleMs) {
+				break;
+			}
+			continue;
+		}
+		elapsed += read;
+		if (rmsLevel(block, read) < options_.silenceThreshold) {
+			quiet += read;
+			if (quiet >= quietSamplesRequired && elapsed >= minSamples) {
+				return true;
+			}
+		}
+		else {
+			quiet = 0;
+		}
+	}
+	// The synth had as much time as its adaptation asks for, continue anyway
+	return true;
+}
+
+ThumbnailPipeline::CaptureResult ThumbnailPipeline::capture(AudioBuffer<float>& result, std::function<bool()> const& shouldExit)
+{
+	int channels = std::max(1, input_.numChannels());
+	int signalTimeout = samplesFromMs(options_.signalTimeoutMs);
+	int releaseSamples = samplesFromMs(options_.releaseSilenceMs);
+	int maxSamples = samplesFromMs(options_.maxRecordingMs);
+
+	std::vector<std::vector<float>> recorded(channels);
+	AudioBuffer<float> block(channels, options_.blockSize);
+
+	input_.flush();
+	driver_.playNote();
+
+	int total = 0;
+	int signalStart = -1;
+	int lastSignalEnd = 0;
+	int quiet = 0;
+	int starvedMs = 0;
+	CaptureResult outcome = CaptureResult::Recorded;
+	while (true) {
+		if (shouldExit()) {
+			return CaptureResult::Aborted;
+		}
+		int read = input_.read(block, kReadTimeoutMs);
+		if (read <= 0) {
+			starvedMs += kReadTimeoutMs;
+			if (signalStart < 0 && starvedMs >= options_.signalTimeoutMs) {
+				return CaptureResult::NoSignal;
+			}
+			if (signalStart >= 0 && starvedMs >= options_.releaseSilenceMs) {
+				// Input went away mid-note, keep what we have
+				break;
+			}
+			continue;
+		}
+		starvedMs = 0;
+
+		for (int c = 0; c < channels; c++) {
+			auto source = block.getReadPointer(c);
+			recorded[c].insert(recorded[c].end(), source, source + read);
+		}
+		total += read;
+
+		if (rmsLevel(block, read) >= options_.silenceThreshold) {
+			if (signalStart < 0) {
+				signalStart = total - read;
+			}
+			lastSignalEnd = total;
+			quiet = 0;
+		}
+		else if (signalStart >= 0) {
+			quiet += read;
+			if (quiet >= releaseSamples) {
+				break;
+			}
+		}
+		else if (total >= signalTimeout) {
+			return CaptureResult::NoSignal;
+		}
+
+		if (signalStart >= 0 && total - signalStart >= maxSamples) {
+			outcome = CaptureResult::NeverEnding;
+			break;
+		}
+	}
+
+	// Trim leading silence down to the pre roll, and trailing silence away
+	int start = std::max(0, signalStart - samplesFromMs(options_.preRollMs));
+	int end = std::max(start, lastSignalEnd);
+	result.setSize(channels, end - start);
+	for (int c = 0; c < channels; c++) {
+		result.copyFrom(c, 0, recorded[c].data() + start, end - start);
+	}
+	return outcome;
+}
+
+void ThumbnailPipeline::encodeAsync(std::string const& patchMd5, AudioBuffer<float>&& audio)
+{
+	pendingEncodes_++;
+	encoders_.addJob(new EncodeJob(*this, patchMd5, std::move(audio), input_.sampleRate()), true);
+}
+
+void ThumbnailPipeline::waitForEncodes(int maxPending)
+{
+	while (pendingEncodes_ > maxPending) {
+		Thread::sleep(5);
+	}
+}
+
+float ThumbnailPipeline::rmsLevel(AudioBuffer<float> const& buffer, int numSamples)
+{
+	if (numSamples <= 0 || buffer.getNumChannels() == 0) {
+		return 0.0f;
+	}
+	float level = 0.0f;
+	for (int c = 0; c < buffer.getNumChannels(); c++) {
+		level = std::max(level, buffer.getRMSLevel(c, 0, numSamples));
+	}
+	return level;
+}
+
+bool ThumbnailPipeline::writeWavFile(File const& target, AudioBuffer<float> const& audio, double sampleRate)
+{
+	if (!target.getParentDirectory().createDirectory()) {
+		return false;
+	}
+
+	// Write to a temporary first, so the grid never picks up a half written file
+	TemporaryFile temp(target);
+	auto stream = temp.getFile().createOutputStream();
+	if (!stream) {
+		return false;
+	}
+	WavAudioFormat wav;
+	std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, (unsigned int)audio.getNumChannels(), 16, {}, 0));
+	if (!writer) {
+		return false;
+	}
+	stream.release(); // Now owned by the writer
+	if (!writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples())) {
+		return false;
+	}
+	writer.reset();
+	return temp.overwriteTargetFileWithTemporary();
+}
+
+ThumbnailAudioCapture::ThumbnailAudioCapture(int capacitySamples) :
+	ring_(2, capacitySamples), fifo_(capacitySamples), sampleRate_(48000.0), numChannels_(1)
+{
+}
+
+void ThumbnailAudioCapture::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+	float* const* outputChannelData, int numOutputChannels, int numSamples, const AudioIODeviceCallbackContext& context)
+{
+	ignoreUnused(context);
+	// We don't produce any output
+	for (int c = 0; c < numOutputChannels; c++) {
+		if (outputChannelData[c]) {
+			FloatVectorOperations::clear(outputChannelData[c], numSamples);
+		}
+	}
+
+	// Lock free write into the ring buffer. If the reader is behind, the newest audio is dropped
+	int channels = std::min(numInputChannels, ring_.getNumChannels());
+	int start1, size1, start2, size2;
+	fifo_.prepareToWrite(numSamples, start1, size1, start2, size2);
+	for (int c = 0; c < channels; c++) {
+		if (inputChannelData[c]) {
+			if (size1 > 0) ring_.copyFrom(c, start1, inputChannelData[c], size1);
+			if (size2 > 0) ring_.copyFrom(c, start2, inputChannelData[c] + size1, size2);
+		}
+		else {
+			if (size1 > 0) ring_.clear(c, start1, size1);
+			if (size2 > 0) ring_.clear(c, start2, size2);
+		}
+	}
+	fifo_.finishedWrite(size1 + size2);
+}
+
+void ThumbnailAudioCapture::audioDeviceAboutToStart(AudioIODevice* device)
+{
+	if (device) {
+		sampleRate_ = device->getCurrentSampleRate();
+		numChannels_ = jlimit(1, ring_.getNumChannels(), device->getActiveInputChannels().countNumberOfSetBits());
+	}
+}
+
+void ThumbnailAudioCapture::audioDeviceStopped()
+{
+}
+
+double ThumbnailAudioCapture::sampleRate() const
+{
+	return sampleRate_;
+}
+
+int ThumbnailAudioCapture::numChannels() const
+{
+	return numChannels_;
+}
+
+void ThumbnailAudioCapture::flush()
+{
+	// Only the reader side may move the read position, so this is safe without locking
+	fifo_.finishedRead(fifo_.getNumReady());
+}
+
+int ThumbnailAudioCapture::read(AudioBuffer<float>& buffer, int timeoutMs)
+{
+	auto startTime = Time::getMillisecondCounter();
+	while (fifo_.getNumReady() == 0) {
+		if (Time::getMillisecondCounter() - startTime >= (uint32)timeoutMs) {
+			return 0;
+		}
+		Thread::sleep(2);
+	}
+
+	int channels = std::min(buffer.getNumChannels(), numChannels());
+	int start1, size1, start2, size2;
+	fifo_.prepareToRead(buffer.getNumSamples(), start1, size1, start2, size2);
+	for (int c = 0; c < channels; c++) {
+		if (size1 > 0) buffer.copyFrom(c, 0, ring_, c, start1, size1);
+		if (size2 > 0) buffer.copyFrom(c, size1, ring_, c, start2, size2);
+	}
+	for (int c = channels; c < buffer.getNumChannels(); c++) {
+		buffer.clear(c, 0, size1 + size2);
+	}
+	fifo_.finishedRead(size1 + size2);
+	return size1 + size2;
+}
@@ -0,0 +1,136 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+// The ThumbnailPipeline records the prehear audio for a sequence of patches. It is split into stages:
+//   send    - the PatchDriver selects the next patch and sends it to the synth, the audio captured before is discarded
+//   settle  - wait until the audio input is quiet instead of sleeping a fixed time
+//   capture - play a note and record until the signal has died away
+//   encode  - write the WAV file on a worker pool, while the next patch is already being sent
+// Audio input and MIDI output are abstracted so the pipeline can run headless against simulated devices.
+class ThumbnailPipeline {
+public:
+	struct Options {
+		float silenceThreshold = 0.001f; // RMS level below which a block counts as silence
+		int blockSize = 256; // Samples per read from the audio input
+		int minSettleMs = 150; // Minimum time to give the synth after a patch change, silence before it has reacted doesn't count
+		int settleSilenceMs = 50; // Continuous silence required to call the synth settled
+		int maxSettleMs = 2000; // Upper bound for settling, typically the deviceDetectSleepMS of the synth
+		int signalTimeoutMs = 5000; // Give up if no signal is detected after playing the note
+		int releaseSilenceMs = 300; // Continuous silence that ends a recording
+		int maxRecordingMs = 60000; // Hard cap for drones and never ending patches
+		int preRollMs = 10; // Audio kept before the first block with signal
+		int encoderThreads = 2;
+		int maxPendingEncodes = 8; // Back pressure so a slow disk can't make us hold the whole bank in memory
+	};
+
+	class AudioInput {
+	public:
+		virtual ~AudioInput() = default;
+
+		virtual double sampleRate() const = 0;
+		virtual int numChannels() const = 0;
+
+		// Discard anything captured so far
+		virtual void flush() = 0;
+
+		// Read up to buffer.getNumSamples() samples, waiting at most timeoutMs for data to arrive. Returns the number of samples read
+		virtual int read(AudioBuffer<float>& buffer, int timeoutMs) = 0;
+	};
+
+	class PatchDriver {
+	public:
+		virtual ~PatchDriver() = default;
+
+		// Select the first resp. next patch and send it to the synth. Returns the md5 of the patch, or an empty string when there are no more patches
+		virtual std::string sendNextPatch(bool first) = 0;
+
+		// Play the note to be recorded
+		virtual void playNote() = 0;
+	};
+
+	enum class CaptureResult {
+		Recorded,
+		NeverEnding,
+		NoSignal,
+		Aborted
+	};
+
+	struct Statistics {
+		int sent = 0;
+		int recorded = 0;
+		int neverEnding = 0;
+		int encoded = 0;
+		int encodeFailed = 0;
+		bool noSignal = false;
+	};
+
+	typedef std::function<File(std::string const& patchMd5)> TTargetFile;
+	typedef std::function<void(std::string const& patchMd5, File const& file)> TEncodedHandler;
+
+	ThumbnailPipeline(Options const& options, AudioInput& input, PatchDriver& driver, TTargetFile targetFile, TEncodedHandler onEncoded);
+	~ThumbnailPipeline();
+
+	// Runs all stages until the driver runs out of patches, shouldExit returns true, or no signal can be recorded
+	Statistics run(int totalPatches, std::function<bool()> shouldExit, std::function<void(double)> progress);
+
+	// Individual stages, public for testing
+	std::string sendPatch(bool first);
+	bool waitForSettle(std::function<bool()> const& shouldExit);
+	CaptureResult capture(AudioBuffer<float>& result, std::function<bool()> const& shouldExit);
+	void encodeAsync(std::string const& patchMd5, AudioBuffer<float>&& audio);
+	void waitForEncodes(int maxPending);
+
+	static float rmsLevel(AudioBuffer<float> const& buffer, int numSamples);
+	static bool writeWavFile(File const& target, AudioBuffer<float> const& audio, double sampleRate);
+
+private:
+	class EncodeJob;
+
+	int samplesFromMs(int ms) const;
+
+	Options options_;
+	AudioInput& input_;
+	PatchDriver& driver_;
+	TTargetFile targetFile_;
+	TEncodedHandler onEncoded_;
+	ThreadPool encoders_;
+	std::atomic<int> pendingEncodes_;
+	std::atomic<int> encoded_;
+	std::atomic<int> encodeFailed_;
+};
+
+// Audio device callback feeding a ring buffer, so the pipeline can read the incoming audio from its own thread
+class ThumbnailAudioCapture : public AudioIODeviceCallback, public ThumbnailPipeline::AudioInput {
+public:
+	// The ring buffer is allocated once, large enough for a few seconds at the highest sample rate we expect
+	explicit ThumbnailAudioCapture(int capacitySamples = 192000 * 4);
+
+	// AudioIODeviceCallback
+	void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+		float* const* outputChannelData, int numOutputChannels, int numSamples, const AudioIODeviceCallbackContext& context) override;
+	void audioDeviceAboutToStart(AudioIODevice* device) override;
+	void audioDeviceStopped() override;
+
+	// ThumbnailPipeline::AudioInput
+	double sampleRate() const override;
+	int numChannels() const override;
+	void flush() override;
+	int read(AudioBuffer<float>& buffer, int timeoutMs) override;
+
+private:
+	AudioBuffer<float> ring_;
+	AbstractFifo fifo_;
+	std::atomic<double> sampleRate_;
+	std::atomic<int> numChannels_;
+};
@@ -0,0 +1,197 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationInterpreter.h"
+
+#include "JuceHeader.h"
+
+#include "AdaptationModule.h"
+#include "PythonUtils.h"
+
+#include <spdlog/spdlog.h>
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	namespace {
+
+		thread_local AdaptationInterpreter* sCurrentInterpreter = nullptr;
+
+		std::mutex sPoolMutex;
+		std::vector<std::shared_ptr<AdaptationInterpreter>> sInterpreters;
+		std::map<std::string, std::shared_ptr<AdaptationInterpreter>> sRoutes;
+		size_t sNextInterpreter = 0;
+
+	}
+
+	AdaptationInterpreter::AdaptationInterpreter(int index, std::string const& setupCode) : index_(index), open_(false)
+	{
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+		PyInterpreterConfig config{};
+		config.use_main_obmalloc = 0;
+		config.allow_fork = 0;
+		config.allow_exec = 0;
+		config.allow_threads = 1;
+		config.allow_daemon_threads = 0;
+		config.check_multi_interp_extensions = 1;
+		config.gil = PyInterpreterConfig_OWN_GIL;
+		interpreter_.emplace(py::subinterpreter::create(config));
+		open_ = true;
+		InterpreterScope scope(this);
+		py::exec(setupCode);
+		output_ = std::make_unique<PyStdErrOutStreamRedirect>();
+#else
+		ignoreUnused(setupCode);
+		throw std::runtime_error("This build of pybind11 has no sub-interpreter support");
+#endif
+	}
+
+	AdaptationInterpreter::~AdaptationInterpreter()
+	{
+		close();
+	}
+
+	void AdaptationInterpreter::close()
+	{
+		if (!open_) {
+			return;
+		}
+		{
+			InterpreterScope scope(this);
+			output_.reset();
+		}
+		open_ = false;
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+		interpreter_.reset();
+#endif
+	}
+
+	void AdaptationInterpreter::flushOutputToLogger(std::string const& logDomain)
+	{
+		if (output_) {
+			output_->flushToLogger(logDomain);
+		}
+	}
+
+	AdaptationInterpreter* AdaptationInterpreter::current()
+	{
+		return sCurrentInterpreter;
+	}
+
+	InterpreterScope::InterpreterScope(std::shared_ptr<AdaptationInterpreter> const& interpreter) : keepAlive_(interpreter)
+	{
+		enter(interpreter.get());
+	}
+
+	InterpreterScope::InterpreterScope(std::shared_ptr<AdaptationModule const> const& module) : keepAlive_(module ? module->interpreter() : nullptr)
+	{
+		enter(keepAlive_.get());
+	}
+
+	InterpreterScope::InterpreterScope(AdaptationInterpreter* interpreter)
+	{
+		enter(interpreter);
+	}
+
+	void InterpreterScope::enter(AdaptationInterpreter* interpreter)
+	{
+		previous_ = sCurrentInterpreter;
+		if (interpreter == nullptr || !interpreter->isOpen()) {
+			if (previous_ != nullptr) {
+				// Objects of the main interpreter must not be used while an adaptation interpreter is active on this thread
+				throw std::logic_error(fmt::format("Main interpreter entered while adaptation interpreter {} is active", previous_->index()));
+			}
+			gil_.emplace();
+			return;
+		}
+		if (interpreter != previous_) {
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+			activation_.emplace(*interpreter->interpreter_);
+#endif
+			sCurrentInterpreter = interpreter;
+		}
+	}
+
+	InterpreterScope::~InterpreterScope()
+	{
+		sCurrentInterpreter = previous_;
+	}
+
+	void AdaptationInterpreterPool::startup(size_t numberOfInterpreters, std::string const& setupCode)
+	{
+		std::lock_guard<std::mutex> lock(sPoolMutex);
+		if (numberOfInterpreters > 0 && !isSupported()) {
+			spdlog::info("Python sub-interpreters not supported by this build, running all adaptations in one interpreter");
+			return;
+		}
+		for (size_t i = 0; i < numberOfInterpreters; i++) {
+			try {
+				sInterpreters.push_back(std::make_shared<AdaptationInterpreter>((int)i, setupCode));
+			}
+			catch (std::exception& e) {
+				spdlog::warn("Could not create Python interpreter {} for adaptations, continuing with {}: {}", i, sInterpreters.size(), e.what());
+				break;
+			}
+		}
+		if (!sInterpreters.empty()) {
+			spdlog::debug("Running adaptations in {} Python interpreters", sInterpreters.size());
+		}
+	}
+
+	void AdaptationInterpreterPool::shutdown()
+	{
+		std::lock_guard<std::mutex> lock(sPoolMutex);
+		for (auto& interpreter : sInterpreters) {
+			interpreter->close();
+		}
+		sInterpreters.clear();
+		sRoutes.clear();
+		sNextInterpreter = 0;
+	}
+
+	bool AdaptationInterpreterPool::isSupported()
+	{
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	size_t AdaptationInterpreterPool::defaultSize()
+	{
+		// Opt-in only. Not every extension module an adaptation might import can live in an interpreter with its own GIL
+		return 0;
+	}
+
+	size_t AdaptationInterpreterPool::size()
+	{
+		std::lock_guard<std::mutex> lock(sPoolMutex);
+		return sInterpreters.size();
+	}
+
+	std::shared_ptr<AdaptationInterpreter> AdaptationInterpreterPool::interpreterFor(std::string const& adaptationKey)
+	{
+		std::lock_guard<std::mutex> lock(sPoolMutex);
+		if (sInterpreters.empty()) {
+			return nullptr;
+		}
+		auto found = sRoutes.find(adaptationKey);
+		if (found != sRoutes.end()) {
+			return found->second;
+		}
+		auto interpreter = sInterpreters[sNextInterpreter++ % sInterpreters.size()];
+		sRoutes[adaptationKey] = interpreter;
+		return interpreter;
+	}
+
+}
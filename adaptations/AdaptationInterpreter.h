@@ -0,0 +1,103 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#ifdef _MSC_VER
+#pragma warning ( push )
+#pragma warning ( disable: 4100 )
+#endif
+#include <pybind11/embed.h>
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+#include <pybind11/subinterpreter.h>
+#endif
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+
+class PyStdErrOutStreamRedirect;
+
+namespace knobkraft {
+
+	class AdaptationModule;
+
+	// An isolated Python interpreter with its own GIL, hosting a share of the adaptations so calls into different adaptations
+	// don't queue behind each other. Requires pybind11 sub-interpreter support, without it the pool stays empty and all
+	// adaptations live in the main interpreter as before. nullptr is used throughout to denote the main interpreter.
+	class AdaptationInterpreter {
+	public:
+		// Must be called with the GIL of the main interpreter held. setupCode is run first thing, e.g. to set up sys.path
+		AdaptationInterpreter(int index, std::string const& setupCode);
+		~AdaptationInterpreter();
+
+		int index() const { return index_; }
+		bool isOpen() const { return open_; }
+
+		// Ends the interpreter. Objects still living in it are leaked rather than destroyed
+		void close();
+
+		void flushOutputToLogger(std::string const& logDomain);
+
+		// The interpreter entered on this thread, nullptr if none or the main interpreter
+		static AdaptationInterpreter* current();
+
+	private:
+		friend class InterpreterScope;
+
+		int index_;
+		std::atomic<bool> open_;
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+		std::optional<pybind11::subinterpreter> interpreter_;
+#endif
+		std::unique_ptr<PyStdErrOutStreamRedirect> output_;
+	};
+
+	// Enters the interpreter hosting an adaptation on this thread and holds its GIL, replacing py::gil_scoped_acquire for
+	// all code touching the Python objects of an adaptation. Nesting is fine, but entering the main interpreter while an
+	// adaptation interpreter is active on the same thread throws std::logic_error.
+	class InterpreterScope {
+	public:
+		explicit InterpreterScope(std::shared_ptr<AdaptationInterpreter> const& interpreter);
+		explicit InterpreterScope(std::shared_ptr<AdaptationModule const> const& module);
+		~InterpreterScope();
+
+		InterpreterScope(InterpreterScope const&) = delete;
+		InterpreterScope& operator=(InterpreterScope const&) = delete;
+
+	private:
+		friend class AdaptationInterpreter;
+		explicit InterpreterScope(AdaptationInterpreter* interpreter);
+		void enter(AdaptationInterpreter* interpreter);
+
+		std::shared_ptr<AdaptationInterpreter> keepAlive_;
+		AdaptationInterpreter* previous_;
+		std::optional<pybind11::gil_scoped_acquire> gil_;
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+		std::optional<pybind11::subinterpreter_scoped_activate> activation_;
+#endif
+	};
+
+	// Routes each adaptation to one of a fixed set of interpreters, round robin in load order and stable for the lifetime of the process
+	class AdaptationInterpreterPool {
+	public:
+		// Call with the GIL of the main interpreter held. 0 interpreters keeps everything in the main interpreter
+		static void startup(size_t numberOfInterpreters, std::string const& setupCode);
+		static void shutdown();
+
+		static bool isSupported();
+		// 0, the pool is opt-in via the adaptation_interpreters setting or ORM_ADAPTATION_INTERPRETERS
+		static size_t defaultSize();
+		static size_t size();
+
+		static std::shared_ptr<AdaptationInterpreter> interpreterFor(std::string const& adaptationKey);
+	};
+
+}
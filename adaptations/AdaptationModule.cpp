@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationModule.h"
+
+#include "GenericAdaptation.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	extern const char* kIndicateBankDownloadMethod;
+
+	namespace {
+
+		// Maps every function name we look for to its bit in the bitmap
+		std::unordered_map<std::string_view, int> const& knownFunctions() {
+			static std::unordered_map<std::string_view, int> known = []() {
+				std::vector<const char*> names = kAdaptationPythonFunctionNames;
+				// Optional functions not listed for the adaptation templates
+				names.push_back(kLayerTitles);
+				names.push_back(kConvertPatchesToBankDump);
+				names.push_back(kIndicateBankDownloadMethod);
+				std::unordered_map<std::string_view, int> result;
+				for (auto name : names) {
+					if (result.find(name) == result.end()) {
+						int bit = (int)result.size();
+						jassert(bit < 64);
+						result[name] = bit;
+					}
+				}
+				return result;
+			}();
+			return known;
+		}
+
+	}
+
+	AdaptationModule::AdaptationModule(pybind11::module const& module, std::shared_ptr<AdaptationInterpreter> interpreter) :
+		module_(module), interpreter_(interpreter), functionBitmap_(0)
+	{
+		refreshFunctionBitmap();
+	}
+
+	AdaptationModule::~AdaptationModule()
+	{
+		bool interpreterAlive = interpreter_ ? interpreter_->isOpen() : Py_IsInitialized() != 0;
+		if (interpreterAlive) {
+			InterpreterScope python(interpreter_);
+			module_ = py::module();
+		}
+		else {
+			// Interpreter is gone already, nothing left to release
+			module_.release();
+		}
+	}
+
+	bool AdaptationModule::hasFunction(std::string const& functionName) const
+	{
+		auto const& known = knownFunctions();
+		auto found = known.find(functionName);
+		if (found != known.end()) {
+			return (functionBitmap_.load(std::memory_order_relaxed) & (uint64_t(1) << found->second)) != 0;
+		}
+		InterpreterScope python(interpreter_);
+		return module_ && py::hasattr(module_, functionName.c_str());
+	}
+
+	void AdaptationModule::reload()
+	{
+		module_.reload();
+		refreshFunctionBitmap();
+	}
+
+	void AdaptationModule::refreshFunctionBitmap()
+	{
+		uint64_t bitmap = 0;
+		if (module_) {
+			for (auto const& [name, bit] : knownFunctions()) {
+				if (py::hasattr(module_, std::string(name).c_str())) {
+					bitmap |= uint64_t(1) << bit;
+				}
+			}
+		}
+		functionBitmap_.store(bitmap);
+	}
+
+}
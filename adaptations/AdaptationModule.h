@@ -0,0 +1,53 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#ifdef _MSC_VER
+#pragma warning ( push )
+#pragma warning ( disable: 4100 )
+#endif
+#include <pybind11/embed.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include "AdaptationInterpreter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace knobkraft {
+
+	// The C++ owned handle to the Python module of an adaptation, shared by the GenericAdaptation and all its patches.
+	// Which of the known adaptation functions are implemented is determined once when the module is loaded, so
+	// capability queries don't need the GIL. Only the last owner going away touches the interpreter.
+	class AdaptationModule {
+	public:
+		// The module must have been imported in the given interpreter (nullptr for the main one), which must be entered
+		// when creating or reloading the module
+		AdaptationModule(pybind11::module const& module, std::shared_ptr<AdaptationInterpreter> interpreter = nullptr);
+		~AdaptationModule();
+
+		pybind11::module const& module() const { return module_; }
+		std::shared_ptr<AdaptationInterpreter> const& interpreter() const { return interpreter_; }
+
+		// Lock free for all known adaptation function names, falls back to asking Python for others
+		bool hasFunction(std::string const& functionName) const;
+
+		void reload();
+
+	private:
+		void refreshFunctionBitmap();
+
+		pybind11::module module_;
+		std::shared_ptr<AdaptationInterpreter> interpreter_;
+		std::atomic<uint64_t> functionBitmap_;
+	};
+
+}
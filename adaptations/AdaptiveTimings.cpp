@@ -0,0 +1,223 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptiveTimings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace knobkraft {
+
+	namespace {
+		const int kStoredFormatVersion = 3;
+		const int kSampleWindow = 256; // Older samples fade out, so the statistics follow e.g. a changed MIDI interface
+		const double kSafetyMarginMs = 50.0;
+		// A complete dump is unpacked right away, a corrupt one shows then
+		const double kUnpackWindowMs = 2000.0;
+	}
+
+	void AdaptiveTimings::Latency::add(double sampleMs)
+	{
+		if (count >= kSampleWindow) {
+			count /= 2;
+			m2 /= 2.0;
+			// The maximum fades out with the samples, it is the one of the half window before
+			max = windowMax;
+			windowMax = 0.0;
+		}
+		count++;
+		double delta = sampleMs - mean;
+		mean += delta / count;
+		m2 += delta * (sampleMs - mean);
+		max = std::max(max, sampleMs);
+		windowMax = std::max(windowMax, sampleMs);
+	}
+
+	int AdaptiveTimings::Latency::learnedTimeoutMs() const
+	{
+		if (count < kMinimumSamples) {
+			return -1;
+		}
+		double stddev = std::sqrt(m2 / (count - 1));
+		return (int)std::ceil(std::max(mean + 4.0 * stddev, 1.5 * max) + kSafetyMarginMs);
+	}
+
+	AdaptiveTimings::AdaptiveTimings() : dumpReplied_(false), cleanExchanges_(0), lastReplyTimeoutMs_(0), dirty_(false)
+	{
+	}
+
+	void AdaptiveTimings::requestSent(Exchange exchange, double nowMs)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (exchange == Exchange::DeviceDetect) {
+			pendingDetectSince_ = nowMs;
+			return;
+		}
+		if (pendingDumpSince_.has_value() && !dumpReplied_ && lastReplyTimeoutMs_ > 0 && nowMs - *pendingDumpSince_ >= lastReplyTimeoutMs_) {
+			// The previous request was never answered, so the caller must have given up on it
+			fallback();
+		}
+		pendingDumpSince_ = nowMs;
+		dumpReplied_ = false;
+		dumpCompletedAt_.reset();
+	}
+
+	void AdaptiveTimings::replyReceived(Exchange exchange, double nowMs)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (exchange == Exchange::DeviceDetect) {
+			if (pendingDetectSince_.has_value()) {
+				detect_.add(std::max(0.0, nowMs - *pendingDetectSince_));
+				pendingDetectSince_.reset();
+				dirty_ = true;
+			}
+			return;
+		}
+		firstDumpReply(nowMs);
+	}
+
+	void AdaptiveTimings::replyComplete(double nowMs)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		// A single message dump is complete with its first message
+		if (!firstDumpReply(nowMs)) {
+			return;
+		}
+		dumpComplete_.add(std::max(0.0, nowMs - *pendingDumpSince_));
+		pendingDumpSince_.reset();
+		dumpCompletedAt_ = nowMs;
+		cleanExchanges_++;
+		dirty_ = true;
+	}
+
+	void AdaptiveTimings::replyCorrupt(double nowMs)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		bool afterComplete = dumpCompletedAt_.has_value() && nowMs - *dumpCompletedAt_ <= kUnpackWindowMs;
+		if (pendingDumpSince_.has_value() || afterComplete) {
+			fallback();
+		}
+	}
+
+	int AdaptiveTimings::replyTimeoutMs(Bounds const& bounds) const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		// Long enough for the whole dump, which usually takes longer than its first message
+		int learned = dumpComplete_.learnedTimeoutMs() < 0 ? -1 : std::max(dump_.learnedTimeoutMs(), dumpComplete_.learnedTimeoutMs());
+		int result = learned < 0 ? bounds.conservative : clampToBounds(learned, bounds);
+		lastReplyTimeoutMs_ = result;
+		return result;
+	}
+
+	int AdaptiveTimings::deviceDetectWaitMs(Bounds const& bounds) const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		int learned = detect_.learnedTimeoutMs();
+		return learned < 0 ? bounds.conservative : clampToBounds(learned, bounds);
+	}
+
+	int AdaptiveTimings::messageDelayMs(Bounds const& bounds) const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (bounds.conservative <= 0) {
+			return bounds.conservative;
+		}
+		// Halve the delay for every run of clean exchanges, any trouble starts over at the full delay
+		int steps = std::min(cleanExchanges_ / kCleanExchangesPerDelayStep, 16);
+		return clampToBounds(bounds.conservative >> steps, bounds);
+	}
+
+	int AdaptiveTimings::samples(Exchange exchange) const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return exchange == Exchange::DeviceDetect ? detect_.count : dump_.count;
+	}
+
+	int AdaptiveTimings::completeSamples() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		return dumpComplete_.count;
+	}
+
+	std::string AdaptiveTimings::toString() const
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		std::ostringstream out;
+		out << kStoredFormatVersion << " " << cleanExchanges_;
+		for (auto const* stats : { &dump_, &dumpComplete_, &detect_ }) {
+			out << " " << stats->count << " " << stats->mean << " " << stats->m2 << " " << stats->max << " " << stats->windowMax;
+		}
+		return out.str();
+	}
+
+	void AdaptiveTimings::restore(std::string const& stored)
+	{
+		std::istringstream in(stored);
+		int version = 0;
+		int clean = 0;
+		Latency dump, complete, detect;
+		in >> version >> clean;
+		for (auto* stats : { &dump, &complete, &detect }) {
+			in >> stats->count >> stats->mean >> stats->m2 >> stats->max >> stats->windowMax;
+		}
+		if (in.fail() || version != kStoredFormatVersion || clean < 0 || dump.count < 0 || complete.count < 0 || detect.count < 0) {
+			// Nothing stored or not readable - start learning from scratch
+			return;
+		}
+		std::lock_guard<std::mutex> lock(lock_);
+		cleanExchanges_ = clean;
+		dump_ = dump;
+		dumpComplete_ = complete;
+		detect_ = detect;
+	}
+
+	bool AdaptiveTimings::takeDirty()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		bool wasDirty = dirty_;
+		dirty_ = false;
+		return wasDirty;
+	}
+
+	bool AdaptiveTimings::firstDumpReply(double nowMs)
+	{
+		if (!pendingDumpSince_.has_value()) {
+			// Not a reply, nothing was requested
+			return false;
+		}
+		if (!dumpReplied_) {
+			if (lastReplyTimeoutMs_ > 0 && nowMs - *pendingDumpSince_ > lastReplyTimeoutMs_) {
+				// Too late, the caller gave up on the request already
+				fallback();
+				return false;
+			}
+			dump_.add(std::max(0.0, nowMs - *pendingDumpSince_));
+			dumpReplied_ = true;
+			dirty_ = true;
+		}
+		return true;
+	}
+
+	void AdaptiveTimings::fallback()
+	{
+		// Forget what we learned about dumps, the conservative values apply until we have enough clean samples again
+		dump_ = Latency();
+		dumpComplete_ = Latency();
+		cleanExchanges_ = 0;
+		pendingDumpSince_.reset();
+		dumpReplied_ = false;
+		dumpCompletedAt_.reset();
+		dirty_ = true;
+	}
+
+	int AdaptiveTimings::clampToBounds(int learned, Bounds const& bounds)
+	{
+		int minimum = std::min(bounds.minimum.value_or(bounds.conservative / 4), bounds.conservative);
+		return std::clamp(learned, minimum, bounds.conservative);
+	}
+
+}
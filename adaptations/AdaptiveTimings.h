@@ -0,0 +1,92 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace knobkraft {
+
+	// Learns how quickly a synth actually answers, so the generous timeouts and delays given by an adaptation's messageTimings()
+	// can be shortened. The adaptation's values stay the upper bound and are used again right after a reply timed out or was
+	// corrupt, until enough clean exchanges have been seen again. Thread safe, replies are reported from the MIDI thread.
+	//
+	// A dump is timed twice from the moment its request was sent: to its first message, and to its last one. Messages that
+	// arrive while no request is outstanding, e.g. from a file import, are not replies and don't count.
+	class AdaptiveTimings {
+	public:
+		enum class Exchange {
+			DeviceDetect, // Unanswered probes are normal here, the synth might just not be on that port
+			DumpRequest
+		};
+
+		struct Bounds {
+			int conservative; // The adaptation's value, never exceeded
+			std::optional<int> minimum; // Lower bound given by the adaptation, a quarter of the conservative value if not
+		};
+
+		static constexpr int kMinimumSamples = 8;
+		static constexpr int kCleanExchangesPerDelayStep = 16;
+
+		AdaptiveTimings();
+
+		// Call when a request has been sent, and when the first message of its reply has been recognized
+		void requestSent(Exchange exchange, double nowMs);
+		void replyReceived(Exchange exchange, double nowMs);
+		// Call when the last message of a dump has been recognized
+		void replyComplete(double nowMs);
+		// Counts only while a request is outstanding, or right after its reply was complete
+		void replyCorrupt(double nowMs);
+
+		// The values to use right now
+		int replyTimeoutMs(Bounds const& bounds) const;
+		int deviceDetectWaitMs(Bounds const& bounds) const;
+		int messageDelayMs(Bounds const& bounds) const;
+
+		// Of the first messages of the replies, and of complete dumps
+		int samples(Exchange exchange) const;
+		int completeSamples() const;
+
+		// For persisting between sessions
+		std::string toString() const;
+		void restore(std::string const& stored);
+
+		// True once if something worth persisting happened since the last call
+		bool takeDirty();
+
+	private:
+		struct Latency {
+			int count = 0;
+			double mean = 0.0;
+			double m2 = 0.0; // Sum of squared differences from the mean, as in Welford's algorithm
+			double max = 0.0; // Of the samples since the window was halved the time before last
+			double windowMax = 0.0; // Of the samples since the window was halved
+
+			void add(double sampleMs);
+			int learnedTimeoutMs() const;
+		};
+
+		bool firstDumpReply(double nowMs);
+		void fallback();
+		static int clampToBounds(int learned, Bounds const& bounds);
+
+		mutable std::mutex lock_;
+		Latency detect_;
+		Latency dump_; // To the first message of the reply
+		Latency dumpComplete_; // To the last message of the reply
+		std::optional<double> pendingDetectSince_;
+		std::optional<double> pendingDumpSince_; // Until the dump is complete
+		bool dumpReplied_; // The first message of the pending dump has been seen
+		std::optional<double> dumpCompletedAt_;
+		int cleanExchanges_;
+		mutable int lastReplyTimeoutMs_;
+		bool dirty_;
+	};
+
+}
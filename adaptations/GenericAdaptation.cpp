@@ -21,6 +21,8 @@
 #include "GenericHasBanksCapability.h"
 #include "GenericHasBankDescriptorsCapability.h"
 #include "GenericLegacyLoaderCapability.h"
+#include "NativeSysex.h"
+#include "NativeRoland.h"
 
 #ifdef _MSC_VER
 #pragma warning ( push )
@@ -30,6 +32,7 @@
 #ifdef _MSC_VER
 #pragma warning ( pop )
 #endif
+#include <algorithm>
 #include <memory>
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
@@ -40,6 +43,17 @@ using namespace py::literals;
 #include <fmt/format.h>
 #include <string>
 
+// Native versions of the knobkraft.sysex helpers and the GenericRoland engine, picked up by the Python modules when running inside the Orm.
+// Must live in this translation unit so the linker doesn't drop the module registration from the static library.
+#ifdef PYBIND11_HAS_SUBINTERPRETER_SUPPORT
+PYBIND11_EMBEDDED_MODULE(knobkraft_native, m, pybind11::multiple_interpreters::per_interpreter_gil()) {
+#else
+PYBIND11_EMBEDDED_MODULE(knobkraft_native, m) {
+#endif
+	knobkraft::registerNativeSysex(m);
+	knobkraft::registerNativeRoland(m);
+}
+
 namespace knobkraft {
 
 	const char
@@ -135,13 +149,20 @@ namespace knobkraft {
 	};
 
 	const char* kUserAdaptationsFolderSettingsKey = "user_adaptations_folder";
+	const char* kAdaptationInterpretersSettingsKey = "adaptation_interpreters";
+	const char* kAdaptiveTimingsSettingsKey = "adaptive_timings";
 
 	std::unique_ptr<py::scoped_interpreter> sGenericAdaptationPythonEmbeddedGuard;
 	std::unique_ptr<py::gil_scoped_release> sGenericAdaptationDontLockGIL;
 	std::unique_ptr<PyStdErrOutStreamRedirect> sGenericAdaptationPyOutputRedirect;
 
 	void checkForPythonOutputAndLog() {
-		sGenericAdaptationPyOutputRedirect->flushToLogger("Adaptation");
+		if (auto interpreter = AdaptationInterpreter::current()) {
+			interpreter->flushOutputToLogger("Adaptation");
+		}
+		else {
+			sGenericAdaptationPyOutputRedirect->flushToLogger("Adaptation");
+		}
 	}
 
 	class FatalAdaptationException : public std::runtime_error {
@@ -149,9 +170,30 @@ namespace knobkraft {
 		using std::runtime_error::runtime_error;
 	};
 
+	std::shared_ptr<AdaptationModule> importModule(std::string const& moduleName, std::shared_ptr<AdaptationInterpreter> interpreter)
+	{
+		{
+			InterpreterScope python(interpreter);
+			try {
+				auto module = std::make_shared<AdaptationModule>(py::module::import(moduleName.c_str()), interpreter);
+				checkForPythonOutputAndLog();
+				return module;
+			}
+			catch (py::error_already_set& ex) {
+				if (!interpreter || !ex.matches(PyExc_ImportError)) {
+					spdlog::error("Adaptation: Failure loading python module {}: {}", moduleName, ex.what());
+					ex.restore();
+					throw FatalAdaptationException("Cannot initialize Adaptation");
+				}
+				// Most likely the adaptation uses an extension module that can't be loaded into a sub-interpreter
+				spdlog::debug("Adaptation {} could not be imported into Python interpreter {}, using the main interpreter: {}", moduleName, interpreter->index(), ex.what());
+			}
+		}
+		return importModule(moduleName, nullptr);
+	}
+
 	GenericAdaptation::GenericAdaptation(std::string const& pythonModuleFilePath) : filepath_(pythonModuleFilePath)
 	{
-		py::gil_scoped_acquire acquire;
 		editBufferCapabilityImpl_ = std::make_shared<GenericEditBufferCapability>(this);
 		programDumpCapabilityImpl_ = std::make_shared<GenericProgramDumpCapability>(this);
 		bankDumpCapabilityImpl_ = std::make_shared<GenericBankDumpCapability>(this);
@@ -172,13 +214,10 @@ namespace knobkraft {
 			if (!result["matches"].cast<bool>()) {
 				SimpleLogger::instance()->postMessage(fmt::format("Adaptation: Warning: file name %s is not a valid module identifier in Python, please use only lower case letters and numbers") % pythonModuleFilePath).str());
 			}*/
-			adaptation_module = py::module::import(filepath_.c_str());
-			checkForPythonOutputAndLog();
+			adaptationModule_ = importModule(filepath_, AdaptationInterpreterPool::interpreterFor(filepath_));
 		}
-		catch (py::error_already_set& ex) {
-			spdlog::error("Adaptation: Failure loading python module {}: {}", pythonModuleFilePath, ex.what());
-			ex.restore();
-			throw FatalAdaptationException("Cannot initialize Adaptation");
+		catch (FatalAdaptationException&) {
+			throw;
 		}
 		catch (std::exception& ex) {
 			spdlog::error("Adaptation: Failure loading python module {}: {}", pythonModuleFilePath, ex.what());
@@ -186,27 +225,31 @@ namespace knobkraft {
 		}
 	}
 
-	GenericAdaptation::GenericAdaptation(pybind11::module adaptationModule)
+	GenericAdaptation::GenericAdaptation(pybind11::module adaptationModule) : GenericAdaptation(adaptationModule, nullptr)
 	{
-		py::gil_scoped_acquire acquire;
+	}
+
+	GenericAdaptation::GenericAdaptation(pybind11::module adaptationModule, std::shared_ptr<AdaptationInterpreter> interpreter)
+	{
+		InterpreterScope python(interpreter);
 		editBufferCapabilityImpl_ = std::make_shared<GenericEditBufferCapability>(this);
 		programDumpCapabilityImpl_ = std::make_shared<GenericProgramDumpCapability>(this);
 		bankDumpCapabilityImpl_ = std::make_shared<GenericBankDumpCapability>(this);
 		bankDumpRequestCapabilityImpl_ = std::make_shared<GenericBankDumpRequestCapability>(this);
 		legacyLoaderCapabilityImpl_ = std::make_shared<GenericLegacyLoaderCapability>(this);
 		customProgramChangeCapabilityImpl_ = std::make_shared<GenericCustomProgramChangeCapability>(this);
-		adaptation_module = adaptationModule;
+		adaptationModule_ = std::make_shared<AdaptationModule>(adaptationModule, interpreter);
 	}
 
 	GenericAdaptation::~GenericAdaptation()
 	{
-		py::gil_scoped_acquire gil;
-		adaptation_module.release();
+		// The module handle releases itself once the last patch created by us is gone
 	}
 
 	std::shared_ptr<GenericAdaptation> GenericAdaptation::fromBinaryCode(std::string moduleName, std::string adaptationCode)
 	{
-		py::gil_scoped_acquire acquire;
+		auto interpreter = AdaptationInterpreterPool::interpreterFor(moduleName);
+		InterpreterScope python(interpreter);
 		try {
 			auto importlib = py::module::import("importlib.util");
 			checkForPythonOutputAndLog();
@@ -223,7 +266,7 @@ namespace knobkraft {
 			checkForPythonOutputAndLog();
 			py::exec(adaptationCode, adaptation_module.attr("__dict__")); // Now run the define statements in the code, creating the defines within the right namespace
 			checkForPythonOutputAndLog();
-			auto newAdaptation = std::make_shared<GenericAdaptation>(py::cast<py::module>(adaptation_module));
+			auto newAdaptation = std::make_shared<GenericAdaptation>(py::cast<py::module>(adaptation_module), interpreter);
 			//if (newAdaptation) newAdaptation->logNamespace();
 			return newAdaptation;
 		}
@@ -238,10 +281,10 @@ namespace knobkraft {
 	}
 
 	void GenericAdaptation::logNamespace() {
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		try {
-			auto name = py::cast<std::string>(adaptation_module.attr("__name__"));
-			auto moduleDict = adaptation_module.attr("__dict__");
+			auto name = py::cast<std::string>(adaptationModule_->module().attr("__name__"));
+			auto moduleDict = adaptationModule_->module().attr("__dict__");
 			for (auto a : moduleDict) {
 				spdlog::debug("Found in {} attribute {}", name, py::cast<std::string>(a));
 			}
@@ -284,6 +327,13 @@ namespace knobkraft {
     }
 #endif
 
+	size_t numberOfAdaptationInterpreters() {
+		// ORM_ADAPTATION_INTERPRETERS overrides the setting, 0 runs all adaptations in the main interpreter
+		auto configured = juce::SystemStats::getEnvironmentVariable("ORM_ADAPTATION_INTERPRETERS",
+			Settings::instance().get(kAdaptationInterpretersSettingsKey, std::to_string(AdaptationInterpreterPool::defaultSize())));
+		return (size_t)std::max(0, configured.getIntValue());
+	}
+
 	void GenericAdaptation::startupGenericAdaptation()
 	{
 		if (juce::SystemStats::getEnvironmentVariable("ORM_NO_PYTHON", "NOTSET") != "NOTSET") {
@@ -317,10 +367,12 @@ namespace knobkraft {
 		// For Apple (probably for Linux as well?) we need to append the path "python" to the python sys path, so it will find 
 		// python code we are installing, e.g. the generic sequential module which is used by all Sequential synths
 		File pythonPath2 = File::getSpecialLocation(File::SpecialLocationType::currentExecutableFile).getParentDirectory().getChildFile("python");
-		command = "import sys\nsys.path.append(R\"" + pythonPath2.getFullPathName().toStdString() + "\")\n";
-		py::exec(command);
+		std::string command2 = "import sys\nsys.path.append(R\"" + pythonPath2.getFullPathName().toStdString() + "\")\n";
+		py::exec(command2);
+		command += command2;
 #endif
 		checkForPythonOutputAndLog();
+		AdaptationInterpreterPool::startup(numberOfAdaptationInterpreters(), command);
 		sGenericAdaptationDontLockGIL = std::make_unique<py::gil_scoped_release>();
 		// From this point on, whenever you want to call into python you need to acquire the GIL 
 		// with:
@@ -339,6 +391,7 @@ namespace knobkraft {
 		// Remove the global release on Python, else the destruction code will fail!
 		{
 			py::gil_scoped_acquire acquire;
+			AdaptationInterpreterPool::shutdown();
 			sGenericAdaptationPyOutputRedirect.reset();
 		}
 		sGenericAdaptationDontLockGIL.reset();
@@ -370,7 +423,7 @@ namespace knobkraft {
 	}
 
 	[[nodiscard]] bool GenericAdaptation::createCompiledAdaptationModule(std::string const& pythonModuleName, std::string const& adaptationCode, std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>>& outAddToThis) {
-		py::gil_scoped_acquire acquire;
+		// The adaptation enters its own interpreter for every call, don't hold the main GIL here
 		auto newAdaptation = GenericAdaptation::fromBinaryCode(pythonModuleName, adaptationCode);
 		if (newAdaptation) {
 			// Now we need to check the name of the compiled adaptation just created, and if it is already present. If yes, don't add it but rather issue a warning
@@ -525,11 +578,7 @@ namespace knobkraft {
 
 
 	bool GenericAdaptation::pythonModuleHasFunction(std::string const& functionName) const {
-		py::gil_scoped_acquire acquire;
-		if (!adaptation_module) {
-			return false;
-		}
-		return py::hasattr(*adaptation_module, functionName.c_str());
+		return adaptationModule_ && adaptationModule_->hasFunction(functionName);
 	}
 
 	bool GenericAdaptation::isFromFile() const
@@ -539,15 +588,15 @@ namespace knobkraft {
 
 	std::string GenericAdaptation::getSourceFilePath() const
 	{
-		py::gil_scoped_acquire acquire;
-		return adaptation_module.attr("__file__").cast<std::string>();
+		InterpreterScope python(adaptationModule_);
+		return adaptationModule_->module().attr("__file__").cast<std::string>();
 	}
 
 	void GenericAdaptation::reloadPython()
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		try {
-			adaptation_module.reload();
+			adaptationModule_->reload();
 			logNamespace();
 		}
 		catch (py::error_already_set& ex) {
@@ -561,15 +610,15 @@ namespace knobkraft {
 
 	std::shared_ptr<midikraft::DataFile> GenericAdaptation::patchFromPatchData(const Synth::PatchData& data, MidiProgramNumber place) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		ignoreUnused(place);
-		auto patch = std::make_shared<GenericPatch>(this, adaptation_module, data, GenericPatch::PROGRAM_DUMP);
+		auto patch = std::make_shared<GenericPatch>(this, adaptationModule_, data, GenericPatch::PROGRAM_DUMP);
 		return patch;
 	}
 
 	bool GenericAdaptation::isOwnSysex(MidiMessage const& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		//TODO - if we delegate this to the python code, the "sniff synth" method of the Librarian can be used. But this is currently disabled anyway,
 		// even if I forgot why
 		ignoreUnused(message);
@@ -578,28 +627,12 @@ namespace knobkraft {
 
 	void GenericAdaptation::sendBlockOfMessagesToSynth(juce::MidiDeviceInfo const& midiOutput, std::vector<MidiMessage> const& buffer)
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		int delay = 0;
 		bool handled = false;
-		if (pythonModuleHasFunction(kMessageTimings)) {
-			try {
-				py::object result = callMethod(kMessageTimings);
-				if (py::isinstance<py::dict>(result)) {
-					auto dict = result.cast<py::dict>();
-					auto key = py::str("generalMessageDelay");
-					if (dict.contains(key)) {
-						delay = dict[key].cast<int>();
-						handled = true;
-					}
-				}
-			}
-			catch (py::error_already_set& ex) {
-				logAdaptationError(kMessageTimings, ex);
-				ex.restore();
-			}
-			catch (std::exception& ex) {
-				logAdaptationError(kMessageTimings, ex);
-			}
+		if (auto configured = messageTiming("generalMessageDelay")) {
+			delay = *configured;
+			handled = true;
 		}
 
 		if (!handled && pythonModuleHasFunction(kGeneralMessageDelay)) {
@@ -617,18 +650,22 @@ namespace knobkraft {
 			}
 		}
 
+		if (handled && delay > 0 && adaptiveTimingsEnabled()) {
+			delay = timings().messageDelayMs({ delay, messageTiming("minimumGeneralMessageDelay") });
+		}
 		if (handled && delay > 0) {
 			midikraft::MidiController::instance()->getMidiOutput(midiOutput)->sendBlockOfMessagesThrottled(buffer, delay);
-			return;
 		}
-
-		// No special behavior - just send at full speed
-		midikraft::MidiController::instance()->getMidiOutput(midiOutput)->sendBlockOfMessagesFullSpeed(buffer);
+		else {
+			// No special behavior - just send at full speed
+			midikraft::MidiController::instance()->getMidiOutput(midiOutput)->sendBlockOfMessagesFullSpeed(buffer);
+		}
+		observeSent(buffer);
 	}
 
 	std::string GenericAdaptation::friendlyProgramName(MidiProgramNumber programNo) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		if (pythonModuleHasFunction(kFriendlyProgramName)) {
 			try {
 				int zerobased = programNo.toZeroBasedWithBank();
@@ -648,7 +685,7 @@ namespace knobkraft {
 
 	std::string GenericAdaptation::setupHelpText() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		if (!pythonModuleHasFunction("setupHelp")) {
 			return Synth::setupHelpText();
 		}
@@ -669,44 +706,56 @@ namespace knobkraft {
 
 	int GenericAdaptation::defaultReplyTimeoutMs() const
 	{
-		py::gil_scoped_acquire acquire;
-		if (pythonModuleHasFunction(kMessageTimings)) {
-			try {
-				py::object result = callMethod(kMessageTimings);
-				if (py::isinstance<py::dict>(result)) {
-					auto dict = result.cast<py::dict>();
-					auto key = py::str("replyTimeoutMs");
-					if (dict.contains(key)) {
-						int value = dict[key].cast<int>();
-						if (value > 0) {
-							return value;
-						}
-					}
-				}
+		InterpreterScope python(adaptationModule_);
+		int conservative = Synth::defaultReplyTimeoutMs();
+		auto configured = messageTiming("replyTimeoutMs");
+		if (configured.has_value() && *configured > 0) {
+			conservative = *configured;
+		}
+		if (!adaptiveTimingsEnabled()) {
+			return conservative;
+		}
+		return timings().replyTimeoutMs({ conservative, messageTiming("minimumReplyTimeoutMs") });
+	}
+
+	int GenericAdaptation::deviceDetectSleepMS()
+	{
+		InterpreterScope python(adaptationModule_);
+		int conservative = 200;
+		if (auto configured = messageTiming("deviceDetectWaitMilliseconds")) {
+			conservative = *configured;
+		}
+		else if (pythonModuleHasFunction(kDeviceDetectWaitMilliseconds)) {
+			try
+			{
+				py::object result = callMethod(kDeviceDetectWaitMilliseconds);
+				conservative = result.cast<int>();
 			}
 			catch (py::error_already_set& ex) {
-				logAdaptationError(kMessageTimings, ex);
+				logAdaptationError(kDeviceDetectWaitMilliseconds, ex);
 				ex.restore();
 			}
 			catch (std::exception& ex) {
-				logAdaptationError(kMessageTimings, ex);
+				logAdaptationError(kDeviceDetectWaitMilliseconds, ex);
 			}
 		}
-		return Synth::defaultReplyTimeoutMs();
+		if (!adaptiveTimingsEnabled()) {
+			return conservative;
+		}
+		return timings().deviceDetectWaitMs({ conservative, messageTiming("minimumDeviceDetectWaitMilliseconds") });
 	}
 
-	int GenericAdaptation::deviceDetectSleepMS()
+	std::optional<int> GenericAdaptation::messageTiming(std::string const& key) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		if (pythonModuleHasFunction(kMessageTimings)) {
-			try
-			{
+			try {
 				py::object result = callMethod(kMessageTimings);
 				if (py::isinstance<py::dict>(result)) {
 					auto dict = result.cast<py::dict>();
-					auto key = py::str("deviceDetectWaitMilliseconds");
-					if (dict.contains(key)) {
-						return dict[key].cast<int>();
+					auto pyKey = py::str(key);
+					if (dict.contains(pyKey)) {
+						return dict[pyKey].cast<int>();
 					}
 				}
 			}
@@ -718,28 +767,106 @@ namespace knobkraft {
 				logAdaptationError(kMessageTimings, ex);
 			}
 		}
-		if (!pythonModuleHasFunction(kDeviceDetectWaitMilliseconds)) {
-			return 200;
+		return {};
+	}
+
+	bool GenericAdaptation::adaptiveTimingsEnabled() const
+	{
+		if (Settings::instance().get(kAdaptiveTimingsSettingsKey, "1") == "0") {
+			return false;
 		}
-		try
-		{
-			py::object result = callMethod(kDeviceDetectWaitMilliseconds);
-			return result.cast<int>();
+		// Adaptations can opt out with "adaptive": False in their messageTimings()
+		auto adaptive = messageTiming("adaptive");
+		return !adaptive.has_value() || *adaptive != 0;
+	}
+
+	AdaptiveTimings& GenericAdaptation::timings() const
+	{
+		std::call_once(timingsRestored_, [this]() {
+			timingsSettingsKey_ = "adaptive_timings_" + getName();
+			timings_.restore(Settings::instance().get(timingsSettingsKey_, ""));
+		});
+		return timings_;
+	}
+
+	void GenericAdaptation::observeRequest(AdaptiveTimings::Exchange exchange) const
+	{
+		timings().requestSent(exchange, Time::getMillisecondCounterHiRes());
+	}
 
+	void GenericAdaptation::armDumpRequest(std::vector<MidiMessage> const& request) const
+	{
+		std::lock_guard<std::mutex> lock(armedLock_);
+		armedRequest_.clear();
+		for (auto const& message : request) {
+			armedRequest_.insert(armedRequest_.end(), message.getRawData(), message.getRawData() + message.getRawDataSize());
 		}
-		catch (py::error_already_set& ex) {
-			logAdaptationError(kDeviceDetectWaitMilliseconds, ex);
-			ex.restore();
+	}
+
+	void GenericAdaptation::observeSent(std::vector<MidiMessage> const& buffer) const
+	{
+		{
+			std::lock_guard<std::mutex> lock(armedLock_);
+			if (armedRequest_.empty()) {
+				return;
+			}
+			std::vector<uint8> sent;
+			for (auto const& message : buffer) {
+				sent.insert(sent.end(), message.getRawData(), message.getRawData() + message.getRawDataSize());
+			}
+			if (std::search(sent.begin(), sent.end(), armedRequest_.begin(), armedRequest_.end()) == sent.end()) {
+				return;
+			}
+			armedRequest_.clear();
 		}
-		catch (std::exception& ex) {
-			logAdaptationError(kDeviceDetectWaitMilliseconds, ex);
+		// After the whole block is out, the synth might wait for its end
+		observeRequest(AdaptiveTimings::Exchange::DumpRequest);
+	}
+
+	void GenericAdaptation::observeDeviceDetect(double sentMs, double receivedMs) const
+	{
+		timings().requestSent(AdaptiveTimings::Exchange::DeviceDetect, sentMs);
+		timings().replyReceived(AdaptiveTimings::Exchange::DeviceDetect, receivedMs);
+		persistTimings();
+	}
+
+	void GenericAdaptation::observeReply(AdaptiveTimings::Exchange exchange) const
+	{
+		timings().replyReceived(exchange, Time::getMillisecondCounterHiRes());
+		persistTimings();
+	}
+
+	void GenericAdaptation::observeReplyComplete() const
+	{
+		timings().replyComplete(Time::getMillisecondCounterHiRes());
+		persistTimings();
+	}
+
+	void GenericAdaptation::observeCorruptReply() const
+	{
+		timings().replyCorrupt(Time::getMillisecondCounterHiRes());
+		persistTimings();
+	}
+
+	void GenericAdaptation::persistTimings() const
+	{
+		// Don't write the settings for every single reply
+		double now = Time::getMillisecondCounterHiRes();
+		if (now - timingsPersistedMs_.load() < 5000.0) {
+			return;
+		}
+		if (timings().takeDirty()) {
+			timingsPersistedMs_ = now;
+			// Replies come in on the MIDI thread, the settings are written on the message thread
+			MessageManager::callAsync([key = timingsSettingsKey_, value = timings_.toString()]() {
+				Settings::instance().set(key, value);
+			});
 		}
-		return 200;
 	}
 
 	std::vector<juce::MidiMessage> GenericAdaptation::deviceDetect(int channel)
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		try {
 			py::object result = callMethod(kCreateDeviceDetectMessage, channel);
 			std::vector<uint8> byteData = intVectorToByteVector(result.cast<std::vector<int>>());
@@ -758,7 +885,7 @@ namespace knobkraft {
 
 	MidiChannel GenericAdaptation::channelIfValidDeviceResponse(const MidiMessage& message)
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		try {
 			auto vector = messageToVector(message);
 			py::object result = callMethod(kChannelIfValidDeviceResponse, vector);
@@ -782,7 +909,7 @@ namespace knobkraft {
 
 	bool GenericAdaptation::needsChannelSpecificDetection()
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		if (!pythonModuleHasFunction(kNeedsChannelSpecificDetection)) {
 			return true;
 		}
@@ -802,7 +929,7 @@ namespace knobkraft {
 	}
 
 	midikraft::BankDownloadMethod GenericAdaptation::bankDownloadMethod() const {
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		if (!pythonModuleHasFunction(kIndicateBankDownloadMethod)) {
 			return midikraft::BankDownloadMethod::UNKNOWN;
 		}
@@ -832,7 +959,7 @@ namespace knobkraft {
 
 	std::string GenericAdaptation::getName() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		try {
 			py::object result = callMethod(kName);
 			return result.cast<std::string>();
@@ -849,7 +976,7 @@ namespace knobkraft {
 
 	std::string GenericAdaptation::calculateFingerprint(std::shared_ptr<midikraft::DataFile> patch) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(adaptationModule_);
 		// This is an optional function to allow ignoring bytes that do not define the identity of the patch
 		if (!pythonModuleHasFunction(kCalculateFingerprint)) {
 			return Synth::calculateFingerprint(patch);
@@ -917,7 +1044,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::EditBufferCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kIsEditBufferDump)
 			&& pythonModuleHasFunction(kCreateEditBufferRequest)
 			&& pythonModuleHasFunction(kConvertToEditBuffer)) {
@@ -939,7 +1065,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::ProgramDumpCabability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kIsSingleProgramDump)
 			&& pythonModuleHasFunction(kCreateProgramDumpRequest)
 			&& pythonModuleHasFunction(kConvertToProgramDump)) {
@@ -961,7 +1086,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::BankDumpCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if ((pythonModuleHasFunction(kExtractPatchesFromBank) || pythonModuleHasFunction(kExtractPatchesFromAllBankMessages))
 			&& pythonModuleHasFunction(kIsPartOfBankDump)
 			&& pythonModuleHasFunction(kIsBankDumpFinished)) {
@@ -983,7 +1107,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::BankDumpRequestCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kCreateBankDumpRequest)) {
 			*outCapability = dynamic_cast<midikraft::BankDumpRequestCapability*>(bankDumpRequestCapabilityImpl_.get());
 			return true;
@@ -1003,7 +1126,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::HasBanksCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kNumberOfBanks)
 			&& pythonModuleHasFunction(kNumberOfPatchesPerBank))
 		{
@@ -1025,7 +1147,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::HasBankDescriptorsCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kBankDescriptors))
 		{
 			*outCapability = dynamic_cast<midikraft::HasBankDescriptorsCapability*>(hasBankDescriptorsCapabilityImpl_.get());
@@ -1045,7 +1166,6 @@ namespace knobkraft {
 	}
 
 	bool GenericAdaptation::hasCapability(midikraft::BankSendCapability **outCapability) const {
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kConvertPatchesToBankDump))
 		{
 			*outCapability = dynamic_cast<midikraft::BankSendCapability*>(hasBankDumpSendCapabilityImpl_.get());
@@ -1064,7 +1184,6 @@ namespace knobkraft {
 	}
 
 	bool GenericAdaptation::hasCapability(midikraft::LegacyLoaderCapability** outCapability) const {
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kLegacyLoadSupportedExtensions)
 			&& pythonModuleHasFunction(kLoadPatchesFromLegacyData))
 		{
@@ -1085,7 +1204,6 @@ namespace knobkraft {
 
 	bool GenericAdaptation::hasCapability(midikraft::CustomProgramChangeCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kCreateCustomProgramChange))
 		{
 			*outCapability = dynamic_cast<midikraft::CustomProgramChangeCapability*>(customProgramChangeCapabilityImpl_.get());
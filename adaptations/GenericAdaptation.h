@@ -17,6 +17,9 @@
 #include "LegacyLoaderCapability.h"
 #include "CustomProgramChangeCapability.h"
 
+#include "AdaptationModule.h"
+#include "AdaptiveTimings.h"
+
 #ifdef _MSC_VER
 #pragma warning ( push )
 #pragma warning ( disable: 4100 )
@@ -28,6 +31,10 @@
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <mutex>
+#include <optional>
+
 namespace knobkraft {
 
 	//TODO Some forwards during refactoring
@@ -77,6 +84,7 @@ namespace knobkraft {
 	public:
 		GenericAdaptation(std::string const &pythonModuleFilePath);
 		GenericAdaptation(pybind11::module adaptation_module);
+		GenericAdaptation(pybind11::module adaptation_module, std::shared_ptr<AdaptationInterpreter> interpreter);
 		virtual ~GenericAdaptation() override;
 		static std::shared_ptr<GenericAdaptation> fromBinaryCode(std::string moduleName, std::string adaptationCode);
 
@@ -92,6 +100,8 @@ namespace knobkraft {
 		int defaultReplyTimeoutMs() const override;
 		MidiChannel channelIfValidDeviceResponse(const MidiMessage &message) override;
 		bool needsChannelSpecificDetection() override;
+		// Replies to device detects are identified in bulk after the wait, so the latency is reported by the detection
+		void observeDeviceDetect(double sentMs, double receivedMs) const;
 
 		// Allow to override the default algorithm to determine how to query a bank
 		virtual midikraft::BankDownloadMethod bankDownloadMethod() const override;
@@ -191,14 +201,27 @@ namespace knobkraft {
 		friend class GenericCustomProgramChangeCapability;
 		std::shared_ptr<GenericCustomProgramChangeCapability> customProgramChangeCapabilityImpl_;
 
+		// Timings given by messageTimings(), shortened by what we learned about the synth's actual latency
+		std::optional<int> messageTiming(std::string const& key) const;
+		bool adaptiveTimingsEnabled() const;
+		AdaptiveTimings& timings() const;
+		// A dump request is timed from when it is sent, which is when it passes sendBlockOfMessagesToSynth()
+		void observeRequest(AdaptiveTimings::Exchange exchange) const;
+		void armDumpRequest(std::vector<MidiMessage> const& request) const;
+		void observeSent(std::vector<MidiMessage> const& buffer) const;
+		void observeReply(AdaptiveTimings::Exchange exchange) const;
+		void observeReplyComplete() const;
+		void observeCorruptReply() const;
+		void persistTimings() const;
+
 		template <typename ... Args> pybind11::object callMethod(std::string const &methodName, Args& ... args) const
 		{
-			if (!adaptation_module) {
+			if (!adaptationModule_) {
 				return pybind11::none();
 			}
-			pybind11::gil_scoped_acquire acquire;
-			if (pybind11::hasattr(*adaptation_module, methodName.c_str())) {
-				auto result = adaptation_module.attr(methodName.c_str())(args...);
+			InterpreterScope python(adaptationModule_);
+			if (adaptationModule_->hasFunction(methodName)) {
+				auto result = adaptationModule_->module().attr(methodName.c_str())(args...);
 				checkForPythonOutputAndLog();
 				return result;
 			}
@@ -212,11 +235,18 @@ namespace knobkraft {
 		static bool createCompiledAdaptationModule(std::string const &pythonModuleName, std::string const &adaptationCode, std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> &outAddToThis);
 		void logNamespace();
 
-		pybind11::module adaptation_module;
+		std::shared_ptr<AdaptationModule> adaptationModule_;
 		std::string filepath_;
 
 		mutable std::map<std::string, std::string> nameCache_;
 		mutable std::map<std::string, std::string> fingerprintCache_;
+
+		mutable AdaptiveTimings timings_;
+		mutable std::once_flag timingsRestored_;
+		mutable std::string timingsSettingsKey_;
+		mutable std::atomic<double> timingsPersistedMs_ { 0.0 };
+		mutable std::mutex armedLock_;
+		mutable std::vector<uint8> armedRequest_; // The dump request created last and not yet seen sent
 	};
 
 }
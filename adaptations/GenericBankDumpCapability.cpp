@@ -28,13 +28,15 @@ namespace knobkraft {
 	std::vector<juce::MidiMessage> GenericBankDumpRequestCapability::requestBankDump(MidiBankNumber bankNo) const
 	{
 		spdlog::debug("requestBankDump called for bank {}", bankNo.toZeroBased());
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			int c = me_->channel().toZeroBasedInt();
 			int bank = bankNo.toZeroBased();
 			py::object result = me_->callMethod(kCreateBankDumpRequest, c, bank);
 			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			auto request = Sysex::vectorToMessages(byteData);
+			me_->armDumpRequest(request);
+			return request;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kCreateBankDumpRequest, ex);
@@ -48,11 +50,15 @@ namespace knobkraft {
 
 	bool GenericBankDumpCapability::isBankDump(const MidiMessage& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			auto vector = me_->messageToVector(message);
 			py::object result = me_->callMethod(kIsPartOfBankDump, vector);
-			return result.cast<bool>();
+			bool isPart = result.cast<bool>();
+			if (isPart) {
+				me_->observeReply(AdaptiveTimings::Exchange::DumpRequest);
+			}
+			return isPart;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kIsPartOfBankDump, ex);
@@ -61,19 +67,24 @@ namespace knobkraft {
 		catch (std::exception &ex) {
 			me_->logAdaptationError(kIsPartOfBankDump, ex);
 		}
+		me_->observeCorruptReply();
 		return false;
 	}
 
 	bool GenericBankDumpCapability::isBankDumpFinished(std::vector<MidiMessage> const &bankDump) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			std::vector<std::vector<int>> vector;
 			for (auto message : bankDump) {
 				vector.push_back(me_->messageToVector(message));
 			}
 			py::object result = me_->callMethod(kIsBankDumpFinished, vector);
-			return result.cast<bool>();
+			bool finished = result.cast<bool>();
+			if (finished) {
+				me_->observeReplyComplete();
+			}
+			return finished;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kIsBankDumpFinished, ex);
@@ -89,7 +100,7 @@ namespace knobkraft {
 	{
 		spdlog::debug("patchesFromSysexBank called with {} messages", messages.size());
 		midikraft::TPatchVector patchesFound;
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		if (me_->pythonModuleHasFunction(kExtractPatchesFromAllBankMessages)) {
 			try {
 				// This is the new interface for the bank dump capability - the Python function gets all bank dump messages handed at once and returns a vector
@@ -112,6 +123,7 @@ namespace knobkraft {
 					}
 					else {
 						spdlog::warn("Adaptation: Could not create patch from data returned from {}", kExtractPatchesFromAllBankMessages);
+						me_->observeCorruptReply();
 					}
 				}
 			}
@@ -143,6 +155,7 @@ namespace knobkraft {
 						}
 						else {
 							spdlog::warn("Adaptation: Could not create patch from data returned from {}", kExtractPatchesFromBank);
+							me_->observeCorruptReply();
 						}
 					}
 				}
@@ -161,7 +174,7 @@ namespace knobkraft {
 
 	std::vector<MidiMessage> GenericBankDumpSendCapability::createBankMessages(std::vector<std::vector<MidiMessage>> patches) {
 		std::vector<MidiMessage> bankMessages;
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		if (me_->pythonModuleHasFunction(kConvertPatchesToBankDump)) {
 			try {
 				std::vector<std::vector<int>> vector;
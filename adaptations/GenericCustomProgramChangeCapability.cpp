@@ -25,7 +25,7 @@ namespace knobkraft {
 
 	std::vector<juce::MidiMessage> GenericCustomProgramChangeCapability::createCustomProgramChangeMessages(MidiProgramNumber program) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			int c = me_->channel().toZeroBasedInt();
 			if (c < 0) {
@@ -29,12 +29,14 @@ namespace knobkraft {
 
 	std::vector<MidiMessage> GenericEditBufferCapability::requestEditBufferDump() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			int c = me_->channel().toZeroBasedInt();
 			py::object result = me_->callMethod(kCreateEditBufferRequest, c);
 			// These should be only one midi message...
-			return { GenericAdaptation::vectorToMessages(result.cast<std::vector<int>>()) };
+			auto request = GenericAdaptation::vectorToMessages(result.cast<std::vector<int>>());
+			me_->armDumpRequest(request);
+			return request;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kCreateEditBufferRequest, ex);
@@ -48,11 +50,16 @@ namespace knobkraft {
 
 	bool GenericEditBufferCapability::isEditBufferDump(const std::vector<MidiMessage>& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			auto vectorForm = GenericAdaptation::midiMessagesToVector(message);
 			py::object result = me_->callMethod(kIsEditBufferDump, vectorForm);
-			return result.cast<bool>();
+			bool isDump = result.cast<bool>();
+			if (isDump) {
+				// All messages are there
+				me_->observeReplyComplete();
+			}
+			return isDump;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kIsEditBufferDump, ex);
@@ -66,7 +73,7 @@ namespace knobkraft {
 
 	midikraft::EditBufferCapability::HandshakeReply GenericEditBufferCapability::isMessagePartOfEditBuffer(const MidiMessage& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		// This is an optional function that can be implemented for multi message edit buffers like in the DSI Evolver
 		if (me_->pythonModuleHasFunction(kIsPartOfEditBufferDump)) {
 			try {
@@ -77,10 +84,10 @@ namespace knobkraft {
 					auto result_tuple = py::cast<py::tuple>(result);
 					py::object replyBool = result_tuple[0];
 					auto byteData = GenericAdaptation::vectorToMessages(result_tuple[1].cast<std::vector<int>>());
-					return { replyBool.cast<bool>(), byteData };
+					return observed(replyBool.cast<bool>(), byteData);
 				}
 				else {
-					return { result.cast<bool>(), {} };
+					return observed(result.cast<bool>(), {});
 				}
 			}
 			catch (py::error_already_set& ex) {
@@ -90,28 +97,37 @@ namespace knobkraft {
 			catch (std::exception& ex) {
 				me_->logAdaptationError(kIsPartOfEditBufferDump, ex);
 			}
+			me_->observeCorruptReply();
 			return { false, {} };
 		}
 		else {
 			// Default implementation is to just to call isEditBuffer() with a single message vector
-			return { isEditBufferDump({ message }), {} };
+			return observed(isEditBufferDump({ message }), {});
+		}
+	}
+
+	midikraft::EditBufferCapability::HandshakeReply GenericEditBufferCapability::observed(bool isPart, std::vector<MidiMessage> const& handshake) const
+	{
+		if (isPart) {
+			me_->observeReply(AdaptiveTimings::Exchange::DumpRequest);
 		}
+		return { isPart, handshake };
 	}
 
 	std::shared_ptr<midikraft::DataFile> GenericEditBufferCapability::patchFromSysex(const std::vector<MidiMessage>& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		// For the Generic Adaptation, this is a nop, as we do not unpack the MidiMessage, but rather store the raw MidiMessage
 		midikraft::Synth::PatchData data;
 		for (auto const& m : message) {
 			std::copy(m.getRawData(), m.getRawData() + m.getRawDataSize(), std::back_inserter(data));
 		}
-		return std::make_shared<GenericPatch>(me_, me_->adaptation_module, data, GenericPatch::EDIT_BUFFER);
+		return std::make_shared<GenericPatch>(me_, me_->adaptationModule_, data, GenericPatch::EDIT_BUFFER);
 	}
 
 	std::vector<juce::MidiMessage> GenericEditBufferCapability::patchToSysex(std::shared_ptr<midikraft::DataFile> patch) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			auto data = patch->data();
 			int c = me_->channel().toZeroBasedInt();
@@ -135,7 +151,7 @@ namespace knobkraft {
 
 	juce::MidiMessage GenericEditBufferCapability::saveEditBufferToProgram(int programNumber)
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		ignoreUnused(programNumber);
 		return MidiMessage();
 	}
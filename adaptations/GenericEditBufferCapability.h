@@ -25,6 +25,9 @@ namespace knobkraft {
 		MidiMessage saveEditBufferToProgram(int programNumber) override;
 
 	private:
+		// Reports the first message of a reply to the adaptive timings
+		HandshakeReply observed(bool isPart, std::vector<MidiMessage> const& handshake) const;
+
 		GenericAdaptation *me_;
 	};
 
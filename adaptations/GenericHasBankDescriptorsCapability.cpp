@@ -25,7 +25,7 @@ namespace knobkraft {
 
 	std::vector<midikraft::BankDescriptor> GenericHasBankDescriptorsCapability::bankDescriptors() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			py::object result = me_->callMethod(kBankDescriptors);
 			std::vector<midikraft::BankDescriptor> banks;
@@ -65,7 +65,7 @@ namespace knobkraft {
 	}
 
 	std::vector<juce::MidiMessage> GenericHasBankDescriptorsCapability::bankSelectMessages(MidiBankNumber bankNo) const {
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			if (me_->pythonModuleHasFunction(kBankSelect)) {
 				int c = me_->channel().toZeroBasedInt();
@@ -24,7 +24,7 @@ namespace knobkraft {
 
 	int GenericHasBanksCapability::numberOfBanks() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			py::object result = me_->callMethod(kNumberOfBanks);
 			return result.cast<int>();
@@ -41,7 +41,7 @@ namespace knobkraft {
 
 	int GenericHasBanksCapability::numberOfPatches() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			py::object result = me_->callMethod(kNumberOfPatchesPerBank);
 			return result.cast<int>();
@@ -58,7 +58,7 @@ namespace knobkraft {
 
 	std::string GenericHasBanksCapability::friendlyBankName(MidiBankNumber bankNo) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		if (!me_->pythonModuleHasFunction(kFriendlyBankName)) {
 			return fmt::format("Bank {}", bankNo.toOneBased());
 		}
@@ -78,7 +78,7 @@ namespace knobkraft {
 	}
 
 	std::vector<juce::MidiMessage> GenericHasBanksCapability::bankSelectMessages(MidiBankNumber bankNo) const {
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			if (me_->pythonModuleHasFunction(kBankSelect)) {
 				int c = me_->channel().toZeroBasedInt();
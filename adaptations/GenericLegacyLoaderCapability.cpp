@@ -66,7 +66,7 @@ namespace knobkraft {
 	void GenericLegacyLoaderCapability::ensureCachedNormalizedExtensions()
 	{
 		std::call_once(cachedNormalizedExtensionsInitOnce_, [this]() {
-			py::gil_scoped_acquire acquire;
+			InterpreterScope python(me_->adaptationModule_);
 			try {
 				py::object result = me_->callMethod(kLegacyLoadSupportedExtensions);
 				std::vector<std::string> extensions = result.cast<std::vector<std::string>>();
@@ -144,7 +144,7 @@ namespace knobkraft {
 
 	midikraft::TPatchVector GenericLegacyLoaderCapability::load(std::string const& filename, std::vector<uint8> const& fileContent)
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		midikraft::TPatchVector patches;
 
 		try {
@@ -184,7 +184,7 @@ namespace knobkraft {
 
 				try {
 					auto patchData = GenericAdaptation::intVectorToByteVector(patchBytes);
-					patches.push_back(std::make_shared<GenericPatch>(me_, me_->adaptation_module, patchData, patchType));
+					patches.push_back(std::make_shared<GenericPatch>(me_, me_->adaptationModule_, patchData, patchType));
 				}
 				catch (py::error_already_set& ex) {
 					me_->logAdaptationError(kLoadPatchesFromLegacyData, ex);
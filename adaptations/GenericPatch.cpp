@@ -24,29 +24,27 @@ namespace py = pybind11;
 
 namespace knobkraft {
 
-	GenericPatch::GenericPatch(GenericAdaptation const *me, pybind11::module const &adaptation_module, midikraft::Synth::PatchData const &data, DataType dataType) : midikraft::DataFile(dataType, data), me_(me), adaptation_(adaptation_module)
-	{
+	namespace {
+
+		std::shared_ptr<AdaptationModule const> moduleOf(std::weak_ptr<GenericPatch> const& patch) {
+			auto locked = patch.lock();
+			return locked ? locked->adaptationModule() : nullptr;
+		}
+
 	}
 
-	GenericPatch::~GenericPatch()
+	GenericPatch::GenericPatch(GenericAdaptation const *me, std::shared_ptr<AdaptationModule const> adaptationModule, midikraft::Synth::PatchData const &data, DataType dataType) : midikraft::DataFile(dataType, data), me_(me), adaptation_(adaptationModule)
 	{
-		py::gil_scoped_acquire gil;
-		adaptation_.dec_ref();
-		adaptation_.release();
 	}
 
 	bool GenericPatch::pythonModuleHasFunction(std::string const &functionName) const
 	{
-		py::gil_scoped_acquire acquire;
-		if (!adaptation_) {
-			return false;
-		}
-		return py::hasattr(*adaptation_, functionName.c_str());
+		return adaptation_ && adaptation_->hasFunction(functionName);
 	}
 
 	std::string GenericStoredPatchNameCapability::name() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(moduleOf(me_));
 		if (!me_.expired()) {
 			auto patch = me_.lock();
 			if (patch->pythonModuleHasFunction(kNameFromDump)) {
@@ -104,7 +102,7 @@ namespace knobkraft {
 			// No need to change the name, as the current calculation already gives the correct result
 			return true;
 		}
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(moduleOf(me_));
 		if (!me_.expired()) {
 			// set name is an optional method - if it is not implemented, the name in the patch is never changed, the name displayed in the Librarian is
 			if (!me_.lock()->pythonModuleHasFunction(kRenamePatch)) return false;
@@ -136,7 +134,7 @@ namespace knobkraft {
 
 	bool GenericDefaultNameCapability::isDefaultName(std::string const &patchName) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(moduleOf(me_));
 		if (!me_.expired()) {
 			auto patch = me_.lock();
 			try {
@@ -167,7 +165,7 @@ namespace knobkraft {
 
 	int GenericLayeredPatchCapability::numberOfLayers() const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(moduleOf(me_));
 		if (!me_.expired()) {
 			auto patch = me_.lock();
 			try {
@@ -192,7 +190,7 @@ namespace knobkraft {
 	}
 
 	std::vector<std::string> GenericLayeredPatchCapability::layerTitles() const {
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(moduleOf(me_));
 		if (!me_.expired()) {
 			auto patch = me_.lock();
 			if (patch->pythonModuleHasFunction(kLayerTitles)) {
@@ -219,7 +217,7 @@ namespace knobkraft {
 
 	std::string GenericLayeredPatchCapability::layerName(int layerNo) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(moduleOf(me_));
 		if (!me_.expired()) {
 			auto patch = me_.lock();			
 			try {
@@ -246,7 +244,7 @@ namespace knobkraft {
 	void GenericLayeredPatchCapability::setLayerName(int layerNo, std::string const& layerName)
 	{
 		if (me_.lock()->pythonModuleHasFunction(kSetLayerName)) {
-			py::gil_scoped_acquire acquire;
+			InterpreterScope python(moduleOf(me_));
 			if (!me_.expired()) {
 				auto patch = me_.lock();
 				try {
@@ -284,7 +282,7 @@ namespace knobkraft {
 	std::set<midikraft::Tag> GenericStoredTagCapability::tags() const
 	{
 		if (me_.lock()->pythonModuleHasFunction(kGetStoredTags)) {
-			py::gil_scoped_acquire acquire;
+			InterpreterScope python(moduleOf(me_));
 			if (!me_.expired()) {
 				auto patch = me_.lock();
 				try {
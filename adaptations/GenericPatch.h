@@ -91,20 +91,21 @@ namespace knobkraft {
 			EDIT_BUFFER
 		};
 
-		GenericPatch(GenericAdaptation const *me, pybind11::module const &adaptation_module, midikraft::Synth::PatchData const &data, DataType dataType);
-        virtual ~GenericPatch() override;
+		GenericPatch(GenericAdaptation const *me, std::shared_ptr<AdaptationModule const> adaptationModule, midikraft::Synth::PatchData const &data, DataType dataType);
+        virtual ~GenericPatch() override = default;
 
 		bool pythonModuleHasFunction(std::string const &functionName) const;
+		std::shared_ptr<AdaptationModule const> const& adaptationModule() const { return adaptation_; }
 
 		template <typename ... Args>
 		pybind11::object callMethod(std::string const &methodName, Args& ... args) const {
-			pybind11::gil_scoped_acquire acquire;
 			if (!adaptation_) {
 				return pybind11::none();
 			}
-			if (pybind11::hasattr(*adaptation_, methodName.c_str())) {
+			InterpreterScope python(adaptation_);
+			if (adaptation_->hasFunction(methodName)) {
 				try {
-					auto result = adaptation_.attr(methodName.c_str())(args...);
+					auto result = adaptation_->module().attr(methodName.c_str())(args...);
 					checkForPythonOutputAndLog();
 					return result;
 				}
@@ -148,7 +149,7 @@ namespace knobkraft {
 		std::shared_ptr<GenericStoredTagCapability> genericStoredTagCapabilityImpl_;
 
 		GenericAdaptation const *me_;
-		pybind11::module adaptation_;
+		std::shared_ptr<AdaptationModule const> adaptation_; // Shared with the adaptation, so destroying a patch never needs the GIL
 	};
 
 
@@ -27,23 +27,25 @@ namespace knobkraft {
 
 	std::shared_ptr<midikraft::DataFile> GenericProgramDumpCapability::patchFromProgramDumpSysex(const std::vector<MidiMessage>& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		// For the Generic Adaptation, this is a nop, as we do not unpack the MidiMessage, but rather store the raw MidiMessage
 		midikraft::Synth::PatchData data;
 		for (auto const& m : message) {
 			std::copy(m.getRawData(), m.getRawData() + m.getRawDataSize(), std::back_inserter(data));
 		}
-		return std::make_shared<GenericPatch>(me_, me_->adaptation_module, data, GenericPatch::PROGRAM_DUMP);
+		return std::make_shared<GenericPatch>(me_, me_->adaptationModule_, data, GenericPatch::PROGRAM_DUMP);
 	}
 
 	std::vector<juce::MidiMessage> GenericProgramDumpCapability::requestPatch(int patchNo) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			int c = me_->channel().toZeroBasedInt();
 			py::object result = me_->callMethod(kCreateProgramDumpRequest, c, patchNo);
 			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			auto request = Sysex::vectorToMessages(byteData);
+			me_->armDumpRequest(request);
+			return request;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kCreateProgramDumpRequest, ex);
@@ -57,11 +59,16 @@ namespace knobkraft {
 
 	bool GenericProgramDumpCapability::isSingleProgramDump(const std::vector<MidiMessage>& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try {
 			auto vector = GenericAdaptation::midiMessagesToVector(message);
 			py::object result = me_->callMethod(kIsSingleProgramDump, vector);
-			return result.cast<bool>();
+			bool isDump = result.cast<bool>();
+			if (isDump) {
+				// All messages are there
+				me_->observeReplyComplete();
+			}
+			return isDump;
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kIsSingleProgramDump, ex);
@@ -75,7 +82,7 @@ namespace knobkraft {
 
 	midikraft::ProgramDumpCabability::HandshakeReply GenericProgramDumpCapability::isMessagePartOfProgramDump(const MidiMessage& message) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		// This is an optional function that can be implemented for multi message edit buffers like in the DSI Evolver
 		if (me_->pythonModuleHasFunction(kIsPartOfSingleProgramDump)) {
 			try {
@@ -86,10 +93,10 @@ namespace knobkraft {
 					auto result_tuple = py::cast<py::tuple>(result);
 					py::object replyBool = result_tuple[0];
 					auto byteData = GenericAdaptation::vectorToMessages(result_tuple[1].cast<std::vector<int>>());
-					return { replyBool.cast<bool>(), byteData };
+					return observed(replyBool.cast<bool>(), byteData);
 				}
 				else {
-					return { result.cast<bool>(), {} };
+					return observed(result.cast<bool>(), {});
 				}
 			}
 			catch (py::error_already_set& ex) {
@@ -99,12 +106,21 @@ namespace knobkraft {
 			catch (std::exception& ex) {
 				me_->logAdaptationError(kIsPartOfSingleProgramDump, ex);
 			}
+			me_->observeCorruptReply();
 			return { false, {} };
 		}
 		else {
 			// Default implementation is to just to call isSingleProgramDump() with a single message vector
-			return { isSingleProgramDump({ message }), {} };
+			return observed(isSingleProgramDump({ message }), {});
+		}
+	}
+
+	midikraft::ProgramDumpCabability::HandshakeReply GenericProgramDumpCapability::observed(bool isPart, std::vector<MidiMessage> const& handshake) const
+	{
+		if (isPart) {
+			me_->observeReply(AdaptiveTimings::Exchange::DumpRequest);
 		}
+		return { isPart, handshake };
 	}
 
 	MidiProgramNumber GenericProgramDumpCapability::getProgramNumber(const std::vector<MidiMessage>& message) const
@@ -112,7 +128,7 @@ namespace knobkraft {
         if (!isSingleProgramDump(message)) {
             return MidiProgramNumber::invalidProgram();
         }
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		if (me_->pythonModuleHasFunction("numberFromDump")) {
 			try {
 				auto vector = GenericAdaptation::midiMessagesToVector(message);
@@ -138,7 +154,7 @@ namespace knobkraft {
 
 	std::vector<juce::MidiMessage> GenericProgramDumpCapability::patchToProgramDumpSysex(std::shared_ptr<midikraft::DataFile> patch, MidiProgramNumber programNumber) const
 	{
-		py::gil_scoped_acquire acquire;
+		InterpreterScope python(me_->adaptationModule_);
 		try
 		{
 			auto data = patch->data();
@@ -25,6 +25,8 @@ namespace knobkraft {
 		virtual std::vector<MidiMessage> patchToProgramDumpSysex(std::shared_ptr<midikraft::DataFile> patch, MidiProgramNumber programNumber) const override;
 
 	private:
+		HandshakeReply observed(bool isPart, std::vector<MidiMessage> const& handshake) const;
+
 		GenericAdaptation *me_;
 	};
 
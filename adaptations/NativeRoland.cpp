@@ -0,0 +1,348 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "NativeRoland.h"
+
+#ifdef _MSC_VER
+#pragma warning ( push )
+#pragma warning ( disable: 4100 )
+#endif
+#include <pybind11/stl.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <algorithm>
+#include <set>
+#include <span>
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	namespace native_roland {
+
+		namespace {
+
+			const int64_t kRolandId = 0x41;
+			const int64_t kCommandDT1 = 0x12;
+
+			typedef std::span<int64_t const> ByteView;
+
+			[[noreturn]] void throwZeroDivision()
+			{
+				PyErr_SetString(PyExc_ZeroDivisionError, "integer division or modulo by zero");
+				throw py::error_already_set();
+			}
+
+			// Python's // and %, which round towards negative infinity
+			int64_t floorDiv(int64_t a, int64_t b)
+			{
+				if (b == 0) throwZeroDivision();
+				int64_t q = a / b;
+				return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+			}
+
+			int64_t floorMod(int64_t a, int64_t b)
+			{
+				return a - floorDiv(a, b) * b;
+			}
+
+			// DataBlock.size_to_number
+			int64_t sizeToNumber(ByteView values)
+			{
+				int64_t result = 0;
+				for (size_t i = 0; i < values.size(); i++) {
+					result += values[i] << (7 * (values.size() - 1 - i));
+				}
+				return result;
+			}
+
+			// DataBlock.size_as_7bit_list
+			Bytes sizeAs7BitList(int64_t size, size_t numberOfValues)
+			{
+				Bytes result(numberOfValues);
+				for (size_t i = 0; i < numberOfValues; i++) {
+					result[i] = (size >> ((numberOfValues - 1 - i) * 7)) & 0x7f;
+				}
+				return result;
+			}
+
+			int64_t at(ByteView values, size_t index)
+			{
+				if (index >= values.size()) {
+					throw py::index_error("list index out of range");
+				}
+				return values[index];
+			}
+
+			ByteView slice(Bytes const& values, size_t start, size_t end)
+			{
+				return ByteView(values).subspan(start, end - start);
+			}
+
+		}
+
+		AddressMap AddressMap::fromPython(pybind11::handle rolandData)
+		{
+			AddressMap result;
+			result.numItems = rolandData.attr("num_items").cast<int64_t>();
+			result.numAddressBytes = rolandData.attr("num_address_bytes").cast<size_t>();
+			result.size = rolandData.attr("size").cast<int64_t>();
+			result.baseAddress = rolandData.attr("base_address").cast<Bytes>();
+			result.baseAddressAsNumber = sizeToNumber(result.baseAddress);
+			result.usesConsecutiveAddresses = py::bool_(rolandData.attr("uses_consecutive_addresses"));
+			for (auto block : rolandData.attr("data_blocks")) {
+				auto address = block.attr("address").cast<Bytes>();
+				Bytes absolute;
+				for (size_t i = 0; i < result.numAddressBytes; i++) {
+					absolute.push_back(at(address, i) + at(result.baseAddress, i));
+				}
+				result.absoluteBlockAddresses.push_back(absolute);
+			}
+			auto zones = rolandData.attr("blank_out_zones");
+			if (!zones.is_none()) {
+				result.blankOutZones = zones.cast<std::vector<std::pair<int64_t, int64_t>>>();
+			}
+			return result;
+		}
+
+		Bytes AddressMap::resetToBaseAddress(Bytes const& address) const
+		{
+			if (usesConsecutiveAddresses) {
+				int64_t addressAsNumber = sizeToNumber(address);
+				if (addressAsNumber >= baseAddressAsNumber) {
+					int64_t normalized = floorMod(addressAsNumber - baseAddressAsNumber, size);
+					return sizeAs7BitList(baseAddressAsNumber + normalized, numAddressBytes);
+				}
+				return address;
+			}
+			// address[1] holds the program number, to compare addresses we reset it to the base address
+			Bytes result(numAddressBytes);
+			for (size_t i = 0; i < numAddressBytes; i++) {
+				result[i] = i != 1 ? at(address, i) : at(baseAddress, i);
+			}
+			return result;
+		}
+
+		int AddressMap::blockIndex(Bytes const& normalizedAddress) const
+		{
+			for (size_t i = 0; i < absoluteBlockAddresses.size(); i++) {
+				if (absoluteBlockAddresses[i] == normalizedAddress) {
+					return (int)i;
+				}
+			}
+			return -1;
+		}
+
+		RolandEngine::RolandEngine(Bytes const& modelId, size_t addressSize, AddressMap const& editBuffer, AddressMap const& programDump, bool usesConsecutiveAddresses) :
+			modelId_(modelId), addressSize_(addressSize), editBuffer_(editBuffer), programDump_(programDump), usesConsecutiveAddresses_(usesConsecutiveAddresses)
+		{
+		}
+
+		int64_t RolandEngine::checksum(Bytes const& data)
+		{
+			int64_t sum = 0;
+			for (auto b : data) {
+				sum -= b;
+			}
+			return sum & 0x7f;
+		}
+
+		bool RolandEngine::isOwnSysex(Bytes const& message) const
+		{
+			return isOwnSysex(ByteView(message));
+		}
+
+		bool RolandEngine::isOwnSysex(ByteView message) const
+		{
+			if (message.size() > 2 + modelId_.size() && message[0] == 0xf0 && message[1] == kRolandId) {
+				auto model = message.subspan(std::min<size_t>(3, message.size()));
+				model = model.first(std::min(model.size(), modelId_.size()));
+				return std::equal(model.begin(), model.end(), modelId_.begin(), modelId_.end());
+			}
+			return false;
+		}
+
+		int64_t RolandEngine::commandOf(ByteView message) const
+		{
+			return at(message, 3 + modelId_.size());
+		}
+
+		Bytes RolandEngine::addressOf(ByteView message) const
+		{
+			size_t start = std::min(4 + modelId_.size(), message.size());
+			size_t end = std::min(start + addressSize_, message.size());
+			return Bytes(message.begin() + (ptrdiff_t)start, message.begin() + (ptrdiff_t)end);
+		}
+
+		Bytes RolandEngine::buildMessage(int64_t device, int64_t command, Bytes const& address, Bytes const& data) const
+		{
+			Bytes message{ 0xf0, kRolandId, device & 0x1f };
+			message.reserve(modelId_.size() + address.size() + data.size() + 6);
+			message.insert(message.end(), modelId_.begin(), modelId_.end());
+			message.push_back(command);
+			message.insert(message.end(), address.begin(), address.end());
+			message.insert(message.end(), data.begin(), data.end());
+			int64_t sum = 0;
+			for (size_t i = 4 + modelId_.size(); i < message.size(); i++) {
+				sum -= message[i];
+			}
+			message.push_back(sum & 0x7f);
+			message.push_back(0xf7);
+			return message;
+		}
+
+		int RolandEngine::editBufferBlock(Bytes const& message) const
+		{
+			if (isOwnSysex(message) && commandOf(message) == kCommandDT1) {
+				return editBuffer_.blockIndex(editBuffer_.resetToBaseAddress(addressOf(message)));
+			}
+			return -1;
+		}
+
+		std::pair<int, int64_t> RolandEngine::programDumpBlock(Bytes const& message) const
+		{
+			if (isOwnSysex(message) && commandOf(message) == kCommandDT1) {
+				auto address = addressOf(message);
+				int64_t patchNo = patchNumberFromAddress(address);
+				return { programDump_.blockIndex(programDump_.resetToBaseAddress(address)), patchNo };
+			}
+			return { -1, 0 };
+		}
+
+		bool RolandEngine::isEditBufferDump(Bytes const& messages) const
+		{
+			std::set<Bytes> addresses;
+			for (auto const& [start, end] : native_sysex::findSysexDelimiters(messages, std::nullopt)) {
+				auto message = slice(messages, start, end);
+				if (isOwnSysex(message)) {
+					commandOf(message);
+					addresses.insert(editBuffer_.resetToBaseAddress(addressOf(message)));
+				}
+			}
+			for (auto const& allowed : editBuffer_.absoluteBlockAddresses) {
+				if (addresses.find(allowed) == addresses.end()) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool RolandEngine::isSingleProgramDump(Bytes const& messages) const
+		{
+			std::set<Bytes> addresses;
+			std::set<int64_t> programs;
+			for (auto const& [start, end] : native_sysex::findSysexDelimiters(messages, std::nullopt)) {
+				auto message = slice(messages, start, end);
+				commandOf(message);
+				auto address = addressOf(message);
+				addresses.insert(programDump_.resetToBaseAddress(address));
+				programs.insert(patchNumberFromAddress(address));
+			}
+			if (programs.size() != 1) {
+				return false;
+			}
+			for (auto const& allowed : programDump_.absoluteBlockAddresses) {
+				if (addresses.find(allowed) == addresses.end()) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		int64_t RolandEngine::patchNumberFromAddress(Bytes const& address) const
+		{
+			if (usesConsecutiveAddresses_) {
+				return floorDiv(sizeToNumber(address) - programDump_.baseAddressAsNumber, programDump_.size);
+			}
+			return at(address, 1) - at(programDump_.baseAddress, 1);
+		}
+
+		int64_t RolandEngine::numberFromDump(Bytes const& messages) const
+		{
+			if (!isSingleProgramDump(messages)) {
+				return 0;
+			}
+			auto first = native_sysex::findSysexDelimiters(messages, 1);
+			auto message = slice(messages, first[0].first, first[0].second);
+			commandOf(message);
+			return patchNumberFromAddress(addressOf(message));
+		}
+
+		std::optional<Bytes> RolandEngine::blankedOut(Bytes const& messages) const
+		{
+			if (isEditBufferDump(messages)) {
+				return applyBlankout(messages, editBuffer_.blankOutZones);
+			}
+			else if (isSingleProgramDump(messages)) {
+				return applyBlankout(messages, programDump_.blankOutZones);
+			}
+			return std::nullopt;
+		}
+
+		Bytes RolandEngine::applyBlankout(Bytes data, std::vector<std::pair<int64_t, int64_t>> const& zones)
+		{
+			int64_t length = (int64_t)data.size();
+			for (auto const& [start, count] : zones) {
+				for (int64_t i = 0; i < count; i++) {
+					int64_t index = start + i;
+					if (index < 0) {
+						index += length;
+					}
+					if (index < 0 || index >= length) {
+						throw py::index_error("list assignment index out of range");
+					}
+					data[(size_t)index] = 0;
+				}
+			}
+			// The checksums can't be precalculated, as messages have varying length. Blank every byte before an 0xf7 instead
+			for (size_t i = 0; i + 1 < data.size(); i++) {
+				if (data[i + 1] == 0xf7) {
+					data[i] = 0;
+				}
+			}
+			return data;
+		}
+
+	}
+
+	void registerNativeRoland(pybind11::module& module)
+	{
+		using namespace native_roland;
+		module.def("roland_checksum", &RolandEngine::checksum, py::arg("data_block"));
+		py::class_<RolandEngine>(module, "RolandEngine")
+			.def(py::init([](Bytes const& modelId, size_t addressSize, py::handle editBuffer, py::handle programDump, py::handle usesConsecutiveAddresses) {
+				return RolandEngine(modelId, addressSize, AddressMap::fromPython(editBuffer), AddressMap::fromPython(programDump), py::bool_(py::reinterpret_borrow<py::object>(usesConsecutiveAddresses)));
+			}), py::arg("model_id"), py::arg("address_size"), py::arg("edit_buffer"), py::arg("program_dump"), py::arg("uses_consecutive_addresses") = false)
+			.def("isOwnSysex", py::overload_cast<Bytes const&>(&RolandEngine::isOwnSysex, py::const_), py::arg("message"))
+			.def("buildRolandMessage", &RolandEngine::buildMessage, py::arg("device"), py::arg("command_id"), py::arg("address"), py::arg("data"))
+			.def("editBufferBlock", &RolandEngine::editBufferBlock, py::arg("message"))
+			.def("programDumpBlock", &RolandEngine::programDumpBlock, py::arg("message"))
+			.def("isEditBufferDump", &RolandEngine::isEditBufferDump, py::arg("messages"))
+			.def("isSingleProgramDump", &RolandEngine::isSingleProgramDump, py::arg("messages"))
+			.def("patchNumberFromAddress", &RolandEngine::patchNumberFromAddress, py::arg("address"))
+			.def("numberFromDump", &RolandEngine::numberFromDump, py::arg("message"))
+			.def("blankedOut", &RolandEngine::blankedOut, py::arg("messages"))
+			.def("fingerprintData", [](RolandEngine const& engine, Bytes const& messages) -> py::object {
+				auto blanked = engine.blankedOut(messages);
+				if (!blanked.has_value()) {
+					return py::none();
+				}
+				std::string raw;
+				raw.reserve(blanked->size());
+				for (auto b : *blanked) {
+					if (b < 0 || b > 255) {
+						// Same as bytearray() would complain
+						throw py::value_error("byte must be in range(0, 256)");
+					}
+					raw.push_back((char)b);
+				}
+				return py::bytes(raw);
+			}, py::arg("messages"));
+	}
+
+}
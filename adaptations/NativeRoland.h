@@ -0,0 +1,79 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "NativeSysex.h"
+
+#include <span>
+
+namespace knobkraft {
+
+	namespace native_roland {
+
+		using native_sysex::Bytes;
+
+		// Frozen copy of a roland.RolandData address map, with the absolute block addresses and blank out zones precomputed
+		struct AddressMap {
+			static AddressMap fromPython(pybind11::handle rolandData);
+
+			Bytes resetToBaseAddress(Bytes const& address) const;
+			int blockIndex(Bytes const& normalizedAddress) const;
+
+			int64_t numItems = 0;
+			size_t numAddressBytes = 0;
+			int64_t size = 0;
+			int64_t baseAddressAsNumber = 0;
+			Bytes baseAddress;
+			std::vector<Bytes> absoluteBlockAddresses;
+			bool usesConsecutiveAddresses = false;
+			std::vector<std::pair<int64_t, int64_t>> blankOutZones;
+		};
+
+		// Does the per message work of roland.GenericRoland natively. Results, including the exceptions raised on malformed
+		// input, are the same as those of the Python code it replaces. Anything depending on mutable state like the device ID
+		// is passed in, so one engine can be shared by all calls.
+		class RolandEngine {
+		public:
+			// usesConsecutiveAddresses is the flag of the GenericRoland, which decides how patch numbers are calculated
+			RolandEngine(Bytes const& modelId, size_t addressSize, AddressMap const& editBuffer, AddressMap const& programDump, bool usesConsecutiveAddresses);
+
+			static int64_t checksum(Bytes const& data);
+
+			bool isOwnSysex(Bytes const& message) const;
+			Bytes buildMessage(int64_t device, int64_t command, Bytes const& address, Bytes const& data) const;
+
+			// Index of the data block the message is for, or -1 if it is not part of the dump
+			int editBufferBlock(Bytes const& message) const;
+			std::pair<int, int64_t> programDumpBlock(Bytes const& message) const;
+
+			bool isEditBufferDump(Bytes const& messages) const;
+			bool isSingleProgramDump(Bytes const& messages) const;
+			int64_t patchNumberFromAddress(Bytes const& address) const;
+			int64_t numberFromDump(Bytes const& messages) const;
+
+			// The bytes to fingerprint, or nullopt if the messages are neither edit buffer nor program dump
+			std::optional<Bytes> blankedOut(Bytes const& messages) const;
+
+		private:
+			bool isOwnSysex(std::span<int64_t const> message) const;
+			int64_t commandOf(std::span<int64_t const> message) const;
+			Bytes addressOf(std::span<int64_t const> message) const;
+			static Bytes applyBlankout(Bytes data, std::vector<std::pair<int64_t, int64_t>> const& zones);
+
+			Bytes modelId_;
+			size_t addressSize_;
+			AddressMap editBuffer_;
+			AddressMap programDump_;
+			bool usesConsecutiveAddresses_;
+		};
+
+	}
+
+	// Adds the RolandEngine class and roland_checksum to the knobkraft_native module
+	void registerNativeRoland(pybind11::module& module);
+
+}
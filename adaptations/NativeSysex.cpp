@@ -0,0 +1,199 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "NativeSysex.h"
+
+#ifdef _MSC_VER
+#pragma warning ( push )
+#pragma warning ( disable: 4100 )
+#endif
+#include <pybind11/stl.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	namespace native_sysex {
+
+		Bytes loadFile(std::string const& filename)
+		{
+			std::ifstream file(filename, std::ios::binary);
+			if (!file) {
+				// Same exception as Python's open() would raise
+				errno = ENOENT;
+				PyErr_SetFromErrnoWithFilename(PyExc_OSError, filename.c_str());
+				throw py::error_already_set();
+			}
+			std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			Bytes result;
+			result.reserve(content.size());
+			for (auto c : content) {
+				result.push_back((uint8_t)c);
+			}
+			return result;
+		}
+
+		std::vector<Bytes> loadSysex(std::string const& filename)
+		{
+			auto content = loadFile(filename);
+			std::vector<Bytes> messages;
+			size_t start = 0;
+			for (size_t i = 0; i < content.size(); i++) {
+				if (content[i] == 0xf7) {
+					messages.emplace_back(content.begin() + (ptrdiff_t)start, content.begin() + (ptrdiff_t)i + 1);
+					start = i + 1;
+				}
+			}
+			return messages;
+		}
+
+		std::vector<Bytes> splitSysexMessage(Bytes const& messages)
+		{
+			std::vector<Bytes> result;
+			size_t start = 0;
+			for (size_t read = 0; read < messages.size(); read++) {
+				if (messages[read] == 0xf0) {
+					start = read;
+				}
+				else if (messages[read] == 0xf7) {
+					result.emplace_back(messages.begin() + (ptrdiff_t)start, messages.begin() + (ptrdiff_t)read + 1);
+				}
+			}
+			return result;
+		}
+
+		std::vector<std::pair<size_t, size_t>> findSysexDelimiters(Bytes const& messages, std::optional<int64_t> maxNo)
+		{
+			std::vector<std::pair<size_t, size_t>> result;
+			size_t start = 0;
+			for (size_t read = 0; read < messages.size(); read++) {
+				if (messages[read] == 0xf0) {
+					start = read;
+				}
+				else if (messages[read] == 0xf7) {
+					result.emplace_back(start, read + 1);
+					if (maxNo.has_value() && (int64_t)result.size() >= *maxNo) {
+						return result;
+					}
+				}
+			}
+			return result;
+		}
+
+		std::vector<Bytes> splitSysex(Bytes const& byteList)
+		{
+			std::vector<Bytes> result;
+			size_t index = 0;
+			while (index < byteList.size()) {
+				if (byteList[index] == 0xf0) {
+					Bytes sysex;
+					while (true) {
+						if (index >= byteList.size()) {
+							// The Python original indexes past the end of an unterminated message
+							throw py::index_error("list index out of range");
+						}
+						if (byteList[index] == 0xf7) {
+							break;
+						}
+						sysex.push_back(byteList[index]);
+						index++;
+					}
+					sysex.push_back(0xf7);
+					index++;
+					result.push_back(std::move(sysex));
+				}
+				else {
+					result.push_back({ byteList[index] });
+					index++;
+				}
+			}
+			return result;
+		}
+
+		Bytes unescapeSysexDeepmind(Bytes const& sysex)
+		{
+			Bytes result;
+			result.reserve(sysex.size() * 7 / 8 + 7);
+			size_t dataIndex = 0;
+			while (dataIndex < sysex.size()) {
+				int64_t msbits = sysex[dataIndex];
+				dataIndex++;
+				for (int i = 0; i < 7; i++) {
+					if (dataIndex < sysex.size()) {
+						result.push_back(sysex[dataIndex] | ((msbits & (int64_t(1) << i)) << (7 - i)));
+					}
+					dataIndex++;
+				}
+			}
+			return result;
+		}
+
+		Bytes denibbleHiThenLo(Bytes const& message)
+		{
+			if (message.size() % 2 != 0) {
+				throw py::index_error("list index out of range");
+			}
+			Bytes result;
+			result.reserve(message.size() / 2);
+			for (size_t x = 0; x < message.size(); x += 2) {
+				result.push_back(message[x + 1] | (message[x] << 4));
+			}
+			return result;
+		}
+
+		Bytes denibbleLoThenHi(Bytes const& message)
+		{
+			if (message.size() % 2 != 0) {
+				throw py::index_error("list index out of range");
+			}
+			Bytes result;
+			result.reserve(message.size() / 2);
+			for (size_t x = 0; x < message.size(); x += 2) {
+				result.push_back(message[x] | (message[x + 1] << 4));
+			}
+			return result;
+		}
+
+		Bytes nibble(Bytes const& message)
+		{
+			Bytes result;
+			result.reserve(message.size() * 2);
+			for (auto b : message) {
+				result.push_back(b & 0x0f);
+				result.push_back((b & 0xf0) >> 4);
+			}
+			return result;
+		}
+
+	}
+
+	void registerNativeSysex(pybind11::module& module)
+	{
+		using namespace native_sysex;
+		module.doc() = "Native implementations of the knobkraft.sysex helpers";
+		module.def("load_sysex", [](std::string const& filename, bool asSingleList) -> py::object {
+			if (asSingleList) {
+				return py::cast(loadFile(filename));
+			}
+			return py::cast(loadSysex(filename));
+		}, py::arg("filename"), py::arg("as_single_list") = false);
+		module.def("splitSysexMessage", &splitSysexMessage, py::arg("messages"));
+		module.def("findSysexDelimiters", &findSysexDelimiters, py::arg("messages"), py::arg("max_no") = py::none());
+		module.def("splitSysex", &splitSysex, py::arg("byte_list"));
+		module.def("unescapeSysex_deepmind", &unescapeSysexDeepmind, py::arg("sysex"));
+		module.def("denibble_hi_then_lo", &denibbleHiThenLo, py::arg("message"));
+		module.def("denibble_lo_then_hi", &denibbleLoThenHi, py::arg("message"));
+		module.def("nibble", &nibble, py::arg("message"));
+	}
+
+}
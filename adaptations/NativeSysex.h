@@ -0,0 +1,47 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#ifdef _MSC_VER
+#pragma warning ( push )
+#pragma warning ( disable: 4100 )
+#endif
+#include <pybind11/pybind11.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace knobkraft {
+
+	// C++ versions of the helpers in knobkraft/sysex.py. They produce exactly the same results as the Python originals,
+	// including raising IndexError where those run off the end of the input.
+	namespace native_sysex {
+
+		typedef std::vector<int64_t> Bytes;
+
+		Bytes loadFile(std::string const& filename);
+		std::vector<Bytes> loadSysex(std::string const& filename);
+		std::vector<Bytes> splitSysexMessage(Bytes const& messages);
+		std::vector<std::pair<size_t, size_t>> findSysexDelimiters(Bytes const& messages, std::optional<int64_t> maxNo);
+		std::vector<Bytes> splitSysex(Bytes const& byteList);
+		Bytes unescapeSysexDeepmind(Bytes const& sysex);
+		Bytes denibbleHiThenLo(Bytes const& message);
+		Bytes denibbleLoThenHi(Bytes const& message);
+		Bytes nibble(Bytes const& message);
+
+	}
+
+	// Adds the functions under their Python names to the given module, which is knobkraft_native both when embedded and when built as extension
+	void registerNativeSysex(pybind11::module& module);
+
+}
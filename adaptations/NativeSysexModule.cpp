@@ -0,0 +1,14 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "NativeSysex.h"
+#include "NativeRoland.h"
+
+// Standalone build of the embedded knobkraft_native module, for running the adaptation tests outside of the Orm
+PYBIND11_MODULE(knobkraft_native, m) {
+	knobkraft::registerNativeSysex(m);
+	knobkraft::registerNativeRoland(m);
+}
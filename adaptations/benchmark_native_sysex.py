@@ -0,0 +1,57 @@
+#
+#   Copyright (c) 2026 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+# Compares the pure Python knobkraft.sysex helpers with the knobkraft_native versions over all files in testData.
+#
+#     python benchmark_native_sysex.py [--repeat 5]
+#
+import argparse
+import glob
+import os
+import sys
+import timeit
+
+import knobkraft.sysex as sysex
+
+try:
+    import knobkraft_native
+except ImportError:
+    print("knobkraft_native not found, build with -DBUILD_NATIVE_SYSEX_MODULE=ON and add it to the PYTHONPATH")
+    sys.exit(1)
+
+
+def workloads(files):
+    data = [sysex.PYTHON_IMPLEMENTATIONS["load_sysex"](f, as_single_list=True) for f in files]
+    messages = [m[1:-1] for d in data for m in sysex.PYTHON_IMPLEMENTATIONS["splitSysexMessage"](d)]
+    even = [m[:len(m) & ~1] for m in messages]
+    return {
+        "load_sysex": lambda impl: [impl(f) for f in files],
+        "splitSysexMessage": lambda impl: [impl(d) for d in data],
+        "findSysexDelimiters": lambda impl: [impl(d) for d in data],
+        "splitSysex": lambda impl: [impl(d) for d in data if d and d[-1] == 0xf7],
+        "unescapeSysex_deepmind": lambda impl: [impl(m) for m in messages],
+        "denibble_hi_then_lo": lambda impl: [impl(m) for m in even],
+        "denibble_lo_then_hi": lambda impl: [impl(m) for m in even],
+        "nibble": lambda impl: [impl(m) for m in messages],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    test_data_dir = os.path.join(os.path.dirname(os.path.realpath(__file__)), "testData")
+    files = sorted(glob.glob(os.path.join(test_data_dir, "**", "*.syx"), recursive=True))
+    print(f"{len(files)} files, best of {args.repeat} runs")
+    print(f"{'function':<24}{'python ms':>12}{'native ms':>12}{'speedup':>10}")
+    for name, run in workloads(files).items():
+        python_time = min(timeit.repeat(lambda: run(sysex.PYTHON_IMPLEMENTATIONS[name]), number=1, repeat=args.repeat))
+        native_time = min(timeit.repeat(lambda: run(getattr(knobkraft_native, name)), number=1, repeat=args.repeat))
+        print(f"{name:<24}{python_time * 1000:>12.2f}{native_time * 1000:>12.2f}{python_time / native_time:>9.1f}x")
+
+
+if __name__ == "__main__":
+    main()
@@ -5,6 +5,8 @@
 #
 from typing import List, Tuple
 import binascii
+import functools
+import os
 
 
 def load_sysex(filename, as_single_list=False) -> List[List[int]]:
@@ -102,3 +104,55 @@ def nibble(message):
         result.append(b & 0x0f)
         result.append((b & 0xf0) >> 4)
     return result
+
+
+# When running inside the Orm (or with the knobkraft_native extension on the path), the list based helpers above are
+# replaced by C++ implementations with identical results. Anything that is not a plain list of ints, e.g. bytes or
+# tuples whose slices would keep their type, still goes to the Python version. Set KNOBKRAFT_NO_NATIVE to disable.
+PYTHON_IMPLEMENTATIONS = {f.__name__: f for f in [load_sysex, splitSysexMessage, findSysexDelimiters, splitSysex,
+                                                  unescapeSysex_deepmind, denibble_hi_then_lo, denibble_lo_then_hi,
+                                                  nibble]}
+
+try:
+    if os.environ.get("KNOBKRAFT_NO_NATIVE"):
+        raise ImportError("native sysex helpers disabled")
+    import knobkraft_native
+except ImportError:
+    knobkraft_native = None
+
+
+def _native_for_lists(python_function, native_function):
+    @functools.wraps(python_function)
+    def dispatch(data, *args, **kwargs):
+        if type(data) is list:
+            try:
+                return native_function(data, *args, **kwargs)
+            except TypeError:
+                # Elements the native code can't take, e.g. floats
+                pass
+        return python_function(data, *args, **kwargs)
+    return dispatch
+
+
+def _native_for_files(python_function, native_function):
+    @functools.wraps(python_function)
+    def dispatch(filename, *args, **kwargs):
+        if isinstance(filename, str) and os.path.isfile(filename):
+            return native_function(filename, *args, **kwargs)
+        return python_function(filename, *args, **kwargs)
+    return dispatch
+
+
+def has_native_implementation() -> bool:
+    return knobkraft_native is not None
+
+
+if knobkraft_native is not None:
+    load_sysex = _native_for_files(load_sysex, knobkraft_native.load_sysex)
+    splitSysexMessage = _native_for_lists(splitSysexMessage, knobkraft_native.splitSysexMessage)
+    findSysexDelimiters = _native_for_lists(findSysexDelimiters, knobkraft_native.findSysexDelimiters)
+    splitSysex = _native_for_lists(splitSysex, knobkraft_native.splitSysex)
+    unescapeSysex_deepmind = _native_for_lists(unescapeSysex_deepmind, knobkraft_native.unescapeSysex_deepmind)
+    denibble_hi_then_lo = _native_for_lists(denibble_hi_then_lo, knobkraft_native.denibble_hi_then_lo)
+    denibble_lo_then_hi = _native_for_lists(denibble_lo_then_hi, knobkraft_native.denibble_lo_then_hi)
+    nibble = _native_for_lists(nibble, knobkraft_native.nibble)
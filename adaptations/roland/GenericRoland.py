@@ -7,6 +7,11 @@ import hashlib
 from typing import List, Tuple, Optional, Dict, Union
 import knobkraft
 
+# The C++ RolandEngine of the Orm, if available. It takes over the per message work of GenericRoland for plain lists
+_native = knobkraft.sysex.knobkraft_native if knobkraft.sysex.has_native_implementation() else None
+if _native is not None and not hasattr(_native, "RolandEngine"):
+    _native = None
+
 roland_id = 0x41  # Roland
 command_rq1 = 0x11
 command_dt1 = 0x12
@@ -206,6 +211,21 @@ class GenericRoland:
         edit_buffer.make_black_out_zones(self._model_id_len, program_position=5 + self._model_id_len)
         program_dump.make_black_out_zones(self._model_id_len, program_position=5 + self._model_id_len,
                                           name_blankout=(0, 0, 12))  # name always is in block 0 with index 0 and length 12
+        self._native_engine = None
+
+    def prepare_native_engine(self):
+        # Hand the address maps to the native engine. Changes to them after this point are not seen by the engine
+        if _native is not None and self._native_engine is None:
+            self._native_engine = _native.RolandEngine(self.model_id, self.address_size, self.edit_buffer, self.program_dump,
+                                                      self.uses_consecutive_addresses)
+
+    def _engine(self, message):
+        # Only plain lists go native, everything else is handled by the Python code below
+        if type(message) is not list or _native is None:
+            return None
+        if self._native_engine is None:
+            self.prepare_native_engine()
+        return self._native_engine
 
     @knobkraft_api
     def name(self):
@@ -258,6 +278,9 @@ class GenericRoland:
         return [{"bank": 0, "name": "User Patches", "size": self.program_dump.num_items, "type": "User Patch"}]
 
     def isOwnSysex(self, message) -> bool:
+        engine = self._engine(message)
+        if engine is not None:
+            return engine.isOwnSysex(message)
         if len(message) > (2 + self._model_id_len):
             if message[0] == 0xf0 and message[1] == roland_id and message[3:3 + self._model_id_len] == self.model_id:
                 return True
@@ -267,6 +290,9 @@ class GenericRoland:
         return 4 + self._model_id_len
 
     def buildRolandMessage(self, device, command_id, address, data) -> List[int]:
+        engine = self._engine(data)
+        if engine is not None and type(address) is list:
+            return engine.buildRolandMessage(device, command_id, address, data)
         message = [0xf0, roland_id, device & 0x1f] + self.model_id + [command_id] + address + data + [0, 0xf7]
         message[-2] = self.roland_checksum(message[self._checksum_start():-2])
         return message
@@ -286,6 +312,8 @@ class GenericRoland:
 
     @staticmethod
     def roland_checksum(data_block) -> int:
+        if _native is not None and type(data_block) is list:
+            return _native.roland_checksum(data_block)
         return sum([-x for x in data_block]) & 0x7f
 
     @knobkraft_api
@@ -305,6 +333,10 @@ class GenericRoland:
     @knobkraft_api
     def isPartOfEditBufferDump(self, message):
         # Accept a certain set of addresses. This does not verify the checksum, for speed reasons, or check the size
+        engine = self._engine(message)
+        if engine is not None:
+            sub_request = engine.editBufferBlock(message)
+            return (True, self._createFollowUpEditBufferDumpRequest(sub_request)) if sub_request >= 0 else False
         if self.isOwnSysex(message):
             command, address = self.getCommandAndAddressFromRolandMessage(message)
             if command == command_dt1:
@@ -317,6 +349,9 @@ class GenericRoland:
 
     @knobkraft_api
     def isEditBufferDump(self, messages):
+        engine = self._engine(messages)
+        if engine is not None:
+            return engine.isEditBufferDump(messages)
         addresses = set()
         for message in knobkraft.sysex.findSysexDelimiters(messages):
             if self.isOwnSysex(messages[message[0]:message[1]]):
@@ -354,6 +389,10 @@ class GenericRoland:
     @knobkraft_api
     def isPartOfSingleProgramDump(self, message):
         # Accept a certain set of addresses
+        engine = self._engine(message)
+        if engine is not None:
+            sub_request, patchNo = engine.programDumpBlock(message)
+            return (True, self._createFollowUpProgramDumpRequest(patchNo, sub_request)) if sub_request >= 0 else False
         if self.isOwnSysex(message):
             command, address = self.getCommandAndAddressFromRolandMessage(message)
             if command == command_dt1:
@@ -367,6 +406,9 @@ class GenericRoland:
 
     @knobkraft_api
     def isSingleProgramDump(self, messages):
+        engine = self._engine(messages)
+        if engine is not None:
+            return engine.isSingleProgramDump(messages)
         addresses = set()
         programs = set()
         for message in knobkraft.sysex.findSysexDelimiters(messages):
@@ -405,6 +447,12 @@ class GenericRoland:
 
     def blankedOut(self, message):
         # Use the prepared blank out zones to clear out a) program place and b) patch name
+        engine = self._engine(message)
+        if engine is not None:
+            result = engine.blankedOut(message)
+            if result is None:
+                raise Exception("Only works with edit buffers and program dumps")
+            return result
         if self.isEditBufferDump(message):
             return self._apply_blankout(message.copy(), self.edit_buffer.blank_out_zones)
         elif self.isSingleProgramDump(message):
@@ -413,9 +461,18 @@ class GenericRoland:
 
     @knobkraft_api
     def calculateFingerprint(self, message):
+        engine = self._engine(message)
+        if engine is not None:
+            data = engine.fingerprintData(message)
+            if data is None:
+                raise Exception("Only works with edit buffers and program dumps")
+            return hashlib.md5(data).hexdigest()
         return hashlib.md5(bytearray(self.blankedOut(message))).hexdigest()
 
     def _patch_number_from_address(self, address):
+        engine = self._engine(address)
+        if engine is not None:
+            return engine.patchNumberFromAddress(address)
         if self.uses_consecutive_addresses:
             address_as_number = DataBlock.size_to_number(tuple(address))
             base_as_number = DataBlock.size_to_number(tuple(self.program_dump.base_address))
@@ -425,6 +482,9 @@ class GenericRoland:
 
     @knobkraft_api
     def numberFromDump(self, message) -> int:
+        engine = self._engine(message)
+        if engine is not None:
+            return engine.numberFromDump(message)
         if not self.isSingleProgramDump(message):
             return 0
         messages = knobkraft.sysex.findSysexDelimiters(message, 1)
@@ -502,6 +562,7 @@ class GenericRoland:
     def install(self, module):
         # This is required because the original KnobKraft modules are not objects, but rather a module namespace with
         # methods declared. Expose our objects methods in the top level module namespace so the C++ code finds it
+        self.prepare_native_engine()
         for a in dir(self):
             if callable(getattr(self, a)) and hasattr(getattr(self, a), "_is_knobkraft"):
                 # this was helpful: http://stupidpythonideas.blogspot.com/2013/06/how-methods-work.html
@@ -634,6 +695,8 @@ class GenericRolandWithBackwardCompatibility:
     def install(self, module):
         # This is required because the original KnobKraft modules are not objects, but rather a module namespace with
         # methods declared. Expose our objects methods in the top level module namespace so the C++ code finds it
+        for model in [self.main_model] + self.models_supported:
+            model.prepare_native_engine()
         for a in dir(self):
             if callable(getattr(self, a)) and hasattr(getattr(self, a), "_is_knobkraft"):
                 # this was helpful: http://stupidpythonideas.blogspot.com/2013/06/how-methods-work.html
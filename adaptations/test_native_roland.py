@@ -0,0 +1,128 @@
+#
+#   Copyright (c) 2026 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+# Checks that GenericRoland gives the same results with the native RolandEngine as with the pure Python code.
+# Needs the knobkraft_native extension, build with -DBUILD_NATIVE_SYSEX_MODULE=ON and put it on the PYTHONPATH.
+import copy
+
+import pytest
+
+native = pytest.importorskip("knobkraft_native")
+
+import knobkraft
+import roland
+from roland import DataBlock, RolandData, GenericRoland
+import Roland_JD_Xi
+import Roland_JV80
+import Roland_JV1080
+import Roland_XV3080
+
+if not knobkraft.sysex.has_native_implementation() or not hasattr(native, "RolandEngine"):
+    pytest.skip("Native Roland engine not available", allow_module_level=True)
+
+
+def consecutive_model():
+    blocks = [DataBlock((0x00, 0x00, 0x00), 0x10, "Common"), DataBlock((0x00, 0x00, 0x10), 0x20, "Tone")]
+    edit_buffer = RolandData("Edit buffer", 1, 3, 3, (0x10, 0x00, 0x00), blocks, uses_consecutive_addresses=True)
+    program_dump = RolandData("Programs", 64, 3, 3, (0x20, 0x00, 0x00), blocks, uses_consecutive_addresses=True)
+    return GenericRoland("Consecutive", model_id=[0x42], address_size=3, edit_buffer=edit_buffer, program_dump=program_dump,
+                         uses_consecutive_addresses=True)
+
+
+models = {
+    "JV-80": Roland_JV80.jv_80,
+    "JV-1080": Roland_JV1080.jv_1080,
+    "XV-3080": Roland_XV3080.xv_3080_main,
+    "JD-Xi": Roland_JD_Xi._jdxi_sn_tone,
+    "Consecutive": consecutive_model(),
+}
+
+test_files = ["testData/JV1080_AGSOUND1.SYX", "testData/RolandJV1080/Super JV Pad.syx",
+              "testData/RolandJV1080/Super JV Pad2.syx", "testData/Roland_JD_Xi/JDXi-SN-Atmo_Pad.syx"]
+
+
+def python_only(model):
+    reference = copy.copy(model)
+    reference._engine = lambda message: None
+    return reference
+
+
+def outcome(function, *args):
+    try:
+        return function(*args)
+    except Exception as e:
+        return type(e)
+
+
+def generated_dumps(model):
+    # Program dumps and edit buffers built by the model itself, so every model has data in its own format
+    dumps = []
+    for program in [0, 1, model.program_dump.num_items - 1]:
+        program_dump = []
+        edit_buffer = []
+        for block_no, block in enumerate(model.program_dump.data_blocks):
+            data = [(program + block_no + i) & 0x7f for i in range(block.size)]
+            address, _ = model.program_dump.address_and_size_for_sub_request(block_no, program)
+            program_dump += model.buildRolandMessage(0x10, roland.command_dt1, address, data)
+            if block_no < len(model.edit_buffer.data_blocks):
+                address, _ = model.edit_buffer.address_and_size_for_sub_request(block_no, 0)
+                edit_buffer += model.buildRolandMessage(0x10, roland.command_dt1, address, data)
+        dumps += [program_dump, edit_buffer]
+    return dumps
+
+
+def file_dumps(model):
+    dumps = []
+    for file in test_files:
+        data = knobkraft.load_sysex(file, as_single_list=True)
+        dumps.append(data)
+        current = []
+        for message in knobkraft.splitSysexMessage(data):
+            current += message
+            part = python_only(model).isPartOfSingleProgramDump(message)
+            if part is False or part[1] == []:
+                dumps.append(current)
+                current = []
+    return dumps
+
+
+@pytest.mark.parametrize("name", models.keys())
+def test_same_results(name):
+    model = models[name]
+    model.prepare_native_engine()
+    assert model._native_engine is not None
+    reference = python_only(model)
+    for dump in generated_dumps(model) + file_dumps(model):
+        for function in ["isEditBufferDump", "isSingleProgramDump", "numberFromDump", "blankedOut", "calculateFingerprint"]:
+            assert outcome(getattr(model, function), dump) == outcome(getattr(reference, function), dump), function
+        for message in knobkraft.splitSysexMessage(dump):
+            for function in ["isOwnSysex", "isPartOfEditBufferDump", "isPartOfSingleProgramDump"]:
+                assert outcome(getattr(model, function), message) == outcome(getattr(reference, function), message), function
+            address = message[4 + len(model.model_id):4 + len(model.model_id) + model.address_size]
+            assert outcome(model._patch_number_from_address, address) == outcome(reference._patch_number_from_address, address)
+            assert model.roland_checksum(message[1:-2]) == reference.roland_checksum(tuple(message[1:-2]))
+
+
+@pytest.mark.parametrize("name", models.keys())
+@pytest.mark.parametrize("message", [[], [0xf0], [0xf0, 0x41], [0xf0, 0x41, 0x10], [0xf0, 0x41, 0x10, 0x6a],
+                                     [0xf0, 0x41, 0x10, 0x6a, 0x12, 0x11, 0xf7], [0xf0, 0x41, 0x10, 0x00, 0x10, 0x12, 0xf7],
+                                     [0xf0, 0x41, 0x10, 0x42, 0x12, 0x30, 0x00, 0x00, 0x01, 0x00, 0xf7],
+                                     [0x00, 0x12, 0xf7, 0xf0, 0x12, 0x34]], ids=str)
+def test_malformed_messages(name, message):
+    model = models[name]
+    reference = python_only(model)
+    for function in ["isOwnSysex", "isPartOfEditBufferDump", "isPartOfSingleProgramDump", "isEditBufferDump",
+                     "isSingleProgramDump", "numberFromDump", "blankedOut", "_patch_number_from_address"]:
+        assert outcome(getattr(model, function), message) == outcome(getattr(reference, function), message), function
+
+
+@pytest.mark.parametrize("name", models.keys())
+def test_build_message(name):
+    model = models[name]
+    reference = python_only(model)
+    for device in [0x00, 0x10, 0x7f]:
+        address = list(model.program_dump.base_address)
+        assert model.buildRolandMessage(device, roland.command_rq1, address, [0, 0, 1, 0]) == \
+               reference.buildRolandMessage(device, roland.command_rq1, address, [0, 0, 1, 0])
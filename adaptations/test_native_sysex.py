@@ -0,0 +1,86 @@
+#
+#   Copyright (c) 2026 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+# Checks that the C++ versions of the knobkraft.sysex helpers give exactly the same results as the Python ones.
+# Needs the knobkraft_native extension, build with -DBUILD_NATIVE_SYSEX_MODULE=ON and put it on the PYTHONPATH.
+import glob
+import os
+
+import pytest
+
+import knobkraft.sysex as sysex
+
+native = pytest.importorskip("knobkraft_native")
+python = sysex.PYTHON_IMPLEMENTATIONS
+
+test_data_dir = os.path.join(os.path.dirname(os.path.realpath(__file__)), "testData")
+syx_files = sorted(glob.glob(os.path.join(test_data_dir, "**", "*.syx"), recursive=True))
+
+
+def outcome(function, *args, **kwargs):
+    # Result or exception type, so error behaviour is compared as well
+    try:
+        return function(*args, **kwargs)
+    except Exception as e:
+        return type(e)
+
+
+def assert_same(name, *args, **kwargs):
+    assert outcome(getattr(native, name), *args, **kwargs) == outcome(python[name], *args, **kwargs)
+
+
+@pytest.mark.parametrize("syx_file", syx_files, ids=lambda f: os.path.relpath(f, test_data_dir))
+def test_test_data(syx_file):
+    assert_same("load_sysex", syx_file)
+    assert_same("load_sysex", syx_file, as_single_list=True)
+    data = python["load_sysex"](syx_file, as_single_list=True)
+    assert_same("splitSysexMessage", data)
+    assert_same("findSysexDelimiters", data)
+    assert_same("findSysexDelimiters", data, max_no=1)
+    assert_same("findSysexDelimiters", data, 3)
+    assert_same("splitSysex", data)
+    for message in python["splitSysexMessage"](data):
+        payload = message[1:-1]
+        assert_same("unescapeSysex_deepmind", payload)
+        assert_same("denibble_hi_then_lo", payload)
+        assert_same("denibble_lo_then_hi", payload)
+        assert_same("nibble", payload)
+
+
+@pytest.mark.parametrize("data", [
+    [],
+    [0xf7],
+    [0xf0],
+    [0x01, 0x02, 0x03],
+    [0xf0, 0x01, 0x02],
+    [0x00, 0xf0, 0x01, 0xf7, 0x05, 0xf7],
+    [0xf0, 0xf0, 0x01, 0xf7, 0xf0, 0x7f, 0xf7, 0x33],
+    [0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x01],
+    [0x0f, 0x0e, 0x0d],
+    [0x0f, 0x0e, 0x0d, 0x0c],
+    [-1, 0x1ff, 0x80],
+], ids=str)
+def test_edge_cases(data):
+    for name in ["splitSysexMessage", "findSysexDelimiters", "splitSysex", "unescapeSysex_deepmind",
+                 "denibble_hi_then_lo", "denibble_lo_then_hi", "nibble"]:
+        assert_same(name, data)
+    for max_no in [None, 0, 1, 2, -1]:
+        assert_same("findSysexDelimiters", data, max_no=max_no)
+
+
+def test_missing_file():
+    with pytest.raises(FileNotFoundError):
+        native.load_sysex(os.path.join(test_data_dir, "does_not_exist.syx"))
+
+
+def test_dispatch_keeps_python_semantics():
+    if not sysex.has_native_implementation():
+        pytest.skip("Native helpers disabled")
+    # Slices of bytes and tuples keep their type, so these must not go to the native code
+    data = bytes([0xf0, 0x01, 0xf7])
+    assert sysex.splitSysexMessage(data) == [data]
+    assert sysex.splitSysexMessage((0xf0, 0x01, 0xf7)) == [(0xf0, 0x01, 0xf7)]
+    assert sysex.nibble([0x12, 0x34]) == [0x02, 0x01, 0x04, 0x03]
+    assert sysex.nibble.__name__ == "nibble"
@@ -0,0 +1,148 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+// Measures how the import work done in Python (splitting the sysex into patches, fingerprinting and naming them) scales when
+// several adaptations are busy at the same time, one thread per adaptation. With 0 interpreters all adaptations share the main
+// interpreter and its GIL, with more they are spread over isolated interpreters with their own GIL.
+// Usage: adaptation_parallel_benchmark [--interpreters N] [--rounds R]
+// Without --interpreters, the benchmark runs itself for 0, 1, 2 and 4 interpreters and prints the throughput of each.
+
+#include "GenericAdaptation.h"
+#include "Sysex.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct ParallelCase {
+	std::string adaptation;
+	std::string syxFile;
+};
+
+const std::vector<ParallelCase> kCases = {
+	{ "DSI_Mopho.py", "Mopho_Programs_v1.0.syx" },
+	{ "Sequential Prophet 6.py", "P6_Programs_v1.01.syx" },
+	{ "DSI Prophet 08.py", "Prophet_08_Programs_v1.0.syx" },
+	{ "DSI Pro 2.py", "Pro_2_Programs_v1.0a.syx" },
+	{ "DSI_Tetra.py", "Tetra_ProgramsCombos_1.0.syx" },
+	{ "DSI Prophet 12.py", "P12_Programs_v1.1c.syx" },
+	{ "Sequential_Take_5.py", "Take5_Factory_Set1_v1.0.syx" },
+	{ "DSI_Evolver.py", "Evolver_bank3_1-0.syx" },
+};
+
+File adaptationsDirectory() {
+	return File(KNOBKRAFT_SOURCE_DIR).getChildFile("adaptations");
+}
+
+void setInterpreterCount(std::string const& count) {
+#ifdef _WIN32
+	_putenv_s("ORM_ADAPTATION_INTERPRETERS", count.c_str());
+#else
+	setenv("ORM_ADAPTATION_INTERPRETERS", count.c_str(), 1);
+#endif
+}
+
+int runScan(File const& executable, int rounds) {
+	int failed = 0;
+	for (int interpreters : { 0, 1, 2, 4 }) {
+		ChildProcess child;
+		StringArray arguments{ executable.getFullPathName(), "--interpreters", String(interpreters), "--rounds", String(rounds) };
+		if (!child.start(arguments)) {
+			std::printf("Could not start %s\n", executable.getFullPathName().toRawUTF8());
+			return 1;
+		}
+		std::printf("%s", child.readAllProcessOutput().toRawUTF8());
+		if (child.getExitCode() != 0) {
+			failed++;
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+int runBenchmark(int interpreters, int rounds) {
+	setInterpreterCount(std::to_string(interpreters));
+	knobkraft::GenericAdaptation::startupGenericAdaptation();
+	if (!knobkraft::GenericAdaptation::hasPython()) {
+		std::printf("No Python found, nothing to benchmark\n");
+		return 0;
+	}
+
+	struct Loaded {
+		std::shared_ptr<knobkraft::GenericAdaptation> adaptation;
+		std::vector<MidiMessage> messages;
+	};
+	std::vector<Loaded> loaded;
+	for (auto const& parallelCase : kCases) {
+		auto path = adaptationsDirectory().getChildFile(parallelCase.adaptation);
+		auto syx = adaptationsDirectory().getChildFile("testData").getChildFile(parallelCase.syxFile);
+		if (!path.existsAsFile() || !syx.existsAsFile()) {
+			std::printf("Skipping %s, files not found\n", parallelCase.adaptation.c_str());
+			continue;
+		}
+		try {
+			auto adaptation = std::make_shared<knobkraft::GenericAdaptation>(path.getFullPathName().toStdString());
+			loaded.push_back({ adaptation, Sysex::loadSysex(syx.getFullPathName().toStdString()) });
+		}
+		catch (std::exception& e) {
+			std::printf("Skipping %s: %s\n", parallelCase.adaptation.c_str(), e.what());
+		}
+	}
+
+	std::atomic<size_t> patchesProcessed(0);
+	std::vector<std::thread> workers;
+	double start = Time::getMillisecondCounterHiRes();
+	for (auto& job : loaded) {
+		workers.emplace_back([&job, &patchesProcessed, rounds]() {
+			for (int round = 0; round < rounds; round++) {
+				auto patches = job.adaptation->loadSysex(job.messages);
+				for (auto const& patch : patches) {
+					auto fingerprint = job.adaptation->calculateFingerprint(patch);
+					auto name = job.adaptation->nameForPatch(patch);
+					if (!fingerprint.empty() || !name.empty()) {
+						patchesProcessed++;
+					}
+				}
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	double elapsed = Time::getMillisecondCounterHiRes() - start;
+
+	std::printf("%d interpreters (%d in use): %d adaptations %8d patches %10.1f ms %10.0f patches/s\n", interpreters,
+		(int)knobkraft::AdaptationInterpreterPool::size(), (int)loaded.size(), (int)patchesProcessed.load(), elapsed,
+		elapsed > 0.0 ? patchesProcessed.load() * 1000.0 / elapsed : 0.0);
+
+	loaded.clear();
+	knobkraft::GenericAdaptation::shutdownGenericAdaptation();
+	return patchesProcessed.load() > 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	ScopedJuceInitialiser_GUI juce;
+
+	int interpreters = -1;
+	int rounds = 10;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string option(argv[i]);
+		if (option == "--interpreters") interpreters = atoi(argv[i + 1]);
+		else if (option == "--rounds") rounds = atoi(argv[i + 1]);
+	}
+
+	if (interpreters < 0) {
+		return runScan(File::getSpecialLocation(File::currentExecutableFile), rounds);
+	}
+	return runBenchmark(interpreters, rounds);
+}
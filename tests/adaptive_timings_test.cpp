@@ -0,0 +1,185 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "adaptations/AdaptiveTimings.h"
+
+using knobkraft::AdaptiveTimings;
+
+namespace {
+
+const AdaptiveTimings::Bounds kReplyBounds{ 2000, std::nullopt };
+
+// Runs a number of clean request/reply exchanges with the given latency, returns the time afterwards. A dump is a single
+// message, unless it takes lastMessageMs more to complete
+double exchange(AdaptiveTimings& timings, AdaptiveTimings::Exchange kind, int count, double latencyMs, double startMs = 0.0, double lastMessageMs = 0.0) {
+	double now = startMs;
+	for (int i = 0; i < count; i++) {
+		timings.requestSent(kind, now);
+		now += latencyMs;
+		timings.replyReceived(kind, now);
+		if (kind == AdaptiveTimings::Exchange::DumpRequest) {
+			now += lastMessageMs;
+			timings.replyComplete(now);
+		}
+		now += 10.0;
+	}
+	return now;
+}
+
+} // namespace
+
+TEST_CASE("adaptive timings stay conservative until enough samples were seen") {
+	AdaptiveTimings timings;
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 2000);
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, AdaptiveTimings::kMinimumSamples - 1, 100.0);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 2000);
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 1, 100.0);
+	CHECK(timings.samples(AdaptiveTimings::Exchange::DumpRequest) == AdaptiveTimings::kMinimumSamples);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) < 2000);
+}
+
+TEST_CASE("learned timeouts are clamped to the adaptation's bounds") {
+	AdaptiveTimings timings;
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 32, 200.0);
+	// 1.5 times the slowest reply plus margin
+	CHECK(timings.replyTimeoutMs({ 2000, 100 }) == 350);
+	// Not below the minimum given, a quarter of the conservative value if none given
+	CHECK(timings.replyTimeoutMs({ 2000, 500 }) == 500);
+	CHECK(timings.replyTimeoutMs({ 4000, std::nullopt }) == 1000);
+	// Never above the conservative value
+	CHECK(timings.replyTimeoutMs({ 300, std::nullopt }) == 300);
+}
+
+TEST_CASE("a timed out request falls back to the conservative values") {
+	AdaptiveTimings timings;
+	double now = exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 32, 100.0);
+	int learned = timings.replyTimeoutMs(kReplyBounds);
+	REQUIRE(learned < 2000);
+
+	// This one is never answered, the next request comes after the timeout handed out
+	timings.requestSent(AdaptiveTimings::Exchange::DumpRequest, now);
+	now += learned + 1;
+	timings.requestSent(AdaptiveTimings::Exchange::DumpRequest, now);
+	CHECK(timings.samples(AdaptiveTimings::Exchange::DumpRequest) == 0);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 2000);
+}
+
+TEST_CASE("a corrupt reply falls back to the conservative values") {
+	AdaptiveTimings timings;
+	double now = exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 64, 100.0);
+	REQUIRE(timings.replyTimeoutMs(kReplyBounds) < 2000);
+	REQUIRE(timings.messageDelayMs({ 100, std::nullopt }) < 100);
+	// The last dump turns out to be corrupt when it is unpacked
+	timings.replyCorrupt(now);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 2000);
+	CHECK(timings.messageDelayMs({ 100, std::nullopt }) == 100);
+}
+
+TEST_CASE("a dump is timed to its first and to its last message") {
+	AdaptiveTimings timings;
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 32, 100.0, 0.0, 500.0);
+	CHECK(timings.samples(AdaptiveTimings::Exchange::DumpRequest) == 32);
+	CHECK(timings.completeSamples() == 32);
+	// The whole dump has to fit, 1.5 times the slowest plus margin
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 950);
+}
+
+TEST_CASE("a first message alone is not enough to shorten the timeout") {
+	AdaptiveTimings timings;
+	double now = 0.0;
+	for (int i = 0; i < 32; i++) {
+		timings.requestSent(AdaptiveTimings::Exchange::DumpRequest, now);
+		timings.replyReceived(AdaptiveTimings::Exchange::DumpRequest, now + 100.0);
+		now += 200.0;
+	}
+	CHECK(timings.samples(AdaptiveTimings::Exchange::DumpRequest) == 32);
+	CHECK(timings.completeSamples() == 0);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 2000);
+}
+
+TEST_CASE("messages without an outstanding request are not replies") {
+	AdaptiveTimings timings;
+	double now = exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 32, 100.0);
+	int learned = timings.replyTimeoutMs(kReplyBounds);
+	REQUIRE(learned < 2000);
+	// A file import much later, with a broken patch in it
+	now += 60000.0;
+	timings.replyReceived(AdaptiveTimings::Exchange::DumpRequest, now);
+	timings.replyComplete(now);
+	timings.replyCorrupt(now);
+	CHECK(timings.samples(AdaptiveTimings::Exchange::DumpRequest) == 32);
+	CHECK(timings.completeSamples() == 32);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == learned);
+
+	// A reply after the caller gave up is no sample either, the request timed out
+	timings.requestSent(AdaptiveTimings::Exchange::DumpRequest, now);
+	timings.replyReceived(AdaptiveTimings::Exchange::DumpRequest, now + learned + 1);
+	CHECK(timings.samples(AdaptiveTimings::Exchange::DumpRequest) == 0);
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == 2000);
+}
+
+TEST_CASE("the message delay halves with every run of clean exchanges") {
+	AdaptiveTimings timings;
+	AdaptiveTimings::Bounds delay{ 80, 5 };
+	CHECK(timings.messageDelayMs(delay) == 80);
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, AdaptiveTimings::kCleanExchangesPerDelayStep, 50.0);
+	CHECK(timings.messageDelayMs(delay) == 40);
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, AdaptiveTimings::kCleanExchangesPerDelayStep, 50.0);
+	CHECK(timings.messageDelayMs(delay) == 20);
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 10 * AdaptiveTimings::kCleanExchangesPerDelayStep, 50.0);
+	CHECK(timings.messageDelayMs(delay) == 5);
+	// No delay stays no delay
+	CHECK(timings.messageDelayMs({ 0, std::nullopt }) == 0);
+}
+
+TEST_CASE("unanswered device detects do not count as failures") {
+	AdaptiveTimings timings;
+	double now = exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 32, 100.0);
+	int learned = timings.replyTimeoutMs(kReplyBounds);
+	for (int i = 0; i < 10; i++) {
+		timings.requestSent(AdaptiveTimings::Exchange::DeviceDetect, now);
+		now += 5000.0;
+	}
+	CHECK(timings.replyTimeoutMs(kReplyBounds) == learned);
+	exchange(timings, AdaptiveTimings::Exchange::DeviceDetect, 16, 40.0, now);
+	CHECK(timings.deviceDetectWaitMs({ 1000, std::nullopt }) == 250);
+	CHECK(timings.deviceDetectWaitMs({ 1000, 300 }) == 300);
+}
+
+TEST_CASE("learned timings survive a round trip through the settings") {
+	AdaptiveTimings timings;
+	exchange(timings, AdaptiveTimings::Exchange::DumpRequest, 40, 120.0);
+	exchange(timings, AdaptiveTimings::Exchange::DeviceDetect, 20, 30.0);
+	CHECK(timings.takeDirty());
+	CHECK_FALSE(timings.takeDirty());
+
+	AdaptiveTimings restored;
+	restored.restore(timings.toString());
+	CHECK(restored.samples(AdaptiveTimings::Exchange::DumpRequest) == 40);
+	CHECK(restored.samples(AdaptiveTimings::Exchange::DeviceDetect) == 20);
+	CHECK(restored.completeSamples() == 40);
+	CHECK(restored.replyTimeoutMs(kReplyBounds) == timings.replyTimeoutMs(kReplyBounds));
+	CHECK(restored.deviceDetectWaitMs({ 1000, std::nullopt }) == timings.deviceDetectWaitMs({ 1000, std::nullopt }));
+	CHECK(restored.messageDelayMs({ 100, std::nullopt }) == timings.messageDelayMs({ 100, std::nullopt }));
+
+	AdaptiveTimings garbage;
+	garbage.restore("not a timing");
+	CHECK(garbage.samples(AdaptiveTimings::Exchange::DumpRequest) == 0);
+	CHECK(garbage.replyTimeoutMs(kReplyBounds) == 2000);
+}
+
+TEST_CASE("a slow outlier fades out of the learned timeout") {
+	AdaptiveTimings timings;
+	const AdaptiveTimings::Bounds detectBounds{ 2000, 10 };
+	double now = exchange(timings, AdaptiveTimings::Exchange::DeviceDetect, 10, 40.0);
+	now = exchange(timings, AdaptiveTimings::Exchange::DeviceDetect, 1, 900.0, now);
+	now = exchange(timings, AdaptiveTimings::Exchange::DeviceDetect, 10, 40.0, now);
+	CHECK(timings.deviceDetectWaitMs(detectBounds) >= 1350);
+	exchange(timings, AdaptiveTimings::Exchange::DeviceDetect, 600, 40.0, now);
+	CHECK(timings.deviceDetectWaitMs(detectBounds) < 200);
+}
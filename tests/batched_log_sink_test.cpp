@@ -0,0 +1,120 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "The-Orm/BatchedLogSink.h"
+
+#include <spdlog/logger.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct CollectedLines {
+	std::vector<std::string> lines;
+
+	BatchedLogSink::TLineHandler handler() {
+		return [this](spdlog::level::level_enum, std::string const& line) { lines.push_back(line); };
+	}
+};
+
+std::shared_ptr<spdlog::logger> makeLogger(std::shared_ptr<BatchedLogSink> sink) {
+	sink->set_pattern("%v");
+	auto logger = std::make_shared<spdlog::logger>("test", sink);
+	logger->set_level(spdlog::level::trace);
+	return logger;
+}
+
+} // namespace
+
+TEST_CASE("log queue hands lines over in order and counts overflow") {
+	LogMessageQueue queue(4);
+	auto now = spdlog::log_clock::now();
+	for (int i = 0; i < 6; i++) {
+		auto text = std::to_string(i);
+		CHECK(queue.push(spdlog::level::info, now, text) == (i < 4));
+	}
+	CHECK(queue.takeDropped() == 2);
+	CHECK(queue.takeDropped() == 0);
+
+	LogMessageQueue::Entry entry;
+	for (int i = 0; i < 4; i++) {
+		REQUIRE(queue.pop(entry));
+		CHECK(entry.text == std::to_string(i));
+	}
+	CHECK_FALSE(queue.pop(entry));
+	CHECK(queue.push(spdlog::level::info, now, "again"));
+}
+
+TEST_CASE("batched log sink collapses repeated lines") {
+	CollectedLines collected;
+	auto sink = std::make_shared<BatchedLogSink>(collected.handler());
+	auto logger = makeLogger(sink);
+
+	logger->info("first");
+	for (int i = 0; i < 5; i++) {
+		logger->info("same");
+	}
+	logger->info("last");
+	logger->info("last");
+	CHECK(collected.lines.empty());
+
+	CHECK(sink->drain() == 8);
+	sink->drain();
+	REQUIRE(collected.lines.size() == 5);
+	CHECK(collected.lines[0].find("first") == 0);
+	CHECK(collected.lines[1].find("same") == 0);
+	CHECK(collected.lines[2].find("Last message repeated 4 times") == 0);
+	CHECK(collected.lines[3].find("last") == 0);
+	CHECK(collected.lines[4].find("Last message repeated 1 times") == 0);
+}
+
+TEST_CASE("batched log sink drops instead of blocking the producers") {
+	CollectedLines collected;
+	auto sink = std::make_shared<BatchedLogSink>(collected.handler(), 64, 16);
+	auto logger = makeLogger(sink);
+
+	const int kThreads = 4;
+	const int kLinesPerThread = 1000;
+	std::vector<std::thread> producers;
+	for (int t = 0; t < kThreads; t++) {
+		producers.emplace_back([logger, t]() {
+			for (int i = 0; i < kLinesPerThread; i++) {
+				logger->info("thread {} line {}", t, i);
+			}
+		});
+	}
+	for (auto& producer : producers) {
+		producer.join();
+	}
+
+	// Batches are limited in size, so the UI thread is never held up for long
+	CHECK(sink->drain() == 16);
+	size_t delivered = 16;
+	while (size_t n = sink->drain()) {
+		delivered += n;
+	}
+	CHECK(delivered == 64);
+	auto expected = "Log overflow, " + std::to_string(kThreads * kLinesPerThread - 64) + " lines dropped";
+	CHECK(std::count_if(collected.lines.begin(), collected.lines.end(), [&](std::string const& line) { return line.find(expected) == 0; }) == 1);
+}
+
+TEST_CASE("batched log sink keeps the lines until a handler is attached") {
+	CollectedLines collected;
+	auto sink = std::make_shared<BatchedLogSink>(nullptr);
+	auto logger = makeLogger(sink);
+	logger->info("early");
+	CHECK(sink->drain() == 0);
+
+	sink->setLineHandler(collected.handler());
+	CHECK(sink->drain() == 1);
+	REQUIRE(collected.lines.size() == 1);
+	CHECK(collected.lines[0].find("early") == 0);
+}
@@ -0,0 +1,230 @@
+#include "doctest/doctest.h"
+
+#include "The-Orm/DatabaseSnapshots.h"
+#include "The-Orm/ReadConnectionPool.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <filesystem>
+#include <string>
+
+namespace {
+
+class ScopedTempDirectory {
+public:
+	explicit ScopedTempDirectory(std::filesystem::path path) : path_(std::move(path)) {
+		std::filesystem::create_directories(path_);
+	}
+	~ScopedTempDirectory() {
+		std::error_code ec;
+		std::filesystem::remove_all(path_, ec);
+	}
+
+	std::filesystem::path const& path() const { return path_; }
+
+private:
+	std::filesystem::path path_;
+};
+
+ScopedTempDirectory makeTempDirectory() {
+	auto base = std::filesystem::temp_directory_path();
+	return ScopedTempDirectory(base / ("database_snapshots_" + test_helpers::makeRandomSuffix()));
+}
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+}
+
+void insertPatches(SQLite::Database& db, int first, int count) {
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, data, favorite, hidden, categories) VALUES ('OB-6', :MD5, :NAM, zeroblob(4096), 0, 0, 1)");
+	for (int i = first; i < first + count; i++) {
+		insert.bind(":MD5", "md5-" + std::to_string(i));
+		insert.bind(":NAM", "Patch " + std::to_string(i));
+		insert.exec();
+		insert.reset();
+	}
+}
+
+int countPatches(std::string const& file) {
+	SQLite::Database db(file, SQLite::OPEN_READONLY);
+	SQLite::Statement query(db, "SELECT count(*) FROM patches");
+	REQUIRE(query.executeStep());
+	return query.getColumn(0).getInt();
+}
+
+} // namespace
+
+TEST_CASE("snapshots are only taken when the database changed") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+	createTables(writer);
+	insertPatches(writer, 0, 500);
+
+	DatabaseSnapshots snapshots(file);
+	CHECK(snapshots.directory() == (tmp.path() / "patches-snapshots").string());
+	CHECK_FALSE(snapshots.upToDate());
+	auto first = snapshots.snapshotNow("test");
+	REQUIRE_FALSE(first.empty());
+	CHECK(countPatches(first) == 500);
+	CHECK(snapshots.upToDate());
+	CHECK(snapshots.latest() == std::filesystem::path(first).filename().string());
+
+	// Nothing new, nothing copied
+	CHECK(snapshots.snapshotNow("test") == first);
+	CHECK(snapshots.snapshots().size() == 1);
+
+	insertPatches(writer, 500, 10);
+	CHECK_FALSE(snapshots.upToDate());
+	auto second = snapshots.snapshotNow("test");
+	REQUIRE_FALSE(second.empty());
+	CHECK(second != first);
+	CHECK(countPatches(second) == 510);
+	CHECK(countPatches(first) == 500);
+	CHECK(snapshots.upToDate());
+	CHECK(snapshots.snapshots().size() == 2);
+	CHECK(snapshots.latest() == std::filesystem::path(second).filename().string());
+}
+
+TEST_CASE("a snapshot identical to the newest one is dropped, and only the newest are kept") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+	createTables(writer);
+	insertPatches(writer, 0, 20);
+	ReadConnectionPool::enableWriteAheadLog(writer);
+
+	std::string kept;
+	{
+		DatabaseSnapshots snapshots(file, 2);
+		kept = snapshots.snapshotNow("test");
+		REQUIRE_FALSE(kept.empty());
+	}
+	{
+		// A new session doesn't know whether anything changed, the copy shows it didn't
+		DatabaseSnapshots snapshots(file, 2);
+		CHECK(snapshots.snapshotNow("test") == kept);
+		CHECK(snapshots.snapshots().size() == 1);
+
+		for (int i = 0; i < 3; i++) {
+			insertPatches(writer, 100 + i, 1);
+			REQUIRE_FALSE(snapshots.snapshotNow("test").empty());
+		}
+		auto all = snapshots.snapshots();
+		REQUIRE(all.size() == 2);
+		CHECK(all.back() == snapshots.latest());
+		CHECK(countPatches((tmp.path() / "patches-snapshots" / all.front()).string()) == 22);
+		CHECK(countPatches((tmp.path() / "patches-snapshots" / all.back()).string()) == 23);
+	}
+}
+
+TEST_CASE("a snapshot identical to an older one shares its file") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	std::string first, second;
+	{
+		SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+		createTables(writer);
+		insertPatches(writer, 0, 20);
+		DatabaseSnapshots snapshots(file);
+		first = snapshots.snapshotNow("test");
+		insertPatches(writer, 20, 5);
+		second = snapshots.snapshotNow("test");
+		REQUIRE_FALSE(first.empty());
+		REQUIRE(second != first);
+	}
+	// The first snapshot restored
+	std::filesystem::copy_file(first, file, std::filesystem::copy_options::overwrite_existing);
+	DatabaseSnapshots snapshots(file);
+	CHECK(snapshots.snapshotNow("test") == first);
+	CHECK(snapshots.snapshots().size() == 2);
+	CHECK(snapshots.latest() == std::filesystem::path(first).filename().string());
+	CHECK(snapshots.upToDate());
+}
+
+TEST_CASE("a snapshot in WAL mode doesn't wait for a writer and has the state before its transaction") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+	createTables(writer);
+	insertPatches(writer, 0, 100);
+	REQUIRE(ReadConnectionPool::enableWriteAheadLog(writer));
+
+	DatabaseSnapshots snapshots(file);
+	writer.exec("BEGIN");
+	insertPatches(writer, 100, 50);
+	auto snapshot = snapshots.snapshotNow("test");
+	REQUIRE_FALSE(snapshot.empty());
+	writer.exec("COMMIT");
+	CHECK(countPatches(snapshot) == 100);
+	CHECK_FALSE(snapshots.upToDate());
+
+	// The snapshot is a single file, no WAL next to it
+	SQLite::Database copy(snapshot, SQLite::OPEN_READONLY);
+	SQLite::Statement mode(copy, "PRAGMA journal_mode");
+	REQUIRE(mode.executeStep());
+	CHECK(mode.getColumn(0).getString() == "delete");
+}
+
+TEST_CASE("background snapshots run on request") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	{
+		SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(writer);
+		insertPatches(writer, 0, 10);
+	}
+	DatabaseSnapshots snapshots(file);
+	snapshots.request("requested");
+	for (int i = 0; i < 500 && snapshots.latest().empty(); i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	REQUIRE_FALSE(snapshots.latest().empty());
+	CHECK(snapshots.latest().find("-requested.db3") != std::string::npos);
+	CHECK(snapshots.upToDate());
+}
+
+TEST_CASE("a changed database is snapshotted in the background once it is quiet") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+	createTables(writer);
+	insertPatches(writer, 0, 10);
+
+	DatabaseSnapshots snapshots(file, 5, 50);
+	for (int i = 0; i < 500 && !snapshots.upToDate(); i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	REQUIRE(snapshots.upToDate());
+	CHECK(snapshots.latest().find("-changed.db3") != std::string::npos);
+	CHECK(countPatches((tmp.path() / "patches-snapshots" / snapshots.latest()).string()) == 10);
+
+	insertPatches(writer, 10, 5);
+	CHECK_FALSE(snapshots.upToDate());
+	for (int i = 0; i < 500 && !snapshots.upToDate(); i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	REQUIRE(snapshots.upToDate());
+	CHECK(countPatches((tmp.path() / "patches-snapshots" / snapshots.latest()).string()) == 15);
+	CHECK(snapshots.snapshots().size() == 2);
+}
+
+TEST_CASE("a new session on an unchanged database is up to date without copying") {
+	auto tmp = makeTempDirectory();
+	auto file = (tmp.path() / "patches.db3").string();
+	SQLite::Database writer(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+	createTables(writer);
+	insertPatches(writer, 0, 10);
+	{
+		DatabaseSnapshots snapshots(file);
+		REQUIRE_FALSE(snapshots.snapshotNow("test").empty());
+	}
+	DatabaseSnapshots snapshots(file);
+	CHECK(snapshots.upToDate());
+	CHECK(snapshots.snapshots().size() == 1);
+
+	insertPatches(writer, 10, 1);
+	CHECK_FALSE(snapshots.upToDate());
+}
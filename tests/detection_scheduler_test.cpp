@@ -0,0 +1,295 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "The-Orm/DetectionScheduler.h"
+
+#include "virtual_midi_device.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kReplyTimeoutMs = 20;
+
+// Made up device inquiry: F0 7D <model> 01 [channel] F7, answered with F0 7D <model> 02 <channel> F7
+std::vector<uint8> probeBytes(uint8 model, int channel) {
+	if (channel < 0) {
+		return { 0xf0, 0x7d, model, 0x01, 0xf7 };
+	}
+	return { 0xf0, 0x7d, model, 0x01, (uint8)channel, 0xf7 };
+}
+
+MidiMessage reply(uint8 model, int channel) {
+	uint8 body[] = { 0x7d, model, 0x02, (uint8)channel };
+	return MidiMessage::createSysExMessage(body, (int)sizeof(body));
+}
+
+// probedAs is the model whose inquiry the synth answers, for synths sharing one, -1 for its own
+DetectionScheduler::Candidate candidate(std::string const& name, uint8 model, bool channelSpecific, int probedAs = -1) {
+	uint8 probeModel = probedAs < 0 ? model : (uint8)probedAs;
+	DetectionScheduler::Candidate result;
+	result.name = name;
+	result.channelSpecific = channelSpecific;
+	result.replyTimeoutMs = kReplyTimeoutMs;
+	result.probe = [probeModel](int channel) {
+		auto bytes = probeBytes(probeModel, channel);
+		return std::vector<MidiMessage>({ MidiMessage(bytes.data(), (int)bytes.size()) });
+	};
+	result.identify = [model](MidiMessage const& message) {
+		auto data = message.getSysExData();
+		if (message.isSysEx() && message.getSysExDataSize() == 4 && data[0] == 0x7d && data[1] == model && data[2] == 0x02) {
+			return MidiChannel::fromZeroBase(data[3]);
+		}
+		return MidiChannel::invalidChannel();
+	};
+	return result;
+}
+
+// Device inquiry F0 7E <device> 06 01 F7, answered with F0 7E 00 06 02 <model> F7
+std::vector<uint8> identityRequest(uint8 device) {
+	return { 0xf0, 0x7e, device, 0x06, 0x01, 0xf7 };
+}
+
+MidiMessage identityReply(uint8 model) {
+	uint8 body[] = { 0x7e, 0x00, 0x06, 0x02, model };
+	return MidiMessage::createSysExMessage(body, (int)sizeof(body));
+}
+
+DetectionScheduler::Candidate identityCandidate(std::string const& name, uint8 model, uint8 device) {
+	DetectionScheduler::Candidate result;
+	result.name = name;
+	result.channelSpecific = false;
+	result.replyTimeoutMs = kReplyTimeoutMs;
+	result.probe = [device](int) {
+		auto bytes = identityRequest(device);
+		return std::vector<MidiMessage>({ MidiMessage(bytes.data(), (int)bytes.size()) });
+	};
+	result.identify = [model](MidiMessage const& message) {
+		auto data = message.getSysExData();
+		if (message.isSysEx() && message.getSysExDataSize() == 5 && data[0] == 0x7e && data[2] == 0x06 && data[3] == 0x02 && data[4] == model) {
+			return MidiChannel::fromZeroBase(0);
+		}
+		return MidiChannel::invalidChannel();
+	};
+	return result;
+}
+
+// A studio of simulated synths. Each synth listens on one or more outputs and replies on its own input, so a synth behind a
+// MIDI merger can be reached through several outputs
+class SimulatedStudio : public DetectionScheduler::Transport {
+public:
+	explicit SimulatedStudio(int ports) {
+		for (int i = 1; i <= ports; i++) {
+			juce::MidiDeviceInfo input("In " + String(i), "in" + String(i));
+			juce::MidiDeviceInfo output("Out " + String(i), "out" + String(i));
+			inputs_.push_back(input);
+			outputs_.push_back(output);
+		}
+	}
+
+	~SimulatedStudio() override {
+		stopListening();
+		wiring_.clear();
+		synths_.clear();
+	}
+
+	void addSynth(uint8 model, int channel, bool channelSpecific, std::vector<int> outputPorts, int inputPort, int latencyMs = 2, int probedAs = -1) {
+		addSynth({ probeBytes(probedAs < 0 ? model : (uint8)probedAs, channelSpecific ? channel : -1) }, reply(model, channel), outputPorts, inputPort, latencyMs);
+	}
+
+	// A synth giving the same answer to each of the probes
+	void addSynth(std::vector<std::vector<uint8>> const& probes, MidiMessage const& answer, std::vector<int> outputPorts, int inputPort, int latencyMs = 2) {
+		test_helpers::VirtualMidiScript script;
+		for (auto const& probe : probes) {
+			script.expect(probe, { answer });
+		}
+		auto input = inputs_[(size_t)inputPort - 1];
+		auto synth = std::make_shared<test_helpers::VirtualMidiDevice>(std::move(script), test_helpers::VirtualMidiDevice::Timing{ latencyMs, 0 },
+			[this, input](MidiMessage const& message) {
+				std::lock_guard<std::mutex> guard(lock_);
+				if (handler_) {
+					handler_(input, message);
+				}
+			});
+		for (int port : outputPorts) {
+			wiring_[outputs_[(size_t)port - 1].identifier].push_back(synth);
+		}
+		synths_.push_back(synth);
+	}
+
+	std::vector<juce::MidiDeviceInfo> outputs() override {
+		return outputs_;
+	}
+
+	void send(juce::MidiDeviceInfo const& output, std::vector<MidiMessage> const& messages) override {
+		sent_++;
+		for (auto const& synth : wiring_[output.identifier]) {
+			for (auto const& message : messages) {
+				synth->receive(message);
+			}
+		}
+	}
+
+	void startListening(TReplyHandler handler) override {
+		std::lock_guard<std::mutex> guard(lock_);
+		handler_ = handler;
+	}
+
+	void stopListening() override {
+		std::lock_guard<std::mutex> guard(lock_);
+		handler_ = nullptr;
+	}
+
+	int sent() const { return sent_; }
+
+private:
+	std::vector<juce::MidiDeviceInfo> inputs_;
+	std::vector<juce::MidiDeviceInfo> outputs_;
+	std::vector<std::shared_ptr<test_helpers::VirtualMidiDevice>> synths_;
+	std::map<String, std::vector<std::shared_ptr<test_helpers::VirtualMidiDevice>>> wiring_;
+	std::mutex lock_;
+	TReplyHandler handler_;
+	int sent_ = 0;
+};
+
+void checkSame(std::vector<DetectionScheduler::Detection> const& concurrent, std::vector<DetectionScheduler::Detection> const& sequential) {
+	REQUIRE(concurrent.size() == sequential.size());
+	for (size_t i = 0; i < concurrent.size(); i++) {
+		CAPTURE(i);
+		CHECK(concurrent[i].found == sequential[i].found);
+		CHECK(concurrent[i].input.identifier == sequential[i].input.identifier);
+		CHECK(concurrent[i].output.identifier == sequential[i].output.identifier);
+		CHECK(concurrent[i].channel.toZeroBasedInt() == sequential[i].channel.toZeroBasedInt());
+	}
+}
+
+} // namespace
+
+TEST_CASE("concurrent detection finds the same synths as sequential detection") {
+	auto studio = std::make_shared<SimulatedStudio>(4);
+	studio->addSynth(0x10, 0, false, { 2 }, 2);
+	studio->addSynth(0x11, 3, false, { 4 }, 3);
+	studio->addSynth(0x12, 9, true, { 3 }, 4);
+	studio->addSynth(0x13, 1, false, { 3, 4 }, 1); // Behind a merger, sequential detection finds it on the first output
+	std::vector<DetectionScheduler::Candidate> candidates = {
+		candidate("Mono", 0x10, false),
+		candidate("Poly", 0x11, false),
+		candidate("Channel specific", 0x12, true),
+		candidate("Merged", 0x13, false),
+		candidate("Not connected", 0x14, false),
+	};
+
+	DetectionScheduler scheduler(studio);
+	double start = Time::getMillisecondCounterHiRes();
+	auto sequential = scheduler.detectSequentially(candidates, nullptr);
+	double sequentialMs = Time::getMillisecondCounterHiRes() - start;
+	start = Time::getMillisecondCounterHiRes();
+	auto concurrent = scheduler.detect(candidates, nullptr);
+	double concurrentMs = Time::getMillisecondCounterHiRes() - start;
+
+	checkSame(concurrent, sequential);
+	CHECK(concurrent[0].found);
+	CHECK(concurrent[0].output.name == "Out 2");
+	CHECK(concurrent[1].input.name == "In 3");
+	CHECK(concurrent[1].channel.toZeroBasedInt() == 3);
+	CHECK(concurrent[2].channel.toZeroBasedInt() == 9);
+	CHECK(concurrent[2].output.name == "Out 3");
+	CHECK(concurrent[3].output.name == "Out 3");
+	CHECK(concurrent[3].input.name == "In 1");
+	CHECK_FALSE(concurrent[4].found);
+
+	// One round to find everybody plus two rounds of bisecting four outputs, versus one timeout per probe
+	CHECK(concurrentMs < 10 * kReplyTimeoutMs);
+	CHECK(concurrentMs * 5 < sequentialMs);
+}
+
+TEST_CASE("concurrent detection without any outputs finds nothing") {
+	auto studio = std::make_shared<SimulatedStudio>(0);
+	DetectionScheduler scheduler(studio);
+	auto detections = scheduler.detect({ candidate("Mono", 0x10, false) }, nullptr);
+	REQUIRE(detections.size() == 1);
+	CHECK_FALSE(detections[0].found);
+	CHECK(studio->sent() == 0);
+}
+
+TEST_CASE("synths sharing their probe are bisected in separate rounds") {
+	auto studio = std::make_shared<SimulatedStudio>(4);
+	// Both answer the same inquiry. Bisected together, the probe for the first on output 3 would make the second answer as well
+	studio->addSynth(0x21, 0, false, { 3 }, 1, 2, 0x20);
+	studio->addSynth(0x22, 0, false, { 2, 3 }, 2, 2, 0x20);
+	std::vector<DetectionScheduler::Candidate> candidates = {
+		candidate("First", 0x21, false, 0x20),
+		candidate("Second", 0x22, false, 0x20),
+	};
+
+	DetectionScheduler scheduler(studio);
+	auto sequential = scheduler.detectSequentially(candidates, nullptr);
+	auto concurrent = scheduler.detect(candidates, nullptr);
+
+	checkSame(concurrent, sequential);
+	CHECK(concurrent[0].output.name == "Out 3");
+	CHECK(concurrent[1].output.name == "Out 2");
+	CHECK(concurrent[1].input.name == "In 2");
+}
+
+TEST_CASE("a universal device inquiry is bisected apart from synths probed by their device ID") {
+	auto studio = std::make_shared<SimulatedStudio>(4);
+	// The first synth is probed with the inquiry to all devices, which the second answers as well as its own inquiry
+	studio->addSynth({ identityRequest(0x7f) }, identityReply(0x51), { 3 }, 1);
+	studio->addSynth({ identityRequest(0x7f), identityRequest(0x00) }, identityReply(0x52), { 2, 3 }, 2);
+	std::vector<DetectionScheduler::Candidate> candidates = {
+		identityCandidate("Universal", 0x51, 0x7f),
+		identityCandidate("Device ID", 0x52, 0x00),
+	};
+
+	DetectionScheduler scheduler(studio);
+	auto sequential = scheduler.detectSequentially(candidates, nullptr);
+	auto concurrent = scheduler.detect(candidates, nullptr);
+
+	checkSame(concurrent, sequential);
+	CHECK(concurrent[0].output.name == "Out 3");
+	CHECK(concurrent[1].output.name == "Out 2");
+	CHECK(concurrent[1].input.name == "In 2");
+}
+
+TEST_CASE("bisection only counts replies on the input the synth was found on") {
+	auto studio = std::make_shared<SimulatedStudio>(4);
+	// Two synths of the same kind, the one on the first output replies later and is not the one found in the first round
+	studio->addSynth(0x30, 0, false, { 3 }, 1);
+	studio->addSynth(0x30, 0, false, { 1 }, 2, 10);
+
+	DetectionScheduler scheduler(studio);
+	auto detections = scheduler.detect({ candidate("Twin", 0x30, false) }, nullptr);
+	REQUIRE(detections.size() == 1);
+	CHECK(detections[0].found);
+	CHECK(detections[0].input.name == "In 1");
+	CHECK(detections[0].output.name == "Out 3");
+}
+
+TEST_CASE("a reply is timed when it arrives, not when the round is over") {
+	auto studio = std::make_shared<SimulatedStudio>(2);
+	studio->addSynth(0x40, 0, false, { 1 }, 2);
+	auto slow = candidate("Slow to time out", 0x40, false);
+	slow.replyTimeoutMs = 200;
+	std::vector<double> latencies;
+	slow.replied = [&latencies](double sentMs, double receivedMs) { latencies.push_back(receivedMs - sentMs); };
+
+	DetectionScheduler scheduler(studio);
+	auto detections = scheduler.detect({ slow }, nullptr);
+	REQUIRE(detections[0].found);
+	// The first round, and the one bisection round that probes the first output
+	REQUIRE(latencies.size() == 2);
+	for (double latency : latencies) {
+		CHECK(latency >= 0.0);
+		CHECK(latency < 100.0);
+	}
+}
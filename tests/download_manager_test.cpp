@@ -0,0 +1,210 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "The-Orm/DownloadManager.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kTransferMs = 40;
+const int kProcessMs = 30;
+
+// What happened when, to check which stages overlapped
+class Timeline {
+public:
+	struct Span {
+		std::string what;
+		double startMs;
+		double endMs;
+	};
+
+	void record(std::string const& what, double startMs) {
+		std::lock_guard<std::mutex> guard(lock_);
+		spans_.push_back({ what, startMs, Time::getMillisecondCounterHiRes() });
+	}
+
+	Span find(std::string const& what) const {
+		std::lock_guard<std::mutex> guard(lock_);
+		for (auto const& span : spans_) {
+			if (span.what == what) {
+				return span;
+			}
+		}
+		FAIL("No span " << what);
+		return {};
+	}
+
+	static bool overlap(Span const& a, Span const& b) {
+		return a.startMs < b.endMs && b.startMs < a.endMs;
+	}
+
+private:
+	mutable std::mutex lock_;
+	std::vector<Span> spans_;
+};
+
+std::vector<MidiBankNumber> banks(int count) {
+	std::vector<MidiBankNumber> result;
+	for (int i = 0; i < count; i++) {
+		result.push_back(MidiBankNumber::fromZeroBase(i, 128));
+	}
+	return result;
+}
+
+// A simulated synth that takes kTransferMs to send a bank, replying from its own thread like the MIDI input would
+DownloadManager::Download simulatedDownload(std::string const& synth, std::string const& port, int bankCount, Timeline& timeline,
+	std::vector<std::thread>& threads, std::mutex& threadsLock, std::atomic<bool>* finishedCancelled = nullptr) {
+	DownloadManager::Download download;
+	download.synthName = synth;
+	download.port = port;
+	download.banks = banks(bankCount);
+	download.transfer = [synth, &timeline, &threads, &threadsLock](MidiBankNumber bank, midikraft::ProgressHandler* progress, DownloadManager::TBankDone done) {
+		std::lock_guard<std::mutex> guard(threadsLock);
+		threads.emplace_back([synth, bank, progress, done, &timeline]() {
+			double start = Time::getMillisecondCounterHiRes();
+			for (int i = 0; i < 4; i++) {
+				if (progress->shouldAbort()) {
+					return;
+				}
+				Thread::sleep(kTransferMs / 4);
+				progress->setProgressPercentage((i + 1) / 4.0);
+			}
+			timeline.record(synth + " transfer " + std::to_string(bank.toZeroBased()), start);
+			done({});
+		});
+	};
+	download.process = [synth, &timeline](MidiBankNumber bank, std::vector<midikraft::PatchHolder>) {
+		double start = Time::getMillisecondCounterHiRes();
+		Thread::sleep(kProcessMs);
+		timeline.record(synth + " process " + std::to_string(bank.toZeroBased()), start);
+	};
+	download.finished = [finishedCancelled](bool cancelled) {
+		if (finishedCancelled) {
+			*finishedCancelled = cancelled;
+		}
+	};
+	return download;
+}
+
+void joinAll(std::vector<std::thread>& threads, std::mutex& threadsLock) {
+	std::lock_guard<std::mutex> guard(threadsLock);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+} // namespace
+
+TEST_CASE("processing a bank overlaps with transferring the next one") {
+	Timeline timeline;
+	std::vector<std::thread> threads;
+	std::mutex threadsLock;
+	{
+		DownloadManager manager;
+		manager.start(simulatedDownload("OB-6", "port1", 3, timeline, threads, threadsLock));
+		REQUIRE(manager.waitUntilIdle(5000));
+		auto status = manager.status();
+		REQUIRE(status.size() == 1);
+		CHECK(status[0].state == DownloadManager::State::Finished);
+		CHECK(status[0].banksTransferred == 3);
+		CHECK(status[0].banksProcessed == 3);
+	}
+	joinAll(threads, threadsLock);
+	CHECK(Timeline::overlap(timeline.find("OB-6 process 0"), timeline.find("OB-6 transfer 1")));
+	CHECK(Timeline::overlap(timeline.find("OB-6 process 1"), timeline.find("OB-6 transfer 2")));
+	// Banks are still requested strictly one after the other
+	CHECK(timeline.find("OB-6 transfer 0").endMs <= timeline.find("OB-6 transfer 1").startMs);
+}
+
+TEST_CASE("synths on different ports download at the same time, synths on the same port queue up") {
+	Timeline timeline;
+	std::vector<std::thread> threads;
+	std::mutex threadsLock;
+	{
+		DownloadManager manager;
+		manager.start(simulatedDownload("OB-6", "port1", 2, timeline, threads, threadsLock));
+		manager.start(simulatedDownload("Rev2", "port2", 2, timeline, threads, threadsLock));
+		manager.start(simulatedDownload("Matrix", "port1", 2, timeline, threads, threadsLock));
+		auto status = manager.status();
+		REQUIRE(status.size() == 3);
+		CHECK(status[0].state == DownloadManager::State::Running);
+		CHECK(status[1].state == DownloadManager::State::Running);
+		CHECK(status[2].state == DownloadManager::State::Queued);
+		REQUIRE(manager.waitUntilIdle(5000));
+		for (auto const& download : manager.status()) {
+			CHECK(download.state == DownloadManager::State::Finished);
+		}
+	}
+	joinAll(threads, threadsLock);
+	CHECK(Timeline::overlap(timeline.find("OB-6 transfer 0"), timeline.find("Rev2 transfer 0")));
+	// The queued synth starts as soon as the port is free, while the last bank of the first one is still being processed
+	CHECK(timeline.find("OB-6 transfer 1").endMs <= timeline.find("Matrix transfer 0").startMs);
+	CHECK(timeline.find("Matrix transfer 0").startMs < timeline.find("OB-6 process 1").endMs);
+}
+
+TEST_CASE("cancelling a download stops requesting banks and frees the port") {
+	Timeline timeline;
+	std::vector<std::thread> threads;
+	std::mutex threadsLock;
+	std::atomic<bool> firstCancelled{ false };
+	std::atomic<bool> secondCancelled{ true };
+	{
+		DownloadManager manager;
+		int first = manager.start(simulatedDownload("OB-6", "port1", 10, timeline, threads, threadsLock, &firstCancelled));
+		manager.start(simulatedDownload("Matrix", "port1", 1, timeline, threads, threadsLock, &secondCancelled));
+		Thread::sleep(kTransferMs + kTransferMs / 2);
+		manager.cancel(first);
+		REQUIRE(manager.waitUntilIdle(5000));
+		auto status = manager.status();
+		REQUIRE(status.size() == 2);
+		CHECK(status[0].state == DownloadManager::State::Cancelled);
+		CHECK(status[0].banksTransferred < 10);
+		CHECK(status[1].state == DownloadManager::State::Finished);
+		manager.clearDone();
+		CHECK(manager.status().empty());
+	}
+	joinAll(threads, threadsLock);
+	CHECK(firstCancelled);
+	CHECK_FALSE(secondCancelled);
+}
+
+TEST_CASE("a synth replying after the manager is gone finds nothing to call") {
+	DownloadManager::TBankDone lateDone;
+	midikraft::ProgressHandler* lateProgress = nullptr;
+	std::atomic<int> processed{ 0 };
+	auto manager = std::make_unique<DownloadManager>();
+	{
+		DownloadManager::Download download;
+		download.synthName = "OB-6";
+		download.port = "port1";
+		download.banks = banks(2);
+		download.transfer = [&](MidiBankNumber, midikraft::ProgressHandler* progress, DownloadManager::TBankDone done) {
+			// The reply is still on its way when the manager goes
+			lateDone = done;
+			lateProgress = progress;
+		};
+		download.process = [&](MidiBankNumber, std::vector<midikraft::PatchHolder>) {
+			processed++;
+		};
+		manager->start(download);
+		REQUIRE(lateDone);
+	}
+	manager.reset();
+	REQUIRE(lateProgress);
+	CHECK(lateProgress->shouldAbort());
+	lateProgress->setProgressPercentage(0.5);
+	lateProgress->setMessage("Still here");
+	lateDone({});
+	CHECK(processed == 0);
+}
@@ -0,0 +1,155 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "The-Orm/OrmSchema.h"
+#include "The-Orm/PatchPager.h"
+#include "The-Orm/PatchQuery.h"
+#include "The-Orm/SearchQueryScheduler.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL)");
+	db.exec("CREATE TABLE lists(id TEXT PRIMARY KEY, name TEXT NOT NULL, synth TEXT, midi_bank_number INTEGER, last_synced INTEGER, list_type INTEGER)");
+	db.exec("CREATE TABLE categories (bitIndex INTEGER UNIQUE, name TEXT, color TEXT, active INTEGER, sort_order INTEGER)");
+}
+
+void insertPatch(SQLite::Database& db, std::string const& synth, std::string const& md5, std::string const& name, int bank, int program) {
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, favorite, hidden, midiBankNo, midiProgramNo, categories) VALUES (:SYN, :MD5, :NAM, 0, 0, :BNK, :PRG, 0)");
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":NAM", name);
+	insert.bind(":BNK", bank);
+	insert.bind(":PRG", program);
+	insert.exec();
+}
+
+// The keys the duplicate names filter of the synths pages through, in its order
+std::vector<std::string> duplicates(SQLite::Database& db, std::vector<std::shared_ptr<midikraft::Synth>> const& synths, midikraft::PatchOrdering orderBy) {
+	auto filter = midikraft::PatchFilter(synths);
+	filter.onlyDuplicateNames = true;
+	filter.orderBy = orderBy;
+	auto query = PatchQuery::from(filter);
+	REQUIRE(query);
+	std::vector<std::string> result;
+	for (auto const& key : query->keys(db, {}, 100)) {
+		result.push_back(key.synth + "/" + key.md5);
+	}
+	CHECK(query->count(db) == static_cast<int>(result.size()));
+	return result;
+}
+
+using Listed = std::vector<std::string>;
+
+} // namespace
+
+TEST_CASE("duplicate name join holds the patches sharing a name within their synth, in filter order") {
+	auto tmp = test_helpers::makeTempDatabasePath("duplicate_name_filter");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", "Pad", 1, 3);
+	insertPatch(db, "OB-6", "b", "Bass", 0, 7);
+	insertPatch(db, "OB-6", "c", "Pad", 0, 2);
+	insertPatch(db, "OB-6", "d", "Bass", 1, 0);
+	insertPatch(db, "OB-6", "e", "Lead", 0, 0);
+	// Same name on another synth is not a duplicate
+	insertPatch(db, "Rev2", "a", "Lead", 0, 1);
+	insertPatch(db, "Rev2", "b", "Keys", 0, 2);
+	insertPatch(db, "Rev2", "c", "Keys", 0, 3);
+	OrmSchema::migrate(db);
+
+	std::shared_ptr<midikraft::Synth> ob6 = std::make_shared<test_helpers::DummySynth>("OB-6");
+	std::shared_ptr<midikraft::Synth> rev2 = std::make_shared<test_helpers::DummySynth>("Rev2");
+	CHECK(duplicates(db, { ob6 }, midikraft::PatchOrdering::Order_by_Name) == Listed({ "OB-6/b", "OB-6/d", "OB-6/c", "OB-6/a" }));
+	CHECK(duplicates(db, { ob6, rev2 }, midikraft::PatchOrdering::Order_by_ProgramNo) == Listed({ "Rev2/b", "OB-6/c", "Rev2/c", "OB-6/b", "OB-6/d", "OB-6/a" }));
+
+	// Follows renames and deletes, which the counters pick up in the same transaction. Nothing to rewrite
+	db.exec("UPDATE patches SET name = 'Lead' WHERE synth = 'OB-6' AND md5 = 'a'");
+	CHECK(duplicates(db, { ob6 }, midikraft::PatchOrdering::Order_by_Name) == Listed({ "OB-6/b", "OB-6/d", "OB-6/e", "OB-6/a" }));
+	db.exec("DELETE FROM patches WHERE synth = 'OB-6' AND md5 = 'd'");
+	CHECK(duplicates(db, { ob6 }, midikraft::PatchOrdering::Order_by_Name) == Listed({ "OB-6/e", "OB-6/a" }));
+
+	db.exec("DELETE FROM patches WHERE synth = 'OB-6' AND md5 = 'e'");
+	CHECK(duplicates(db, { ob6 }, midikraft::PatchOrdering::Order_by_Name).empty());
+	// Only read, there is no result list
+	SQLite::Statement entries(db, "SELECT count(*) FROM patch_in_list");
+	REQUIRE(entries.executeStep());
+	CHECK(entries.getColumn(0).getInt() == 0);
+}
+
+TEST_CASE("duplicate name join gives the same patches as the grouping query") {
+	auto tmp = test_helpers::makeTempDatabasePath("duplicate_name_filter");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synthA = std::make_shared<test_helpers::DummySynth>("DupFilterSynthA", 8, 2);
+	auto synthB = std::make_shared<test_helpers::DummySynth>("DupFilterSynthB", 8, 1);
+	std::vector<std::string> names = { "Pad", "Bass", "Pad", "Solo", "Bass", "Keys" };
+	for (int i = 0; i < 18; ++i) {
+		auto patch = test_helpers::makePatchHolder(i % 3 == 0 ? synthB : synthA, names[i % names.size()] + (i > 11 ? " 2" : ""), { (uint8)i });
+		patch.setHidden(i % 4 == 1);
+		patch.setFavorite(midikraft::Favorite(i % 5 == 2));
+		db.putPatch(patch);
+	}
+
+	{
+		SQLite::Database schema(tmp.path().string(), SQLite::OPEN_READWRITE);
+		OrmSchema::migrate(schema);
+	}
+	PatchPager pager(db);
+	SearchQueryScheduler searches;
+	std::vector<std::shared_ptr<midikraft::Synth>> synths = { synthA, synthB };
+	for (auto orderBy : { midikraft::PatchOrdering::Order_by_Name, midikraft::PatchOrdering::Order_by_ProgramNo }) {
+		for (int visibility = 0; visibility < 3; ++visibility) {
+			CAPTURE(static_cast<int>(orderBy));
+			CAPTURE(visibility);
+			auto filter = midikraft::PatchFilter(synths);
+			filter.onlyDuplicateNames = true;
+			filter.orderBy = orderBy;
+			if (visibility == 1) {
+				filter.turnOnAll();
+			}
+			else if (visibility == 2) {
+				// No translation, the pager falls back to the grouping query
+				filter.onlyFaves = true;
+			}
+			CHECK(PatchQuery::from(filter).has_value() == (visibility != 2));
+
+			searches.cancelAll();
+			auto token = searches.current();
+			auto expected = db.getPatches(filter, 0, -1);
+			auto result = pager.page(filter, token, 0, 100);
+			// Ties may be broken differently, so compare the patches and the order of the sort key
+			std::multiset<std::string> expectedMd5s, resultMd5s;
+			for (auto const& patch : expected) expectedMd5s.insert(patch.synth()->getName() + "/" + patch.md5());
+			for (auto const& patch : result) resultMd5s.insert(patch.synth()->getName() + "/" + patch.md5());
+			CHECK(resultMd5s == expectedMd5s);
+			if (orderBy == midikraft::PatchOrdering::Order_by_Name) {
+				for (size_t i = 1; i < result.size(); ++i) {
+					CHECK(result[i - 1].name() <= result[i].name());
+				}
+			}
+			CHECK(pager.count(filter, token) == db.getPatchesCount(filter));
+		}
+	}
+
+	// Import order keeps the grouping query, a list is joined as well
+	auto byImport = midikraft::PatchFilter(synths);
+	byImport.onlyDuplicateNames = true;
+	byImport.orderBy = midikraft::PatchOrdering::Order_by_Import_id;
+	CHECK_FALSE(PatchQuery::from(byImport));
+	auto inList = midikraft::PatchFilter(synths);
+	inList.onlyDuplicateNames = true;
+	inList.orderBy = midikraft::PatchOrdering::Order_by_Place_in_List;
+	inList.listID = "some-list";
+	CHECK(PatchQuery::from(inList));
+}
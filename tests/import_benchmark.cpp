@@ -0,0 +1,136 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+// Runs complete "import bank from synth" flows through MidiController and Librarian against simulated synths, which replay the
+// recorded sysex files from adaptations/testData over virtual MIDI ports with realistic latency and DIN bandwidth.
+// Usage: import_benchmark [latencyMs] [bytesPerSecond]
+
+#include "virtual_midi_device.h"
+
+#include "MidiController.h"
+#include "Librarian.h"
+#include "Capability.h"
+#include "SynthBank.h"
+#include "OB6.h"
+#include "GenericAdaptation.h"
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ImportCase {
+	std::string title;
+	std::function<std::shared_ptr<midikraft::Synth>()> createSynth;
+	std::string syxFile;
+	test_helpers::VirtualMidiScript::Replay replay;
+};
+
+File testDataDirectory() {
+	return File(KNOBKRAFT_SOURCE_DIR).getChildFile("adaptations").getChildFile("testData");
+}
+
+std::shared_ptr<midikraft::Synth> loadAdaptation(std::string const& fileName) {
+	auto path = File(KNOBKRAFT_SOURCE_DIR).getChildFile("adaptations").getChildFile(fileName);
+	return std::make_shared<knobkraft::GenericAdaptation>(path.getFullPathName().toStdString());
+}
+
+bool runImport(ImportCase const& importCase, test_helpers::VirtualMidiDevice::Timing timing) {
+	auto synth = importCase.createSynth();
+	auto device = std::dynamic_pointer_cast<midikraft::SimpleDiscoverableDevice>(synth);
+	auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+	if (!synth || !device || !location) {
+		std::printf("%-28s skipped, synth could not be created\n", importCase.title.c_str());
+		return false;
+	}
+
+	auto script = test_helpers::VirtualMidiScript::fromSyxFile(testDataDirectory().getChildFile(importCase.syxFile), importCase.replay);
+	test_helpers::VirtualMidiPort port("KnobKraft Virtual " + String(importCase.title), std::move(script), timing);
+	if (!port.isValid()) {
+		std::printf("%-28s skipped, could not create virtual MIDI ports\n", importCase.title.c_str());
+		return false;
+	}
+
+	auto controller = midikraft::MidiController::instance();
+	device->setOutput(controller->getMidiOutputByName(port.outputName().toStdString()));
+	device->setInput(controller->getMidiInputByName(port.inputName().toStdString()));
+	device->setChannel(MidiChannel::fromZeroBase(0));
+	controller->enableMidiInput(location->midiInput());
+
+	midikraft::Librarian librarian({});
+	std::atomic<bool> done(false);
+	size_t patchesLoaded = 0;
+	auto bank = MidiBankNumber::fromZeroBase(0, midikraft::SynthBank::numberOfPatchesInBank(synth, 0));
+	double start = Time::getMillisecondCounterHiRes();
+	librarian.startDownloadingAllPatches(controller->getMidiOutput(location->midiOutput()), synth, { bank }, nullptr,
+		[&done, &patchesLoaded](std::vector<midikraft::PatchHolder> patches) {
+			patchesLoaded = patches.size();
+			done = true;
+		});
+
+	// The Librarian uses the message thread for its timeouts, so keep the dispatch loop running while we wait
+	const double kTimeoutMs = 600000.0;
+	while (!done && Time::getMillisecondCounterHiRes() - start < kTimeoutMs) {
+		MessageManager::getInstance()->runDispatchLoopUntil(5);
+	}
+	double elapsed = Time::getMillisecondCounterHiRes() - start;
+	controller->disableMidiInput(location->midiInput());
+
+	if (!done || patchesLoaded == 0) {
+		std::printf("%-28s failed after %.0f ms, %d requests, %d replies, %d unmatched\n", importCase.title.c_str(), elapsed,
+			port.device().requestsReceived(), port.device().repliesSent(), (int)port.device().unmatchedRequests().size());
+		return false;
+	}
+	std::printf("%-28s %5d patches %10.1f ms total %8.2f ms/patch %6d requests\n", importCase.title.c_str(), (int)patchesLoaded, elapsed,
+		elapsed / patchesLoaded, port.device().requestsReceived());
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	ScopedJuceInitialiser_GUI juce;
+
+	test_helpers::VirtualMidiDevice::Timing timing;
+	if (argc > 1) timing.latencyMs = atoi(argv[1]);
+	if (argc > 2) timing.bytesPerSecond = atoi(argv[2]);
+
+	if (!test_helpers::VirtualMidiPort::isSupported()) {
+		std::printf("Virtual MIDI ports are not supported on this platform\n");
+		return 0;
+	}
+
+	using Replay = test_helpers::VirtualMidiScript::Replay;
+	std::vector<ImportCase> cases = {
+		{ "OB-6 (C++)", []() { return std::make_shared<midikraft::OB6>(); }, "Sequential_OB6/OB6_Programs_v1.01.syx", Replay::OneMessagePerRequest },
+	};
+
+	knobkraft::GenericAdaptation::startupGenericAdaptation();
+	if (knobkraft::GenericAdaptation::hasPython()) {
+		cases.push_back({ "Mopho (Python)", []() { return loadAdaptation("DSI_Mopho.py"); }, "Mopho_Programs_v1.0.syx", Replay::OneMessagePerRequest });
+		cases.push_back({ "Prophet 6 (Python)", []() { return loadAdaptation("Sequential Prophet 6.py"); }, "P6_Programs_v1.01.syx", Replay::OneMessagePerRequest });
+		cases.push_back({ "Prophet 08 (Python)", []() { return loadAdaptation("DSI Prophet 08.py"); }, "Prophet_08_Programs_v1.0.syx", Replay::OneMessagePerRequest });
+	}
+	else {
+		std::printf("No Python found, only benchmarking the C++ synths\n");
+	}
+
+	std::printf("Latency %d ms, bandwidth %d bytes/s\n", timing.latencyMs, timing.bytesPerSecond);
+	int failed = 0;
+	for (auto const& importCase : cases) {
+		if (!runImport(importCase, timing)) {
+			failed++;
+		}
+	}
+
+	midikraft::MidiController::shutdown();
+	knobkraft::GenericAdaptation::shutdownGenericAdaptation();
+	return failed == 0 ? 0 : 1;
+}
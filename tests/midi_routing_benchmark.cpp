@@ -0,0 +1,146 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+// Measures the per message cost of the MIDI thru path, comparing the precompiled MidiRoutingTable against
+// the previous implementation that compared port names, copied and re-channeled each message and scanned all macros.
+
+#include "The-Orm/MidiRoutingTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace {
+
+class CountingOutput : public MidiRoutingTable::Output {
+public:
+	void send(MidiMessage const& message) override {
+		checksum += message.getRawDataSize();
+	}
+
+	size_t checksum = 0;
+};
+
+struct Latency {
+	double median;
+	double p99;
+	double max;
+};
+
+Latency measure(std::vector<MidiMessage> const& messages, std::function<void(MidiMessage const&)> const& handler) {
+	std::vector<double> nanos;
+	nanos.reserve(messages.size());
+	for (auto const& message : messages) {
+		auto start = std::chrono::high_resolution_clock::now();
+		handler(message);
+		auto end = std::chrono::high_resolution_clock::now();
+		nanos.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+	std::sort(nanos.begin(), nanos.end());
+	return { nanos[nanos.size() / 2], nanos[nanos.size() * 99 / 100], nanos.back() };
+}
+
+void report(char const* name, Latency const& latency) {
+	std::printf("%-10s median %8.1f ns   p99 %8.1f ns   max %10.1f ns\n", name, latency.median, latency.p99, latency.max);
+}
+
+} // namespace
+
+int main() {
+	const int kMessages = 200000;
+	const int kMacros = 10;
+	String const keyboardName("Masterkeyboard");
+	int keyboardPort = 0;
+
+	std::vector<MidiMessage> messages;
+	messages.reserve(kMessages);
+	for (int i = 0; i < kMessages; i++) {
+		int note = 36 + (i / 2) % 48;
+		messages.push_back(i % 2 == 0 ? MidiMessage::noteOn(1, note, (uint8)100) : MidiMessage::noteOff(1, note));
+		if (i % 16 == 0) {
+			messages.push_back(MidiMessage::controllerEvent(1, 1, i % 128));
+		}
+	}
+
+	std::map<int, std::set<int>> macroNotes;
+	for (int m = 0; m < kMacros; m++) {
+		macroNotes[m] = { 24 + m, 26 + m };
+	}
+
+	// Legacy path: name compare per message, copy plus setChannel, full macro scan against the keyboard state
+	auto legacyOutput = std::make_shared<CountingOutput>();
+	MidiKeyboardState state;
+	auto legacy = [&](MidiMessage const& message) {
+		String inputName(keyboardName);
+		if (inputName != keyboardName) {
+			return;
+		}
+		MidiMessage copy(message);
+		if (copy.getChannel() != 0) {
+			copy.setChannel(3);
+		}
+		legacyOutput->send(copy);
+		state.processNextMidiEvent(message);
+		for (auto const& macro : macroNotes) {
+			bool active = true;
+			for (int n = 0; n < 128; n++) {
+				bool wanted = macro.second.find(n) != macro.second.end();
+				if (state.isNoteOnForChannels(0xffff, n) != wanted) {
+					active = false;
+					break;
+				}
+			}
+			if (active) {
+				legacyOutput->checksum++;
+			}
+		}
+	};
+
+	// Compiled path: pointer lookup, stack rebuilt message, bitset compare
+	auto compiledOutput = std::make_shared<CountingOutput>();
+	auto table = std::make_unique<MidiRoutingTable>();
+	int source = table->addSource(keyboardName);
+	table->addDestination(source, compiledOutput, 3);
+	for (auto const& macro : macroNotes) {
+		table->addMacro(macro.first, macro.second);
+	}
+	MidiRouter router;
+	router.publish(std::move(table));
+	std::bitset<128> held;
+	auto compiled = [&](MidiMessage const& message) {
+		MidiRouter::Snapshot routing(router);
+		auto route = routing->findSource(&keyboardPort, [&]() { return keyboardName; });
+		if (!route) {
+			return;
+		}
+		routing->forward(*route, message);
+		if (message.isNoteOn()) {
+			held.set((size_t)message.getNoteNumber());
+		}
+		else if (message.isNoteOff()) {
+			held.reset((size_t)message.getNoteNumber());
+		}
+		for (auto const& macro : routing->macros()) {
+			if (held == macro.notes) {
+				compiledOutput->checksum++;
+			}
+		}
+	};
+
+	// Warm up both paths once before measuring
+	measure(messages, legacy);
+	measure(messages, compiled);
+
+	std::printf("%d messages, %d macros\n", (int)messages.size(), kMacros);
+	report("legacy", measure(messages, legacy));
+	report("compiled", measure(messages, compiled));
+	std::printf("checksums %zu %zu\n", legacyOutput->checksum, compiledOutput->checksum);
+	return 0;
+}
@@ -0,0 +1,188 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "The-Orm/MidiRoutingTable.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+class RecordingOutput : public MidiRoutingTable::Output {
+public:
+	void send(MidiMessage const& message) override {
+		received.push_back(message);
+	}
+
+	std::vector<MidiMessage> received;
+};
+
+struct FakePort {
+	String name;
+	int lookups = 0;
+
+	MidiRoutingTable::Source const* find(MidiRoutingTable const& table) {
+		return table.findSource(this, [this]() { lookups++; return name; });
+	}
+};
+
+} // namespace
+
+TEST_CASE("routing table matches ports by name only once") {
+	MidiRoutingTable table;
+	table.addSource("Masterkeyboard");
+
+	FakePort keyboard{ "Masterkeyboard" };
+	FakePort other{ "Other Synth" };
+
+	for (int i = 0; i < 10; i++) {
+		CHECK(keyboard.find(table) != nullptr);
+		CHECK(other.find(table) == nullptr);
+	}
+	CHECK(keyboard.lookups == 1);
+	CHECK(other.lookups == 1);
+	CHECK(table.findSource(nullptr, []() { return String("Masterkeyboard"); }) == nullptr);
+}
+
+TEST_CASE("routing table re-channels channel messages and passes everything else") {
+	MidiRoutingTable table;
+	int source = table.addSource("Masterkeyboard");
+	auto output = std::make_shared<RecordingOutput>();
+	auto unchanged = std::make_shared<RecordingOutput>();
+	table.addDestination(source, output, 5);
+	table.addDestination(source, unchanged, 0);
+
+	FakePort keyboard{ "Masterkeyboard" };
+	auto route = keyboard.find(table);
+	REQUIRE(route);
+
+	uint8 sysexData[] = { 0x7e, 0x00, 0x06, 0x01 };
+	std::vector<MidiMessage> input = {
+		MidiMessage::noteOn(1, 60, (uint8)100),
+		MidiMessage::aftertouchChange(1, 60, 50),
+		MidiMessage::channelPressureChange(2, 70),
+		MidiMessage::pitchWheel(3, 9000),
+		MidiMessage::controllerEvent(1, 74, 12),
+		MidiMessage::createSysExMessage(sysexData, (int)sizeof(sysexData)),
+		MidiMessage::midiClock()
+	};
+	for (auto const& message : input) {
+		table.forward(*route, message);
+	}
+
+	REQUIRE(output->received.size() == input.size());
+	REQUIRE(unchanged->received.size() == input.size());
+	for (size_t i = 0; i < input.size(); i++) {
+		auto const& original = input[i];
+		auto const& forwarded = output->received[i];
+		CHECK(forwarded.getRawDataSize() == original.getRawDataSize());
+		if (original.getChannel() != 0) {
+			CHECK(forwarded.getChannel() == 5);
+			CHECK(std::memcmp(forwarded.getRawData() + 1, original.getRawData() + 1, (size_t)original.getRawDataSize() - 1) == 0);
+		}
+		else {
+			CHECK(std::memcmp(forwarded.getRawData(), original.getRawData(), (size_t)original.getRawDataSize()) == 0);
+		}
+		CHECK(std::memcmp(unchanged->received[i].getRawData(), original.getRawData(), (size_t)original.getRawDataSize()) == 0);
+	}
+}
+
+TEST_CASE("routing table maps and drops controllers") {
+	MidiRoutingTable table;
+	int source = table.addSource("Controller");
+	auto output = std::make_shared<RecordingOutput>();
+	int destination = table.addDestination(source, output, 0);
+	table.mapController(source, destination, 1, 74);
+	table.mapController(source, destination, 64, -1);
+
+	FakePort controller{ "Controller" };
+	auto route = controller.find(table);
+	REQUIRE(route);
+	table.forward(*route, MidiMessage::controllerEvent(3, 1, 100));
+	table.forward(*route, MidiMessage::controllerEvent(3, 64, 127));
+	table.forward(*route, MidiMessage::controllerEvent(3, 7, 90));
+
+	REQUIRE(output->received.size() == 2);
+	CHECK(output->received[0].isControllerOfType(74));
+	CHECK(output->received[0].getControllerValue() == 100);
+	CHECK(output->received[0].getChannel() == 3);
+	CHECK(output->received[1].isControllerOfType(7));
+}
+
+TEST_CASE("routing table compiles macros into note sets") {
+	MidiRoutingTable table;
+	table.addMacro(1, { 36, 38 });
+	table.addMacro(2, {});
+	table.addMacro(3, { 200 });
+	REQUIRE(table.macros().size() == 1);
+	std::bitset<128> held;
+	held.set(36);
+	CHECK(held != table.macros()[0].notes);
+	held.set(38);
+	CHECK(held == table.macros()[0].notes);
+}
+
+TEST_CASE("router swaps tables atomically") {
+	MidiRouter router;
+	{
+		MidiRouter::Snapshot empty(router);
+		CHECK_FALSE(empty);
+	}
+
+	auto first = std::make_unique<MidiRoutingTable>();
+	first->addSource("First");
+	router.publish(std::move(first));
+
+	FakePort port{ "First" };
+	{
+		MidiRouter::Snapshot pinned(router);
+		REQUIRE(pinned);
+		CHECK(port.find(*pinned.operator->()) != nullptr);
+
+		// Publishing while a reader holds the old table must keep it alive
+		auto second = std::make_unique<MidiRoutingTable>();
+		second->addSource("Second");
+		router.publish(std::move(second));
+		CHECK(port.find(*pinned.operator->()) != nullptr);
+	}
+
+	MidiRouter::Snapshot current(router);
+	REQUIRE(current);
+	FakePort secondPort{ "Second" };
+	CHECK(port.find(*current.operator->()) == nullptr);
+	CHECK(secondPort.find(*current.operator->()) != nullptr);
+}
+
+TEST_CASE("router knows when its table was compiled from state that changed since") {
+	MidiRouter router;
+	CHECK_FALSE(router.outdated());
+
+	String output = "Synth Port";
+	int channel = 3;
+	auto table = std::make_unique<MidiRoutingTable>();
+	table->addSource("Masterkeyboard");
+	table->dependOn([&output, &channel]() { return output + "/" + String(channel); });
+	router.publish(std::move(table));
+	CHECK_FALSE(router.outdated());
+
+	// The auto-detection found the synth on another channel
+	channel = 5;
+	CHECK(router.outdated());
+	channel = 3;
+	CHECK_FALSE(router.outdated());
+	output = "Other Port";
+	CHECK(router.outdated());
+
+	// Compiled again
+	auto rebuilt = std::make_unique<MidiRoutingTable>();
+	rebuilt->dependOn([&output, &channel]() { return output + "/" + String(channel); });
+	router.publish(std::move(rebuilt));
+	CHECK_FALSE(router.outdated());
+}
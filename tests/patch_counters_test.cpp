@@ -0,0 +1,328 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "PatchList.h"
+#include "The-Orm/OrmSchema.h"
+#include "The-Orm/PatchCounters.h"
+#include "The-Orm/PatchCountService.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL, FOREIGN KEY(synth, md5) REFERENCES patches(synth, md5))");
+	db.exec("CREATE TABLE lists(id TEXT PRIMARY KEY, name TEXT NOT NULL, synth TEXT, midi_bank_number INTEGER, last_synced INTEGER, list_type INTEGER)");
+	db.exec("CREATE TABLE categories (bitIndex INTEGER UNIQUE, name TEXT, color TEXT, active INTEGER, sort_order INTEGER)");
+}
+
+void insertPatch(SQLite::Database& db, std::string const& synth, std::string const& md5, int favorite, int hidden, long long categories) {
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, favorite, hidden, categories) VALUES (:SYN, :MD5, :NAM, :FAV, :HID, :CAT)");
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":NAM", "Patch " + md5);
+	insert.bind(":FAV", favorite);
+	insert.bind(":HID", hidden);
+	insert.bind(":CAT", categories);
+	insert.exec();
+}
+
+void insertEntry(SQLite::Database& db, std::string const& list, std::string const& synth, std::string const& md5, int orderNum) {
+	SQLite::Statement insert(db, "INSERT INTO patch_in_list (id, synth, md5, order_num) VALUES (:ID, :SYN, :MD5, :ORD)");
+	insert.bind(":ID", list);
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":ORD", orderNum);
+	insert.exec();
+}
+
+int scalar(SQLite::Database& db, std::string const& sql) {
+	SQLite::Statement query(db, sql);
+	REQUIRE(query.executeStep());
+	return query.getColumn(0).getInt();
+}
+
+// Compares all counters with what a full scan says
+void checkAgainstScan(PatchCounters& counters, SQLite::Database& db) {
+	for (std::string synth : { "OB-6", "Rev2" }) {
+		CAPTURE(synth);
+		auto counts = counters.synth(synth);
+		CHECK(counts.total == scalar(db, "SELECT count(*) FROM patches WHERE synth = '" + synth + "'"));
+		CHECK(counts.hidden == scalar(db, "SELECT count(*) FROM patches WHERE synth = '" + synth + "' AND hidden = 1"));
+		CHECK(counts.favorites == scalar(db, "SELECT count(*) FROM patches WHERE synth = '" + synth + "' AND favorite = 1 AND hidden = 0"));
+		for (int bit = 0; bit < 4; bit++) {
+			CAPTURE(bit);
+			CHECK(counters.category(synth, bit) == scalar(db, "SELECT count(*) FROM patches WHERE synth = '" + synth + "' AND hidden = 0 AND (categories >> " + std::to_string(bit) + ") & 1"));
+		}
+		std::string duplicate = "(SELECT count(*) FROM patches q WHERE q.synth = p.synth AND q.name = p.name) > 1";
+		auto duplicates = counters.duplicates(synth);
+		CHECK(duplicates.patches == scalar(db, "SELECT count(*) FROM patches p WHERE synth = '" + synth + "' AND " + duplicate));
+		CHECK(duplicates.visible == scalar(db, "SELECT count(*) FROM patches p WHERE synth = '" + synth + "' AND hidden = 0 AND " + duplicate));
+		for (std::string list : { "list-1", "list-2" }) {
+			CAPTURE(list);
+			auto listCounts = counters.list(list, synth);
+			CHECK(listCounts.entries == scalar(db, "SELECT count(*) FROM patch_in_list WHERE id = '" + list + "' AND synth = '" + synth + "'"));
+			CHECK(listCounts.visible == scalar(db, "SELECT count(*) FROM patch_in_list l JOIN patches p ON p.synth = l.synth AND p.md5 = l.md5 "
+				"WHERE l.id = '" + list + "' AND l.synth = '" + synth + "' AND p.hidden = 0"));
+		}
+	}
+}
+
+} // namespace
+
+TEST_CASE("patch counters are backfilled and follow writes from another connection") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_counters");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", 1, 0, 0b0011);
+	insertPatch(db, "OB-6", "b", 0, 1, 0b0001);
+	insertPatch(db, "Rev2", "a", 0, 0, 0b0100);
+	insertEntry(db, "list-1", "OB-6", "a", 0);
+	insertEntry(db, "list-1", "OB-6", "b", 1);
+	insertEntry(db, "list-1", "OB-6", "a", 2);
+
+	CHECK_THROWS(PatchCounters(tmp.path().string()));
+	CHECK(OrmSchema::migrate(db) == OrmSchema::kVersion);
+	PatchCounters counters(tmp.path().string());
+	CHECK(counters.synth("OB-6").total == 2);
+	CHECK(counters.list("list-1", "OB-6").visible == 2);
+	checkAgainstScan(counters, db);
+
+	SUBCASE("inserts") {
+		insertPatch(db, "OB-6", "c", 0, 0, 0b1001);
+		insertPatch(db, "Rev2", "b", 1, 1, 0b0110);
+		insertEntry(db, "list-2", "Rev2", "a", 0);
+		// An entry that arrives before its patch
+		insertEntry(db, "list-2", "Rev2", "c", 1);
+		insertPatch(db, "Rev2", "c", 0, 0, 0);
+		checkAgainstScan(counters, db);
+	}
+
+	SUBCASE("hide, favorite and recategorize") {
+		db.exec("UPDATE patches SET hidden = 1 WHERE synth = 'OB-6' AND md5 = 'a'");
+		db.exec("UPDATE patches SET hidden = 0, favorite = 1 WHERE synth = 'OB-6' AND md5 = 'b'");
+		db.exec("UPDATE patches SET categories = 10 WHERE synth = 'Rev2'");
+		checkAgainstScan(counters, db);
+		CHECK(counters.list("list-1", "OB-6").visible == 1);
+	}
+
+	SUBCASE("renames make and break duplicate names") {
+		db.exec("UPDATE patches SET name = 'Patch a' WHERE synth = 'OB-6' AND md5 = 'b'");
+		checkAgainstScan(counters, db);
+		CHECK(counters.duplicates("OB-6").patches == 2);
+		CHECK(counters.duplicates("OB-6").visible == 1);
+		CHECK(counters.duplicates("Rev2").patches == 0);
+		db.exec("UPDATE patches SET name = 'Other' WHERE synth = 'OB-6' AND md5 = 'a'");
+		checkAgainstScan(counters, db);
+		CHECK(counters.duplicates("OB-6").patches == 0);
+		// Names nobody uses are gone
+		CHECK(scalar(db, "SELECT count(*) FROM orm_count_name WHERE total = 0") == 0);
+	}
+
+	SUBCASE("deletes in either order") {
+		// Patch first, entries later
+		db.exec("DELETE FROM patches WHERE synth = 'OB-6' AND md5 = 'a'");
+		checkAgainstScan(counters, db);
+		db.exec("DELETE FROM patch_in_list WHERE synth = 'OB-6' AND md5 = 'a'");
+		checkAgainstScan(counters, db);
+		// Entries first, patch later
+		db.exec("DELETE FROM patch_in_list WHERE synth = 'OB-6' AND md5 = 'b'");
+		db.exec("DELETE FROM patches WHERE synth = 'OB-6' AND md5 = 'b'");
+		checkAgainstScan(counters, db);
+		CHECK(counters.synth("OB-6").total == 0);
+	}
+
+	SUBCASE("rolled back writes leave the counters alone") {
+		db.exec("BEGIN");
+		insertPatch(db, "OB-6", "c", 0, 0, 0b0001);
+		db.exec("UPDATE patches SET hidden = 1");
+		db.exec("ROLLBACK");
+		checkAgainstScan(counters, db);
+	}
+}
+
+TEST_CASE("patch counters are recreated by the migration when their triggers went missing") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_counters");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", 0, 0, 0b0001);
+	OrmSchema::migrate(db);
+	CHECK(OrmSchema::upToDate(db));
+	// Nothing to do the second time
+	CHECK(OrmSchema::migrate(db) == 0);
+	// What a migration rebuilding the table does to the triggers
+	db.exec("DROP TRIGGER orm_count_patch_insert");
+	insertPatch(db, "OB-6", "b", 0, 0, 0b0001);
+	CHECK_FALSE(OrmSchema::upToDate(db));
+	CHECK(OrmSchema::version(db) == OrmSchema::kVersion);
+
+	CHECK(OrmSchema::migrate(db) == 1);
+	PatchCounters counters(tmp.path().string());
+	CHECK(counters.synth("OB-6").total == 2);
+	CHECK(counters.category("OB-6", 0) == 2);
+	insertPatch(db, "OB-6", "c", 0, 1, 0b0001);
+	checkAgainstScan(counters, db);
+
+	// A rebuild gives the same result as the triggers
+	counters.rebuild();
+	checkAgainstScan(counters, db);
+}
+
+TEST_CASE("duplicate name groups page through all names used more than once") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_counters");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	for (int i = 0; i < 40; i++) {
+		std::string synth = i % 3 == 0 ? "Rev2" : "OB-6";
+		insertPatch(db, synth, std::to_string(i), 0, i % 5 == 0, 0);
+		// Seven names per synth, some of them used once only
+		db.exec("UPDATE patches SET name = 'Name " + std::to_string(i % 7 == 6 ? i : i % 7) + "' WHERE md5 = '" + std::to_string(i) + "'");
+	}
+	OrmSchema::migrate(db);
+	PatchCounters counters(tmp.path().string());
+
+	std::vector<std::string> expected;
+	{
+		SQLite::Statement query(db, "SELECT synth || '/' || name || '/' || count(*) || '/' || sum(hidden) FROM patches GROUP BY synth, name HAVING count(*) > 1 ORDER BY synth, name");
+		while (query.executeStep()) {
+			expected.push_back(query.getColumn(0).getString());
+		}
+	}
+	REQUIRE(expected.size() > 6);
+
+	for (int pageSize : { 1, 3, 100 }) {
+		CAPTURE(pageSize);
+		std::vector<std::string> paged;
+		std::optional<PatchCounters::NameGroup> after;
+		while (true) {
+			auto page = counters.duplicateGroups({ "OB-6", "Rev2" }, pageSize, after);
+			for (auto const& group : page) {
+				paged.push_back(group.synth + "/" + group.name + "/" + std::to_string(group.total) + "/" + std::to_string(group.hidden));
+			}
+			if (static_cast<int>(page.size()) < pageSize) {
+				break;
+			}
+			after = page.back();
+		}
+		CHECK(paged == expected);
+	}
+	CHECK(counters.duplicateGroups({ "Rev2" }, 100).size() < expected.size());
+	CHECK(counters.duplicateGroups({}, 100).empty());
+}
+
+TEST_CASE("patch count service agrees with the full count query") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_counters");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synthA = std::make_shared<test_helpers::DummySynth>("CountSynthA", 4, 2);
+	auto synthB = std::make_shared<test_helpers::DummySynth>("CountSynthB", 4, 1);
+	auto categories = db.getCategories();
+	REQUIRE(categories.size() >= 3);
+	std::vector<midikraft::PatchHolder> patches;
+	for (int i = 0; i < 12; ++i) {
+		auto patch = test_helpers::makePatchHolder(i % 3 == 0 ? synthB : synthA, "Count " + std::to_string(i % 5), { (uint8)i });
+		patch.setHidden(i % 4 == 1);
+		patch.setFavorite(midikraft::Favorite(i % 4 == 2));
+		if (i % 2 == 0) {
+			patch.setCategory(categories[0], true);
+		}
+		if (i % 3 != 2) {
+			patch.setCategory(categories[1], true);
+		}
+		patches.push_back(patch);
+		db.putPatch(patch);
+	}
+	auto list = std::make_shared<midikraft::PatchList>("count-list", "Count List");
+	list->setPatches({ patches[0], patches[1], patches[2], patches[1], patches[5] });
+	db.putPatchList(list);
+
+	{
+		SQLite::Database schema(tmp.path().string(), SQLite::OPEN_READWRITE);
+		OrmSchema::migrate(schema);
+	}
+	PatchCountService counts(db);
+	std::vector<std::shared_ptr<midikraft::Synth>> synths = { synthA, synthB };
+	std::vector<midikraft::PatchFilter> filters;
+	filters.push_back(midikraft::PatchFilter(synths));
+	std::vector<std::shared_ptr<midikraft::Synth>> onlyA = { synthA };
+	filters.push_back(midikraft::PatchFilter(onlyA));
+	auto all = midikraft::PatchFilter(synths);
+	all.turnOnAll();
+	filters.push_back(all);
+	auto inList = midikraft::PatchFilter(synths);
+	inList.listID = list->id();
+	filters.push_back(inList);
+	auto byName = midikraft::PatchFilter(synths);
+	byName.name = "Count 3";
+	filters.push_back(byName);
+	auto duplicates = midikraft::PatchFilter(synths);
+	duplicates.onlyDuplicateNames = true;
+	filters.push_back(duplicates);
+	auto allDuplicates = all;
+	allDuplicates.onlyDuplicateNames = true;
+	filters.push_back(allDuplicates);
+	auto faves = midikraft::PatchFilter(synths);
+	faves.onlyFaves = true;
+	filters.push_back(faves);
+	auto oneCategory = midikraft::PatchFilter(synths);
+	oneCategory.categories = { categories[0] };
+	filters.push_back(oneCategory);
+	auto oneCategoryAll = all;
+	oneCategoryAll.categories = { categories[1] };
+	filters.push_back(oneCategoryAll);
+	auto unusedCategory = midikraft::PatchFilter(onlyA);
+	unusedCategory.categories = { categories[2] };
+	filters.push_back(unusedCategory);
+	auto eitherCategory = midikraft::PatchFilter(synths);
+	eitherCategory.categories = { categories[0], categories[1] };
+	filters.push_back(eitherCategory);
+	auto bothCategories = eitherCategory;
+	bothCategories.andCategories = true;
+	filters.push_back(bothCategories);
+	auto categoryInList = inList;
+	categoryInList.categories = { categories[1] };
+	filters.push_back(categoryInList);
+	auto categoryDuplicates = duplicates;
+	categoryDuplicates.categories = { categories[0] };
+	filters.push_back(categoryDuplicates);
+
+	auto checkAll = [&]() {
+		for (size_t i = 0; i < filters.size(); ++i) {
+			CAPTURE(i);
+			int expected = db.getPatchesCount(filters[i]);
+			CHECK(counts.count(filters[i]) == expected);
+			auto estimate = counts.estimate(filters[i]);
+			if (estimate.exact) {
+				CHECK(estimate.total == expected);
+			}
+		}
+	};
+	checkAll();
+	// The common filters are answered from the counters
+	CHECK(counts.estimate(filters[0]).exact);
+	CHECK(counts.estimate(all).exact);
+	CHECK(counts.estimate(inList).exact);
+	CHECK(counts.estimate(duplicates).exact);
+	CHECK(counts.estimate(oneCategory).exact);
+	CHECK(counts.estimate(unusedCategory).exact);
+	CHECK_FALSE(counts.estimate(byName).exact);
+	CHECK_FALSE(counts.estimate(eitherCategory).exact);
+	CHECK_FALSE(counts.estimate(categoryInList).exact);
+	// Others remember their last count
+	CHECK(counts.estimate(byName).total == db.getPatchesCount(byName));
+
+	// Changes made through the database show up in the counters right away
+	patches[0].setHidden(true);
+	db.putPatch(patches[0]);
+	patches[3].setCategory(categories[2], true);
+	db.putPatch(patches[3]);
+	db.putPatch(test_helpers::makePatchHolder(synthA, "Count new", { 0x7f }));
+	checkAll();
+}
@@ -0,0 +1,299 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+// Times the PatchDatabase operations that matter for large libraries on a synthetic database of configurable size,
+// and writes the results as JSON so runs can be compared.
+// Usage: patch_database_benchmark [--patches N] [--synths N] [--repeat N] [--seed N] [--output results.json] [--keep db3]
+
+#include "PatchDatabase.h"
+#include "PatchList.h"
+#include "test_helpers.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using test_helpers::DummySynth;
+using test_helpers::makePatchHolder;
+
+struct Options {
+	int patches = 50000;
+	int synths = 4;
+	int repeat = 5;
+	unsigned seed = 4711;
+	std::string output = "patch_database_benchmark.json";
+	std::string keep;
+};
+
+Options parseOptions(int argc, char* argv[]) {
+	Options options;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string key = argv[i];
+		std::string value = argv[i + 1];
+		if (key == "--patches") options.patches = std::stoi(value);
+		else if (key == "--synths") options.synths = std::stoi(value);
+		else if (key == "--repeat") options.repeat = std::stoi(value);
+		else if (key == "--seed") options.seed = (unsigned)std::stoul(value);
+		else if (key == "--output") options.output = value;
+		else if (key == "--keep") options.keep = value;
+		else std::fprintf(stderr, "Ignoring unknown option %s\n", key.c_str());
+	}
+	return options;
+}
+
+// Synthetic library with the properties of real ones: names follow a long tail with many duplicates (think "Init" or "Brass 1"),
+// categories are skewed towards a few, and patches arrive in imports of bank size from a limited number of sources.
+class LibraryGenerator {
+public:
+	LibraryGenerator(unsigned seed, std::vector<midikraft::Category> categories) : random_(seed), categories_(std::move(categories)) {}
+
+	std::string name() {
+		static const std::vector<std::string> kWords = { "Brass", "Strings", "Pad", "Lead", "Bass", "Bell", "Organ", "Sync", "Sweep", "Pluck",
+			"Choir", "Glass", "Warm", "Dark", "Bright", "Fat", "Soft", "Hard", "Space", "Vintage" };
+		std::uniform_real_distribution<double> kind(0.0, 1.0);
+		double k = kind(random_);
+		if (k < 0.03) {
+			return "Init";
+		}
+		std::uniform_int_distribution<size_t> word(0, kWords.size() - 1);
+		if (k < 0.25) {
+			// Small vocabulary, lots of duplicates
+			return kWords[word(random_)] + " " + std::to_string(std::uniform_int_distribution<int>(1, 9)(random_));
+		}
+		return kWords[word(random_)] + " " + kWords[word(random_)] + " " + std::to_string(std::uniform_int_distribution<int>(1, 9999)(random_));
+	}
+
+	std::vector<uint8> data(size_t index) {
+		// Unique payload, so every patch gets its own md5
+		std::vector<uint8> result(64);
+		for (size_t i = 0; i < result.size(); i++) {
+			result[i] = (uint8)(random_() & 0x7f);
+		}
+		for (size_t i = 0; i < 4; i++) {
+			result[i] = (uint8)((index >> (7 * i)) & 0x7f);
+		}
+		return result;
+	}
+
+	void decorate(midikraft::PatchHolder& holder) {
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		if (!categories_.empty() && chance(random_) < 0.7) {
+			// Skewed: most patches end up in the first few categories
+			std::geometric_distribution<size_t> pick(0.35);
+			holder.setCategory(categories_[std::min(pick(random_), categories_.size() - 1)], true);
+			if (chance(random_) < 0.2) {
+				holder.setCategory(categories_[std::uniform_int_distribution<size_t>(0, categories_.size() - 1)(random_)], true);
+			}
+		}
+		if (chance(random_) < 0.05) {
+			holder.setFavorite(midikraft::Favorite(true));
+		}
+	}
+
+private:
+	std::mt19937 random_;
+	std::vector<midikraft::Category> categories_;
+};
+
+struct Timing {
+	std::vector<double> ms;
+
+	nlohmann::json toJson() const {
+		auto sorted = ms;
+		std::sort(sorted.begin(), sorted.end());
+		nlohmann::json result;
+		result["runs"] = sorted.size();
+		if (!sorted.empty()) {
+			result["min_ms"] = sorted.front();
+			result["median_ms"] = sorted[sorted.size() / 2];
+			result["max_ms"] = sorted.back();
+		}
+		return result;
+	}
+};
+
+double timeMs(std::function<void()> const& operation) {
+	auto start = std::chrono::steady_clock::now();
+	operation();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+Timing repeat(int times, std::function<void()> const& operation) {
+	Timing timing;
+	for (int i = 0; i < times; i++) {
+		timing.ms.push_back(timeMs(operation));
+	}
+	return timing;
+}
+
+std::string orderingName(midikraft::PatchOrdering ordering) {
+	switch (ordering) {
+	case midikraft::PatchOrdering::No_ordering: return "none";
+	case midikraft::PatchOrdering::Order_by_Name: return "name";
+	case midikraft::PatchOrdering::Order_by_ProgramNo: return "program";
+	case midikraft::PatchOrdering::Order_by_BankNo: return "bank";
+	case midikraft::PatchOrdering::Order_by_Import_id: return "import";
+	case midikraft::PatchOrdering::Order_by_Place_in_List: return "list";
+	}
+	return "unknown";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	auto options = parseOptions(argc, argv);
+	auto path = options.keep.empty() ? std::filesystem::temp_directory_path() / ("patch_database_benchmark_" + std::to_string(options.seed) + ".db3")
+		: std::filesystem::path(options.keep);
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+
+	nlohmann::json results;
+	results["patches"] = options.patches;
+	results["synths"] = options.synths;
+	results["repeat"] = options.repeat;
+	results["seed"] = options.seed;
+
+	{
+		midikraft::PatchDatabase db(path.string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+		LibraryGenerator generator(options.seed, db.getCategories());
+
+		const int kBankSize = 128;
+		std::vector<std::shared_ptr<DummySynth>> synths;
+		std::vector<std::shared_ptr<midikraft::Synth>> allSynths;
+		for (int s = 0; s < options.synths; s++) {
+			auto synth = std::make_shared<DummySynth>("BenchmarkSynth" + std::to_string(s), kBankSize, 8);
+			synths.push_back(synth);
+			allSynths.push_back(synth);
+		}
+
+		// Build the library import by import, as users do
+		int perSynth = std::max(1, options.patches / options.synths);
+		int putSample = std::min(1000, perSynth);
+		Timing putPatch;
+		Timing merge;
+		Timing importLists;
+		size_t index = 0;
+		std::vector<midikraft::PatchHolder> userListPatches;
+		for (auto const& synth : synths) {
+			for (int first = 0; first < perSynth; first += kBankSize) {
+				int bankNo = (first / kBankSize) % synth->numberOfBanks();
+				auto source = std::make_shared<midikraft::FromFileSource>("import" + std::to_string(first / kBankSize) + ".syx",
+					"/tmp/import" + std::to_string(first / kBankSize) + ".syx", MidiProgramNumber::invalidProgram());
+				auto bank = MidiBankNumber::fromZeroBase(bankNo, kBankSize);
+				std::vector<midikraft::PatchHolder> batch;
+				for (int p = first; p < std::min(perSynth, first + kBankSize); p++) {
+					auto holder = makePatchHolder(synth, generator.name(), generator.data(index++));
+					holder.setBank(bank);
+					holder.setPatchNumber(MidiProgramNumber::fromZeroBaseWithBank(bank, p - first));
+					holder.setSourceInfo(source);
+					generator.decorate(holder);
+					batch.push_back(holder);
+				}
+				if (first < putSample) {
+					// The first patches go in one by one, to time putPatch
+					for (auto const& holder : batch) {
+						putPatch.ms.push_back(timeMs([&]() { db.putPatch(holder); }));
+					}
+				}
+				else {
+					std::vector<midikraft::PatchHolder> newPatches;
+					merge.ms.push_back(timeMs([&]() {
+						db.mergePatchesIntoDatabase(batch, newPatches, nullptr,
+							midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+					}));
+				}
+				importLists.ms.push_back(timeMs([&]() { db.createImportLists(batch); }));
+				if (userListPatches.size() < 1000) {
+					userListPatches.push_back(batch.front());
+				}
+			}
+		}
+		results["putPatch_per_patch"] = putPatch.toJson();
+		results["mergePatchesIntoDatabase_per_bank"] = merge.toJson();
+		results["createImportLists_per_bank"] = importLists.toJson();
+
+		// Re-merging an already known bank is the common case of re-importing
+		{
+			auto filter = midikraft::PatchFilter(allSynths);
+			auto existing = db.getPatches(filter, 0, kBankSize);
+			results["mergePatchesIntoDatabase_known_bank"] = repeat(options.repeat, [&]() {
+				std::vector<midikraft::PatchHolder> newPatches;
+				db.mergePatchesIntoDatabase(existing, newPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME);
+			}).toJson();
+		}
+
+		auto userList = std::make_shared<midikraft::PatchList>("benchmark-list", "Benchmark List");
+		userList->setPatches(userListPatches);
+		db.putPatchList(userList);
+
+		auto total = db.getPatchesCount(midikraft::PatchFilter(allSynths));
+		results["total_in_database"] = total;
+		results["getPatchesCount"] = repeat(options.repeat, [&]() { db.getPatchesCount(midikraft::PatchFilter(allSynths)); }).toJson();
+
+		// Pages at the start, the middle and the end of the result list for every ordering
+		const int kPageSize = 100;
+		std::vector<int> offsets = { 0, total / 2, std::max(0, total - kPageSize) };
+		auto importListsOfFirstSynth = db.allImportLists(synths.front());
+		nlohmann::json getPatches;
+		for (auto ordering : { midikraft::PatchOrdering::No_ordering, midikraft::PatchOrdering::Order_by_Name, midikraft::PatchOrdering::Order_by_ProgramNo,
+			midikraft::PatchOrdering::Order_by_BankNo, midikraft::PatchOrdering::Order_by_Import_id, midikraft::PatchOrdering::Order_by_Place_in_List }) {
+			auto filter = midikraft::PatchFilter(allSynths);
+			filter.orderBy = ordering;
+			int count = total;
+			if (ordering == midikraft::PatchOrdering::Order_by_Place_in_List) {
+				filter.listID = userList->id();
+				count = (int)userListPatches.size();
+			}
+			for (int offset : offsets) {
+				int clamped = std::min(offset, std::max(0, count - kPageSize));
+				getPatches[orderingName(ordering)]["offset_" + std::to_string(clamped)] = repeat(options.repeat, [&]() {
+					db.getPatches(filter, clamped, kPageSize);
+				}).toJson();
+			}
+		}
+		results["getPatches"] = getPatches;
+
+		{
+			auto filter = midikraft::PatchFilter(allSynths);
+			filter.onlyDuplicateNames = true;
+			filter.orderBy = midikraft::PatchOrdering::Order_by_Name;
+			results["duplicates_in_database"] = db.getPatchesCount(filter);
+			results["duplicateNames_count"] = repeat(options.repeat, [&]() { db.getPatchesCount(filter); }).toJson();
+			results["duplicateNames_first_page"] = repeat(options.repeat, [&]() { db.getPatches(filter, 0, kPageSize); }).toJson();
+		}
+
+		std::map<std::string, std::weak_ptr<midikraft::Synth>> synthMap;
+		for (auto const& synth : synths) {
+			synthMap[synth->getName()] = synth;
+		}
+		results["getPatchList_user_list"] = repeat(options.repeat, [&]() { db.getPatchList({ userList->id(), userList->name() }, synthMap); }).toJson();
+		if (!importListsOfFirstSynth.empty()) {
+			auto const& info = importListsOfFirstSynth.front();
+			results["getPatchList_import_list"] = repeat(options.repeat, [&]() { db.getPatchList(info, synthMap); }).toJson();
+		}
+	}
+
+	if (options.keep.empty()) {
+		std::filesystem::remove(path, ec);
+	}
+
+	std::ofstream out(options.output);
+	out << results.dump(2) << std::endl;
+	std::printf("%s\n", results.dump(2).c_str());
+	return out.good() ? 0 : 1;
+}
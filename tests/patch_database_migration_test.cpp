@@ -6,6 +6,7 @@
 #include "PatchListType.h"
 #include "ImportList.h"
 #include "test_helpers.h"
+#include "The-Orm/PatchSearchIndex.h"
 
 #include <SQLiteCpp/Database.h>
 #include <SQLiteCpp/Statement.h>
@@ -449,3 +450,35 @@ TEST_CASE("migrate misclassified user banks from synth bank type") {
 	REQUIRE(activeBankQuery.executeStep());
 	CHECK(activeBankQuery.getColumn(0).getInt() == midikraft::PatchListType::SYNTH_BANK);
 }
+
+TEST_CASE("search index migration indexes legacy patches and their imports") {
+	auto tmp = makeTempDatabasePath();
+	createLegacyImportDatabase(tmp.path());
+
+	{
+		midikraft::PatchDatabase migrator(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+	}
+
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE);
+	REQUIRE(PatchSearchIndex::install(db));
+	// Running it again on an up to date database is a no-op
+	REQUIRE(PatchSearchIndex::install(db));
+
+	auto byName = PatchSearchIndex::search(db, "bass", {}, 10);
+	REQUIRE(byName.size() == 1);
+	CHECK(byName.front().first == kLegacySynth);
+	CHECK(byName.front().second == kLegacyMd5);
+	// The import became a list during the migration, and its name is searchable
+	auto byImport = PatchSearchIndex::search(db, "legacy bulk", { kLegacySynth }, 10);
+	REQUIRE(byImport.size() == 1);
+	CHECK(byImport.front().second == kLegacyMd5);
+	CHECK(PatchSearchIndex::search(db, "legacy", { kSecondSynth }, 10).empty());
+
+	// Opening the database again keeps the index in sync
+	{
+		midikraft::PatchDatabase reopened(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+		auto dummySynth = std::make_shared<DummySynth>(kLegacySynth, 128);
+		reopened.putPatch(test_helpers::makePatchHolder(dummySynth, "Sub Bass", { 0x10, 0x20 }));
+	}
+	CHECK(PatchSearchIndex::search(db, "bass", {}, 10).size() == 2);
+}
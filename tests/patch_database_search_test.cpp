@@ -678,3 +678,69 @@ TEST_CASE("patch database duplicate-name filter honors list scope and synth part
 	REQUIRE(result.size() == 2);
 	CHECK(result[0].md5() != result[1].md5());
 }
+
+TEST_CASE("patch database pages concatenate to the full result for every ordering") {
+	// Reference for cursor based paging: whichever way pages are fetched, they must add up to exactly the full query
+	auto tmp = makeTempDatabasePath();
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synthA = std::make_shared<DummySynth>("PagingSynthA", 8, 4);
+	auto synthB = std::make_shared<DummySynth>("PagingSynthB", 8, 2);
+	auto importOne = std::make_shared<midikraft::FromFileSource>("paging-1.syx", "/tmp/paging-1.syx", MidiProgramNumber::invalidProgram());
+	auto importTwo = std::make_shared<midikraft::FromFileSource>("paging-2.syx", "/tmp/paging-2.syx", MidiProgramNumber::invalidProgram());
+
+	// Few distinct names and programs, so every ordering has plenty of ties that cross page boundaries
+	std::vector<std::string> names = { "Pad", "Bass", "Lead", "Brass", "Pad", "Keys" };
+	std::vector<midikraft::PatchHolder> patches;
+	for (int i = 0; i < 45; ++i) {
+		bool onA = i % 3 != 0;
+		auto synth = onA ? synthA : synthB;
+		int banks = onA ? 4 : 2;
+		patches.push_back(makeBankedPatch(synth, names[i % names.size()], (i / 3) % banks, i % 5, (uint8)i, i % 2 == 0 ? importOne : importTwo));
+	}
+	for (auto const& patch : patches) {
+		db.putPatch(patch);
+	}
+	db.createImportLists(patches);
+
+	auto list = std::make_shared<midikraft::PatchList>("paging-list", "Paging List");
+	std::vector<midikraft::PatchHolder> listPatches;
+	for (int i = 0; i < 30; ++i) {
+		listPatches.push_back(patches[(i * 7) % patches.size()]);
+	}
+	list->setPatches(listPatches);
+	db.putPatchList(list);
+
+	auto keys = [](std::vector<midikraft::PatchHolder> const& result) {
+		std::vector<std::string> keys;
+		for (auto const& patch : result) {
+			keys.push_back(patch.synth()->getName() + ":" + patch.md5());
+		}
+		return keys;
+	};
+
+	std::vector<std::shared_ptr<midikraft::Synth>> synths = { synthA, synthB };
+	for (auto ordering : { midikraft::PatchOrdering::Order_by_Name, midikraft::PatchOrdering::Order_by_ProgramNo, midikraft::PatchOrdering::Order_by_BankNo,
+		midikraft::PatchOrdering::Order_by_Import_id, midikraft::PatchOrdering::Order_by_Place_in_List }) {
+		auto filter = midikraft::PatchFilter(synths);
+		filter.orderBy = ordering;
+		if (ordering == midikraft::PatchOrdering::Order_by_Place_in_List) {
+			filter.listID = list->id();
+		}
+		auto full = keys(db.getPatches(filter, 0, -1));
+		REQUIRE(!full.empty());
+		CHECK((int)full.size() == db.getPatchesCount(filter));
+
+		for (int pageSize : { 1, 4, 7 }) {
+			CAPTURE(static_cast<int>(ordering));
+			CAPTURE(pageSize);
+			std::vector<std::string> paged;
+			for (int skip = 0; skip <= (int)full.size(); skip += pageSize) {
+				auto page = keys(db.getPatches(filter, skip, pageSize));
+				CHECK((int)page.size() <= pageSize);
+				paged.insert(paged.end(), page.begin(), page.end());
+			}
+			CHECK(paged == full);
+		}
+	}
+}
@@ -0,0 +1,178 @@
+#include "doctest/doctest.h"
+
+#include "ProgressHandler.h"
+#include "The-Orm/PatchDeleteJob.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+class TestProgress : public midikraft::ProgressHandler {
+public:
+	bool shouldAbort() const override { return abortAfter_ >= 0 && calls_ >= abortAfter_; }
+	void setProgressPercentage(double zeroToOne) override {
+		CHECK(zeroToOne >= last_);
+		last_ = zeroToOne;
+	}
+	void onSuccess() override {}
+	void onCancel() override {}
+	void setMessage(std::string const&) override {}
+
+	int abortAfter_ = -1;
+	int calls_ = 0;
+	double last_ = 0.0;
+};
+
+// 2 synths with 500 patches each. Every 10th patch of Rev2 is in a bank and is hidden instead of deleted
+void createDatabase(std::string const& file) {
+	SQLite::Database db(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, hidden INTEGER, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE lists(id TEXT PRIMARY KEY, name TEXT NOT NULL, synth TEXT, midi_bank_number INTEGER, last_synced INTEGER, list_type INTEGER)");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL)");
+	db.exec("INSERT INTO lists (id, name, list_type) VALUES ('favorites', 'Favorites', 0), ('import:OB-6:1', 'Import', 4), ('bank', 'Bank', 3), ('untouched', 'Untouched', 0)");
+	db.exec("BEGIN");
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, hidden) VALUES (:SYN, :MD5, :MD5, 0)");
+	for (auto synth : { "OB-6", "Rev2" }) {
+		for (int i = 0; i < 500; i++) {
+			insert.bind(":SYN", synth);
+			insert.bind(":MD5", "md5-" + std::to_string(i));
+			insert.exec();
+			insert.reset();
+		}
+	}
+	db.exec("COMMIT");
+	db.exec("INSERT INTO patch_in_list (id, synth, md5, order_num) VALUES ('favorites', 'Rev2', 'md5-450', 0), ('import:OB-6:1', 'OB-6', 'md5-3', 0), "
+		"('bank', 'Rev2', 'md5-10', 0), ('untouched', 'Pro-3', 'md5-3', 0)");
+}
+
+struct Fixture {
+	Fixture() : tmp(test_helpers::makeTempDatabasePath("patch_delete_job")) {
+		createDatabase(tmp.path().string());
+		db = std::make_unique<SQLite::Database>(tmp.path().string(), SQLite::OPEN_READWRITE);
+	}
+
+	PatchDeleteJob::TResolve resolve() {
+		return [this](int offset, int limit) {
+			resolvedAt.push_back(offset);
+			std::vector<PatchDeleteJob::Key> keys;
+			SQLite::Statement query(*db, "SELECT synth, md5 FROM patches ORDER BY synth, md5 LIMIT :LIM OFFSET :OFF");
+			query.bind(":LIM", limit);
+			query.bind(":OFF", offset);
+			while (query.executeStep()) {
+				keys.push_back({ query.getColumn(0).getString(), query.getColumn(1).getString() });
+			}
+			return keys;
+		};
+	}
+
+	PatchDeleteJob::TDelete remove(TestProgress* progress = nullptr) {
+		return [this, progress](std::string const& synth, std::vector<std::string> const& md5s) {
+			chunks.push_back(md5s.size());
+			if (progress) progress->calls_++;
+			int deleted = 0;
+			int hidden = 0;
+			db->exec("BEGIN");
+			for (auto const& md5 : md5s) {
+				bool inBank = synth == "Rev2" && std::stoi(md5.substr(4)) % 10 == 0;
+				SQLite::Statement statement(*db, inBank ? "UPDATE patches SET hidden = 1 WHERE synth = :SYN AND md5 = :MD5" : "DELETE FROM patches WHERE synth = :SYN AND md5 = :MD5");
+				statement.bind(":SYN", synth);
+				statement.bind(":MD5", md5);
+				(inBank ? hidden : deleted) += statement.exec();
+			}
+			// Banks keep their entries, the other lists lose them
+			SQLite::Statement entries(*db, "DELETE FROM patch_in_list WHERE synth = :SYN AND id != 'bank' "
+				"AND NOT EXISTS (SELECT 1 FROM patches p WHERE p.synth = patch_in_list.synth AND p.md5 = patch_in_list.md5 AND p.hidden = 0)");
+			entries.bind(":SYN", synth);
+			entries.exec();
+			db->exec("COMMIT");
+			return std::make_pair(deleted, hidden);
+		};
+	}
+
+	int count(std::string const& sql) {
+		SQLite::Statement query(*db, sql);
+		REQUIRE(query.executeStep());
+		return query.getColumn(0).getInt();
+	}
+
+	test_helpers::ScopedTempFile tmp;
+	std::unique_ptr<SQLite::Database> db;
+	std::vector<int> resolvedAt;
+	std::vector<size_t> chunks;
+};
+
+}
+
+TEST_CASE("patches are deleted in chunks and reported in one delta") {
+	Fixture fixture;
+	TestProgress progress;
+	auto delta = PatchDeleteJob::run(fixture.tmp.path().string(), fixture.resolve(), fixture.remove(), 1000, &progress, 100);
+
+	// All resolved before the first delete shifted the pages
+	CHECK(fixture.resolvedAt == std::vector<int>({ 0, 1000 }));
+	CHECK(fixture.chunks == std::vector<size_t>(10, 100));
+	CHECK_FALSE(delta.cancelled);
+	CHECK(delta.deleted == 950);
+	CHECK(delta.hidden == 50);
+	CHECK(progress.last_ == doctest::Approx(1.0));
+	CHECK(fixture.count("SELECT count(*) FROM patches WHERE hidden = 0") == 0);
+
+	CHECK(delta.patches.size() == 2);
+	CHECK(delta.contains("OB-6", "md5-499"));
+	CHECK(delta.contains("Rev2", "md5-10"));
+	CHECK_FALSE(delta.contains("Pro-3", "md5-3"));
+	CHECK(delta.lists == std::set<std::string>({ "favorites", "import:OB-6:1", "bank" }));
+	CHECK(delta.imports == std::set<std::string>({ "import:OB-6:1" }));
+}
+
+TEST_CASE("a cancelled delete keeps the chunks done so far") {
+	Fixture fixture;
+	TestProgress progress;
+	progress.abortAfter_ = 3;
+	auto delta = PatchDeleteJob::run(fixture.tmp.path().string(), fixture.resolve(), fixture.remove(&progress), 1000, &progress, 100);
+
+	CHECK(delta.cancelled);
+	CHECK(fixture.chunks.size() == 3);
+	CHECK(delta.deleted == 300);
+	CHECK(delta.patches.size() == 1);
+	CHECK(delta.patches["OB-6"].size() == 300);
+	CHECK(fixture.count("SELECT count(*) FROM patches") == 700);
+}
+
+TEST_CASE("a failing delete reports the chunks done so far") {
+	Fixture fixture;
+	auto remove = fixture.remove();
+	int calls = 0;
+	auto failing = [&](std::string const& synth, std::vector<std::string> const& md5s) {
+		if (++calls == 3) {
+			throw std::runtime_error("database is locked");
+		}
+		return remove(synth, md5s);
+	};
+	auto delta = PatchDeleteJob::run(fixture.tmp.path().string(), fixture.resolve(), failing, 1000, nullptr, 100);
+
+	CHECK(delta.failed);
+	CHECK_FALSE(delta.cancelled);
+	CHECK(delta.deleted == 200);
+	CHECK(fixture.count("SELECT count(*) FROM patches") == 800);
+	// The failed chunk is refreshed as well
+	REQUIRE(delta.patches.size() == 1);
+	CHECK(delta.patches["OB-6"].size() == 300);
+	CHECK(delta.lists == std::set<std::string>({ "import:OB-6:1" }));
+}
+
+TEST_CASE("nothing matching leaves an empty delta") {
+	Fixture fixture;
+	auto delta = PatchDeleteJob::run(fixture.tmp.path().string(), [](int, int) { return std::vector<PatchDeleteJob::Key>(); }, fixture.remove(), 0, nullptr);
+	CHECK(delta.empty());
+	CHECK(fixture.chunks.empty());
+	CHECK(fixture.count("SELECT count(*) FROM patches") == 1000);
+}
@@ -0,0 +1,241 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "PatchList.h"
+#include "test_helpers.h"
+
+#include "The-Orm/OrmSchema.h"
+#include "The-Orm/PatchPager.h"
+#include "The-Orm/PatchProjection.h"
+#include "The-Orm/PatchQuery.h"
+#include "The-Orm/SearchQueryScheduler.h"
+
+#include <SQLiteCpp/Database.h>
+
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using test_helpers::DummySynth;
+
+// The part of the order the offset query of the PatchDatabase is pinned to, it leaves the order of ties open
+std::tuple<std::string, int, int> sortKey(midikraft::PatchHolder const& patch, midikraft::PatchOrdering orderBy) {
+	switch (orderBy) {
+	case midikraft::PatchOrdering::Order_by_Name:
+		return { patch.name(), 0, 0 };
+	case midikraft::PatchOrdering::Order_by_ProgramNo:
+	case midikraft::PatchOrdering::Order_by_BankNo:
+		return { "", patch.bankNumber().toZeroBased(), patch.patchNumber().toZeroBasedDiscardingBank() };
+	default:
+		return { "", 0, 0 };
+	}
+}
+
+std::string keyOf(midikraft::PatchHolder const& patch) {
+	return patch.synth()->getName() + "/" + patch.md5();
+}
+
+// The offset page of the translation, which breaks the ties the same way as the cursors do
+std::vector<std::string> offsetKeys(midikraft::PatchDatabase& db, midikraft::PatchFilter const& filter, int skip, int limit) {
+	SQLite::Database reads(String(db.getCurrentDatabaseFileName()).toStdString(), SQLite::OPEN_READONLY);
+	std::vector<std::string> result;
+	for (auto const& key : PatchQuery::from(filter)->keysByOffset(reads, skip, limit)) {
+		result.push_back(key.synth + "/" + key.md5);
+	}
+	return result;
+}
+
+std::vector<std::string> keysOf(std::vector<midikraft::PatchHolder> const& patches) {
+	std::vector<std::string> result;
+	for (auto const& patch : patches) {
+		result.push_back(keyOf(patch));
+	}
+	return result;
+}
+
+// A new search, which starts over with the cursors
+SearchQueryScheduler::Token nextSearch(SearchQueryScheduler& searches) {
+	searches.cancelAll();
+	return searches.current();
+}
+
+// Pages through the filter both ways and compares every page. Pages are read forward, then some again in jumps
+void checkAgainstOffsets(midikraft::PatchDatabase& db, PatchPager& pager, midikraft::PatchFilter const& filter, SearchQueryScheduler& searches) {
+	REQUIRE(PatchQuery::from(filter));
+	auto all = db.getPatches(filter, 0, -1);
+	for (int pageSize : { 1, 3, 7, 100 }) {
+		CAPTURE(pageSize);
+		auto token = nextSearch(searches);
+		std::multiset<std::string> paged, expected;
+		for (auto const& patch : all) {
+			expected.insert(keyOf(patch));
+		}
+		std::vector<int> starts;
+		for (int skip = 0; skip < static_cast<int>(all.size()); skip += pageSize) {
+			starts.push_back(skip);
+		}
+		// Forward, then the last, the first and one in the middle from the cursors remembered
+		auto jumps = starts;
+		jumps.push_back(starts.back());
+		jumps.push_back(0);
+		jumps.push_back(starts[starts.size() / 2]);
+		for (size_t i = 0; i < jumps.size(); i++) {
+			int skip = jumps[i];
+			CAPTURE(skip);
+			auto byCursor = pager.page(filter, token, skip, pageSize);
+			auto byOffset = db.getPatches(filter, skip, pageSize);
+			REQUIRE(byCursor.size() == byOffset.size());
+			CHECK(keysOf(byCursor) == offsetKeys(db, filter, skip, pageSize));
+			for (size_t row = 0; row < byCursor.size(); row++) {
+				CHECK(sortKey(byCursor[row], filter.orderBy) == sortKey(byOffset[row], filter.orderBy));
+				if (i < starts.size()) {
+					paged.insert(keyOf(byCursor[row]));
+				}
+			}
+		}
+		CHECK(paged == expected);
+		// Behind the end
+		CHECK(pager.page(filter, token, static_cast<int>(all.size()) + pageSize, pageSize).empty());
+		CHECK(pager.count(filter, token) == static_cast<int>(all.size()));
+	}
+}
+
+}
+
+TEST_CASE("patch pager pages by cursor like the offset query") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_pager");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synthA = std::make_shared<DummySynth>("PagerSynthA", 8, 4);
+	auto synthB = std::make_shared<DummySynth>("PagerSynthB", 8, 2);
+	// Same names in both synths and within one, and names that differ only in case
+	std::vector<std::string> names = { "Pad", "bass", "Pad", "Bass", "Solo", "pad", "Keys", "Solo", "Brass" };
+	std::vector<midikraft::PatchHolder> patches;
+	for (int i = 0; i < 40; ++i) {
+		auto synth = i % 3 == 0 ? synthB : synthA;
+		auto patch = test_helpers::makePatchHolder(synth, names[i % names.size()], { (uint8)i });
+		// Several patches share a program place, so the program order has ties too
+		auto bank = MidiBankNumber::fromZeroBase((i / 5) % synth->numberOfBanks(), synth->numberOfPatches());
+		patch.setBank(bank);
+		patch.setPatchNumber(MidiProgramNumber::fromZeroBaseWithBank(bank, i % 4));
+		patch.setHidden(i % 7 == 3);
+		db.putPatch(patch);
+		patches.push_back(patch);
+	}
+	auto list = std::make_shared<midikraft::PatchList>("pager-list", "Pager List");
+	// A list may hold a patch more than once
+	list->setPatches({ patches[5], patches[3], patches[5], patches[10], patches[0], patches[3], patches[21], patches[17], patches[5] });
+	db.putPatchList(list);
+
+	PatchPager pager(db);
+	SearchQueryScheduler searches;
+	std::vector<std::shared_ptr<midikraft::Synth>> synths = { synthA, synthB };
+	auto filter = midikraft::PatchFilter(synths);
+	filter.orderBy = midikraft::PatchOrdering::Order_by_Name;
+	// Before the migration there are no paging indexes, the offsets are used
+	auto early = pager.page(filter, nextSearch(searches), 3, 5);
+	CHECK(early.size() == db.getPatches(filter, 3, 5).size());
+	CHECK(keysOf(early) == offsetKeys(db, filter, 3, 5));
+	{
+		SQLite::Database schema(tmp.path().string(), SQLite::OPEN_READWRITE);
+		OrmSchema::migrate(schema);
+		CHECK(PatchQuery::indexed(schema));
+	}
+
+	for (auto orderBy : { midikraft::PatchOrdering::Order_by_Name, midikraft::PatchOrdering::Order_by_ProgramNo, midikraft::PatchOrdering::Order_by_BankNo, midikraft::PatchOrdering::No_ordering }) {
+		for (int visibility = 0; visibility < 2; ++visibility) {
+			for (bool duplicates : { false, true }) {
+				CAPTURE(static_cast<int>(orderBy));
+				CAPTURE(visibility);
+				CAPTURE(duplicates);
+				auto paged = midikraft::PatchFilter(synths);
+				paged.orderBy = orderBy;
+				paged.onlyDuplicateNames = duplicates;
+				if (visibility == 1) {
+					paged.turnOnAll();
+				}
+				checkAgainstOffsets(db, pager, paged, searches);
+			}
+		}
+	}
+
+	SUBCASE("list") {
+		auto inList = midikraft::PatchFilter(synths);
+		inList.listID = list->id();
+		inList.orderBy = midikraft::PatchOrdering::Order_by_Place_in_List;
+		checkAgainstOffsets(db, pager, inList, searches);
+		// Entry by entry, the same patch several times
+		auto byCursor = pager.page(inList, nextSearch(searches), 0, 100);
+		auto byOffset = db.getPatches(inList, 0, 100);
+		REQUIRE(byCursor.size() == byOffset.size());
+		for (size_t i = 0; i < byCursor.size(); i++) {
+			CHECK(keyOf(byCursor[i]) == keyOf(byOffset[i]));
+		}
+	}
+
+	SUBCASE("display only pages show the patches and load them on demand") {
+		auto paged = midikraft::PatchFilter(synths);
+		paged.orderBy = midikraft::PatchOrdering::Order_by_Name;
+		paged.turnOnAll();
+		auto token = nextSearch(searches);
+		auto full = pager.page(paged, token, 0, 100);
+		auto shown = pager.page(paged, token, 0, 100, false, PatchPager::Load::DisplayOnly);
+		REQUIRE(shown.size() == full.size());
+		for (size_t i = 0; i < shown.size(); i++) {
+			CAPTURE(i);
+			CHECK(keyOf(shown[i]) == keyOf(full[i]));
+			CHECK(shown[i].name() == full[i].name());
+			CHECK(shown[i].isHidden() == full[i].isHidden());
+			CHECK(shown[i].bankNumber().toZeroBased() == full[i].bankNumber().toZeroBased());
+			CHECK(shown[i].patchNumber().toZeroBasedDiscardingBank() == full[i].patchNumber().toZeroBasedDiscardingBank());
+			CHECK(PatchProjection::isDisplayOnly(shown[i]));
+			CHECK_FALSE(PatchProjection::isDisplayOnly(full[i]));
+
+			auto selected = shown[i];
+			REQUIRE(PatchProjection::materialize(db, selected));
+			CHECK_FALSE(PatchProjection::isDisplayOnly(selected));
+			CHECK(selected.patch()->data() == full[i].patch()->data());
+		}
+	}
+
+	SUBCASE("untranslated filters page by offset") {
+		auto byName = midikraft::PatchFilter(synths);
+		byName.name = "pad";
+		CHECK_FALSE(PatchQuery::from(byName));
+		auto token = nextSearch(searches);
+		CHECK(pager.page(byName, token, 0, 100).size() == db.getPatches(byName, 0, 100).size());
+		CHECK(pager.count(byName, token) == db.getPatchesCount(byName));
+		auto byImport = midikraft::PatchFilter(synths);
+		byImport.orderBy = midikraft::PatchOrdering::Order_by_Import_id;
+		CHECK_FALSE(PatchQuery::from(byImport));
+	}
+
+	SUBCASE("a superseded search reads nothing") {
+		auto paged = midikraft::PatchFilter(synths);
+		paged.orderBy = midikraft::PatchOrdering::Order_by_Name;
+		auto token = nextSearch(searches);
+		nextSearch(searches);
+		CHECK(pager.page(paged, token, 0, 5).empty());
+		CHECK_FALSE(pager.count(paged, token));
+	}
+
+	SUBCASE("cursors of an older generation are not reused") {
+		auto paged = midikraft::PatchFilter(synths);
+		paged.orderBy = midikraft::PatchOrdering::Order_by_Name;
+		auto before = pager.page(paged, nextSearch(searches), 5, 5);
+		// Hiding the first patch of the page moves the rest up by one
+		auto hidden = before.front();
+		hidden.setHidden(true);
+		db.putPatch(hidden);
+		auto after = pager.page(paged, nextSearch(searches), 5, 5);
+		auto expected = db.getPatches(paged, 5, 5);
+		REQUIRE(after.size() == expected.size());
+		for (size_t i = 0; i < after.size(); i++) {
+			CHECK(sortKey(after[i], paged.orderBy) == sortKey(expected[i], paged.orderBy));
+		}
+		CHECK(keysOf(after) == offsetKeys(db, paged, 5, 5));
+	}
+}
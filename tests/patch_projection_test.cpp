@@ -0,0 +1,155 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "The-Orm/PatchProjection.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL)");
+}
+
+void addToList(SQLite::Database& db, std::string const& listId, std::string const& synth, std::string const& md5, int orderNum) {
+	SQLite::Statement insert(db, "INSERT INTO patch_in_list (id, synth, md5, order_num) VALUES (:ID, :SYN, :MD5, :ORD)");
+	insert.bind(":ID", listId);
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":ORD", orderNum);
+	insert.exec();
+}
+
+} // namespace
+
+TEST_CASE("patch summaries carry the list columns in list order") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_projection");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	db.exec("INSERT INTO patches (synth, md5, name, type, data, favorite, hidden, midiBankNo, midiProgramNo, categories) VALUES "
+		"('OB-6', 'a', 'Pad', 0, zeroblob(65536), 1, 0, 1, 7, 5), "
+		"('OB-6', 'b', 'Bass', 2, zeroblob(16), -1, 1, NULL, NULL, 0), "
+		"('Rev2', 'a', 'Lead', 0, zeroblob(16), 0, 0, 0, 3, 2)");
+	addToList(db, "list", "OB-6", "b", 2);
+	addToList(db, "list", "Rev2", "a", 0);
+	addToList(db, "list", "OB-6", "a", 1);
+	addToList(db, "list", "OB-6", "a", 3);
+	// The patch is gone
+	addToList(db, "list", "OB-6", "deleted", 4);
+	addToList(db, "other", "OB-6", "b", 0);
+
+	auto summaries = PatchProjection::list(db, "list");
+	REQUIRE(summaries.size() == 4);
+	CHECK(summaries[0].synth == "Rev2");
+	CHECK(summaries[0].name == "Lead");
+	CHECK(summaries[0].program == 3);
+	CHECK(summaries[1].md5 == "a");
+	CHECK(summaries[1].name == "Pad");
+	CHECK(summaries[1].favorite);
+	CHECK_FALSE(summaries[1].hidden);
+	CHECK(summaries[1].categories == 5);
+	CHECK(summaries[1].bank == 1);
+	CHECK(summaries[1].program == 7);
+	CHECK(summaries[2].md5 == "b");
+	CHECK(summaries[2].dataType == 2);
+	CHECK_FALSE(summaries[2].favorite);
+	CHECK(summaries[2].hidden);
+	CHECK(summaries[2].bank == -1);
+	CHECK(summaries[2].program == -1);
+	CHECK(summaries[3].md5 == "a");
+	CHECK(PatchProjection::list(db, "missing").empty());
+}
+
+TEST_CASE("patch summaries of a list match the patches getPatchList loads") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_projection");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synthA = std::make_shared<test_helpers::DummySynth>("ProjectionSynthA", 8, 2);
+	auto synthB = std::make_shared<test_helpers::DummySynth>("ProjectionSynthB", 8, 1);
+	std::vector<midikraft::PatchHolder> patches;
+	for (int i = 0; i < 8; ++i) {
+		auto patch = test_helpers::makePatchHolder(i % 3 == 0 ? synthB : synthA, "Projection " + std::to_string(i), { (uint8)i });
+		patch.setHidden(i % 4 == 1);
+		patch.setFavorite(midikraft::Favorite(i % 4 == 2));
+		patches.push_back(patch);
+		db.putPatch(patch);
+	}
+	auto list = std::make_shared<midikraft::PatchList>("projection-list", "Projection List");
+	list->setPatches({ patches[4], patches[0], patches[2], patches[4], patches[7] });
+	db.putPatchList(list);
+
+	std::map<std::string, std::weak_ptr<midikraft::Synth>> synthMap;
+	synthMap[synthA->getName()] = synthA;
+	synthMap[synthB->getName()] = synthB;
+	auto loaded = db.getPatchList({ list->id(), list->name() }, synthMap);
+	REQUIRE(loaded);
+	auto expected = loaded->patches();
+
+	PatchProjection projection(db);
+	auto summaries = projection.list(list->id());
+	REQUIRE(summaries.size() == expected.size());
+	for (size_t i = 0; i < summaries.size(); ++i) {
+		CAPTURE(i);
+		CHECK(summaries[i].synth == expected[i].synth()->getName());
+		CHECK(summaries[i].md5 == expected[i].md5());
+		CHECK(summaries[i].name == expected[i].name());
+		CHECK(summaries[i].favorite == expected[i].isFavorite());
+		CHECK(summaries[i].hidden == expected[i].isHidden());
+
+		midikraft::PatchHolder patch;
+		REQUIRE(projection.materialize(summaries[i], synthMap[summaries[i].synth].lock(), patch));
+		CHECK(patch.md5() == expected[i].md5());
+		CHECK(patch.patch()->data() == expected[i].patch()->data());
+	}
+
+	db.deletePatches(synthB->getName(), { patches[0].md5() });
+	midikraft::PatchHolder gone;
+	CHECK_FALSE(projection.materialize(summaries[1], synthB, gone));
+}
+
+TEST_CASE("patch summaries of keys are read from the covering index") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_projection");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	db.exec("INSERT INTO patches (synth, md5, name, type, data, favorite, hidden, midiBankNo, midiProgramNo, categories, author) VALUES "
+		"('OB-6', 'a', 'Pad', 0, zeroblob(262144), 1, 0, 1, 7, 5, 'Someone'), "
+		"('OB-6', 'b', 'Bass', 2, zeroblob(16), -1, 1, NULL, NULL, 0, NULL)");
+	CHECK_FALSE(PatchProjection::indexed(db));
+	PatchProjection::createIndex(db);
+	CHECK(PatchProjection::indexed(db));
+	// Again, as the migration does when it finds a step incomplete
+	PatchProjection::createIndex(db);
+	CHECK(PatchProjection::indexed(db));
+
+	SQLite::Statement plan(db, "EXPLAIN QUERY PLAN SELECT p.synth, p.md5, p.name, p.type, p.categories, p.favorite, p.hidden, p.midiBankNo, p.midiProgramNo, p.author "
+		"FROM patches p INDEXED BY orm_patch_summary WHERE p.synth = 'OB-6' AND p.md5 = 'a'");
+	REQUIRE(plan.executeStep());
+	CHECK(plan.getColumn(3).getString().find("COVERING INDEX orm_patch_summary") != std::string::npos);
+
+	auto summaries = PatchProjection::summaries(db, { { "OB-6", "b" }, { "OB-6", "deleted" }, { "OB-6", "a" } });
+	REQUIRE(summaries.size() == 2);
+	CHECK(summaries[0].md5 == "b");
+	CHECK(summaries[0].dataType == 2);
+	CHECK(summaries[0].hidden);
+	CHECK(summaries[0].bank == -1);
+	CHECK(summaries[0].author.empty());
+	CHECK(summaries[1].md5 == "a");
+	CHECK(summaries[1].name == "Pad");
+	CHECK(summaries[1].favorite);
+	CHECK(summaries[1].categories == 5);
+	CHECK(summaries[1].program == 7);
+	CHECK(summaries[1].author == "Someone");
+
+	// The list reads the same columns, through the index now
+	addToList(db, "list", "OB-6", "a", 0);
+	auto listed = PatchProjection::list(db, "list");
+	REQUIRE(listed.size() == 1);
+	CHECK(listed[0].author == "Someone");
+}
@@ -0,0 +1,283 @@
+#include "doctest/doctest.h"
+
+#include "ProgressHandler.h"
+#include "The-Orm/OrmSchema.h"
+#include "The-Orm/PatchCounters.h"
+#include "The-Orm/PatchReindexer.h"
+#include "The-Orm/PatchSearchIndex.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class TestProgress : public midikraft::ProgressHandler {
+public:
+	bool shouldAbort() const override { return abort_; }
+	void setProgressPercentage(double zeroToOne) override { last_ = zeroToOne; }
+	void onSuccess() override {}
+	void onCancel() override {}
+	void setMessage(std::string const&) override {}
+
+	std::atomic<bool> abort_{ false };
+	std::atomic<double> last_{ 0.0 };
+};
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL)");
+}
+
+// The first byte of the data is what the fingerprint looks at, the second one is noise the old fingerprint included
+void insertPatch(SQLite::Database& db, std::string const& synth, std::string const& md5, uint8_t identity, uint8_t noise, int favorite = 0, int hidden = 0, int categories = 0) {
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, data, favorite, hidden, categories, midiProgramNo) VALUES (:SYN, :MD5, :MD5, :DAT, :FAV, :HID, :CAT, 0)");
+	uint8_t data[] = { identity, noise };
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":DAT", data, 2);
+	insert.bind(":FAV", favorite);
+	insert.bind(":HID", hidden);
+	insert.bind(":CAT", categories);
+	insert.exec();
+}
+
+void insertEntry(SQLite::Database& db, std::string const& list, std::string const& synth, std::string const& md5, int order) {
+	SQLite::Statement insert(db, "INSERT INTO patch_in_list (id, synth, md5, order_num) VALUES (:ID, :SYN, :MD5, :ORD)");
+	insert.bind(":ID", list);
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":ORD", order);
+	insert.exec();
+}
+
+std::string identityFingerprint(std::vector<uint8_t> const& data, int) {
+	return "fp-" + std::to_string(data.at(0));
+}
+
+std::vector<std::string> md5s(SQLite::Database& db, std::string const& sql) {
+	std::vector<std::string> result;
+	SQLite::Statement query(db, sql);
+	while (query.executeStep()) {
+		result.push_back(query.getColumn(0).getString());
+	}
+	return result;
+}
+
+}
+
+TEST_CASE("reindexing moves patches to their new fingerprint and merges duplicates") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_reindexer");
+	{
+		SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(db);
+		insertPatch(db, "OB-6", "a", 1, 10, 1, 0, 1);
+		insertPatch(db, "OB-6", "b", 1, 20, 0, 1, 2);
+		insertPatch(db, "OB-6", "c", 2, 30);
+		// Already indexed correctly, the others merge into it
+		insertPatch(db, "OB-6", "fp-3", 3, 40, 0, 1, 0);
+		insertPatch(db, "OB-6", "d", 3, 50, 1, 0, 4);
+		// Another synth with the same md5 is not touched
+		insertPatch(db, "Rev2", "a", 1, 10);
+		insertEntry(db, "bank", "OB-6", "b", 0);
+		insertEntry(db, "bank", "OB-6", "d", 1);
+		insertEntry(db, "bank", "Rev2", "a", 2);
+	}
+
+	TestProgress progress;
+	auto result = PatchReindexer::reindex(tmp.path().string(), "OB-6", identityFingerprint, &progress, 4);
+	CHECK_FALSE(result.cancelled);
+	CHECK(result.before == 5);
+	CHECK(result.after == 3);
+	CHECK(result.changed == 4);
+	CHECK(result.failed == 0);
+	CHECK(progress.last_ == 1.0);
+
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READONLY);
+	CHECK(md5s(db, "SELECT md5 FROM patches WHERE synth = 'OB-6' ORDER BY md5") == std::vector<std::string>({ "fp-1", "fp-2", "fp-3" }));
+	CHECK(md5s(db, "SELECT md5 FROM patches WHERE synth = 'Rev2'") == std::vector<std::string>({ "a" }));
+	CHECK(md5s(db, "SELECT md5 FROM patch_in_list ORDER BY order_num") == std::vector<std::string>({ "fp-1", "fp-3", "a" }));
+
+	// The merged patch keeps what either copy was marked with
+	SQLite::Statement merged(db, "SELECT favorite, hidden, categories FROM patches WHERE synth = 'OB-6' AND md5 = :MD5");
+	merged.bind(":MD5", "fp-1");
+	REQUIRE(merged.executeStep());
+	CHECK(merged.getColumn(0).getInt() == 1);
+	CHECK(merged.getColumn(1).getInt() == 0);
+	CHECK(merged.getColumn(2).getInt() == 3);
+	merged.reset();
+	merged.bind(":MD5", "fp-3");
+	REQUIRE(merged.executeStep());
+	CHECK(merged.getColumn(0).getInt() == 1);
+	CHECK(merged.getColumn(1).getInt() == 0);
+	CHECK(merged.getColumn(2).getInt() == 4);
+}
+
+TEST_CASE("reindexing a patch in a user list and an import keeps both lists, their counts and the search in step") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_reindexer");
+	{
+		SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(db);
+		db.exec("CREATE TABLE lists(id TEXT PRIMARY KEY, name TEXT NOT NULL, synth TEXT, midi_bank_number INTEGER, last_synced INTEGER, list_type INTEGER)");
+		db.exec("CREATE TABLE categories (bitIndex INTEGER UNIQUE, name TEXT, color TEXT, active INTEGER, sort_order INTEGER)");
+		db.exec("INSERT INTO lists (id, name, synth, list_type) VALUES ('favorites', 'Favorites', NULL, 0), ('import:OB-6:1', 'Summer Bank', 'OB-6', 4)");
+		// a merges into fp-1, which is only in the import, b just moves
+		insertPatch(db, "OB-6", "a", 1, 10);
+		insertPatch(db, "OB-6", "fp-1", 1, 20);
+		insertPatch(db, "OB-6", "b", 2, 30);
+		insertEntry(db, "favorites", "OB-6", "a", 0);
+		insertEntry(db, "favorites", "OB-6", "b", 1);
+		insertEntry(db, "import:OB-6:1", "OB-6", "a", 0);
+		insertEntry(db, "import:OB-6:1", "OB-6", "fp-1", 1);
+		OrmSchema::migrate(db);
+	}
+
+	auto result = PatchReindexer::reindex(tmp.path().string(), "OB-6", identityFingerprint, nullptr);
+	CHECK(result.after == 2);
+	CHECK(result.changed == 2);
+
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE);
+	CHECK(md5s(db, "SELECT md5 FROM patch_in_list WHERE id = 'favorites' ORDER BY order_num") == std::vector<std::string>({ "fp-1", "fp-2" }));
+	CHECK(md5s(db, "SELECT md5 FROM patch_in_list WHERE id = 'import:OB-6:1' ORDER BY order_num") == std::vector<std::string>({ "fp-1", "fp-1" }));
+
+	// The triggers kept the counters where a recount puts them
+	auto listCounts = [&db]() {
+		return md5s(db, "SELECT id || ':' || entries || ':' || visible FROM orm_count_list WHERE synth = 'OB-6' ORDER BY id");
+	};
+	auto counted = listCounts();
+	CHECK(counted == std::vector<std::string>({ "favorites:2:2", "import:OB-6:1:2:2" }));
+	PatchCounters counters(tmp.path().string());
+	CHECK(counters.synth("OB-6").total == 2);
+	counters.rebuild();
+	CHECK(listCounts() == counted);
+
+	// Only the patch in the import is found by the import's name
+	CHECK(md5s(db, "SELECT md5 FROM orm_search_key WHERE synth = 'OB-6' ORDER BY md5") == std::vector<std::string>({ "fp-1", "fp-2" }));
+	auto found = PatchSearchIndex::search(db, "summer", { "OB-6" }, 10);
+	REQUIRE(found.size() == 1);
+	CHECK(found[0].second == "fp-1");
+}
+
+TEST_CASE("without threads given, the fingerprints are computed on one thread") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_reindexer");
+	{
+		SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(db);
+		for (int i = 0; i < 300; i++) {
+			insertPatch(db, "OB-6", "md5-" + std::to_string(i), static_cast<uint8_t>(i % 256), 0);
+		}
+	}
+	std::mutex lock;
+	std::set<std::thread::id> threads;
+	auto fingerprint = [&](std::vector<uint8_t> const& data, int programNo) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			threads.insert(std::this_thread::get_id());
+		}
+		return identityFingerprint(data, programNo);
+	};
+	auto result = PatchReindexer::reindex(tmp.path().string(), "OB-6", fingerprint, nullptr);
+	CHECK(result.before == 300);
+	CHECK(result.after == 256);
+	CHECK(threads.size() == 1);
+}
+
+TEST_CASE("patches can swap their md5s") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_reindexer");
+	{
+		SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(db);
+		insertPatch(db, "OB-6", "fp-2", 1, 0);
+		insertPatch(db, "OB-6", "fp-1", 2, 0);
+		insertEntry(db, "list", "OB-6", "fp-2", 0);
+	}
+	auto result = PatchReindexer::reindex(tmp.path().string(), "OB-6", identityFingerprint, nullptr, 2);
+	CHECK(result.after == 2);
+	CHECK(result.changed == 2);
+
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READONLY);
+	CHECK(md5s(db, "SELECT md5 FROM patches WHERE hex(data) = '0100'") == std::vector<std::string>({ "fp-1" }));
+	CHECK(md5s(db, "SELECT md5 FROM patch_in_list") == std::vector<std::string>({ "fp-1" }));
+}
+
+TEST_CASE("the compute phase runs in parallel and gives the same result as one thread") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_reindexer");
+	const int kPatches = 2000;
+	{
+		SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(db);
+		db.exec("BEGIN");
+		for (int i = 0; i < kPatches; i++) {
+			insertPatch(db, "OB-6", "md5-" + std::to_string(i), static_cast<uint8_t>(i % 250), static_cast<uint8_t>(i / 250));
+		}
+		db.exec("COMMIT");
+	}
+	auto slowFingerprint = [](std::vector<uint8_t> const& data, int programNo) {
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		// Patches the synth can't make sense of keep their md5
+		return data.at(1) == 7 ? std::string() : identityFingerprint(data, programNo);
+	};
+
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READONLY);
+	std::vector<PatchReindexer::Mapping> single;
+	std::vector<PatchReindexer::Mapping> parallel;
+	int failedSingle = 0;
+	int failedParallel = 0;
+	auto start = std::chrono::steady_clock::now();
+	REQUIRE(PatchReindexer::compute(db, "OB-6", slowFingerprint, 1, nullptr, single, failedSingle));
+	auto singleTime = std::chrono::steady_clock::now() - start;
+	start = std::chrono::steady_clock::now();
+	REQUIRE(PatchReindexer::compute(db, "OB-6", slowFingerprint, 8, nullptr, parallel, failedParallel));
+	auto parallelTime = std::chrono::steady_clock::now() - start;
+
+	auto byOld = [](PatchReindexer::Mapping const& a, PatchReindexer::Mapping const& b) { return a.oldMd5 < b.oldMd5; };
+	std::sort(single.begin(), single.end(), byOld);
+	std::sort(parallel.begin(), parallel.end(), byOld);
+	REQUIRE(single.size() == parallel.size());
+	CHECK(single.size() == kPatches - 250);
+	for (size_t i = 0; i < single.size(); i++) {
+		CHECK(single[i].oldMd5 == parallel[i].oldMd5);
+		CHECK(single[i].newMd5 == parallel[i].newMd5);
+	}
+	CHECK(failedSingle == 250);
+	CHECK(failedParallel == 250);
+	CHECK(parallelTime * 2 < singleTime);
+}
+
+TEST_CASE("cancelling the compute phase leaves the database unchanged") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_reindexer");
+	{
+		SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(db);
+		db.exec("BEGIN");
+		for (int i = 0; i < 1000; i++) {
+			insertPatch(db, "OB-6", "md5-" + std::to_string(i), 1, 0);
+		}
+		db.exec("COMMIT");
+	}
+	TestProgress progress;
+	std::atomic<int> computed(0);
+	auto fingerprint = [&](std::vector<uint8_t> const& data, int programNo) {
+		if (++computed == 100) {
+			progress.abort_ = true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return identityFingerprint(data, programNo);
+	};
+	auto result = PatchReindexer::reindex(tmp.path().string(), "OB-6", fingerprint, &progress, 4);
+	CHECK(result.cancelled);
+	CHECK(result.after == 1000);
+	CHECK(computed < 1000);
+
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READONLY);
+	CHECK(md5s(db, "SELECT count(*) FROM patches WHERE md5 LIKE 'md5-%'") == std::vector<std::string>({ "1000" }));
+}
@@ -0,0 +1,270 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "The-Orm/OrmSchema.h"
+#include "The-Orm/PatchPager.h"
+#include "The-Orm/PatchQuery.h"
+#include "The-Orm/PatchSearchIndex.h"
+#include "The-Orm/SearchQueryScheduler.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL)");
+	db.exec("CREATE TABLE lists(id TEXT PRIMARY KEY, name TEXT NOT NULL, synth TEXT, midi_bank_number INTEGER, last_synced INTEGER, list_type INTEGER)");
+	db.exec("CREATE TABLE categories (bitIndex INTEGER UNIQUE, name TEXT, color TEXT, active INTEGER, sort_order INTEGER)");
+	db.exec("INSERT INTO categories (bitIndex, name, color, active) VALUES (0, 'Lead', 'ff8080ff', 1), (1, 'Pad', 'ff80ff80', 1), (2, 'Bass', 'ffff8080', 1)");
+}
+
+void insertPatch(SQLite::Database& db, std::string const& synth, std::string const& md5, std::string const& name, long long categories) {
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, favorite, hidden, categories) VALUES (:SYN, :MD5, :NAM, 0, 0, :CAT)");
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":NAM", name);
+	insert.bind(":CAT", categories);
+	insert.exec();
+}
+
+void insertEntry(SQLite::Database& db, std::string const& list, std::string const& synth, std::string const& md5, int orderNum) {
+	SQLite::Statement insert(db, "INSERT INTO patch_in_list (id, synth, md5, order_num) VALUES (:ID, :SYN, :MD5, :ORD)");
+	insert.bind(":ID", list);
+	insert.bind(":SYN", synth);
+	insert.bind(":MD5", md5);
+	insert.bind(":ORD", orderNum);
+	insert.exec();
+}
+
+void insertImport(SQLite::Database& db, std::string const& id, std::string const& name) {
+	SQLite::Statement insert(db, "INSERT INTO lists (id, name, synth, list_type) VALUES (:ID, :NAM, 'OB-6', 4)");
+	insert.bind(":ID", id);
+	insert.bind(":NAM", name);
+	insert.exec();
+}
+
+// The md5s found, best first
+std::vector<std::string> find(SQLite::Database& db, std::string const& text, std::vector<std::string> const& synths = {}) {
+	std::vector<std::string> result;
+	for (auto const& [synth, md5] : PatchSearchIndex::search(db, text, synths, 100)) {
+		result.push_back(synth + "/" + md5);
+	}
+	return result;
+}
+
+using Found = std::vector<std::string>;
+
+} // namespace
+
+TEST_CASE("match expression turns words into quoted prefix queries") {
+	CHECK(PatchSearchIndex::matchExpression("Bass") == "\"Bass\"*");
+	CHECK(PatchSearchIndex::matchExpression("  fat-bass 02 ") == "\"fat\"* \"bass\"* \"02\"*");
+	// Operators and quotes are just separators
+	CHECK(PatchSearchIndex::matchExpression("\"pad\" NOT -lead:") == "\"pad\"* \"NOT\"* \"lead\"*");
+	CHECK(PatchSearchIndex::matchExpression("Bäss") == "\"Bäss\"*");
+	CHECK(PatchSearchIndex::matchExpression(" - !").empty());
+}
+
+TEST_CASE("search index is backfilled and follows writes from another connection") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_search_index");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", "Fat Bass 01", 0b100);
+	insertPatch(db, "OB-6", "b", "Warm Pad", 0b010);
+	insertPatch(db, "Rev2", "a", "Bassline Lead", 0b001);
+	insertImport(db, "import:OB-6:1", "Factory Set");
+	insertEntry(db, "import:OB-6:1", "OB-6", "b", 0);
+
+	REQUIRE(PatchSearchIndex::install(db));
+
+	// Word prefixes anywhere in the name, names before tags
+	CHECK(find(db, "bass") == Found({ "OB-6/a", "Rev2/a" }));
+	CHECK(find(db, "lead") == Found({ "Rev2/a" }));
+	CHECK(find(db, "bass", { "Rev2" }) == Found({ "Rev2/a" }));
+	CHECK(find(db, "fat 01") == Found({ "OB-6/a" }));
+	CHECK(find(db, "ass").empty());
+	// Tags and import names
+	CHECK(find(db, "pad") == Found({ "OB-6/b" }));
+	CHECK(find(db, "factory") == Found({ "OB-6/b" }));
+	// Diacritics don't matter
+	CHECK(find(db, "wärm") == Found({ "OB-6/b" }));
+
+	SUBCASE("new and renamed patches") {
+		insertPatch(db, "OB-6", "c", "Brass Stab", 0);
+		CHECK(find(db, "brass") == Found({ "OB-6/c" }));
+		db.exec("UPDATE patches SET name = 'Solo Brass' WHERE synth = 'OB-6' AND md5 = 'a'");
+		CHECK(find(db, "brass").size() == 2);
+		CHECK(find(db, "fat").empty());
+		// A rolled back rename leaves the index alone
+		db.exec("BEGIN");
+		db.exec("UPDATE patches SET name = 'Gone' WHERE synth = 'OB-6' AND md5 = 'c'");
+		db.exec("ROLLBACK");
+		CHECK(find(db, "gone").empty());
+		CHECK(find(db, "stab") == Found({ "OB-6/c" }));
+	}
+
+	SUBCASE("categories change or get renamed") {
+		db.exec("UPDATE patches SET categories = 3 WHERE synth = 'OB-6' AND md5 = 'b'");
+		CHECK(find(db, "lead") == Found({ "Rev2/a", "OB-6/b" }));
+		db.exec("UPDATE categories SET name = 'Atmosphere' WHERE bitIndex = 1");
+		CHECK(find(db, "atmo") == Found({ "OB-6/b" }));
+		db.exec("DELETE FROM categories WHERE bitIndex = 1");
+		CHECK(find(db, "atmo").empty());
+	}
+
+	SUBCASE("imports are added, renamed and removed") {
+		insertEntry(db, "import:OB-6:1", "OB-6", "a", 1);
+		CHECK(find(db, "factory").size() == 2);
+		// Entries of other lists are not indexed
+		db.exec("INSERT INTO lists (id, name, list_type) VALUES ('user', 'Favourite Sounds', 0)");
+		insertEntry(db, "user", "OB-6", "a", 0);
+		CHECK(find(db, "favourite").empty());
+		db.exec("UPDATE lists SET name = 'Live Set' WHERE id = 'import:OB-6:1'");
+		CHECK(find(db, "factory").empty());
+		CHECK(find(db, "live").size() == 2);
+		db.exec("DELETE FROM patch_in_list WHERE id = 'import:OB-6:1' AND md5 = 'b'");
+		CHECK(find(db, "live") == Found({ "OB-6/a" }));
+		db.exec("DELETE FROM lists WHERE id = 'import:OB-6:1'");
+		CHECK(find(db, "live").empty());
+	}
+
+	SUBCASE("deleted patches") {
+		db.exec("DELETE FROM patches WHERE synth = 'OB-6'");
+		CHECK(find(db, "bass") == Found({ "Rev2/a" }));
+		CHECK(find(db, "pad").empty());
+		insertPatch(db, "OB-6", "a", "Fat Bass 01", 0);
+		CHECK(find(db, "bass").size() == 2);
+	}
+}
+
+TEST_CASE("search index is recreated when its triggers went missing") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_search_index");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", "Fat Bass 01", 0);
+	REQUIRE(PatchSearchIndex::install(db));
+	// What a migration rebuilding the table does to the triggers
+	db.exec("DROP TRIGGER orm_search_patch_insert");
+	insertPatch(db, "OB-6", "b", "Thin Bass", 0);
+	CHECK(find(db, "thin").empty());
+
+	REQUIRE(PatchSearchIndex::install(db));
+	CHECK(find(db, "thin") == Found({ "OB-6/b" }));
+	insertPatch(db, "OB-6", "c", "Thin Lead", 0);
+	CHECK(find(db, "thin").size() == 2);
+}
+
+TEST_CASE("search index is created and repaired by the schema migration") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_search_index");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", "Fat Bass 01", 0);
+	REQUIRE(PatchSearchIndex::available());
+	CHECK_FALSE(PatchSearchIndex::upToDate(db));
+	OrmSchema::migrate(db);
+	CHECK(PatchSearchIndex::installed(db));
+	CHECK(find(db, "bass") == Found({ "OB-6/a" }));
+
+	db.exec("DROP TRIGGER orm_search_category_update");
+	CHECK_FALSE(OrmSchema::upToDate(db));
+	CHECK(OrmSchema::migrate(db) == 1);
+	CHECK(OrmSchema::upToDate(db));
+	insertPatch(db, "OB-6", "b", "Thin Bass", 0);
+	CHECK(find(db, "bass").size() == 2);
+}
+
+TEST_CASE("ranking writes the best matches into a TEMP table of the connection") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_search_index");
+	SQLite::Database db(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(db);
+	insertPatch(db, "OB-6", "a", "Fat Bass 01", 0);
+	insertPatch(db, "OB-6", "b", "Bass", 0);
+	insertPatch(db, "Rev2", "a", "Bassline Lead", 0);
+	REQUIRE(PatchSearchIndex::install(db));
+
+	auto ranked = [&db]() {
+		std::vector<std::string> result;
+		SQLite::Statement query(db, std::string("SELECT synth || '/' || md5 FROM temp.") + PatchSearchIndex::kRankedTable + " ORDER BY place");
+		while (query.executeStep()) {
+			result.push_back(query.getColumn(0).getString());
+		}
+		return result;
+	};
+	CHECK(PatchSearchIndex::rank(db, "bass", {}, 10) == 3);
+	CHECK(ranked() == find(db, "bass"));
+	// One more than the limit tells there were more
+	CHECK(PatchSearchIndex::rank(db, "bass", { "OB-6" }, 1) == 2);
+	CHECK(ranked() == Found({ "OB-6/b" }));
+	CHECK(PatchSearchIndex::rank(db, "keys", {}, 10) == 0);
+	CHECK(ranked().empty());
+
+	// Nothing of it is in the file
+	SQLite::Database other(tmp.path().string(), SQLite::OPEN_READONLY);
+	CHECK_FALSE(other.tableExists(PatchSearchIndex::kRankedTable));
+	SQLite::Statement entries(other, "SELECT count(*) FROM patch_in_list");
+	REQUIRE(entries.executeStep());
+	CHECK(entries.getColumn(0).getInt() == 0);
+}
+
+TEST_CASE("ranked search pages the best matches in rank order") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_search_index");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synth = std::make_shared<test_helpers::DummySynth>("SearchSynth", 8, 1);
+	db.putPatch(test_helpers::makePatchHolder(synth, "Pad Bass", { 0x01 }));
+	db.putPatch(test_helpers::makePatchHolder(synth, "Bass", { 0x02 }));
+	db.putPatch(test_helpers::makePatchHolder(synth, "Lead", { 0x03 }));
+	auto hidden = test_helpers::makePatchHolder(synth, "Hidden Bass", { 0x04 });
+	hidden.setHidden(true);
+	db.putPatch(hidden);
+	{
+		SQLite::Database schema(tmp.path().string(), SQLite::OPEN_READWRITE);
+		OrmSchema::migrate(schema);
+	}
+
+	PatchPager pager(db);
+	SearchQueryScheduler searches;
+	std::vector<std::shared_ptr<midikraft::Synth>> synths = { synth };
+	auto filter = midikraft::PatchFilter(synths);
+	filter.name = "bass";
+	filter.orderBy = midikraft::PatchOrdering::Order_by_Name;
+
+	// Shorter names rank higher, the rest of the filter still applies
+	auto token = searches.current();
+	CHECK(pager.count(filter, token, true) == 2);
+	auto result = pager.page(filter, token, 0, 100, true);
+	REQUIRE(result.size() == 2);
+	CHECK(result[0].name() == "Bass");
+	CHECK(result[1].name() == "Pad Bass");
+	auto second = pager.page(filter, token, 1, 1, true);
+	REQUIRE(second.size() == 1);
+	CHECK(second[0].name() == "Pad Bass");
+
+	// Patches stored later are found by the next search
+	db.putPatch(test_helpers::makePatchHolder(synth, "Bass Drum", { 0x05 }));
+	searches.cancelAll();
+	token = searches.current();
+	CHECK(pager.page(filter, token, 0, 100, true).size() == 3);
+	CHECK(pager.count(filter, token, true) == 3);
+
+	// Nothing to rank, or a list: the name is a substring again
+	auto noWords = midikraft::PatchFilter(synths);
+	noWords.name = "--";
+	CHECK(pager.page(noWords, token, 0, 100, true).size() == db.getPatches(noWords, 0, 100).size());
+	auto inList = midikraft::PatchFilter(synths);
+	inList.name = "bass";
+	inList.listID = "some-list";
+	CHECK_FALSE(PatchQuery::from(inList, true));
+	// Unranked, it is the substring match of the PatchDatabase
+	auto substring = midikraft::PatchFilter(synths);
+	substring.name = "ass";
+	CHECK_FALSE(PatchQuery::from(substring));
+	CHECK(pager.page(substring, token, 0, 100).size() == 3);
+	CHECK(pager.page(substring, token, 0, 100, true).empty());
+}
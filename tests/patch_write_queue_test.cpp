@@ -0,0 +1,268 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "The-Orm/PatchWriteQueue.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class RecordingWriter {
+public:
+	PatchWriteQueue::TWriter writer() {
+		return [this](std::vector<PatchWriteQueue::Edit> const& batch) {
+			std::lock_guard<std::mutex> lock(lock_);
+			batches_.push_back(batch);
+		};
+	}
+
+	std::vector<std::vector<PatchWriteQueue::Edit>> batches() {
+		std::lock_guard<std::mutex> lock(lock_);
+		return batches_;
+	}
+
+private:
+	std::mutex lock_;
+	std::vector<std::vector<PatchWriteQueue::Edit>> batches_;
+};
+
+} // namespace
+
+TEST_CASE("write queue coalesces edits of the same patch into one batch") {
+	auto synth = std::make_shared<test_helpers::DummySynth>("QueueSynth");
+	auto patchA = test_helpers::makePatchHolder(synth, "Queue A", { 1 });
+	auto patchB = test_helpers::makePatchHolder(synth, "Queue B", { 2 });
+
+	RecordingWriter recorder;
+	PatchWriteQueue queue(recorder.writer(), 10000);
+	patchA.setFavorite(midikraft::Favorite(true));
+	queue.enqueue(patchA);
+	queue.enqueue(patchB);
+	patchA.setHidden(true);
+	queue.enqueue(patchA);
+	CHECK(queue.pending() == 2);
+	CHECK(recorder.batches().empty());
+
+	// Doesn't wait for the delay
+	auto start = std::chrono::steady_clock::now();
+	queue.flush();
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+	CHECK(queue.pending() == 0);
+	auto batches = recorder.batches();
+	REQUIRE(batches.size() == 1);
+	REQUIRE(batches[0].size() == 2);
+	for (auto const& edit : batches[0]) {
+		if (edit.patch.md5() == patchA.md5()) {
+			CHECK(edit.patch.isFavorite());
+			CHECK(edit.patch.isHidden());
+		}
+		else {
+			CHECK(edit.patch.md5() == patchB.md5());
+		}
+	}
+
+	// Nothing pending, nothing written
+	queue.flush();
+	CHECK(recorder.batches().size() == 1);
+}
+
+TEST_CASE("write queue writes after the delay and on destruction") {
+	auto synth = std::make_shared<test_helpers::DummySynth>("QueueSynth");
+	auto patch = test_helpers::makePatchHolder(synth, "Queue", { 1 });
+
+	RecordingWriter recorder;
+	{
+		PatchWriteQueue queue(recorder.writer(), 20);
+		queue.enqueue(patch);
+		for (int i = 0; i < 200 && recorder.batches().empty(); i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		CHECK(recorder.batches().size() == 1);
+	}
+
+	RecordingWriter onShutdown;
+	{
+		PatchWriteQueue queue(onShutdown.writer(), 10000);
+		queue.enqueue(patch);
+	}
+	CHECK(onShutdown.batches().size() == 1);
+}
+
+TEST_CASE("queued metadata edits reach the database on flush") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_write_queue");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+	auto synth = std::make_shared<test_helpers::DummySynth>("QueueDatabaseSynth");
+	std::vector<midikraft::PatchHolder> patches;
+	for (int i = 0; i < 4; ++i) {
+		patches.push_back(test_helpers::makePatchHolder(synth, "Queued " + std::to_string(i), { (uint8)i }));
+		db.putPatch(patches.back());
+	}
+
+	PatchWriteQueue queue([&db](std::vector<PatchWriteQueue::Edit> const& batch) {
+		for (auto const& edit : batch) {
+			db.putPatch(edit.patch);
+		}
+	}, 10000);
+	// Next, favorite, next, hide...
+	for (int round = 0; round < 3; ++round) {
+		for (size_t i = 0; i < patches.size(); ++i) {
+			patches[i].setFavorite(midikraft::Favorite(i % 2 == 0));
+			queue.enqueue(patches[i]);
+			patches[i].setHidden(i % 2 == 1);
+			queue.enqueue(patches[i]);
+		}
+	}
+	queue.flush();
+
+	for (size_t i = 0; i < patches.size(); ++i) {
+		CAPTURE(i);
+		std::vector<midikraft::PatchHolder> loaded;
+		REQUIRE(db.getSinglePatch(synth, patches[i].md5(), loaded));
+		REQUIRE(loaded.size() == 1);
+		CHECK(loaded[0].isFavorite() == (i % 2 == 0));
+		CHECK(loaded[0].isHidden() == (i % 2 == 1));
+	}
+}
+
+TEST_CASE("write queue flushes for a query only if it reads what was edited") {
+	auto synth = std::make_shared<test_helpers::DummySynth>("QueueSynth");
+	auto patch = test_helpers::makePatchHolder(synth, "Queue", { 1 });
+
+	RecordingWriter recorder;
+	PatchWriteQueue queue(recorder.writer(), 10000);
+	queue.enqueue(patch, PatchWriteQueue::Categories);
+
+	// The grid of all patches by name doesn't see the categories, a category filter does
+	std::vector<std::shared_ptr<midikraft::Synth>> synths = { synth };
+	auto byName = midikraft::PatchFilter(synths);
+	byName.orderBy = midikraft::PatchOrdering::Order_by_Name;
+	CHECK((PatchWriteQueue::readBy(byName) & PatchWriteQueue::Categories) == 0);
+	queue.flush(PatchWriteQueue::readBy(byName));
+	CHECK(queue.pending() == 1);
+	auto byCategory = byName;
+	byCategory.onlyUntagged = true;
+	queue.flush(PatchWriteQueue::readBy(byCategory));
+	CHECK(queue.pending() == 0);
+	CHECK(recorder.batches().size() == 1);
+
+	// The default visibility reads hidden, all of them together don't
+	queue.enqueue(patch, PatchWriteQueue::Hidden);
+	auto all = byName;
+	all.turnOnAll();
+	CHECK((PatchWriteQueue::readBy(all) & PatchWriteQueue::Hidden) == 0);
+	queue.flush(PatchWriteQueue::readBy(all));
+	CHECK(queue.pending() == 1);
+	queue.flush(PatchWriteQueue::readBy(byName));
+	CHECK(queue.pending() == 0);
+
+	// A name search reads the name and more
+	auto search = all;
+	search.name = "que";
+	CHECK((PatchWriteQueue::readBy(search) & PatchWriteQueue::Text) != 0);
+	queue.enqueue(patch, PatchWriteQueue::Text);
+	queue.flush(PatchWriteQueue::readBy(search));
+	CHECK(queue.pending() == 0);
+	CHECK(recorder.batches().size() == 3);
+}
+
+TEST_CASE("a batch the writer fails on is retried, and reported when it is lost") {
+	auto synth = std::make_shared<test_helpers::DummySynth>("QueueSynth");
+	auto patch = test_helpers::makePatchHolder(synth, "Queue", { 1 });
+
+	std::mutex lock;
+	int calls = 0;
+	int failUntil = 1;
+	std::vector<PatchWriteQueue::Edit> written;
+	std::vector<PatchWriteQueue::Edit> lost;
+	std::string error;
+	PatchWriteQueue queue([&](std::vector<PatchWriteQueue::Edit> const& batch) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (++calls <= failUntil) {
+			throw std::runtime_error("database is locked");
+		}
+		written = batch;
+	}, 10000, [&](std::vector<PatchWriteQueue::Edit> const& batch, std::string const& what) {
+		std::lock_guard<std::mutex> guard(lock);
+		lost = batch;
+		error = what;
+	});
+
+	// One failure, then the retry writes the favorite and the hide together
+	queue.enqueue(patch, PatchWriteQueue::Favorite);
+	queue.enqueue(patch, PatchWriteQueue::Hidden);
+	queue.flush();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		CHECK(calls == 2);
+		REQUIRE(written.size() == 1);
+		CHECK(written[0].edits == (PatchWriteQueue::Favorite | PatchWriteQueue::Hidden));
+		CHECK(lost.empty());
+		calls = 0;
+		failUntil = PatchWriteQueue::kTries;
+	}
+
+	// Failing every time, it gives up after the last try and hands the batch over
+	queue.enqueue(patch, PatchWriteQueue::Categories);
+	queue.flush();
+	// The handler is called after the flush returned
+	auto reported = [&]() {
+		std::lock_guard<std::mutex> guard(lock);
+		return !lost.empty();
+	};
+	for (int i = 0; i < 200 && !reported(); i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	std::lock_guard<std::mutex> guard(lock);
+	CHECK(calls == PatchWriteQueue::kTries);
+	REQUIRE(lost.size() == 1);
+	CHECK(lost[0].patch.md5() == patch.md5());
+	CHECK(error == "database is locked");
+	CHECK(queue.pending() == 0);
+}
+
+TEST_CASE("flags of a batch are written in one transaction") {
+	auto tmp = test_helpers::makeTempDatabasePath("patch_write_flags");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+	auto synth = std::make_shared<test_helpers::DummySynth>("QueueFlagsSynth");
+	std::vector<midikraft::PatchHolder> patches;
+	for (int i = 0; i < 4; ++i) {
+		patches.push_back(test_helpers::makePatchHolder(synth, "Flagged " + std::to_string(i), { (uint8)i }));
+		db.putPatch(patches.back());
+	}
+
+	std::vector<PatchWriteQueue::Edit> batch;
+	for (size_t i = 0; i < patches.size(); ++i) {
+		patches[i].setFavorite(midikraft::Favorite(i % 2 == 0));
+		patches[i].setHidden(i % 2 == 1);
+		batch.push_back({ patches[i], PatchWriteQueue::Favorite | PatchWriteQueue::Hidden });
+	}
+	// A patch deleted meanwhile is left out
+	auto deleted = test_helpers::makePatchHolder(synth, "Deleted", { 99 });
+	batch.push_back({ deleted, PatchWriteQueue::Hidden });
+	CHECK(PatchWriteQueue::flagsOnly(batch[0].edits));
+	CHECK_FALSE(PatchWriteQueue::flagsOnly(PatchWriteQueue::Name | PatchWriteQueue::Hidden));
+
+	{
+		SQLite::Database connection(tmp.path().string(), SQLite::OPEN_READWRITE, 5000);
+		PatchWriteQueue::writeFlags(connection, batch);
+	}
+
+	for (size_t i = 0; i < patches.size(); ++i) {
+		CAPTURE(i);
+		std::vector<midikraft::PatchHolder> loaded;
+		REQUIRE(db.getSinglePatch(synth, patches[i].md5(), loaded));
+		REQUIRE(loaded.size() == 1);
+		CHECK(loaded[0].isFavorite() == (i % 2 == 0));
+		CHECK(loaded[0].isHidden() == (i % 2 == 1));
+	}
+	std::vector<midikraft::PatchHolder> none;
+	CHECK_FALSE(db.getSinglePatch(synth, deleted.md5(), none));
+}
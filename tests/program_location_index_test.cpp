@@ -0,0 +1,130 @@
+#include "doctest/doctest.h"
+
+#include "PatchDatabase.h"
+#include "SynthBank.h"
+#include "The-Orm/ProgramLocationIndex.h"
+#include "test_helpers.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using test_helpers::DummySynth;
+using test_helpers::makePatchHolder;
+
+std::shared_ptr<midikraft::ActiveSynthBank> activeBank(std::shared_ptr<DummySynth> synth, int bankNo, std::vector<midikraft::PatchHolder> patches) {
+	auto bank = std::make_shared<midikraft::ActiveSynthBank>(synth, MidiBankNumber::fromZeroBase(bankNo, synth->numberOfPatches()), juce::Time::getCurrentTime());
+	bank->setPatches(patches);
+	return bank;
+}
+
+std::vector<int> programs(std::vector<MidiProgramNumber> const& positions) {
+	std::vector<int> result;
+	for (auto const& position : positions) {
+		REQUIRE(position.isBankKnown());
+		result.push_back(position.bank().toZeroBased() * position.bank().bankSize() + position.toZeroBasedDiscardingBank());
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("program location index answers like getBankPositions") {
+	auto tmp = test_helpers::makeTempDatabasePath("program_location_index");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synth = std::make_shared<DummySynth>("DummySynth", 4, 2);
+	auto patchA = makePatchHolder(synth, "A", { 0x01 });
+	auto patchB = makePatchHolder(synth, "B", { 0x02 });
+	auto patchC = makePatchHolder(synth, "C", { 0x03 });
+	auto notInSynth = makePatchHolder(synth, "D", { 0x04 });
+	for (auto const& patch : { patchA, patchB, patchC, notInSynth }) {
+		db.putPatch(patch);
+	}
+	db.putPatchList(activeBank(synth, 0, { patchA, patchB, patchA, patchC }));
+	db.putPatchList(activeBank(synth, 1, { patchC, patchC, patchB, patchB }));
+
+	ProgramLocationIndex index(db);
+	for (auto const& patch : { patchA, patchB, patchC, notInSynth }) {
+		CAPTURE(patch.name());
+		CHECK(programs(index.bankPositions(synth, patch.md5())) == programs(db.getBankPositions(synth, patch.md5())));
+	}
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 0, 2 }));
+	CHECK(index.bankPositions(synth, notInSynth.md5()).empty());
+	CHECK(index.bankPositions(nullptr, patchA.md5()).empty());
+}
+
+TEST_CASE("program location index follows stored banks without asking the database again") {
+	auto tmp = test_helpers::makeTempDatabasePath("program_location_index");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synth = std::make_shared<DummySynth>("DummySynth", 2, 2);
+	auto patchA = makePatchHolder(synth, "A", { 0x01 });
+	auto patchB = makePatchHolder(synth, "B", { 0x02 });
+	auto patchC = makePatchHolder(synth, "C", { 0x03 });
+	for (auto const& patch : { patchA, patchB, patchC }) {
+		db.putPatch(patch);
+	}
+	db.putPatchList(activeBank(synth, 0, { patchA, patchB }));
+
+	ProgramLocationIndex index(db);
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 0 }));
+
+	// Replacing a bank through the index moves the patches
+	index.putPatchList(activeBank(synth, 0, { patchC, patchA }));
+	index.putPatchList(activeBank(synth, 1, { patchB, patchB }));
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 1 }));
+	CHECK(programs(index.bankPositions(synth, patchB.md5())) == std::vector<int>({ 2, 3 }));
+	CHECK(programs(index.bankPositions(synth, patchC.md5())) == std::vector<int>({ 0 }));
+	for (auto const& patch : { patchA, patchB, patchC }) {
+		CHECK(programs(index.bankPositions(synth, patch.md5())) == programs(db.getBankPositions(synth, patch.md5())));
+	}
+
+	// Written behind the index's back, so only seen after invalidating - the lookups are served from memory
+	db.putPatchList(activeBank(synth, 1, { patchA, patchA }));
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 1 }));
+	index.invalidate(synth->getName());
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 1, 2, 3 }));
+	CHECK(index.bankPositions(synth, patchB.md5()).empty());
+}
+
+TEST_CASE("program location index doesn't keep banks read before a bank was stored") {
+	auto tmp = test_helpers::makeTempDatabasePath("program_location_index");
+	midikraft::PatchDatabase db(tmp.path().string(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+
+	auto synth = std::make_shared<DummySynth>("DummySynth", 2, 2);
+	auto patchA = makePatchHolder(synth, "A", { 0x01 });
+	auto patchB = makePatchHolder(synth, "B", { 0x02 });
+	for (auto const& patch : { patchA, patchB }) {
+		db.putPatch(patch);
+	}
+	db.putPatchList(activeBank(synth, 0, { patchA, patchB }));
+
+	// Another thread stores a bank while the first lookup reads the database, then the synth is invalidated during the reread
+	int loads = 0;
+	ProgramLocationIndex* current = nullptr;
+	ProgramLocationIndex index(db, [&](std::string const& synthName) {
+		CHECK(synthName == synth->getName());
+		loads++;
+		if (loads == 1) {
+			current->putPatchList(activeBank(synth, 0, { patchB, patchA }));
+		}
+		else if (loads == 2) {
+			current->invalidate(synthName);
+		}
+	});
+	current = &index;
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 1 }));
+	CHECK(loads == 3);
+	CHECK(programs(index.bankPositions(synth, patchB.md5())) == std::vector<int>({ 0 }));
+	CHECK(loads == 3);
+
+	// Once indexed, a stored bank goes straight into the index
+	index.putPatchList(activeBank(synth, 1, { patchA, patchA }));
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 1, 2, 3 }));
+	CHECK(loads == 3);
+	index.invalidateAll();
+	CHECK(programs(index.bankPositions(synth, patchA.md5())) == std::vector<int>({ 1, 2, 3 }));
+	CHECK(loads == 4);
+}
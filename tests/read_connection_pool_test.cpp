@@ -0,0 +1,221 @@
+#include "doctest/doctest.h"
+
+#include "The-Orm/OrmSchema.h"
+#include "The-Orm/PatchCounters.h"
+#include "The-Orm/ReadConnectionPool.h"
+#include "test_helpers.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void createTables(SQLite::Database& db) {
+	db.exec("CREATE TABLE patches (synth TEXT NOT NULL, md5 TEXT NOT NULL, name TEXT, type INTEGER, data BLOB, favorite INTEGER, hidden INTEGER, sourceName TEXT, sourceInfo TEXT, midiBankNo INTEGER, midiProgramNo INTEGER, categories INTEGER, categoryUserDecision INTEGER, comment TEXT, author TEXT, info TEXT, PRIMARY KEY (synth, md5))");
+	db.exec("CREATE TABLE patch_in_list(id TEXT NOT NULL, synth TEXT NOT NULL, md5 TEXT NOT NULL, order_num INTEGER NOT NULL)");
+	db.exec("CREATE TABLE lists(id TEXT PRIMARY KEY, name TEXT NOT NULL, synth TEXT, midi_bank_number INTEGER, last_synced INTEGER, list_type INTEGER)");
+	db.exec("CREATE TABLE categories (bitIndex INTEGER UNIQUE, name TEXT, color TEXT, active INTEGER, sort_order INTEGER)");
+}
+
+int countPatches(SQLite::Database& db) {
+	SQLite::Statement query(db, "SELECT count(*) FROM patches");
+	REQUIRE(query.executeStep());
+	return query.getColumn(0).getInt();
+}
+
+void insertPatches(SQLite::Database& db, int first, int count) {
+	SQLite::Statement insert(db, "INSERT INTO patches (synth, md5, name, data, favorite, hidden, categories) VALUES ('OB-6', :MD5, :NAM, zeroblob(1024), 0, 0, 1)");
+	for (int i = first; i < first + count; i++) {
+		insert.bind(":MD5", "md5-" + std::to_string(i));
+		insert.bind(":NAM", "Patch " + std::to_string(i));
+		insert.exec();
+		insert.reset();
+	}
+}
+
+} // namespace
+
+TEST_CASE("read connection pool leaves the journal mode to the setting") {
+	auto tmp = test_helpers::makeTempDatabasePath("read_connection_pool");
+	{
+		SQLite::Database writer(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(writer);
+	}
+	{
+		ReadConnectionPool pool(tmp.path().string(), 1);
+		CHECK_FALSE(pool.writeAheadLog());
+	}
+	CHECK(ReadConnectionPool::useWriteAheadLog(tmp.path().string(), true));
+	{
+		ReadConnectionPool pool(tmp.path().string(), 1);
+		CHECK(pool.writeAheadLog());
+	}
+	// Turning the setting off goes back to the rollback journal, as long as nobody else has the file open
+	CHECK_FALSE(ReadConnectionPool::useWriteAheadLog(tmp.path().string(), false));
+	ReadConnectionPool pool(tmp.path().string(), 1);
+	CHECK_FALSE(pool.writeAheadLog());
+	CHECK_FALSE(std::filesystem::exists(tmp.path().string() + "-wal"));
+}
+
+TEST_CASE("read connection pool snapshots keep their state in WAL mode") {
+	auto tmp = test_helpers::makeTempDatabasePath("read_connection_pool");
+	SQLite::Database writer(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	createTables(writer);
+	insertPatches(writer, 0, 10);
+	REQUIRE(ReadConnectionPool::enableWriteAheadLog(writer));
+
+	ReadConnectionPool pool(tmp.path().string(), 2);
+	REQUIRE(pool.writeAheadLog());
+
+	auto snapshot = pool.snapshot();
+	CHECK(countPatches(snapshot.db()) == 10);
+	insertPatches(writer, 10, 5);
+	{
+		auto lease = pool.acquire();
+		CHECK(countPatches(lease.db()) == 15);
+	}
+	// Count and pages read through the snapshot agree, no matter what was committed since
+	CHECK(countPatches(snapshot.db()) == 10);
+	SQLite::Statement page(snapshot.db(), "SELECT md5 FROM patches ORDER BY rowid LIMIT 100 OFFSET 5");
+	int rows = 0;
+	while (page.executeStep()) {
+		rows++;
+	}
+	CHECK(rows == 5);
+
+	// Connections are read only
+	auto lease = pool.acquire();
+	CHECK_THROWS(lease.db().exec("DELETE FROM patches"));
+}
+
+TEST_CASE("read connection pool hands out at most its size") {
+	auto tmp = test_helpers::makeTempDatabasePath("read_connection_pool");
+	{
+		SQLite::Database writer(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		createTables(writer);
+	}
+	ReadConnectionPool pool(tmp.path().string(), 2);
+	std::atomic<bool> gotThird(false);
+	std::thread waiter;
+	{
+		auto first = pool.acquire();
+		auto second = pool.snapshot();
+		waiter = std::thread([&]() {
+			auto third = pool.acquire();
+			gotThird = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		CHECK_FALSE(gotThird.load());
+	}
+	waiter.join();
+	CHECK(gotThird.load());
+	// Returned snapshots are usable as plain connections again
+	auto a = pool.acquire();
+	auto b = pool.acquire();
+	CHECK(countPatches(a.db()) == 0);
+	CHECK(countPatches(b.db()) == 0);
+}
+
+TEST_CASE("counter reads keep going while a bulk merge holds the write transaction") {
+	// What BulkImportPIP does to the database: one long transaction with thousands of inserts, each firing the triggers
+	const int kBefore = 200;
+	const int kBatches = 40;
+	const int kBatchSize = 100;
+	auto tmp = test_helpers::makeTempDatabasePath("read_connection_pool");
+	SQLite::Database writer(tmp.path().string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, 5000);
+	createTables(writer);
+	insertPatches(writer, 0, kBefore);
+	bool writeAheadLog = false;
+	SUBCASE("write-ahead log") {
+		REQUIRE(ReadConnectionPool::enableWriteAheadLog(writer));
+		writeAheadLog = true;
+	}
+	SUBCASE("rollback journal") {
+		// The default. The commit locks the readers out for its duration, and waits for the reads in flight
+		REQUIRE_FALSE(ReadConnectionPool::useWriteAheadLog(tmp.path().string(), false));
+	}
+	OrmSchema::migrate(writer);
+	PatchCounters counters(tmp.path().string());
+	REQUIRE(counters.synth("OB-6").total == kBefore);
+
+	std::atomic<bool> merging(false);
+	std::atomic<bool> done(false);
+	std::atomic<bool> committed(false);
+	std::thread merge([&]() {
+		writer.exec("BEGIN");
+		merging = true;
+		for (int batch = 0; batch < kBatches; batch++) {
+			insertPatches(writer, kBefore + batch * kBatchSize, kBatchSize);
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		try {
+			writer.exec("COMMIT");
+			committed = true;
+		}
+		catch (SQLite::Exception const&) {
+			// SQLITE_BUSY, the readers kept the writer from committing
+			writer.exec("ROLLBACK");
+		}
+		merging = false;
+		done = true;
+	});
+
+	std::mutex resultLock;
+	std::set<int> seen;
+	std::atomic<int> readsDuringMerge(0);
+	std::atomic<int> failedReads(0);
+	long long slowestMs = 0;
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 4; r++) {
+		readers.emplace_back([&]() {
+			while (!done) {
+				auto start = std::chrono::steady_clock::now();
+				bool duringMerge = merging;
+				int total = 0;
+				int inCategory = 0;
+				try {
+					total = counters.synth("OB-6").total;
+					inCategory = counters.category("OB-6", 0);
+				}
+				catch (SQLite::Exception const&) {
+					failedReads++;
+					continue;
+				}
+				auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+				std::lock_guard<std::mutex> lock(resultLock);
+				seen.insert(total);
+				seen.insert(inCategory);
+				slowestMs = std::max(slowestMs, (long long) ms);
+				if (duringMerge && merging) {
+					readsDuringMerge++;
+				}
+			}
+		});
+	}
+	merge.join();
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	// Neither side gave up on a busy database. Readers never waited for the writer, and only ever saw committed states
+	CHECK(committed);
+	CHECK(failedReads.load() == 0);
+	CHECK(readsDuringMerge.load() > 0);
+	CAPTURE(writeAheadLog);
+	CHECK(slowestMs < 1000);
+	const int kAfter = kBefore + kBatches * kBatchSize;
+	for (int total : seen) {
+		CAPTURE(total);
+		CHECK((total == kBefore || total == kAfter));
+	}
+	CHECK(counters.synth("OB-6").total == kAfter);
+}
@@ -0,0 +1,102 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "The-Orm/SearchQueryScheduler.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+TEST_CASE("requests within the debounce window collapse into the last one") {
+	SearchQueryScheduler scheduler(50);
+	std::mutex lock;
+	std::vector<int> executed;
+	std::vector<SearchQueryScheduler::Token> tokens;
+	for (int i = 0; i < 5; i++) {
+		tokens.push_back(scheduler.request([i, &lock, &executed](SearchQueryScheduler::Token const&) {
+			std::lock_guard<std::mutex> guard(lock);
+			executed.push_back(i);
+		}, true));
+		Thread::sleep(5);
+	}
+	REQUIRE(scheduler.waitUntilIdle(5000));
+	CHECK(executed == std::vector<int>({ 4 }));
+	for (int i = 0; i < 4; i++) {
+		CHECK(tokens[i].superseded());
+	}
+	CHECK_FALSE(tokens[4].superseded());
+	CHECK(scheduler.current().generation() == tokens[4].generation());
+}
+
+TEST_CASE("a running query sees that it was superseded") {
+	SearchQueryScheduler scheduler(50);
+	std::atomic<bool> started{ false };
+	std::atomic<bool> sawSuperseded{ false };
+	std::atomic<bool> secondRan{ false };
+	scheduler.request([&](SearchQueryScheduler::Token const& token) {
+		started = true;
+		for (int i = 0; i < 500 && !token.superseded(); i++) {
+			Thread::sleep(10);
+		}
+		sawSuperseded = token.superseded();
+	}, false);
+	while (!started) {
+		Thread::sleep(1);
+	}
+	auto second = scheduler.request([&](SearchQueryScheduler::Token const&) { secondRan = true; }, false);
+	REQUIRE(scheduler.waitUntilIdle(5000));
+	CHECK(sawSuperseded);
+	CHECK(secondRan);
+	CHECK_FALSE(second.superseded());
+
+	// Cancelling drops what is still waiting for its debounce window
+	std::atomic<bool> thirdRan{ false };
+	auto third = scheduler.request([&](SearchQueryScheduler::Token const&) { thirdRan = true; }, true);
+	scheduler.cancelAll();
+	REQUIRE(scheduler.waitUntilIdle(5000));
+	CHECK(third.superseded());
+	CHECK_FALSE(thirdRan);
+}
+
+TEST_CASE("a superseded statement is interrupted") {
+	SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+	// Takes far longer than the test is willing to wait when not interrupted
+	const char* endless = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 2000000000) SELECT count(*) FROM n";
+
+	SearchQueryScheduler scheduler(0);
+	std::atomic<bool> interrupted{ false };
+	std::atomic<bool> started{ false };
+	scheduler.request([&](SearchQueryScheduler::Token const& token) {
+		SearchQueryScheduler::StatementInterrupter interrupter(db.getHandle(), token);
+		SQLite::Statement query(db, endless);
+		started = true;
+		try {
+			query.executeStep();
+		}
+		catch (SQLite::Exception const& e) {
+			interrupted = e.getErrorCode() == SQLITE_INTERRUPT;
+		}
+	}, false);
+	while (!started) {
+		Thread::sleep(1);
+	}
+	Thread::sleep(20);
+	scheduler.request([](SearchQueryScheduler::Token const&) {}, false);
+	REQUIRE(scheduler.waitUntilIdle(5000));
+	CHECK(interrupted);
+
+	// Without an interrupter, the connection is back to normal
+	SQLite::Statement small(db, "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 1000) SELECT count(*) FROM n");
+	REQUIRE(small.executeStep());
+	CHECK(small.getColumn(0).getInt() == 1000);
+}
@@ -11,12 +11,42 @@
 #include "HasBanksCapability.h"
 #include "MidiProgramNumber.h"
 
+#include <filesystem>
 #include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
 namespace test_helpers {
 
+// Deletes the file when going out of scope
+class ScopedTempFile {
+public:
+	explicit ScopedTempFile(std::filesystem::path path) : path_(std::move(path)) {}
+	~ScopedTempFile() {
+		std::error_code ec;
+		std::filesystem::remove(path_, ec);
+	}
+
+	std::filesystem::path const& path() const { return path_; }
+
+private:
+	std::filesystem::path path_;
+};
+
+inline std::string makeRandomSuffix() {
+	std::random_device rd;
+	std::mt19937 gen(rd());
+	std::uniform_int_distribution<int> dist(0, 0xFFFFFF);
+	return std::to_string(dist(gen));
+}
+
+// A database file name in the temp directory that doesn't exist yet
+inline ScopedTempFile makeTempDatabasePath(std::string const& prefix) {
+	auto base = std::filesystem::temp_directory_path();
+	return ScopedTempFile(base / (prefix + "_" + makeRandomSuffix() + ".db3"));
+}
+
 class DummyPatch : public midikraft::Patch {
 public:
 	DummyPatch() : midikraft::Patch(0) {}
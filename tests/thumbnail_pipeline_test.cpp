@@ -0,0 +1,245 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "The-Orm/ThumbnailPipeline.h"
+
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double kSampleRate = 48000.0;
+
+int samples(int ms) {
+	return static_cast<int>(kSampleRate * ms / 1000.0);
+}
+
+struct SimulatedPatch {
+	std::string md5;
+	int glitchMs; // Noise the synth makes while switching to the patch
+	int noteMs; // Length of the note when played, -1 for a drone
+};
+
+// Simulated synth and audio interface. Audio is generated on demand without blocking, so the pipeline runs faster than real time
+class SimulatedSynth : public ThumbnailPipeline::AudioInput, public ThumbnailPipeline::PatchDriver {
+public:
+	explicit SimulatedSynth(std::vector<SimulatedPatch> patches) : patches_(std::move(patches)) {}
+
+	double sampleRate() const override { return kSampleRate; }
+	int numChannels() const override { return 1; }
+	void flush() override { stale_ = 0; }
+
+	int read(AudioBuffer<float>& buffer, int) override {
+		if (deaf_) {
+			return 0;
+		}
+		int n = buffer.getNumSamples();
+		auto out = buffer.getWritePointer(0);
+		for (int i = 0; i < n; i++) {
+			float value = 0.0f;
+			if (stale_ > 0) {
+				// Captured before the patch change, still waiting in the input
+				stale_--;
+			}
+			else if (glitchRemaining_ > 0) {
+				value = (i % 2 == 0) ? 0.2f : -0.2f;
+				glitchRemaining_--;
+			}
+			else if (noteRemaining_ != 0) {
+				value = 0.5f * (float)std::sin(2.0 * MathConstants<double>::pi * 440.0 * phase_++ / kSampleRate);
+				if (noteRemaining_ > 0) {
+					noteRemaining_--;
+				}
+			}
+			out[i] = value;
+		}
+		consumed_ += n;
+		return n;
+	}
+
+	std::string sendNextPatch(bool first) override {
+		if (first) {
+			current_ = 0;
+		}
+		else {
+			current_++;
+		}
+		if (current_ >= patches_.size()) {
+			return {};
+		}
+		glitchRemaining_ = samples(patches_[current_].glitchMs);
+		noteRemaining_ = 0;
+		return patches_[current_].md5;
+	}
+
+	void playNote() override {
+		notesPlayed_++;
+		phase_ = 0;
+		noteRemaining_ = patches_[current_].noteMs < 0 ? -1 : samples(patches_[current_].noteMs);
+	}
+
+	int consumed() const { return consumed_; }
+	int notesPlayed() const { return notesPlayed_; }
+	void setDeaf(bool deaf) { deaf_ = deaf; }
+	// Silence the input captured while nobody was reading
+	void idle(int ms) { stale_ += samples(ms); }
+
+private:
+	std::vector<SimulatedPatch> patches_;
+	size_t current_ = 0;
+	int glitchRemaining_ = 0;
+	int noteRemaining_ = 0;
+	int stale_ = 0;
+	int phase_ = 0;
+	int consumed_ = 0;
+	int notesPlayed_ = 0;
+	bool deaf_ = false;
+};
+
+ThumbnailPipeline::Options fastOptions() {
+	ThumbnailPipeline::Options options;
+	options.maxSettleMs = 1000;
+	options.signalTimeoutMs = 500;
+	options.maxRecordingMs = 2000;
+	return options;
+}
+
+struct EncodedFiles {
+	std::mutex lock;
+	std::map<std::string, File> files;
+};
+
+} // namespace
+
+TEST_CASE("thumbnail pipeline settles on audio level instead of fixed sleep") {
+	SimulatedSynth synth({ { "quiet", 0, 100 }, { "noisy", 200, 100 } });
+	auto options = fastOptions();
+	ThumbnailPipeline pipeline(options, synth, synth, [](std::string const&) { return File(); }, nullptr);
+	auto never = []() { return false; };
+
+	REQUIRE(synth.sendNextPatch(true) == "quiet");
+	CHECK(pipeline.waitForSettle(never));
+	// A quiet synth is ready after the settle window, far earlier than the maximum
+	CHECK(synth.consumed() < samples(options.maxSettleMs / 4));
+
+	int before = synth.consumed();
+	REQUIRE(synth.sendNextPatch(false) == "noisy");
+	CHECK(pipeline.waitForSettle(never));
+	CHECK(synth.consumed() - before >= samples(200 + options.settleSilenceMs));
+	CHECK(synth.consumed() - before < samples(options.maxSettleMs));
+}
+
+TEST_CASE("thumbnail pipeline doesn't settle on audio captured before the patch change") {
+	SimulatedSynth synth({ { "first", 0, 100 }, { "noisy", 200, 300 } });
+	ThumbnailPipeline pipeline(fastOptions(), synth, synth, [](std::string const&) { return File(); }, nullptr);
+	auto never = []() { return false; };
+
+	REQUIRE(pipeline.sendPatch(true) == "first");
+	CHECK(pipeline.waitForSettle(never));
+	// Encoding the previous patch, the input filled up with silence
+	synth.idle(1000);
+	int before = synth.consumed();
+	REQUIRE(pipeline.sendPatch(false) == "noisy");
+	CHECK(pipeline.waitForSettle(never));
+	CHECK(synth.consumed() - before >= samples(200));
+
+	// So the noise of the patch change is not recorded as part of the note
+	AudioBuffer<float> recording;
+	CHECK(pipeline.capture(recording, never) == ThumbnailPipeline::CaptureResult::Recorded);
+	CHECK(recording.getNumSamples() >= samples(300));
+	CHECK(recording.getNumSamples() < samples(400));
+}
+
+TEST_CASE("thumbnail pipeline captures the note and trims silence") {
+	SimulatedSynth synth({ { "patch", 0, 500 } });
+	ThumbnailPipeline pipeline(fastOptions(), synth, synth, [](std::string const&) { return File(); }, nullptr);
+	auto never = []() { return false; };
+
+	REQUIRE(synth.sendNextPatch(true) == "patch");
+	AudioBuffer<float> recording;
+	CHECK(pipeline.capture(recording, never) == ThumbnailPipeline::CaptureResult::Recorded);
+	CHECK(synth.notesPlayed() == 1);
+	CHECK(recording.getNumSamples() >= samples(500));
+	CHECK(recording.getNumSamples() < samples(600));
+}
+
+TEST_CASE("thumbnail pipeline reports missing signal and caps drones") {
+	auto never = []() { return false; };
+
+	SUBCASE("no signal") {
+		SimulatedSynth synth({ { "silent", 0, 0 } });
+		ThumbnailPipeline pipeline(fastOptions(), synth, synth, [](std::string const&) { return File(); }, nullptr);
+		REQUIRE(synth.sendNextPatch(true) == "silent");
+		AudioBuffer<float> recording;
+		CHECK(pipeline.capture(recording, never) == ThumbnailPipeline::CaptureResult::NoSignal);
+	}
+
+	SUBCASE("drone") {
+		SimulatedSynth synth({ { "drone", 0, -1 } });
+		auto options = fastOptions();
+		ThumbnailPipeline pipeline(options, synth, synth, [](std::string const&) { return File(); }, nullptr);
+		REQUIRE(synth.sendNextPatch(true) == "drone");
+		AudioBuffer<float> recording;
+		CHECK(pipeline.capture(recording, never) == ThumbnailPipeline::CaptureResult::NeverEnding);
+		CHECK(recording.getNumSamples() >= samples(options.maxRecordingMs));
+	}
+
+	SUBCASE("cancel") {
+		SimulatedSynth synth({ { "patch", 0, 500 } });
+		synth.setDeaf(true);
+		ThumbnailPipeline pipeline(fastOptions(), synth, synth, [](std::string const&) { return File(); }, nullptr);
+		REQUIRE(synth.sendNextPatch(true) == "patch");
+		AudioBuffer<float> recording;
+		CHECK(pipeline.capture(recording, []() { return true; }) == ThumbnailPipeline::CaptureResult::Aborted);
+	}
+}
+
+TEST_CASE("thumbnail pipeline records a bank and encodes all files") {
+	auto directory = File::getSpecialLocation(File::tempDirectory).getChildFile("thumbnail_pipeline_" + Uuid().toString());
+	REQUIRE(directory.createDirectory());
+
+	std::vector<SimulatedPatch> bank;
+	for (int i = 0; i < 12; i++) {
+		bank.push_back({ "md5-" + std::to_string(i), (i % 3) * 50, 200 + i * 10 });
+	}
+	SimulatedSynth synth(bank);
+
+	EncodedFiles encoded;
+	std::atomic<double> lastProgress(0.0);
+	{
+		ThumbnailPipeline pipeline(fastOptions(), synth, synth,
+			[directory](std::string const& md5) { return directory.getChildFile(md5 + ".wav"); },
+			[&encoded](std::string const& md5, File const& file) {
+				std::lock_guard<std::mutex> guard(encoded.lock);
+				encoded.files[md5] = file;
+			});
+		auto result = pipeline.run((int)bank.size(), []() { return false; }, [&lastProgress](double progress) { lastProgress = progress; });
+		CHECK(result.sent == (int)bank.size());
+		CHECK(result.recorded == (int)bank.size());
+		CHECK(result.encoded == (int)bank.size());
+		CHECK(result.encodeFailed == 0);
+		CHECK_FALSE(result.noSignal);
+	}
+	CHECK(lastProgress == doctest::Approx(1.0));
+
+	REQUIRE(encoded.files.size() == bank.size());
+	WavAudioFormat wav;
+	for (auto const& patch : bank) {
+		auto file = directory.getChildFile(patch.md5 + ".wav");
+		REQUIRE(file.existsAsFile());
+		std::unique_ptr<AudioFormatReader> reader(wav.createReaderFor(file.createInputStream().release(), true));
+		REQUIRE(reader);
+		CHECK(reader->sampleRate == kSampleRate);
+		CHECK(reader->lengthInSamples >= samples(patch.noteMs));
+	}
+	directory.deleteRecursively();
+}
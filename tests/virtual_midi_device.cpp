@@ -0,0 +1,223 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "virtual_midi_device.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace test_helpers {
+
+VirtualMidiScript::VirtualMidiScript(std::vector<MidiMessage> recorded, Replay replay) : recorded_(std::move(recorded)), replay_(replay)
+{
+}
+
+VirtualMidiScript VirtualMidiScript::fromSyxFile(File const& syxFile, Replay replay)
+{
+	MemoryBlock data;
+	if (!syxFile.loadFileAsData(data)) {
+		jassertfalse;
+		return {};
+	}
+	return VirtualMidiScript(splitSysex(data), replay);
+}
+
+std::vector<MidiMessage> VirtualMidiScript::splitSysex(MemoryBlock const& data)
+{
+	std::vector<MidiMessage> result;
+	auto bytes = static_cast<uint8 const*>(data.getData());
+	size_t size = data.getSize();
+	size_t start = 0;
+	while (start < size) {
+		if (bytes[start] != 0xf0) {
+			start++;
+			continue;
+		}
+		size_t end = start + 1;
+		while (end < size && bytes[end] != 0xf7) {
+			end++;
+		}
+		if (end >= size) {
+			break;
+		}
+		result.emplace_back(bytes + start, (int)(end - start + 1));
+		start = end + 1;
+	}
+	return result;
+}
+
+void VirtualMidiScript::expect(std::vector<uint8> const& request, std::vector<MidiMessage> const& replies)
+{
+	rules_.push_back({ request, replies });
+}
+
+std::vector<MidiMessage> VirtualMidiScript::respond(MidiMessage const& request)
+{
+	auto raw = request.getRawData();
+	auto size = (size_t)request.getRawDataSize();
+	for (auto const& rule : rules_) {
+		if (rule.request.size() == size && std::memcmp(rule.request.data(), raw, size) == 0) {
+			return rule.replies;
+		}
+	}
+
+	if (!request.isSysEx()) {
+		// Program changes, bank selects and the like are just state changes for the synth
+		return {};
+	}
+
+	if (next_ < recorded_.size()) {
+		if (replay_ == Replay::WholeFilePerRequest) {
+			std::vector<MidiMessage> replies(recorded_.begin() + (long)next_, recorded_.end());
+			next_ = recorded_.size();
+			return replies;
+		}
+		return { recorded_[next_++] };
+	}
+	unmatched_.push_back(request);
+	return {};
+}
+
+VirtualMidiDevice::VirtualMidiDevice(VirtualMidiScript script, Timing timing, TReplyHandler replyHandler) :
+	Thread("VirtualMidiDevice"), script_(std::move(script)), timing_(timing), replyHandler_(replyHandler), idle_(true), lineBusyUntilMs_(0.0),
+	requestsReceived_(0), repliesSent_(0)
+{
+	idle_.signal();
+	startThread();
+}
+
+VirtualMidiDevice::~VirtualMidiDevice()
+{
+	signalThreadShouldExit();
+	wakeUp_.signal();
+	stopThread(1000);
+}
+
+void VirtualMidiDevice::receive(MidiMessage const& request)
+{
+	requestsReceived_++;
+	ScopedLock lock(lock_);
+	auto replies = script_.respond(request);
+	if (replies.empty()) {
+		return;
+	}
+
+	// Replies start after the latency, and can't start before the previous replies have left the wire
+	double now = Time::getMillisecondCounterHiRes();
+	double due = std::max(now + timing_.latencyMs, lineBusyUntilMs_);
+	for (auto const& reply : replies) {
+		due += transmissionMs(reply);
+		queue_.push_back({ due, reply });
+	}
+	lineBusyUntilMs_ = due;
+	idle_.reset();
+	wakeUp_.signal();
+}
+
+bool VirtualMidiDevice::waitUntilIdle(int timeoutMs)
+{
+	return idle_.wait((double)timeoutMs);
+}
+
+std::vector<MidiMessage> VirtualMidiDevice::unmatchedRequests() const
+{
+	ScopedLock lock(lock_);
+	return script_.unmatchedRequests();
+}
+
+double VirtualMidiDevice::transmissionMs(MidiMessage const& message) const
+{
+	if (timing_.bytesPerSecond <= 0) {
+		return 0.0;
+	}
+	return message.getRawDataSize() * 1000.0 / timing_.bytesPerSecond;
+}
+
+void VirtualMidiDevice::run()
+{
+	while (!threadShouldExit()) {
+		Scheduled next{ 0.0, MidiMessage() };
+		bool hasNext = false;
+		{
+			ScopedLock lock(lock_);
+			if (!queue_.empty()) {
+				next = queue_.front();
+				hasNext = true;
+			}
+			else {
+				idle_.signal();
+			}
+		}
+		if (!hasNext) {
+			wakeUp_.wait(100.0);
+			continue;
+		}
+
+		double waitMs = next.dueMs - Time::getMillisecondCounterHiRes();
+		if (waitMs > 0.0) {
+			// Wake up early for a new request, which might not change the front though
+			wakeUp_.wait(std::max(1.0, waitMs));
+			continue;
+		}
+
+		{
+			ScopedLock lock(lock_);
+			queue_.pop_front();
+		}
+		replyHandler_(next.message);
+		repliesSent_++;
+	}
+}
+
+VirtualMidiPort::VirtualMidiPort(String const& name, VirtualMidiScript script, VirtualMidiDevice::Timing timing)
+{
+	toApplication_ = MidiOutput::createNewDevice(name);
+	device_ = std::make_unique<VirtualMidiDevice>(std::move(script), timing, [this](MidiMessage const& reply) {
+		if (toApplication_) {
+			toApplication_->sendMessageNow(reply);
+		}
+	});
+	fromApplication_ = MidiInput::createNewDevice(name, this);
+	if (fromApplication_) {
+		fromApplication_->start();
+	}
+}
+
+VirtualMidiPort::~VirtualMidiPort()
+{
+	if (fromApplication_) {
+		fromApplication_->stop();
+	}
+	fromApplication_.reset();
+	device_.reset();
+}
+
+bool VirtualMidiPort::isSupported()
+{
+#if JUCE_WINDOWS
+	return false;
+#else
+	return true;
+#endif
+}
+
+String VirtualMidiPort::inputName() const
+{
+	// Our output is what the application receives from
+	return toApplication_ ? toApplication_->getName() : String();
+}
+
+String VirtualMidiPort::outputName() const
+{
+	return fromApplication_ ? fromApplication_->getName() : String();
+}
+
+void VirtualMidiPort::handleIncomingMidiMessage(MidiInput*, MidiMessage const& message)
+{
+	device_->receive(message);
+}
+
+} // namespace test_helpers
@@ -0,0 +1,123 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace test_helpers {
+
+// Request/response script of a simulated synth, the C++ counterpart of the ScriptedMockDevice in adaptations/testing/mock_midi.py.
+// Replies are either registered for exact requests, or replayed from a recorded .syx file.
+class VirtualMidiScript {
+public:
+	enum class Replay {
+		WholeFilePerRequest, // A bank dump request is answered with the complete file
+		OneMessagePerRequest // Every request gets the next message of the file, as for program dumps or edit buffer requests
+	};
+
+	VirtualMidiScript() = default;
+	VirtualMidiScript(std::vector<MidiMessage> recorded, Replay replay);
+	static VirtualMidiScript fromSyxFile(File const& syxFile, Replay replay);
+	static std::vector<MidiMessage> splitSysex(MemoryBlock const& data);
+
+	void expect(std::vector<uint8> const& request, std::vector<MidiMessage> const& replies);
+
+	// Returns the replies for the request, program changes and other short messages are silently swallowed
+	std::vector<MidiMessage> respond(MidiMessage const& request);
+
+	size_t recordedMessages() const { return recorded_.size(); }
+	std::vector<MidiMessage> const& unmatchedRequests() const { return unmatched_; }
+
+private:
+	struct Rule {
+		std::vector<uint8> request;
+		std::vector<MidiMessage> replies;
+	};
+
+	std::vector<Rule> rules_;
+	std::vector<MidiMessage> recorded_;
+	Replay replay_ = Replay::OneMessagePerRequest;
+	size_t next_ = 0;
+	std::vector<MidiMessage> unmatched_;
+};
+
+// A simulated synth answering according to a VirtualMidiScript. Replies are delivered from a worker thread after the configured
+// latency and paced to the configured bandwidth, so timing behaves like a real MIDI DIN connection.
+class VirtualMidiDevice : private Thread {
+public:
+	struct Timing {
+		int latencyMs = 0; // Processing time of the synth before it starts replying
+		int bytesPerSecond = 3125; // 31250 baud with 10 bits per byte, 0 for unlimited
+	};
+
+	typedef std::function<void(MidiMessage const&)> TReplyHandler;
+
+	VirtualMidiDevice(VirtualMidiScript script, Timing timing, TReplyHandler replyHandler);
+	~VirtualMidiDevice() override;
+
+	// Deliver a message sent by the application to the device, any thread
+	void receive(MidiMessage const& request);
+
+	// Wait until all scheduled replies have been delivered
+	bool waitUntilIdle(int timeoutMs);
+
+	int requestsReceived() const { return requestsReceived_; }
+	int repliesSent() const { return repliesSent_; }
+	std::vector<MidiMessage> unmatchedRequests() const;
+
+private:
+	struct Scheduled {
+		double dueMs;
+		MidiMessage message;
+	};
+
+	void run() override;
+	double transmissionMs(MidiMessage const& message) const;
+
+	VirtualMidiScript script_;
+	Timing timing_;
+	TReplyHandler replyHandler_;
+	CriticalSection lock_;
+	WaitableEvent wakeUp_;
+	WaitableEvent idle_;
+	std::deque<Scheduled> queue_;
+	double lineBusyUntilMs_;
+	std::atomic<int> requestsReceived_;
+	std::atomic<int> repliesSent_;
+};
+
+// Exposes a VirtualMidiDevice as a pair of operating system level virtual MIDI ports of the given name. The MidiController and
+// everything above it, e.g. the Librarian, then talk to it exactly as to a real synth. Not available on Windows.
+class VirtualMidiPort : private MidiInputCallback {
+public:
+	VirtualMidiPort(String const& name, VirtualMidiScript script, VirtualMidiDevice::Timing timing);
+	~VirtualMidiPort() override;
+
+	static bool isSupported();
+	bool isValid() const { return toApplication_ != nullptr && fromApplication_ != nullptr; }
+
+	// The port names as seen by the application
+	String inputName() const;
+	String outputName() const;
+
+	VirtualMidiDevice& device() { return *device_; }
+
+private:
+	void handleIncomingMidiMessage(MidiInput* source, MidiMessage const& message) override;
+
+	std::unique_ptr<MidiOutput> toApplication_;
+	std::unique_ptr<VirtualMidiDevice> device_;
+	std::unique_ptr<MidiInput> fromApplication_;
+};
+
+} // namespace test_helpers
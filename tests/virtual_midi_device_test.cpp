@@ -0,0 +1,113 @@
+/*
+   Copyright (c) 2026 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "doctest/doctest.h"
+
+#include "virtual_midi_device.h"
+
+#include <mutex>
+#include <vector>
+
+namespace {
+
+MidiMessage sysex(std::vector<uint8> const& body) {
+	return MidiMessage::createSysExMessage(body.data(), (int)body.size());
+}
+
+MemoryBlock syxFile(std::vector<MidiMessage> const& messages) {
+	MemoryBlock data;
+	for (auto const& message : messages) {
+		data.append(message.getRawData(), (size_t)message.getRawDataSize());
+	}
+	return data;
+}
+
+struct Received {
+	std::mutex lock;
+	std::vector<std::pair<double, MidiMessage>> messages;
+
+	test_helpers::VirtualMidiDevice::TReplyHandler handler() {
+		return [this](MidiMessage const& message) {
+			std::lock_guard<std::mutex> guard(lock);
+			messages.emplace_back(Time::getMillisecondCounterHiRes(), message);
+		};
+	}
+};
+
+} // namespace
+
+TEST_CASE("virtual midi script splits recorded syx files") {
+	auto data = syxFile({ sysex({ 0x01, 0x02 }), sysex({ 0x03 }), sysex({ 0x04, 0x05, 0x06 }) });
+	// Garbage between messages and an unterminated tail are skipped, as in a sloppy recording
+	uint8 garbage[] = { 0x00, 0xf0, 0x7f };
+	data.append(garbage, sizeof(garbage));
+
+	TemporaryFile file(".syx");
+	REQUIRE(file.getFile().replaceWithData(data.getData(), data.getSize()));
+	auto script = test_helpers::VirtualMidiScript::fromSyxFile(file.getFile(), test_helpers::VirtualMidiScript::Replay::OneMessagePerRequest);
+	CHECK(script.recordedMessages() == 3);
+}
+
+TEST_CASE("virtual midi script replays by request") {
+	std::vector<MidiMessage> recorded = { sysex({ 0x10 }), sysex({ 0x11 }), sysex({ 0x12 }) };
+
+	SUBCASE("one message per request") {
+		test_helpers::VirtualMidiScript script(recorded, test_helpers::VirtualMidiScript::Replay::OneMessagePerRequest);
+		CHECK(script.respond(MidiMessage::programChange(1, 5)).empty());
+		for (auto const& expected : recorded) {
+			auto replies = script.respond(sysex({ 0x42 }));
+			REQUIRE(replies.size() == 1);
+			CHECK(replies[0].getSysExDataSize() == expected.getSysExDataSize());
+			CHECK(replies[0].getSysExData()[0] == expected.getSysExData()[0]);
+		}
+		CHECK(script.respond(sysex({ 0x42 })).empty());
+		CHECK(script.unmatchedRequests().size() == 1);
+	}
+
+	SUBCASE("whole file per request") {
+		test_helpers::VirtualMidiScript script(recorded, test_helpers::VirtualMidiScript::Replay::WholeFilePerRequest);
+		CHECK(script.respond(sysex({ 0x42 })).size() == 3);
+		CHECK(script.respond(sysex({ 0x42 })).empty());
+	}
+
+	SUBCASE("exact requests take precedence") {
+		test_helpers::VirtualMidiScript script(recorded, test_helpers::VirtualMidiScript::Replay::OneMessagePerRequest);
+		auto identity = sysex({ 0x7e, 0x00, 0x06, 0x01 });
+		script.expect(std::vector<uint8>(identity.getRawData(), identity.getRawData() + identity.getRawDataSize()), { sysex({ 0x7e, 0x00, 0x06, 0x02 }) });
+		auto replies = script.respond(identity);
+		REQUIRE(replies.size() == 1);
+		CHECK(replies[0].getSysExData()[3] == 0x02);
+		CHECK(script.respond(sysex({ 0x42 })).size() == 1);
+	}
+}
+
+TEST_CASE("virtual midi device honours latency and bandwidth") {
+	std::vector<MidiMessage> recorded;
+	std::vector<uint8> body(98, 0x01);
+	for (int i = 0; i < 4; i++) {
+		recorded.push_back(sysex(body)); // 100 bytes each on the wire
+	}
+
+	Received received;
+	test_helpers::VirtualMidiDevice::Timing timing;
+	timing.latencyMs = 50;
+	timing.bytesPerSecond = 10000; // 10 ms per message
+	test_helpers::VirtualMidiDevice device(test_helpers::VirtualMidiScript(recorded, test_helpers::VirtualMidiScript::Replay::WholeFilePerRequest), timing, received.handler());
+
+	double start = Time::getMillisecondCounterHiRes();
+	device.receive(sysex({ 0x42 }));
+	REQUIRE(device.waitUntilIdle(5000));
+
+	CHECK(device.requestsReceived() == 1);
+	CHECK(device.repliesSent() == 4);
+	std::lock_guard<std::mutex> guard(received.lock);
+	REQUIRE(received.messages.size() == 4);
+	CHECK(received.messages.front().first - start >= 50.0 + 10.0 - 1.0);
+	CHECK(received.messages.back().first - start >= 50.0 + 40.0 - 1.0);
+	for (size_t i = 1; i < received.messages.size(); i++) {
+		CHECK(received.messages[i].first >= received.messages[i - 1].first);
+	}
+}